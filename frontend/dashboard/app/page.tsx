@@ -2,11 +2,17 @@
 
 import { useEffect, useState, useRef } from "react";
 import { start } from "repl";
+import LiveChart from "./LiveChart";
+
+const MAX_OUTPUT_LINES = 500; // older terminal lines are dropped
 
 export default function Home() {
   const [command, setCommand] = useState(""); // Stores the current command input
   const [output, setOutput] = useState<string[]>([]); // Stores the terminal output
   const flaskUrl = process.env.NEXT_PUBLIC_FLASK_URL; // Flask API URL
+  const ingestUrl = process.env.NEXT_PUBLIC_INGEST_URL; // ingest_run.py, for live charts
+  const [liveTarget, setLiveTarget] = useState("board1/lsm6dsl"); // <board>/<sensor> to chart
+  const [liveDraft, setLiveDraft] = useState(liveTarget); // reconnects only on Enter or blur
 
   const outputRef = useRef<HTMLDivElement>(null); // Ref to track the output container
 
@@ -43,7 +49,7 @@ export default function Home() {
     if (!command.trim()) return;
 
     // Add the command to the output
-    setOutput((prev) => [...prev, `> ${command}`]);    
+    setOutput((prev) => [...prev, `> ${command}`].slice(-MAX_OUTPUT_LINES));
 
     console.log("command is ", command);
     try {
@@ -60,7 +66,7 @@ export default function Home() {
 
       // Add the response to the output
       if (data.response) {
-        setOutput((prev) => [...prev, data.response]);
+        setOutput((prev) => [...prev, data.response].slice(-MAX_OUTPUT_LINES));
       } else {
         setOutput((prev) => [...prev, "Error: No response from server"]);
       }
@@ -119,6 +125,25 @@ export default function Home() {
           </button>
         </form>
       </div>
+      <div className="w-2xl mt-4">
+        {ingestUrl ? (
+          <>
+            <input
+              type="text"
+              className="w-full bg-black text-white border border-gray-700 rounded-lg p-2 mb-2 focus:outline-none"
+              placeholder="<board>/<sensor>"
+              value={liveDraft}
+              onChange={(e) => setLiveDraft(e.target.value)}
+              onBlur={() => setLiveTarget(liveDraft)}
+              onKeyDown={(e) => e.key === "Enter" && setLiveTarget(liveDraft)}
+            />
+            <LiveChart source={{ kind: "sse", url: `${ingestUrl}/live/${liveTarget}` }} />
+          </>
+        ) : (
+          // No ingestion service configured: six 100 Hz test channels
+          <LiveChart source={{ kind: "synthetic", channels: 6, rate: 100 }} />
+        )}
+      </div>
     </div>
   );
 }
\ No newline at end of file
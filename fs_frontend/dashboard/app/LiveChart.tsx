@@ -0,0 +1,157 @@
+'use client'
+
+import { useEffect, useRef, useState } from "react";
+import type { LiveSource, WorkerReply } from "./liveChart.worker";
+
+type Frame = Extract<WorkerReply, { type: "frame" }>;
+
+const COLORS = ["#f87171", "#4ade80", "#60a5fa", "#facc15", "#c084fc", "#2dd4bf", "#fb923c"];
+
+interface LiveChartProps {
+  source: LiveSource;
+  windowSec?: number;  // visible time span
+  capacity?: number;   // samples kept per channel, must cover windowSec at the stream rate
+  height?: number;
+}
+
+// Live multi-channel chart. Samples never enter React state: the worker
+// holds them and answers each animation frame with one min/max pair per
+// pixel column, which is drawn straight onto the canvas.
+export default function LiveChart({ source, windowSec = 10, capacity = 1 << 14, height = 240 }: LiveChartProps) {
+  const canvasRef = useRef<HTMLCanvasElement>(null);
+  const statsRef = useRef<HTMLSpanElement>(null);
+  const [fields, setFields] = useState<string[]>([]);
+  const [status, setStatus] = useState("starting");
+  const sourceKey = JSON.stringify(source);
+
+  useEffect(() => {
+    const canvas = canvasRef.current;
+    const ctx = canvas?.getContext("2d");
+    if (!canvas || !ctx) return;
+
+    const worker = new Worker(new URL("./liveChart.worker.ts", import.meta.url));
+    let latest: Frame | null = null;
+    let pending = false;
+    let nextId = 0;
+    let raf = 0;
+    let fps = 0;
+    let frames = 0;
+    let fpsSince = performance.now();
+    let yMin = -1;
+    let yMax = 1;
+
+    worker.onmessage = (e: MessageEvent<WorkerReply>) => {
+      const msg = e.data;
+      if (msg.type === "frame") {
+        latest = msg;
+        pending = false;
+      } else if (msg.type === "meta") {
+        setFields(msg.fields);
+      } else {
+        setStatus(msg.text);
+      }
+    };
+    worker.postMessage({ type: "connect", source: JSON.parse(sourceKey), capacity });
+
+    const draw = (f: Frame, w: number, h: number) => {
+      const { columns, channels, width } = f;
+
+      // Y range follows the data, widening at once and narrowing slowly
+      let lo = Infinity;
+      let hi = -Infinity;
+      for (let i = 0; i < columns.length; i += 2) {
+        if (columns[i] < lo) lo = columns[i];
+        if (columns[i + 1] > hi) hi = columns[i + 1];
+      }
+      if (lo <= hi) {
+        const pad = (hi - lo) * 0.05 || 1;
+        yMin = lo - pad < yMin ? lo - pad : yMin + (lo - pad - yMin) * 0.05;
+        yMax = hi + pad > yMax ? hi + pad : yMax + (hi + pad - yMax) * 0.05;
+      }
+      const sy = h / (yMax - yMin);
+
+      ctx.clearRect(0, 0, w, h);
+      ctx.strokeStyle = "#374151";
+      ctx.lineWidth = 1;
+      ctx.beginPath();
+      const zero = h - (0 - yMin) * sy;
+      ctx.moveTo(0, zero);
+      ctx.lineTo(w, zero);
+      ctx.stroke();
+
+      for (let c = 0; c < channels; c++) {
+        ctx.strokeStyle = COLORS[c % COLORS.length];
+        ctx.beginPath();
+        let open = false;
+        for (let x = 0; x < width; x++) {
+          const at = (c * width + x) * 2;
+          const min = columns[at];
+          if (min !== min) { // NaN: no samples in this column
+            open = false;
+            continue;
+          }
+          const yTop = h - (columns[at + 1] - yMin) * sy;
+          const yBottom = h - (min - yMin) * sy;
+          // One vertical stroke per column covers every sample in it
+          if (open) {
+            ctx.lineTo(x + 0.5, yTop);
+          } else {
+            ctx.moveTo(x + 0.5, yTop);
+          }
+          ctx.lineTo(x + 0.5, yBottom + 0.5);
+          open = true;
+        }
+        ctx.stroke();
+      }
+    };
+
+    const tick = (now: number) => {
+      const dpr = window.devicePixelRatio || 1;
+      const w = Math.floor(canvas.clientWidth * dpr);
+      const h = Math.floor(canvas.clientHeight * dpr);
+      if (canvas.width !== w || canvas.height !== h) {
+        canvas.width = w;
+        canvas.height = h;
+      }
+      if (latest) {
+        draw(latest, w, h);
+      }
+      // One request in flight at a time, so a slow worker cannot queue frames up
+      if (!pending) {
+        pending = true;
+        worker.postMessage({ type: "frame", id: nextId++, width: w, windowMs: windowSec * 1000 });
+      }
+
+      frames++;
+      if (now - fpsSince >= 1000) {
+        fps = (frames * 1000) / (now - fpsSince);
+        frames = 0;
+        fpsSince = now;
+        if (statsRef.current && latest) {
+          statsRef.current.textContent =
+            `${fps.toFixed(0)} fps, ${latest.samplesPerSec.toFixed(0)} samples/s`;
+        }
+      }
+      raf = requestAnimationFrame(tick);
+    };
+    raf = requestAnimationFrame(tick);
+
+    return () => {
+      cancelAnimationFrame(raf);
+      worker.postMessage({ type: "close" });
+      worker.terminate();
+    };
+  }, [sourceKey, windowSec, capacity]);
+
+  return (
+    <div className="w-full border border-gray-700 rounded-lg p-2 bg-gray-900">
+      <div className="flex flex-wrap gap-3 text-xs mb-1">
+        {fields.map((name, c) => (
+          <span key={name} style={{ color: COLORS[c % COLORS.length] }}>{name}</span>
+        ))}
+        <span className="ml-auto text-gray-400">{status} · <span ref={statsRef} /></span>
+      </div>
+      <canvas ref={canvasRef} className="w-full block" style={{ height }} />
+    </div>
+  );
+}
@@ -0,0 +1,171 @@
+// Ingest side of LiveChart: receives samples off the main thread, keeps them
+// in preallocated ring buffers and reduces the visible window to one min/max
+// pair per pixel column, so the page only ever handles `width` points per
+// channel no matter how fast the board streams.
+
+export type LiveSource =
+  | { kind: "sse"; url: string }
+  | { kind: "synthetic"; channels: number; rate: number };
+
+export type WorkerRequest =
+  | { type: "connect"; source: LiveSource; capacity: number }
+  | { type: "frame"; id: number; width: number; windowMs: number }
+  | { type: "close" };
+
+export type WorkerReply =
+  | { type: "meta"; fields: string[] }
+  | { type: "status"; text: string }
+  | {
+      type: "frame";
+      id: number;
+      width: number;
+      channels: number;
+      endMs: number;
+      // channels x width x [min, max], NaN where a column has no samples
+      columns: Float32Array;
+      samplesPerSec: number;
+    };
+
+type SseBatch = { fields: string[]; t: number[]; v: number[][] };
+
+let capacity = 0;
+let channels = 0;
+let times = new Float64Array(0);
+let values = new Float32Array(0); // channel-major: values[c * capacity + i]
+let head = 0; // next slot to write
+let count = 0;
+
+let received = 0;
+let rateSince = 0;
+let samplesPerSec = 0;
+
+let source: EventSource | null = null;
+let timer: ReturnType<typeof setInterval> | null = null;
+
+const post = (msg: WorkerReply, transfer: Transferable[] = []) =>
+  (self as unknown as Worker).postMessage(msg, transfer);
+
+function allocate(fields: string[]) {
+  channels = fields.length;
+  times = new Float64Array(capacity);
+  values = new Float32Array(capacity * channels);
+  head = 0;
+  count = 0;
+  post({ type: "meta", fields });
+}
+
+function push(t: number[], v: number[][]) {
+  const n = t.length;
+  for (let i = 0; i < n; i++) {
+    times[head] = t[i];
+    for (let c = 0; c < channels; c++) {
+      values[c * capacity + head] = v[c][i];
+    }
+    head = head + 1 === capacity ? 0 : head + 1;
+  }
+  count = Math.min(capacity, count + n);
+
+  received += n;
+  const now = performance.now();
+  if (now - rateSince >= 1000) {
+    samplesPerSec = (received * 1000) / (now - rateSince);
+    received = 0;
+    rateSince = now;
+  }
+}
+
+// Index (0 = oldest) of the first sample at or after t, samples are in time order
+function firstAtOrAfter(t: number): number {
+  const oldest = head - count < 0 ? head - count + capacity : head - count;
+  let lo = 0;
+  let hi = count;
+  while (lo < hi) {
+    const mid = (lo + hi) >> 1;
+    if (times[(oldest + mid) % capacity] < t) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  return lo;
+}
+
+function frame(id: number, width: number, windowMs: number) {
+  width = Math.max(1, Math.floor(width));
+  const columns = new Float32Array(channels * width * 2).fill(NaN);
+  const newest = (head - 1 + capacity) % capacity;
+  const endMs = count ? times[newest] : 0;
+  const startMs = endMs - windowMs;
+  const oldest = head - count < 0 ? head - count + capacity : head - count;
+  const scale = width / windowMs;
+
+  for (let k = count ? firstAtOrAfter(startMs) : count; k < count; k++) {
+    const i = (oldest + k) % capacity;
+    const col = Math.min(width - 1, Math.floor((times[i] - startMs) * scale));
+    for (let c = 0; c < channels; c++) {
+      const v = values[c * capacity + i];
+      const at = (c * width + col) * 2;
+      // NaN compares false, so the first sample of a column sets both ends
+      if (!(columns[at] <= v)) columns[at] = v;
+      if (!(columns[at + 1] >= v)) columns[at + 1] = v;
+    }
+  }
+  post({ type: "frame", id, width, channels, endMs, columns, samplesPerSec }, [columns.buffer]);
+}
+
+function connectSse(url: string) {
+  source = new EventSource(url);
+  source.onopen = () => post({ type: "status", text: "connected" });
+  source.onerror = () => post({ type: "status", text: "reconnecting" });
+  source.onmessage = (e) => {
+    const batch: SseBatch = JSON.parse(e.data);
+    if (batch.fields.length !== channels) {
+      allocate(batch.fields);
+    }
+    push(batch.t, batch.v);
+  };
+}
+
+// Sine waves plus noise at a fixed rate, to try the chart without a board
+function startSynthetic(n: number, rate: number) {
+  allocate(Array.from({ length: n }, (_, c) => `ch${c}`));
+  post({ type: "status", text: `synthetic ${n} x ${rate} Hz` });
+  const period = 1000 / rate;
+  let next = Date.now();
+  timer = setInterval(() => {
+    const t: number[] = [];
+    for (const now = Date.now(); next <= now; next += period) {
+      t.push(next);
+    }
+    const v = Array.from({ length: n }, (_, c) =>
+      t.map((ms) => Math.sin((ms / 1000) * (c + 1) * 0.7) * (c + 1) + (Math.random() - 0.5) * 0.2),
+    );
+    push(t, v);
+  }, 10);
+}
+
+function close() {
+  source?.close();
+  source = null;
+  if (timer) clearInterval(timer);
+  timer = null;
+}
+
+self.onmessage = (e: MessageEvent<WorkerRequest>) => {
+  const msg = e.data;
+  if (msg.type === "connect") {
+    close();
+    capacity = msg.capacity;
+    rateSince = performance.now();
+    if (msg.source.kind === "sse") {
+      allocate([]);
+      connectSse(msg.source.url);
+    } else {
+      startSynthetic(msg.source.channels, msg.source.rate);
+    }
+  } else if (msg.type === "frame") {
+    frame(msg.id, msg.width, msg.windowMs);
+  } else {
+    close();
+  }
+};
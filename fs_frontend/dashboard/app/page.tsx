@@ -2,6 +2,9 @@
 
 import React, { useEffect, useState, useRef, PropsWithChildren } from "react";
 import FileExplorer from './FileExplorer'; // Import the new FileExplorer component
+import LiveChart from './LiveChart';
+
+const MAX_OUTPUT_LINES = 500; // older terminal lines are dropped
 
 // An ErrorBoundary component to catch errors in child components
 class ErrorBoundary extends React.Component<PropsWithChildren<{}>> {
@@ -139,6 +142,9 @@ export default function Home() {
   const [activeTab, setActiveTab] = useState("terminal"); // New state for active tab
   const [guiView, setGuiView] = useState("dashboard"); // New state for the GUI sub-view
   const flaskUrl = "http://127.0.0.1:5000";
+  const ingestUrl = "http://127.0.0.1:8080"; // ingest_run.py, for live charts
+  const [liveTarget, setLiveTarget] = useState("synthetic"); // <board>/<sensor>, or synthetic test data
+  const [liveDraft, setLiveDraft] = useState(liveTarget); // reconnects only on Enter or blur
 
   const outputRef = useRef<HTMLDivElement>(null);
   const localCommands = ["clear", "ping"]; // 'read' is now handled by the server
@@ -210,7 +216,7 @@ export default function Home() {
       return;
     }
 
-    setOutput((prev) => [...prev, `> ${commandToExecute}`]);
+    setOutput((prev) => [...prev, `> ${commandToExecute}`].slice(-MAX_OUTPUT_LINES));
 
     try {
       const response = await fetch(`${flaskUrl}/process_command`, {
@@ -224,7 +230,7 @@ export default function Home() {
       const data = await response.json();
 
       if (data.response) {
-        setOutput((prev) => [...prev, data.response]);
+        setOutput((prev) => [...prev, data.response].slice(-MAX_OUTPUT_LINES));
       } else {
         setOutput((prev) => [...prev, "Error: No response from server"]);
       }
@@ -261,6 +267,14 @@ export default function Home() {
           >
             GUI
           </button>
+          <button
+            onClick={() => setActiveTab("live")}
+            className={`flex-1 py-2 px-4 transition-colors ${
+              activeTab === "live" ? "bg-gray-800 text-white font-bold" : "text-gray-400 hover:bg-gray-800"
+            }`}
+          >
+            Live Chart
+          </button>
           <button
             onClick={() => setActiveTab("file-explorer")}
             className={`flex-1 py-2 px-4 rounded-r-lg transition-colors ${
@@ -299,6 +313,25 @@ export default function Home() {
               </div>
             </div>
           )}
+          {activeTab === "live" && (
+            <div className="h-full flex flex-col">
+              <input
+                type="text"
+                className="w-full bg-black text-white border border-gray-700 rounded-lg p-2 mb-2 focus:outline-none"
+                placeholder="<board>/<sensor> or synthetic"
+                value={liveDraft}
+                onChange={(e) => setLiveDraft(e.target.value)}
+                onBlur={() => setLiveTarget(liveDraft)}
+                onKeyDown={(e) => e.key === "Enter" && setLiveTarget(liveDraft)}
+              />
+              <LiveChart
+                height={400}
+                source={liveTarget === "synthetic"
+                  ? { kind: "synthetic", channels: 6, rate: 100 }
+                  : { kind: "sse", url: `${ingestUrl}/live/${liveTarget}` }}
+              />
+            </div>
+          )}
           {activeTab === "file-explorer" && <FileExplorer />}
         </div>
       </div>
@@ -0,0 +1,30 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include "sensors.h"
+#include "stats.h"
+
+#ifndef DEADBAND_H
+#define DEADBAND_H
+
+// Change-triggered logging for periodic sessions. With a deadband configured a
+// sample is only emitted when one of its axes moved further than
+// max(abs, rel * |last emitted value|) away from the last emitted sample, or
+// when the heartbeat interval ran out since the last emit. Settings are per
+// sensor and sink; every session keeps its own reference, so two sessions of
+// one sensor at different rates do not suppress each other.
+
+struct deadband_ref {
+    bool have_ref;
+    uint32_t generation; // settings version the reference was taken under
+    int64_t last_emit_ms;
+    struct sensor_sample sample; // last sample that was emitted
+};
+
+// Forget the last emitted sample so the next one always goes out
+void deadband_restart(struct deadband_ref *ref);
+
+// Returns true when the sample should be written to the sink
+bool deadband_pass(struct deadband_ref *ref, int sensor, enum stats_sink sink,
+                   const struct sensor_sample *sample);
+
+#endif
@@ -0,0 +1,43 @@
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifndef EVENT_BUS_H
+#define EVENT_BUS_H
+
+enum motion_event_type {
+    EVENT_SINGLE_TAP = 0,
+    EVENT_DOUBLE_TAP,
+    EVENT_WAKE_UP,
+    EVENT_FREE_FALL,
+    EVENT_6D,
+    EVENT_GESTURE,      // from the classifier in gesture.c
+    EVENT_NUM_TYPES
+};
+
+struct motion_event {
+    uint32_t cycles;    // stats_now() at the interrupt, for latency accounting
+    uint32_t uptime_ms;
+    uint8_t type;
+    uint8_t detail;     // axis/direction bits from the source register, or the gesture class
+    uint8_t value;      // gesture confidence in percent
+};
+
+enum event_sink {
+    EVENT_SINK_FILE = 0,
+    EVENT_SINK_HTTP,
+    EVENT_SINK_BLE,
+    EVENT_SINK_SHELL,
+    EVENT_NUM_SINKS
+};
+
+// Every subscribed sink has its own queue and thread, so a slow sink only
+// ever delays itself. When a queue is full its oldest event is dropped.
+// target is the file name or URL, unused for BLE and shell
+int event_subscribe(enum event_sink sink, const char *target);
+void event_unsubscribe(enum event_sink sink);
+void event_publish(const struct motion_event *event);
+
+// LSM6DSL INT1 hook for the tap and motion modes, safe to call from the ISR
+void event_bus_int1(void);
+
+#endif
@@ -0,0 +1,55 @@
+#include <stdint.h>
+
+#ifndef FS_PROFILE_H
+#define FS_PROFILE_H
+
+#define FS_MOUNT_POINT "/lfs"
+
+// The profiles share one set of mount buffers, sized for the largest of them
+// so any can be tried at run time. A build that settles on a smaller profile
+// can lower these; profiles that no longer fit then fail with -ENOMEM
+#ifndef FS_PROFILE_CACHE_MAX
+#define FS_PROFILE_CACHE_MAX 512
+#endif
+#ifndef FS_PROFILE_LOOKAHEAD_MAX
+#define FS_PROFILE_LOOKAHEAD_MAX 32
+#endif
+
+// littlefs geometry the storage partition is mounted with. All of them keep
+// the on-flash format, so switching needs no reformat
+struct fs_profile {
+    const char *name;
+    const char *use;
+    uint16_t read_size;
+    uint16_t prog_size;
+    uint16_t cache_size;     // also the per-file cache
+    uint16_t lookahead_size; // bytes, 8 blocks each
+    int32_t block_cycles;    // erase cycles before a metadata block moves
+};
+
+#define FS_PROFILE_DEFAULT 0
+
+int fs_profile_count(void);
+const struct fs_profile *fs_profile_get(int index);
+int fs_profile_find(const char *name);
+int fs_profile_current(void);
+
+// (Re)mounts FS_MOUNT_POINT with the profile. Files open at the time are
+// invalid afterwards. Returns 0 or a negative errno
+int fs_profile_mount(int index);
+
+// Mounts with the profile and keeps it for the next boot
+int fs_profile_select(int index);
+
+// Held by the loggers from open to close of a file on FS_MOUNT_POINT, and by
+// fs_profile_mount across the remount, so writers wait for a profile switch
+// instead of failing against an unmounted partition. littlefs serialises its
+// calls anyway, so writers lose no parallelism. Recursive, like k_mutex
+void fs_profile_lock(void);
+void fs_profile_unlock(void);
+
+// Settings are a file on littlefs, so the board mounts with the default
+// profile first and remounts with the saved one once settings are up
+int fs_profile_restore(void);
+
+#endif
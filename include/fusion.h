@@ -0,0 +1,34 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include "sensors.h"
+
+#ifndef FUSION_H
+#define FUSION_H
+
+#define FUSION_DEFAULT_HZ 104
+#define FUSION_MAX_HZ 416
+
+// Orientation samples carry the quaternion followed by the Euler angles
+// in degrees, in the order of the orientation sensor's axes list
+#define FUSION_NUM_VALS 7
+
+enum fusion_output {
+    FUSION_OUTPUT_QUAT = 0,
+    FUSION_OUTPUT_EULER,
+    FUSION_OUTPUT_BOTH
+};
+
+// Madgwick filter fed from the LSM6DSL (accel + gyro) at imu_hz and the
+// LIS3MDL at a quarter of that. The orientation is read back through the
+// normal sensor pipeline, so any sink period works as the output rate
+int fusion_start(uint32_t imu_hz);
+void fusion_stop(void);
+bool fusion_running(void);
+
+// Latest orientation as a sample, -ENODATA until the filter has run once
+int fusion_capture(struct sensor_sample *sample);
+
+// Which part of the sample sensor_format() writes out
+enum fusion_output fusion_get_output(void);
+
+#endif
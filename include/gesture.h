@@ -0,0 +1,32 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include "imu_window.h"
+
+#ifndef GESTURE_H
+#define GESTURE_H
+
+// FEATURES of python_server/gestures, in that order
+#define GESTURE_FEATURES 20
+#define GESTURE_HIDDEN_MAX 64
+#define GESTURE_CLASSES_MAX 16
+
+// Samples between classifications of the sliding window, 0.25 s at 52 Hz
+#define GESTURE_DEFAULT_HOP 13
+#define GESTURE_DEFAULT_CONF 80
+
+// Slides an IMU_WINDOW_LEN window over the LSM6DSL at IMU_WINDOW_HZ and runs
+// the classifier every hop samples. A gesture seen with at least min_conf
+// percent confidence is published on the event bus as EVENT_GESTURE
+int gesture_start(uint16_t hop, uint8_t min_conf);
+void gesture_stop(void);
+bool gesture_running(void);
+
+// Features of a whole window, as the host computes them for training
+void gesture_features(const struct imu_window *w, float out[GESTURE_FEATURES]);
+
+// Class index of the features, with the softmax confidence in percent
+int gesture_classify(const float features[GESTURE_FEATURES], uint8_t *conf);
+
+const char *gesture_name(int cls);
+
+#endif
@@ -0,0 +1,28 @@
+#include <stdint.h>
+
+#ifndef GESTURE_MODEL_H
+#define GESTURE_MODEL_H
+
+// Quantized MLP over the window features, see python_server/gestures/model.py.
+// The tables live in flash, src/gesture_model.c is generated by
+// `python3 gesture_dataset.py train`
+struct gesture_model {
+    uint8_t num_features;
+    uint8_t hidden;
+    uint8_t num_classes;
+    const char *const *class_names;
+    // Standardization, then int8 = round(z * in_inv_scale)
+    const float *feat_mean;
+    const float *feat_inv_std;
+    float in_inv_scale;
+    const int8_t *w1;   // [hidden][num_features]
+    const int32_t *b1;
+    float h_mult;       // int32 hidden accumulator to int8 after ReLU
+    const int8_t *w2;   // [num_classes][hidden]
+    const int32_t *b2;
+    float out_scale;    // int32 output accumulator to logits
+};
+
+extern const struct gesture_model gesture_model;
+
+#endif
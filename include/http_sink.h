@@ -0,0 +1,25 @@
+#include <stddef.h>
+
+#ifndef HTTP_SINK_H
+#define HTTP_SINK_H
+
+// Destination parsed from a "host/path" URL as given to the shell commands
+struct http_target {
+    char host[64];
+    char path[96];
+};
+
+int http_parse_url(const char *url, struct http_target *target);
+
+// Assemble a POST request carrying body, returns its length or -ENOSPC
+int http_build_post(char *out, size_t out_len, const struct http_target *target,
+                    const char *body, size_t body_len);
+
+// Connect to target and send req, returns bytes written or a negative errno
+int http_send(const struct http_target *target, const char *req, size_t req_len);
+
+// POST body without copying it into a request buffer: the header is built on
+// the stack and the body is sent straight from where it lives
+int http_post(const struct http_target *target, const char *body, size_t body_len);
+
+#endif
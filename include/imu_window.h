@@ -0,0 +1,34 @@
+#include <stdint.h>
+#include "sensors.h"
+
+#ifndef IMU_WINDOW_H
+#define IMU_WINDOW_H
+
+// The gesture windows of python_server/gestures: 128 samples at 52 Hz
+#define IMU_WINDOW_LEN 128
+#define IMU_WINDOW_HZ 52
+#define IMU_WINDOW_MAX_HZ 416
+#define IMU_WINDOW_AXES 6
+
+// Fixed point units of the stored samples: accel in 0.01 m/s^2 (+-327 m/s^2)
+// and gyro in 0.001 rad/s (+-32 rad/s), both past the LSM6DSL full scale
+#define IMU_ACCEL_LSB_PER_MS2 100
+#define IMU_GYRO_LSB_PER_RADS 1000
+
+// LSM6DSL samples in the order of its axes list: accel x/y/z, gyro x/y/z
+struct imu_window {
+    uint16_t len;
+    uint16_t hz;
+    uint16_t missed; // timer periods that passed without a sample
+    int16_t v[IMU_WINDOW_LEN][IMU_WINDOW_AXES];
+};
+
+// An LSM6DSL sample in the fixed point units above
+void imu_window_fixed(const struct sensor_sample *sample, int16_t out[IMU_WINDOW_AXES]);
+
+// Fills w with len samples paced by a timer at hz, blocking the caller for
+// the length of the window. Holds LSM6DSL normal mode and its ODR meanwhile.
+// Returns 0, -EBUSY in the tap, step or other event modes, or a negative errno
+int imu_window_capture(struct imu_window *w, uint16_t len, uint16_t hz);
+
+#endif
@@ -0,0 +1,116 @@
+#ifndef LSM6DSL_CTX_H
+#define LSM6DSL_CTX_H
+
+#include <zephyr/kernel.h>
+#include <zephyr/device.h>
+#include <zephyr/drivers/i2c.h>
+#include <zephyr/drivers/gpio.h>
+#include <zephyr/drivers/sensor.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#define LSM6DSL_I2C_ADDR 0x6A
+
+// Control registers 0x00..0x5F are mirrored in the shadow copy, data and
+// status registers above are always read from the bus
+#define LSM6DSL_SHADOW_SIZE 0x60
+
+enum lsm6dsl_mode {
+    LSM6DSL_MODE_NORMAL = 0,
+    LSM6DSL_MODE_STEP,
+    LSM6DSL_MODE_SINGLE_TAP,
+    LSM6DSL_MODE_DOUBLE_TAP,
+    LSM6DSL_MODE_MOTION,
+    LSM6DSL_MODE_FIFO,
+    LSM6DSL_NUM_MODES
+};
+
+typedef struct {
+    const struct device *i2c_dev;
+    const struct gpio_dt_spec *int1_gpio;
+
+    // Private, set up by lsm6dsl_ctx_init()
+    struct k_mutex lock;
+    struct gpio_callback int1_cb;
+    enum lsm6dsl_mode mode;
+    uint8_t normal_holds;
+    uint8_t shadow[LSM6DSL_SHADOW_SIZE];
+    uint32_t bus_reads;
+    uint32_t bus_writes;
+    uint32_t writes_skipped; // updates the shadow showed to be no-ops
+} lsm6dsl_ctx_t;
+
+// Register program: a constant list of writes, each block covering
+// contiguous registers so it goes out as one auto-increment burst
+#define LSM6DSL_BLOCK_MAX 7
+
+struct lsm6dsl_reg_block {
+    uint8_t reg;
+    uint8_t len;
+    uint8_t val[LSM6DSL_BLOCK_MAX];
+};
+
+struct lsm6dsl_program {
+    const char *name;
+    const struct lsm6dsl_reg_block *blocks;
+    uint8_t num_blocks;
+};
+
+// Board instance, defined in main.c
+extern lsm6dsl_ctx_t lsm6dsl_ctx;
+
+// Loads the shadow from the part (after the Zephyr driver configured it) and
+// hooks the INT1 handler
+int lsm6dsl_ctx_init(lsm6dsl_ctx_t *ctx, gpio_callback_handler_t int1_handler);
+
+// Register access. Writes and updates go through the shadow, so an update
+// costs one write and no read, and is skipped if nothing changes
+int lsm6dsl_reg_read(lsm6dsl_ctx_t *ctx, uint8_t reg, uint8_t *data, uint8_t len);
+int lsm6dsl_reg_write(lsm6dsl_ctx_t *ctx, uint8_t reg, const uint8_t *data, uint8_t len);
+int lsm6dsl_reg_update(lsm6dsl_ctx_t *ctx, uint8_t reg, uint8_t mask, uint8_t val);
+
+// Modes are constant register programs that all set the same registers, so
+// the result never depends on the previous mode. INT1 is masked while a
+// program is applied. With verify set every block is written and read back
+int lsm6dsl_set_mode(lsm6dsl_ctx_t *ctx, enum lsm6dsl_mode mode, bool verify);
+enum lsm6dsl_mode lsm6dsl_get_mode(lsm6dsl_ctx_t *ctx);
+
+// The fusion filter and gesture recognition sample the accelerometer and gyro
+// as normal mode sets them up. Holding normal mode fails with -EBUSY in any
+// other mode; while a hold is taken lsm6dsl_set_mode() refuses to leave it
+int lsm6dsl_hold_normal(lsm6dsl_ctx_t *ctx);
+void lsm6dsl_release_normal(lsm6dsl_ctx_t *ctx);
+const char *lsm6dsl_mode_name(enum lsm6dsl_mode mode);
+int lsm6dsl_mode_from_name(const char *name);
+
+// Output data rate of SENSOR_CHAN_ACCEL_XYZ or SENSOR_CHAN_GYRO_XYZ, rounded
+// up to the next supported rate, 0 powers the sensor down. Full scale is left
+// alone so the Zephyr driver's scaling stays valid
+int lsm6dsl_set_odr(lsm6dsl_ctx_t *ctx, enum sensor_channel chan, const struct sensor_value *hz);
+
+// FIFO, used in LSM6DSL_MODE_FIFO and LSM6DSL_MODE_STEP. Level is in 16-bit words
+int lsm6dsl_fifo_level(lsm6dsl_ctx_t *ctx, uint16_t *words, bool *overrun);
+int lsm6dsl_fifo_read(lsm6dsl_ctx_t *ctx, int16_t *words, uint16_t count);
+
+// Word of the pattern the next FIFO read returns, 0 on a pattern boundary
+int lsm6dsl_fifo_pattern(lsm6dsl_ctx_t *ctx, uint16_t *index);
+
+int lsm6dsl_read_step_count(lsm6dsl_ctx_t *ctx, uint16_t *steps);
+
+// In step mode every detected step puts the step counter and the timestamp
+// into the FIFO as one pattern of LSM6DSL_STEP_WORDS words, and INT1 fires
+// once LSM6DSL_STEP_FIFO_STEPS of them are waiting
+#define LSM6DSL_STEP_WORDS 3
+#define LSM6DSL_STEP_FIFO_STEPS 16
+void lsm6dsl_step_decode(const int16_t words[LSM6DSL_STEP_WORDS], uint16_t *steps,
+                         uint32_t *timestamp);
+
+// Free running timestamp, LSM6DSL_TS_US per count, wraps at 24 bits (~419 s)
+#define LSM6DSL_TS_US 25
+#define LSM6DSL_TS_WRAP (1UL << 24)
+int lsm6dsl_read_timestamp(lsm6dsl_ctx_t *ctx, uint32_t *timestamp);
+
+// Raw WAKE_UP_SRC, TAP_SRC, D6D_SRC
+int lsm6dsl_read_event_sources(lsm6dsl_ctx_t *ctx, uint8_t src[3]);
+
+#endif // LSM6DSL_CTX_H
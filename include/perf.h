@@ -0,0 +1,50 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <zephyr/kernel.h>
+
+#ifndef PERF_H
+#define PERF_H
+
+// Same log2 buckets as the fetch latency histogram in stats.h
+#define PERF_LAT_BUCKETS 16
+
+// Per timer driven job bookkeeping for the latency histograms
+struct perf_stamp {
+    uint32_t fired;    // stats_now() at the last timer callback
+    uint32_t expected; // k_cycle_get_32() the next callback is due at, 0 = unknown
+};
+
+// Timer callback side (ISR): records how late the timer fired against its
+// period. Call perf_work_start() from the handler it submits
+void perf_timer_fire(struct perf_stamp *st, uint32_t period_ms);
+void perf_timer_restart(struct perf_stamp *st);
+// Handler side: records the work queue delay since the timer fired
+void perf_work_start(struct perf_stamp *st);
+
+// Boot phases, each stamped with the time since the kernel started. Shown by
+// boot_times; only the first PERF_BOOT_MARKS are kept
+#define PERF_BOOT_MARKS 12
+void perf_boot_mark(const char *phase);
+
+// Pipeline trace points, written to a RAM buffer in CTF layout while a
+// capture is armed (see perf_trace_start and scripts/perf_trace.py)
+enum perf_event {
+    PERF_EV_TIMER_FIRE = 0, // arg: session id
+    PERF_EV_WORK_START,     // arg: session id
+    PERF_EV_FETCH_START,
+    PERF_EV_FETCH_END,      // value: return code
+    PERF_EV_SINK_WRITE,     // arg: sink, value: bytes or return code
+    PERF_EV_SHARED,         // arg: session id, capture reused
+};
+
+extern atomic_t perf_tracing;
+void perf_trace_record(enum perf_event id, uint8_t sensor, uint8_t arg, int16_t value);
+
+static inline void perf_trace(enum perf_event id, uint8_t sensor, uint8_t arg, int16_t value)
+{
+    if (atomic_get(&perf_tracing)) {
+        perf_trace_record(id, sensor, arg, value);
+    }
+}
+
+#endif
@@ -0,0 +1,43 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <zephyr/drivers/gpio.h>
+#include "sensors.h"
+#include "stats.h"
+
+#ifndef POWER_H
+#define POWER_H
+
+enum power_mode {
+    POWER_MODE_NORMAL = 0,
+    POWER_MODE_LOW
+};
+
+void power_init(const struct gpio_dt_spec *heartbeat_led);
+enum power_mode power_get_mode(void);
+void power_set_mode(enum power_mode mode);
+
+// In low power mode sensors idle at a low ODR and are only raised to their
+// sampling ODR for the duration of a fetch
+void power_window_open(int sensor);
+void power_window_close(int sensor);
+// Keep the ODR untouched while a custom mode (tap, step), the fusion filter or
+// gesture recognition needs it. Holds are counted, each one needs its release
+void power_window_hold(int sensor, bool hold);
+
+// Adaptive sampling state, one per periodic session
+struct power_adapt {
+    bool have_ref;
+    uint8_t quiet;
+    uint32_t base_ms;
+    uint32_t period_ms;
+    struct sensor_sample ref; // last sample that counted as a change
+};
+
+// Adaptive sampling for periodic sessions, in low power mode only: in normal
+// mode a session samples at exactly the period it was started with. Returns
+// the new timer period in ms when the session should be rescheduled, 0 to
+// keep the current one
+void power_adapt_start(struct power_adapt *st, uint32_t base_ms);
+uint32_t power_adapt_update(struct power_adapt *st, const struct sensor_sample *sample);
+
+#endif
@@ -0,0 +1,33 @@
+#include <stdint.h>
+#include <zephyr/kernel.h>
+#include "sensors.h"
+
+#ifndef SAMPLE_POOL_H
+#define SAMPLE_POOL_H
+
+#define SAMPLE_POOL_SIZE 12
+// Longest sensor_format() output, the two LSM6DSL lines
+#define SAMPLE_TEXT_MAX 160
+
+// One capture, shared by reference between every sink that uses it. The
+// sample is read-only once published; the text form is filled in by the
+// first sink that needs it and reused by the rest
+struct sample_rec {
+    atomic_t refs;
+    int64_t taken_ms;
+    struct sensor_sample sample;
+    int16_t text_len; // < 0 until formatted
+    char text[SAMPLE_TEXT_MAX];
+};
+
+// Gets a referenced record for sensor. The last capture is shared if it is
+// at most max_age_ms old, otherwise the sensor is fetched again (0 always
+// fetches). Returns 0 for a new capture, 1 for a shared one, or a negative errno
+int sample_get(int sensor, uint32_t max_age_ms, struct sample_rec **out);
+void sample_ref(struct sample_rec *rec);
+void sample_put(struct sample_rec *rec);
+
+// Text form of the record, returns its length or a negative errno
+int sample_text(struct sample_rec *rec, const char **text);
+
+#endif
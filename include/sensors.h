@@ -0,0 +1,38 @@
+#include <stddef.h>
+#include <zephyr/drivers/sensor.h>
+
+#ifndef SENSORS_H
+#define SENSORS_H
+
+#define NUM_SENSORS 7
+#define SENSOR_MAX_VALS 7
+
+enum sensor_names {
+    HTS221,
+    LPS22HB,
+    LIS3MDL,
+    LSM6DSL,
+    VL53L0X,
+    BUTTON0,
+    ORIENTATION // computed by the fusion filter, see fusion.h
+};
+
+// One fetch worth of values, in the order of the sensor's axes list
+struct sensor_sample {
+    int sensor;
+    int num_vals;
+    struct sensor_value val[SENSOR_MAX_VALS];
+};
+
+int get_sensor_index(const char *sensor_name);
+const char *get_sensor_name(int sensor_index);
+const char *get_sensor_axis_name(int sensor_index, int axis);
+const struct device *get_sensor_device(int sensor_index);
+
+int sensor_capture(int sensor_index, struct sensor_sample *sample);
+int sensor_format(const struct sensor_sample *sample, char *buf, size_t buf_len);
+
+// Sensor Reading (Returns formatted string of sensor data)
+int sensor_reading(const char *sensor_name, char *buf, size_t buf_len);
+
+#endif
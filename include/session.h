@@ -0,0 +1,39 @@
+#include <stdint.h>
+#include "stats.h"
+#include "http_sink.h"
+
+#ifndef SESSION_H
+#define SESSION_H
+
+// Periodic logging sessions live in a fixed table, with the file path or
+// URL copied into the slot, so nothing points back at shell buffers.
+// A sensor can have several sessions at different rates and sinks; captures
+// are shared between them, so extra sessions do not add bus traffic
+#define SESSION_MAX 8
+// "/lfs/" plus the file name, or "host/path" as typed. URLs are kept as text
+// and parsed on the stack for each post, a parsed http_target would take 160
+#define SESSION_DEST_MAX 96
+// Longest target as saved in settings, a file name or "host/path"
+#define SESSION_TARGET_MAX 160
+
+// The whole table has to fit this, checked at build time. A slot is 360
+// bytes on the Cortex-M4: timer 56, work item 16, destination 96, and the
+// reference samples of adaptive sampling and the deadband, 76 and 80
+#define SESSION_RAM_BUDGET 3072
+
+// Starts a session logging sensor to sink every period_ms and returns its id.
+// A session with the same sensor, sink and target is restarted in place.
+// target is a file name for STATS_SINK_FILE and "host/path" for STATS_SINK_HTTP.
+// The session is saved in settings ("session/<id>") until it is stopped
+int session_start(int sensor, enum stats_sink sink, const char *target, uint32_t period_ms);
+int session_stop_id(int id);
+// Stops every session of sensor on sink, returns how many or -ENOENT
+int session_stop(int sensor, enum stats_sink sink);
+// How many sessions are running
+int session_active(void);
+
+// Restarts the saved sessions in their old slots, each taking its first
+// sample straight away. Needs settings loaded, returns how many or an errno
+int session_restore(void);
+
+#endif
@@ -0,0 +1,67 @@
+#include <stddef.h>
+#include <stdint.h>
+#include <zephyr/kernel.h>
+#ifdef CONFIG_TIMING_FUNCTIONS
+#include <zephyr/timing/timing.h>
+#endif
+
+#ifndef STATS_H
+#define STATS_H
+
+// Fetch latency histogram: bucket i counts fetches that took < 2^i us,
+// the last bucket collects everything slower
+#define STATS_LAT_BUCKETS 16
+
+enum stats_sink {
+    STATS_SINK_FILE = 0,
+    STATS_SINK_HTTP,
+    STATS_SINK_INTERRUPT,
+    STATS_NUM_SINKS
+};
+
+// Timestamps are raw cycle counts so taking one costs a single register read.
+// With the timing functions (the board) that is the CPU's DWT cycle counter;
+// k_cycle_get_32() follows the system timer, which on the board is the
+// 32 kHz LPTIM, ~30 us per count and too coarse for a fetch or a format.
+// The CPU counter stops in STOP modes, so intervals that can span idle
+// (timer periods, trace timestamps) use k_cycle_get_32() instead
+static inline uint32_t stats_now(void)
+{
+#ifdef CONFIG_TIMING_FUNCTIONS
+    return (uint32_t)timing_counter_get();
+#else
+    return k_cycle_get_32();
+#endif
+}
+
+static inline uint64_t stats_cyc_to_us64(uint64_t cycles)
+{
+#ifdef CONFIG_TIMING_FUNCTIONS
+    return timing_cycles_to_ns(cycles) / NSEC_PER_USEC;
+#else
+    return k_cyc_to_us_floor64(cycles);
+#endif
+}
+
+static inline uint32_t stats_cyc_to_us(uint32_t cycles)
+{
+    return (uint32_t)stats_cyc_to_us64(cycles);
+}
+
+// Timer side (safe to call from ISR context)
+void stats_tick(int sensor, int submit_ret);
+
+// Fetch and sink side, from any thread
+void stats_work_begin(int sensor);
+void stats_fetch(int sensor, uint32_t start_cycles, int rc);
+void stats_i2c_error(int sensor);
+void stats_sink_write(int sensor, enum stats_sink sink, int rc);
+
+void stats_reset(void);
+
+// Totals since boot or the last reset, for duty cycle reporting
+uint32_t stats_total_ticks(void);
+uint64_t stats_total_fetch_us(void);
+int64_t stats_window_ms(void);
+
+#endif
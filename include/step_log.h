@@ -0,0 +1,23 @@
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifndef STEP_LOG_H
+#define STEP_LOG_H
+
+enum step_sink {
+    STEP_SINK_FILE = 0,
+    STEP_SINK_HTTP
+};
+
+// Step records are batched and written as "step,<hw_ms>,<steps>,<delta>" lines.
+// hw_ms is the step's time on the LSM6DSL's own clock since the session
+// started, steps counts from the start of the session and delta is the number
+// of steps the record covers (more than 1 when the FIFO overran)
+int step_log_start(enum step_sink sink, const char *target);
+// Flushes whatever is batched, returns the number of steps logged
+uint32_t step_log_stop(void);
+
+// INT1 FIFO watermark hook, safe to call from the ISR
+void step_log_int1(void);
+
+#endif
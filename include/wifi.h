@@ -24,6 +24,8 @@ static void cmd_wifi_reconnect(const struct shell *shell, size_t argc, char **ar
 
 void wifi_mgmt_event_handler(struct net_mgmt_event_callback *cb, uint32_t mgmt_event, struct net_if *iface);
 void read_wifi_config();
-void wifi_connect_to_saved_network();
+int wifi_connect_to_saved_network();
+// Connects to the saved network from the system work queue, returns at once
+void wifi_connect_in_background();
 
 #endif
\ No newline at end of file
@@ -1,8 +1,9 @@
 from flask import Flask, request
 import logging
+import math
 import matplotlib.pyplot as plt
+from matplotlib.animation import FuncAnimation
 from mpl_toolkits.mplot3d import Axes3D
-from queue import Queue
 import threading
 import time
 
@@ -10,7 +11,39 @@ log = logging.getLogger('werkzeug')
 log.setLevel(logging.ERROR)
 
 app = Flask(__name__)
-vector_queue = Queue()
+
+FPS = 30
+SMOOTHING_S = 0.08  # time constant the drawn vector follows the device with
+
+
+class LatestVector:
+    """Holds only the newest vector. Writers overwrite it, so nothing queues
+    up however fast the board posts; `coalesced` counts the ones never drawn."""
+
+    def __init__(self):
+        self.lock = threading.Lock()
+        self.vector = None
+        self.arrived = 0.0
+        self.received = 0
+        self.coalesced = 0
+        self.pending = False
+
+    def put(self, vector):
+        with self.lock:
+            if self.pending:
+                self.coalesced += 1
+            self.vector = vector
+            self.arrived = time.monotonic()
+            self.received += 1
+            self.pending = True
+
+    def take(self):
+        with self.lock:
+            self.pending = False
+            return self.vector, self.arrived
+
+
+latest_vector = LatestVector()
 
 @app.route('/', defaults={'path': ''}, methods=['POST'])
 @app.route('/<path:path>', methods=['POST'])
@@ -27,7 +60,7 @@ def catch_all(path):
             x = float(fx)
             y = float(fy)
             z = float(fz)
-            vector_queue.put((x, y, z))
+            latest_vector.put((x, y, z))
         except (IndexError, ValueError) as e:
             pass
     return 'OK'
@@ -35,64 +68,71 @@ def catch_all(path):
 def plot_vectors():
     fig = plt.figure()
     ax = fig.add_subplot(111, projection='3d')
-    
+
     # Set up the plot
     ax.set_xlabel('X')
     ax.set_ylabel('Y')
     ax.set_zlabel('Z')
     ax.set_title('3D Acceleration Vector')
-    
-    # Initialize quiver objects and previous vector
-    quiverX, quiverY, quiverZ = None, None, None
-    last_x, last_y, last_z = 0, 0, 0
-    
+
     # Set fixed plot limits
     ax.set_xlim([-15, 15])
     ax.set_ylim([-15, 15])
     ax.set_zlim([-15, 15])
-    
-    while True:
-        try:
-            x, y, z = vector_queue.get(timeout=1) # Wait for a new vector
-            
-            # Animation settings
-            animation_seconds = 0.45
-            frames = 30
-            
-            # Create a smooth transition
-            for i in range(frames + 1):
-                # Interpolate between the last and new vector
-                inter_x = last_x + (x - last_x) * (i / frames)
-                inter_y = last_y + (y - last_y) * (i / frames)
-                inter_z = last_z + (z - last_z) * (i / frames)
-                
-                magnitude = (inter_x**2 + inter_y**2 + inter_z**2)**0.5
-                
-                # Clear the previous vector
-                if quiverX:
-                    quiverX.remove()
-                if quiverY:
-                    quiverY.remove()
-                if quiverZ:
-                    quiverZ.remove()
-                
-                # Draw the new vector
-                quiverX = ax.quiver(0, 0, 0, inter_x, 0, 0, color='red')
-                quiverY = ax.quiver(0, 0, 0, 0, inter_y, 0, color='green')
-                quiverZ = ax.quiver(0, 0, 0, 0, 0, inter_z, color='blue')
-                
-                # Update title
-                ax.set_title(f'3D Acceleration Vector (Magnitude: {magnitude:.2f})')
-                
-                plt.draw()
-                plt.pause(animation_seconds / frames)
-            
-            # Update the last vector
-            last_x, last_y, last_z = x, y, z
-            
-        except Exception as e:
-            # This allows the plot to stay open and responsive
-            plt.pause(0.01)
+
+    # Artists are created once and moved every frame, never removed and redrawn
+    (line_x,) = ax.plot([0, 0], [0, 0], [0, 0], color='red', linewidth=2)
+    (line_y,) = ax.plot([0, 0], [0, 0], [0, 0], color='green', linewidth=2)
+    (line_z,) = ax.plot([0, 0], [0, 0], [0, 0], color='blue', linewidth=2)
+    (line_v,) = ax.plot([0, 0], [0, 0], [0, 0], color='black', linewidth=1, marker='o', markevery=[1])
+    status = fig.text(0.02, 0.02, '', family='monospace', fontsize=8)
+
+    shown = [0.0, 0.0, 0.0]
+    clock = {'last': time.monotonic(), 'report': time.monotonic(), 'frames': 0,
+             'render_s': 0.0, 'received': 0, 'begin': None}
+
+    # Render time runs from the frame update until the canvas has been drawn
+    def drawn(_):
+        if clock['begin'] is not None:
+            clock['render_s'] += time.monotonic() - clock['begin']
+            clock['begin'] = None
+    fig.canvas.mpl_connect('draw_event', drawn)
+
+    def frame(_):
+        begin = time.monotonic()
+        dt = begin - clock['last']
+        clock['last'] = begin
+
+        target, arrived = latest_vector.take()
+        if target is not None:
+            # Exponential approach to the newest vector, frame-rate independent
+            alpha = 1.0 - math.exp(-dt / SMOOTHING_S)
+            for i in range(3):
+                shown[i] += (target[i] - shown[i]) * alpha
+        x, y, z = shown
+        magnitude = (x**2 + y**2 + z**2)**0.5
+
+        line_x.set_data_3d([0, x], [0, 0], [0, 0])
+        line_y.set_data_3d([0, 0], [0, y], [0, 0])
+        line_z.set_data_3d([0, 0], [0, 0], [0, z])
+        line_v.set_data_3d([0, x], [0, y], [0, z])
+        ax.set_title(f'3D Acceleration Vector (Magnitude: {magnitude:.2f})')
+
+        clock['frames'] += 1
+        clock['begin'] = begin
+        if begin - clock['report'] >= 1.0:
+            elapsed = begin - clock['report']
+            received = latest_vector.received
+            rate = (received - clock['received']) / elapsed
+            age_ms = (begin - arrived) * 1000 if target is not None else float('nan')
+            status.set_text(
+                f"{clock['frames'] / elapsed:4.1f} fps  render {clock['render_s'] / max(clock['frames'], 1) * 1000:5.1f} ms/frame  "
+                f"input {rate:6.1f} Hz  newest {age_ms:6.0f} ms old  coalesced {latest_vector.coalesced}")
+            clock.update(report=begin, frames=0, render_s=0.0, received=received)
+
+    # Keep a reference, the animation stops when it is garbage collected
+    plot_vectors.animation = FuncAnimation(fig, frame, interval=1000 / FPS, cache_frame_data=False)
+    plt.show()
 
 if __name__ == '__main__':
     # Start the Flask app in a separate thread
@@ -0,0 +1,169 @@
+"""Load and latency test for the terminal bridge (run.py) on simulated boards.
+
+Starts `--boards` fake boards (fake_board.py) and the dashboard server on
+them, then `--clients` processes post commands to `/process_command` back to
+back, like many dashboard tabs at once. At the end it prints requests/s and
+the latency percentiles seen by the clients, and the server's per-board
+counters. With --max-p99-ms or --min-rps it exits non-zero when a result is
+worse, so a change to the host side can be checked without a board.
+
+    python3 bridge_load.py --boards 4 --clients 32 --duration 10
+    python3 bridge_load.py --route board --latency-ms 20 --max-p99-ms 400 --min-rps 100
+    python3 bridge_load.py --url http://127.0.0.1:5000 --route all   # a server already running
+
+--route first posts to /process_command (the first board), board spreads
+requests over /boards/<id>/process_command and all fans each command out
+with /boards/process_command.
+"""
+import argparse
+import http.client
+import json
+import logging
+import multiprocessing
+import os
+import sys
+import threading
+import time
+from urllib.parse import urlsplit
+
+import numpy as np
+
+from fake_board import start_boards
+
+COMMANDS = "read hts221,read lsm6dsl,read lps22hb,ls,pwd,list_sessions"
+# Replies that mean the bridge, not the board, failed
+FAILURES = ("Serial error", "No board", "No such board")
+
+
+def request(conn, method, path, body=None):
+    conn.request(method, path, json.dumps(body) if body is not None else None,
+                 {"Content-Type": "application/json"})
+    resp = conn.getresponse()
+    return resp.status, json.loads(resp.read() or b'null')
+
+
+def ok_reply(status, doc):
+    if status != 200 or not isinstance(doc, dict):
+        return False
+    texts = list(doc['responses'].values()) if 'responses' in doc else [doc.get('response')]
+    return all(t is not None and not t.startswith(FAILURES) for t in texts)
+
+
+def client(index, args, board_ids, results):
+    host, port = urlsplit(args.url).hostname, urlsplit(args.url).port
+    conn = http.client.HTTPConnection(host, port, timeout=30)
+    commands = args.commands.split(',')
+    latencies = []
+    errors = 0
+
+    start = time.monotonic()
+    deadline = start + args.duration
+    n = index
+    while time.monotonic() < deadline:
+        body = {"command": commands[n % len(commands)], "timeout": args.timeout}
+        if args.route == "board":
+            path = f"/boards/{board_ids[n % len(board_ids)]}/process_command"
+        elif args.route == "all":
+            path = "/boards/process_command"
+        else:
+            path = "/process_command"
+        n += 1
+        begin = time.monotonic()
+        try:
+            ok = ok_reply(*request(conn, "POST", path, body))
+        except (OSError, http.client.HTTPException, ValueError):
+            conn.close()
+            conn = http.client.HTTPConnection(host, port, timeout=30)
+            ok = False
+        latencies.append(time.monotonic() - begin)
+        errors += not ok
+    results.put((latencies, errors, time.monotonic() - start))
+
+
+def serve(boards, fast_baud=None):
+    """The dashboard app on the fake boards, on a free local port."""
+    from werkzeug.serving import make_server
+
+    os.environ["BOARD_PORTS"] = ",".join(b.port for b in boards)
+    if fast_baud is not None:
+        os.environ["BOARD_FAST_BAUD"] = str(fast_baud)
+    from flaskr import create_app
+
+    # One access log line per request would cost more than the requests
+    logging.getLogger("werkzeug").setLevel(logging.WARNING)
+    server = make_server("127.0.0.1", 0, create_app(), threaded=True)
+    threading.Thread(target=server.serve_forever, daemon=True).start()
+    return server, f"http://127.0.0.1:{server.server_port}"
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--url", help="test a running server instead of starting one")
+    parser.add_argument("--boards", type=int, default=4)
+    parser.add_argument("--clients", type=int, default=16)
+    parser.add_argument("--duration", type=float, default=10.0, help="seconds")
+    parser.add_argument("--route", choices=["first", "board", "all"], default="board")
+    parser.add_argument("--commands", default=COMMANDS, help="comma separated, sent in turn")
+    parser.add_argument("--timeout", type=float, default=2.0, help="per command, as in the API")
+    parser.add_argument("--latency-ms", type=float, default=0.0, help="fake board time per command")
+    parser.add_argument("--baud", type=int, default=115200, help="fake board output pacing, 0 = none")
+    parser.add_argument("--fast-baud", type=int, help="rate the server asks for, 0 = stay at 115200")
+    parser.add_argument("--max-p99-ms", type=float, help="fail above this p99 latency")
+    parser.add_argument("--min-rps", type=float, help="fail below this throughput")
+    args = parser.parse_args()
+
+    fakes = server = None
+    if not args.url:
+        fakes = start_boards(args.boards, latency_ms=args.latency_ms, baud=args.baud)
+        server, args.url = serve(fakes, args.fast_baud)
+
+    host, port = urlsplit(args.url).hostname, urlsplit(args.url).port
+    _, listed = request(http.client.HTTPConnection(host, port, timeout=10), "GET", "/boards")
+    board_ids = [b['id'] for b in listed]
+    if not board_ids:
+        sys.exit(f"No boards behind {args.url}")
+
+    # Spawned, so the clients do not inherit the boards' and server's threads
+    ctx = multiprocessing.get_context("spawn")
+    results = ctx.Queue()
+    procs = [ctx.Process(target=client, args=(i, args, board_ids, results))
+             for i in range(args.clients)]
+    for p in procs:
+        p.start()
+    outcomes = [results.get() for _ in procs]
+    for p in procs:
+        p.join()
+
+    latencies = np.concatenate([o[0] for o in outcomes]) * 1000
+    errors = sum(o[1] for o in outcomes)
+    elapsed = max(o[2] for o in outcomes)
+    rps = len(latencies) / elapsed
+    p50, p95, p99 = np.percentile(latencies, [50, 95, 99]) if len(latencies) else (0, 0, 0)
+
+    print(f"{len(board_ids)} boards, {args.clients} clients, route {args.route}, {elapsed:.1f} s")
+    print(f"throughput: {rps:,.1f} requests/s, {len(latencies)} requests, {errors} failed")
+    if len(latencies):
+        print(f"latency ms: p50 {p50:.1f}  p95 {p95:.1f}  p99 {p99:.1f}  max {latencies.max():.1f}")
+    _, listed = request(http.client.HTTPConnection(host, port, timeout=10), "GET", "/boards")
+    for b in listed:
+        print(f"  {b['id']}: {b['commands']} commands, {b['errors']} errors, avg {b['avg_ms']} ms"
+              f" at {b['baud']} baud")
+
+    if server:
+        server.shutdown()
+        for fake in fakes:
+            fake.close()
+
+    failed = []
+    if errors:
+        failed.append(f"{errors} failed requests")
+    if args.max_p99_ms is not None and p99 > args.max_p99_ms:
+        failed.append(f"p99 {p99:.1f} ms > {args.max_p99_ms} ms")
+    if args.min_rps is not None and rps < args.min_rps:
+        failed.append(f"{rps:.1f} requests/s < {args.min_rps}")
+    if failed:
+        sys.exit("FAIL: " + ", ".join(failed))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,410 @@
+"""Simulated boards: the firmware's shell on a pseudo-terminal, no hardware needed.
+
+Each board opens a pty and answers on it like the Zephyr shell does: it echoes
+the command, prints the output with the same text as src/ and ends with the
+`uart:~$` prompt. It knows `read`, the file commands on an in-memory /lfs
+(`ls`, `cat`, `pwd`, `cd`, `mkdir`, `rm`), the logging sessions
+(`sensor_timer_start`/`_stop`, `list_sessions`, `stop_session`),
+`imu_window` and the `uart_baud` rate switch with `uart_flood`. Readings come from a generator: a mean plus an optional sine and
+Gaussian noise per channel, seeded per board and overridable with --profile.
+
+    python3 fake_board.py                                  # one board, prints its port
+    python3 fake_board.py --boards 8 --latency-ms 50       # 8 boards, 50 ms per command
+    python3 fake_board.py --profile profile.json --baud 0  # own sensor values, no UART pacing
+
+It prints a BOARD_PORTS=... line to start the server with, e.g.
+`BOARD_PORTS=/dev/pts/3,/dev/pts/4 python3 run.py`. A profile maps a sensor
+to per-channel settings, e.g. {"hts221": {"temp": {"mean": 30, "noise": 0.5}}}.
+"""
+import argparse
+import json
+import math
+import os
+import posixpath
+import select
+import threading
+import time
+import tty
+
+import numpy as np
+
+PROMPT = '\x1b[1;32muart:~$ \x1b[m'
+ERROR = '\x1b[1;31m{}\x1b[m'
+SESSION_MAX = 8
+IMU_WINDOW_LEN = 128
+IMU_WINDOW_MAX_HZ = 416
+UART_RATES = (115200, 230400, 460800, 921600, 1000000, 2000000)
+UART_CONFIRM_S = 2.0
+
+# Channel: mean, sine amplitude, sine period in seconds, noise sigma. The
+# order and units are those of sensor_format() in src/main.c
+SENSORS = {
+    'hts221': {'temp': (23.0, 1.0, 600, 0.05), 'hum': (45.0, 3.0, 900, 0.2)},
+    'lps22hb': {'press': (101.3, 0.1, 1200, 0.005)},
+    'lis3mdl': {'x': (0.2, 0.05, 30, 0.01), 'y': (-0.1, 0.05, 30, 0.01),
+                'z': (-0.4, 0.05, 30, 0.01)},
+    'lsm6dsl': {'accel_x': (0.0, 0.0, 1, 0.05), 'accel_y': (0.0, 0.0, 1, 0.05),
+                'accel_z': (9.81, 0.0, 1, 0.05), 'gyro_x': (0.0, 0.0, 1, 0.5),
+                'gyro_y': (0.0, 0.0, 1, 0.5), 'gyro_z': (0.0, 0.0, 1, 0.5)},
+    'vl53l0x': {'distance': (250.0, 50.0, 20, 2.0)},
+    'button0': {'pressed': (0.0, 0.0, 1, 0.0)},
+}
+SETTINGS = ('mean', 'amplitude', 'period', 'noise')
+
+
+class Generator:
+    """Sensor values at a point in time, from SENSORS with profile overrides."""
+
+    def __init__(self, seed=0, profile=None):
+        self.rng = np.random.default_rng(seed)
+        self.channels = {name: {ch: dict(zip(SETTINGS, v)) for ch, v in chans.items()}
+                         for name, chans in SENSORS.items()}
+        for name, chans in (profile or {}).items():
+            for ch, settings in chans.items():
+                self.channels[name][ch].update(settings)
+
+    def values(self, sensor, t=None):
+        t = time.time() if t is None else t
+        out = []
+        for c in self.channels[sensor].values():
+            wave = c['amplitude'] * math.sin(2 * math.pi * t / c['period'])
+            out.append(c['mean'] + wave + (self.rng.normal(0, c['noise']) if c['noise'] else 0.0))
+        return out
+
+
+def sensor_value(x):
+    """%d.%06d of a Zephyr sensor_value, which prints -0.5 as 0.-500000."""
+    micro = round(x * 1e6)
+    val1 = int(micro / 1e6)
+    return f"{val1}.{micro - val1 * 1000000:06d}"
+
+
+def sensor_format(sensor, v):
+    if sensor == 'hts221':
+        return f"HTS221: Temp {sensor_value(v[0])} C, Hum {sensor_value(v[1])} %\n"
+    if sensor == 'lps22hb':
+        return f"LPS22HB: Pressure {sensor_value(v[0])} kPa\n"
+    if sensor == 'lis3mdl':
+        x, y, z = (sensor_value(a) for a in v)
+        return f"LIS3MDL: X {x}, Y {y}, Z {z} uT\n"
+    if sensor == 'lsm6dsl':
+        a = [sensor_value(x) for x in v]
+        return (f"LSM6DSL Accel: X {a[0]}, Y {a[1]}, Z {a[2]} m/s^2\n"
+                f"LSM6DSL Gyro: X {a[3]}, Y {a[4]}, Z {a[5]} deg/s\n")
+    if sensor == 'vl53l0x':
+        return f"VL53L0X: Raw Distance {int(v[0])}\n"
+    return f"Button {'pressed' if v[0] >= 0.5 else 'released'}\n"
+
+
+def parse_period_ms(text):
+    """parse_period_ms() of src/session.c: seconds, N.NNN seconds or Nms, 0 if bad."""
+    try:
+        if text.endswith('ms'):
+            return int(text[:-2])
+        return round(float(text) * 1000) if text[:1].isdigit() or text[:1] == '.' else 0
+    except ValueError:
+        return 0
+
+
+class FakeBoard:
+    """One simulated board on its own pty and thread. `port` is the path to open.
+
+    latency_ms is added to every command, like a sensor fetch or a flash
+    write on the real board. Output is paced at baud bits/s (10 bits a byte)
+    so long replies take as long as on a UART; baud=0 writes at once. A pty
+    has no line rate, so `uart_baud` only changes the pacing.
+    """
+
+    def __init__(self, seed=0, profile=None, latency_ms=0.0, baud=115200):
+        self.gen = Generator(seed, profile)
+        self.latency_s = latency_ms / 1000
+        self.paced = baud != 0
+        self.baud = baud or UART_RATES[0]
+        self._confirmed_baud = self.baud
+        self._pending_baud = None
+        self._revert_at = None
+        self.cwd = '/lfs'
+        self.dirs = {'/lfs'}
+        self.files = {}
+        self.sessions = [None] * SESSION_MAX
+        self.commands = 0
+        self._master, self._slave = os.openpty()
+        tty.setraw(self._slave)
+        self.port = os.ttyname(self._slave)
+        self._stop = threading.Event()
+        self._thread = threading.Thread(target=self._run, daemon=True, name=f"fake-{self.port}")
+        self._thread.start()
+
+    def close(self):
+        self._stop.set()
+        self._thread.join(timeout=2)
+        os.close(self._master)
+        os.close(self._slave)
+
+    def _write(self, text):
+        data = text.replace('\n', '\r\n').encode()
+        os.write(self._master, data)
+        if self.paced:
+            time.sleep(len(data) * 10 / self.baud)
+
+    def _run(self):
+        line = bytearray()
+        last = None
+        while not self._stop.is_set():
+            due = [s['next'] for s in self.sessions if s]
+            wait = max(0.0, min(due) - time.monotonic()) if due else 0.1
+            ready, _, _ = select.select([self._master], [], [], min(wait, 0.1))
+            self._log_due()
+            if self._revert_at and time.monotonic() >= self._revert_at:
+                self.baud, self._pending_baud, self._revert_at = self._confirmed_baud, None, None
+            if not ready:
+                continue
+            try:
+                data = os.read(self._master, 1024)
+            except OSError:
+                break
+            for byte in data:
+                if byte == ord('\n') and last == ord('\r'):
+                    pass  # \r\n ends one line, not two
+                elif byte in b'\r\n':
+                    # The shell echoes what was typed, then answers on the next line
+                    self._write(line.decode(errors='ignore') + '\n')
+                    self._execute(line.decode(errors='ignore').split())
+                    line.clear()
+                elif byte in b'\x7f\x08':
+                    del line[-1:]
+                else:
+                    line.append(byte)
+                last = byte
+
+    def _execute(self, argv):
+        if argv:
+            self.commands += 1
+            if self.latency_s:
+                time.sleep(self.latency_s)
+            handler = getattr(self, f"cmd_{argv[0]}", None)
+            if handler is None:
+                self._write(ERROR.format(f"{argv[0]}: command not found") + '\n')
+            else:
+                out = handler(argv)
+                if out:
+                    self._write(out)
+        self._write(PROMPT)
+        if self._pending_baud and not self._revert_at:
+            # Like the firmware, switch once the reply and prompt are out
+            self.baud = self._pending_baud
+            self._revert_at = time.monotonic() + UART_CONFIRM_S
+
+    def _log_due(self):
+        now = time.monotonic()
+        for s in self.sessions:
+            if s and s['next'] <= now:
+                self._append(s['path'], sensor_format(s['sensor'], self.gen.values(s['sensor'])))
+                s['runs'] += 1
+                s['written'] += 1
+                # Catch up by skipping, like a k_timer whose work item ran late
+                s['next'] += s['period_ms'] / 1000 * max(1, math.ceil((now - s['next']) * 1000 / s['period_ms']))
+
+    def _append(self, path, text):
+        self.files.setdefault(path, bytearray()).extend(text.encode())
+        self.dirs.add(posixpath.dirname(path))
+
+    def _path(self, name):
+        return posixpath.join(self.cwd, name)
+
+    # Commands, with the output of their counterparts in src/
+
+    def cmd_help(self, argv):
+        names = sorted(n[4:] for n in dir(self) if n.startswith('cmd_'))
+        return "Available commands:\n" + ''.join(f"  {n}\n" for n in names)
+
+    def cmd_read(self, argv):
+        if len(argv) < 2:
+            return ERROR.format("Usage: read <sensor_name>") + '\n'
+        if argv[1] not in SENSORS:
+            return f"Unknown sensor: {argv[1]}\n\n"
+        return sensor_format(argv[1], self.gen.values(argv[1])) + '\n'
+
+    def cmd_pwd(self, argv):
+        return f"{self.cwd}\n\n"
+
+    def cmd_ls(self, argv):
+        prefix = self.cwd + '/'
+        names = {p[len(prefix):].split('/')[0] for p in list(self.files) + list(self.dirs)
+                 if p.startswith(prefix)}
+        return ''.join(f"{n}\n" for n in sorted(names))
+
+    def cmd_cat(self, argv):
+        if len(argv) < 2:
+            return ERROR.format("Usage: cat <file_name>") + '\n'
+        data = self.files.get(f"/lfs/{argv[1]}")
+        if data is None:
+            return f"File doesn't exist: {argv[1]}\n"
+        return f"Contents of {argv[1]}:\n" + data.decode(errors='ignore')
+
+    def cmd_cd(self, argv):
+        if len(argv) != 2:
+            return ERROR.format("Usage: cd <dir_name>") + '\n'
+        if argv[1] == '..':
+            if self.cwd == '/lfs':
+                return ERROR.format("Presently in root directory") + '\n' + f"Now in: {self.cwd}\n"
+            self.cwd = posixpath.dirname(self.cwd)
+        elif self._path(argv[1]) in self.dirs:
+            self.cwd = self._path(argv[1])
+        else:
+            return ERROR.format(f"Directory not found: {self._path(argv[1])}") + '\n'
+        return f"Now in: {self.cwd}\n"
+
+    def cmd_mkdir(self, argv):
+        if len(argv) != 2:
+            return ERROR.format("Usage: mkdir <dir_name>") + '\n'
+        path = self._path(argv[1])
+        if path in self.dirs or path in self.files:
+            return ERROR.format(f"Directory already exists: {path}") + '\n'
+        self.dirs.add(path)
+        return ''
+
+    def cmd_rm(self, argv):
+        if len(argv) < 2:
+            return ERROR.format("Usage: rm <file_name>") + '\n'
+        path = self._path(argv[1])
+        if self.files.pop(path, None) is None:
+            return ERROR.format(f"Failed to remove file {path}: -2") + '\n'
+        return f"File {path} removed successfully\n"
+
+    def cmd_sensor_timer_start(self, argv):
+        usage = ERROR.format("Usage: sensor_timer_start <sensor_name> <file_name> <seconds|N.NNN|Nms>") + '\n'
+        if len(argv) < 4 or argv[1] not in SENSORS or not parse_period_ms(argv[3]):
+            return usage
+        free = [i for i, s in enumerate(self.sessions) if s is None]
+        if not free:
+            return ERROR.format(f"All {SESSION_MAX} sessions are in use, see list_sessions") + '\n'
+        period_ms = parse_period_ms(argv[3])
+        self.sessions[free[0]] = {
+            'sensor': argv[1], 'path': f"/lfs/{argv[2]}", 'period_ms': period_ms,
+            'next': time.monotonic(), 'runs': 0, 'written': 0,
+        }
+        return f"Session {free[0]}: {argv[1]} every {period_ms} ms\n"
+
+    def cmd_sensor_timer_stop(self, argv):
+        if len(argv) < 2 or argv[1] not in SENSORS:
+            return ERROR.format(f"Usage: {argv[0]} <sensor_name>") + '\n'
+        stopped = [i for i, s in enumerate(self.sessions) if s and s['sensor'] == argv[1]]
+        for i in stopped:
+            self.sessions[i] = None
+        if not stopped:
+            return f"\x1b[1;33mNo timer running for {argv[1]}\x1b[m\n"
+        return f"Stopped {len(stopped)} timer(s) for {argv[1]}\n"
+
+    def cmd_list_sessions(self, argv):
+        out = [f"{'id':<3} {'sensor':<11} {'sink':<5} {'period':>9} {'requested':>9} "
+               f"{'runs':>7} {'shared':>7} {'written':>7} {'err':>5}  target"]
+        for i, s in enumerate(self.sessions):
+            if s:
+                out.append(f"{i:<3} {s['sensor']:<11} {'file':<5} {s['period_ms']:>7} ms "
+                           f"{s['period_ms']:>6} ms {s['runs']:>7} {0:>7} {s['written']:>7} "
+                           f"{0:>5}  {s['path']}")
+        active = sum(1 for s in self.sessions if s)
+        out.append(f"{active} of {SESSION_MAX} sessions in use")
+        return '\n'.join(out) + '\n'
+
+    def cmd_stop_session(self, argv):
+        if len(argv) < 2:
+            return ERROR.format("Usage: stop_session <id>") + '\n'
+        try:
+            sid = int(argv[1])
+        except ValueError:
+            sid = -1
+        if not 0 <= sid < SESSION_MAX or self.sessions[sid] is None:
+            return ERROR.format(f"No session {argv[1]}, see list_sessions") + '\n'
+        self.sessions[sid] = None
+        return f"Stopped session {sid}\n"
+
+    def cmd_imu_window(self, argv):
+        try:
+            n = int(argv[1]) if len(argv) > 1 else IMU_WINDOW_LEN
+            hz = int(argv[2]) if len(argv) > 2 else 52
+        except ValueError:
+            n = hz = 0
+        if not 0 < n <= IMU_WINDOW_LEN or not 0 < hz <= IMU_WINDOW_MAX_HZ:
+            return ERROR.format(f"Usage: imu_window [samples 1-{IMU_WINDOW_LEN}] "
+                                f"[hz 1-{IMU_WINDOW_MAX_HZ}]") + '\n'
+        # Captured at the board's pace, as src/imu_window.c does
+        time.sleep(n / hz)
+        t0 = time.time()
+        scale = np.array([100] * 3 + [1000] * 3)
+        rows = [np.clip(np.rint(np.array(self.gen.values('lsm6dsl', t0 + k / hz)) * scale),
+                        -32768, 32767).astype('<i2') for k in range(n)]
+        out = [f"IMU_WINDOW {n} {hz} 100 1000"]
+        for k in range(0, n, 8):
+            out.append("IMU " + b''.join(r.tobytes() for r in rows[k:k + 8]).hex())
+        out.append("IMU_END 0")
+        return '\n'.join(out) + '\n'
+
+
+    def cmd_uart_baud(self, argv):
+        if len(argv) < 2:
+            return f"UART_BAUD {self.baud} (boot {UART_RATES[0]}, confirmed {self._confirmed_baud})\n"
+        try:
+            baud = int(argv[1])
+        except ValueError:
+            baud = 0
+        if baud not in UART_RATES:
+            return ERROR.format("Usage: uart_baud [rate], see uart_baud for the rates") + '\n'
+        if self._pending_baud:
+            return ERROR.format(f"Switch to {self._pending_baud} still waiting for uart_baud_confirm") + '\n'
+        if baud == self.baud:
+            self._confirmed_baud = baud
+            return f"UART_BAUD {baud}\n"
+        self._pending_baud = baud
+        return f"UART_BAUD {baud} in 20 ms, confirm within {int(UART_CONFIRM_S * 1000)} ms\n"
+
+    def cmd_uart_baud_confirm(self, argv):
+        if not self._pending_baud or not self._revert_at:
+            return ERROR.format("No rate change to confirm") + '\n'
+        self._confirmed_baud = self._pending_baud
+        self._pending_baud = self._revert_at = None
+        return f"UART_BAUD_OK {self._confirmed_baud}\n"
+
+
+    def cmd_uart_flood(self, argv):
+        lines = (int(argv[1]) if len(argv) > 1 and argv[1].isdigit() else 16384) // 64
+        started = time.monotonic()
+        self._write(('U' * 63 + '\n') * lines)
+        ms = int((time.monotonic() - started) * 1000)
+        return f"UART_FLOOD {lines} lines in {ms} ms at {self.baud} baud\n"
+
+
+def start_boards(count, seed=0, profile=None, latency_ms=0.0, baud=115200):
+    return [FakeBoard(seed + i, profile, latency_ms, baud) for i in range(count)]
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--boards", type=int, default=1)
+    parser.add_argument("--latency-ms", type=float, default=0.0, help="added to every command")
+    parser.add_argument("--baud", type=int, default=115200, help="output pacing, 0 = none")
+    parser.add_argument("--seed", type=int, default=0)
+    parser.add_argument("--profile", help="JSON file of sensor channel overrides")
+    args = parser.parse_args()
+
+    profile = None
+    if args.profile:
+        with open(args.profile) as f:
+            profile = json.load(f)
+    boards = start_boards(args.boards, args.seed, profile, args.latency_ms, args.baud)
+    for board in boards:
+        print(board.port)
+    print("BOARD_PORTS=" + ",".join(b.port for b in boards), flush=True)
+    try:
+        while True:
+            time.sleep(1)
+    except KeyboardInterrupt:
+        pass
+    finally:
+        for board in boards:
+            board.close()
+
+
+if __name__ == "__main__":
+    main()
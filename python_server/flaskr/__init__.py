@@ -1,11 +1,26 @@
+import atexit
+import os
+import signal
+import sys
+import threading
+
 from flask import Flask
 from flask_cors import CORS
 
 def create_app():
     app = Flask(__name__)
     CORS(app)  # allow cross-origin requests (different ports communicating) 
+    # Where ingest_run.py writes, for the /history endpoints
+    app.config['SENSOR_DATA_DIR'] = os.environ.get('SENSOR_DATA_DIR', 'sensor_data')
 
     from .routes import bp as routes_bp
     app.register_blueprint(routes_bp)
 
+    # Boards go back to 115200 for other tools when the server exits, for
+    # Ctrl-C and kill alike
+    from .controller import boards
+    atexit.register(boards.close)
+    if threading.current_thread() is threading.main_thread():
+        signal.signal(signal.SIGTERM, lambda *_: sys.exit(0))
+
     return app
\ No newline at end of file
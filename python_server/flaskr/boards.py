@@ -0,0 +1,272 @@
+"""Every attached board, each with its own serial connection and I/O loop.
+
+A Board owns one port and runs an asyncio loop on its own thread. Commands
+are submitted from any thread and run one after another on that port, so
+boards never wait for each other and a request only waits for its own board.
+The connection stays open between commands and a reply is complete as soon
+as the shell prompt comes back, instead of after a fixed read timeout; the
+timeout only bounds commands that never finish.
+
+Boards boot at BAUD_RATE. With fast_baud set, a Board asks the firmware for
+that rate right after connecting (`uart_baud`, see src/uart_speed.c) and
+confirms it at the new rate; a board that does not know the command or does
+not confirm stays at BAUD_RATE. Closing the Board puts the board back to
+BAUD_RATE for other tools.
+
+BoardManager finds the boards, keeps them by id (the USB serial number, or
+the port name when there is none) and fans commands out to many at once.
+"""
+import asyncio
+import concurrent.futures
+import os
+import re
+import threading
+import time
+
+BAUD_RATE = 115200
+PROMPT = b'uart:~$'
+ANSI_ESCAPE = re.compile(r'\x1B(?:[@-Z\\-_]|\[[0-?]*[ -/]*[@-~])')
+ANSI_ESCAPE_BYTES = re.compile(rb'\x1B(?:[@-Z\\-_]|\[[0-?]*[ -/]*[@-~])')
+PROBE_TIMEOUT = 0.3
+# Port scans are slow (USB enumeration on some hosts), so the board list is
+# rescanned at most this often unless a board is asked for that is not known
+REFRESH_S = 5.0
+# The firmware switches UART_SWITCH_DELAY_MS after its reply and goes back if
+# the switch is not confirmed within UART_CONFIRM_MS
+SWITCH_DELAY = 0.05
+CONFIRM_WINDOW = 2.0
+
+
+def filter_line(line, command_sent):
+    filter = ['<dbg>', '<wrn>', 'uart:~$']
+    if any(f in line for f in filter):
+        return None
+    if command_sent.strip() == line.strip():
+        return None
+    return ANSI_ESCAPE.sub('', line)
+
+
+def has_prompt(buf):
+    """The shell prints a fresh, empty prompt line once a command has finished."""
+    end = buf.rfind(b'\n')
+    return end >= 0 and ANSI_ESCAPE_BYTES.sub(b'', bytes(buf[end:])).strip().endswith(PROMPT)
+
+
+class Board:
+    def __init__(self, board_id, port, baud=BAUD_RATE, fast_baud=None):
+        self.id = board_id
+        self.port = port
+        self.baud = baud
+        self.fast_baud = fast_baud
+        self.link_baud = None
+        self.ser = None
+        self.commands = 0
+        self.errors = 0
+        self.busy_s = 0.0
+        self.last_error = None
+        self.loop = asyncio.new_event_loop()
+        self._lock = asyncio.Lock()
+        self._thread = threading.Thread(target=self.loop.run_forever, daemon=True,
+                                        name=f"board-{board_id}")
+        self._thread.start()
+
+    def submit(self, command, timeout=0.3):
+        """Queues command on this board's loop, returns a concurrent Future."""
+        return asyncio.run_coroutine_threadsafe(self._command(command, timeout), self.loop)
+
+    def command(self, command, timeout=0.3):
+        return self.submit(command, timeout).result()
+
+    def info(self):
+        return {
+            'id': self.id,
+            'port': self.port,
+            'connected': self.ser is not None,
+            'baud': self.link_baud,
+            'commands': self.commands,
+            'errors': self.errors,
+            'avg_ms': round(self.busy_s * 1000 / self.commands, 1) if self.commands else None,
+            'last_error': self.last_error,
+        }
+
+    def close(self):
+        if self.link_baud not in (None, self.baud):
+            try:
+                asyncio.run_coroutine_threadsafe(self._restore(), self.loop).result(timeout=2)
+            except Exception:
+                pass  # left at the fast rate until it resets
+
+        def stop():
+            if self.ser:
+                self.ser.close()
+                self.ser = None
+            self.loop.stop()
+        self.loop.call_soon_threadsafe(stop)
+        self._thread.join(timeout=2)
+
+    async def _connect(self):
+        """Opens the port at the rate the board answers on, then asks for
+        fast_baud. A confirmed rate lasts until the board resets, so after a
+        server restart the board may still be at fast_baud."""
+        import serial
+        # Non-blocking where the loop can wait on the descriptor itself
+        self.ser = serial.Serial(self.port, self.baud, timeout=0 if os.name == 'posix' else 0.05)
+        for rate in [self.baud] + ([self.fast_baud] if self.fast_baud else []):
+            self.ser.baudrate = rate
+            self.ser.reset_input_buffer()
+            self.ser.write(b'\n')
+            if has_prompt(await self._read_reply(PROBE_TIMEOUT)):
+                break
+        else:
+            self.ser.baudrate = self.baud
+        self.link_baud = self.ser.baudrate
+        if self.fast_baud and self.link_baud != self.fast_baud:
+            await self._switch(self.fast_baud)
+
+    async def _switch(self, baud):
+        """Moves the board and the port to baud. True if the board confirmed."""
+        ser = self.ser
+        ser.reset_input_buffer()
+        ser.write(f'uart_baud {baud}\n'.encode())
+        if f'UART_BAUD {baud} in'.encode() not in await self._read_reply(PROBE_TIMEOUT * 3):
+            return False  # firmware without uart_baud, or a busy board
+        await asyncio.sleep(SWITCH_DELAY)
+        ser.baudrate = baud
+        ser.reset_input_buffer()
+        ser.write(b'uart_baud_confirm\n')
+        if b'UART_BAUD_OK' in await self._read_reply(PROBE_TIMEOUT * 3):
+            self.link_baud = baud
+            return True
+        # The board goes back by itself once the confirmation window closes
+        ser.baudrate = self.link_baud
+        await asyncio.sleep(CONFIRM_WINDOW)
+        ser.reset_input_buffer()
+        return False
+
+    async def _restore(self):
+        async with self._lock:
+            if self.ser is not None:
+                await self._switch(self.baud)
+
+    async def _read(self, timeout):
+        ser = self.ser
+        if os.name != 'posix':
+            return await self.loop.run_in_executor(None, ser.read, max(1, ser.in_waiting))
+        if not ser.in_waiting:
+            ready = self.loop.create_future()
+            self.loop.add_reader(ser.fileno(), lambda: ready.done() or ready.set_result(None))
+            try:
+                await asyncio.wait_for(ready, timeout)
+            except asyncio.TimeoutError:
+                return b''
+            finally:
+                self.loop.remove_reader(ser.fileno())
+        return ser.read(max(1, ser.in_waiting))
+
+    async def _command(self, command, timeout):
+        async with self._lock:
+            started = time.monotonic()
+            try:
+                if self.ser is None:
+                    await self._connect()
+                ser = self.ser
+                ser.reset_input_buffer()
+                ser.write((command + '\n').encode('utf-8'))
+                raw = await self._read_reply(timeout)
+                if self.link_baud != self.baud and not has_prompt(raw):
+                    # Maybe reset and back at the boot rate, probe again next time
+                    ser.close()
+                    self.ser = None
+            except Exception as e:
+                # Reopened on the next command, e.g. after the board was reset
+                self.errors += 1
+                self.last_error = str(e)
+                if self.ser is not None:
+                    self.ser.close()
+                    self.ser = None
+                return f"Serial error: {e}"
+            finally:
+                self.commands += 1
+                self.busy_s += time.monotonic() - started
+
+        lines = raw.decode('utf-8', errors='ignore').replace('\r', '').split('\n')
+        kept = (filter_line(line, command) for line in lines)
+        return ''.join(line + '\n' for line in kept if line)
+
+    async def _read_reply(self, timeout):
+        buf = bytearray()
+        deadline = time.monotonic() + timeout
+        while (left := deadline - time.monotonic()) > 0:
+            buf += await self._read(left)
+            if has_prompt(buf):
+                break
+        return bytes(buf)
+
+
+class BoardManager:
+    """The boards found by `discover`, a callable returning (id, port) pairs."""
+
+    def __init__(self, discover, baud=BAUD_RATE, fast_baud=None):
+        self._discover = discover
+        self.baud = baud
+        self.fast_baud = fast_baud
+        self._boards = {}
+        self._lock = threading.Lock()
+        self._refreshed = None
+
+    def refresh(self, max_age=0.0):
+        """Adds new boards and drops those whose port is gone. With max_age,
+        a scan younger than that many seconds is reused."""
+        with self._lock:
+            if max_age and self._refreshed is not None and \
+                    time.monotonic() - self._refreshed < max_age:
+                return sorted(self._boards)
+        found = dict(self._discover())
+        with self._lock:
+            self._refreshed = time.monotonic()
+            dropped = [self._boards.pop(b) for b in list(self._boards) if b not in found]
+            for board_id, port in found.items():
+                if board_id not in self._boards:
+                    self._boards[board_id] = Board(board_id, port, self.baud, self.fast_baud)
+            ids = sorted(self._boards)
+        # Closing waits for the board's loop, which must not hold up the others
+        for board in dropped:
+            board.close()
+        return ids
+
+    def ids(self):
+        with self._lock:
+            return sorted(self._boards)
+
+    def boards(self):
+        with self._lock:
+            return [self._boards[b] for b in sorted(self._boards)]
+
+    def get(self, board_id=None):
+        """The board with board_id, or the first one. KeyError if there is none."""
+        with self._lock:
+            if not self._boards:
+                raise KeyError(board_id)
+            if board_id is None:
+                return self._boards[min(self._boards)]
+            return self._boards[board_id]
+
+    def fan_out(self, command, timeout=0.3, board_ids=None):
+        """Runs command on every board (or those in board_ids) at once and
+        returns {board_id: response}. Unknown ids map to None."""
+        targets = self.ids() if board_ids is None else list(board_ids)
+        futures = {}
+        for board_id in targets:
+            try:
+                futures[board_id] = self.get(board_id).submit(command, timeout)
+            except KeyError:
+                futures[board_id] = None
+        concurrent.futures.wait([f for f in futures.values() if f])
+        return {b: f.result() if f else None for b, f in futures.items()}
+
+    def close(self):
+        with self._lock:
+            closing = list(self._boards.values())
+            self._boards.clear()
+        for board in closing:
+            board.close()
@@ -9,6 +9,11 @@ import time
 import glob
 import re
 
+# Also runnable as a script (python3 flaskr/controller.py) for the plain terminal
+if not __package__:
+    sys.path.insert(0, os.path.dirname(os.path.dirname(os.path.abspath(__file__))))
+from flaskr.boards import REFRESH_S, BoardManager, filter_line
+
 opening = r"""
  ____ ____ ____ ____ ____ _________ ____ ____ ____ 
 ||S |||T |||M |||3 |||2 |||       |||D |||e |||v ||
@@ -28,13 +33,19 @@ def get_opening():
     return opening
 
 # Configuration
-def find_serial_port():
+def find_serial_ports():
+    """Every likely board as (board_id, port). The id is the USB serial number
+    when the port reports one, so it survives replugging into another port."""
+    # Explicit list, e.g. BOARD_PORTS=/dev/ttyACM0,/dev/ttyACM1
+    if os.environ.get('BOARD_PORTS'):
+        ports = [p for p in os.environ['BOARD_PORTS'].split(',') if p]
+        return [(os.path.basename(p), p) for p in ports]
+
+    infos = list(serial.tools.list_ports.comports())
     if platform.system() == "Windows":
         # Windows-specific serial port detection
-        ports = list(serial.tools.list_ports.comports())
-        
-        likely_microcontroller_ports = [
-            p for p in ports if (
+        found = [
+            p.device for p in infos if (
                 "USB Serial Device" in str(p.description) or
                 "Arduino" in str(p.description) or
                 "CP210x" in str(p.description) or
@@ -43,15 +54,6 @@ def find_serial_port():
                 "VID:PID" in str(p.hwid)
             )
         ]
-
-        if not likely_microcontroller_ports:
-            print("No serial ports found. Ensure the board is connected.")
-            sys.exit()
-        elif len(likely_microcontroller_ports) > 1:
-            print(f"Multiple potential serial ports found: {[p.device for p in likely_microcontroller_ports]}. The first one has been selected.")
-        
-        return likely_microcontroller_ports[0].device
-        
     elif platform.system() in ["Linux", "Darwin"]: # Darwin is macOS
         # Unix-like (macOS/Linux) serial port detection
         # Common patterns for microcontrollers on these systems
@@ -61,80 +63,77 @@ def find_serial_port():
             '/dev/cu.usbmodem*', # macOS (common for Arduino, ESP32 Dev Boards)
             '/dev/tty.usbmodem*', # macOS (alternative for some USB modems)
         ]
-        
-        found_ports = []
-        for pattern in patterns:
-            found_ports.extend(glob.glob(pattern))
-        
-        # Remove duplicates
-        found_ports = sorted(list(set(found_ports)))
-
-        if not found_ports:
-            print("No serial ports found. Ensure the board is connected.")
-            sys.exit()
-        elif len(found_ports) > 1:
-            print(f"Multiple serial ports found: {found_ports}. The first one has been selected.")
-        
-        return found_ports[0]
+        found = sorted(set(p for pattern in patterns for p in glob.glob(pattern)))
     else:
         print(f"Unsupported operating system: {platform.system()}")
-        sys.exit()
+        return []
 
+    serials = {p.device: p.serial_number for p in infos if p.serial_number}
+    boards = []
+    for port in found:
+        board_id = serials.get(port) or os.path.basename(port)
+        # macOS lists each board twice, as cu.* and tty.*
+        if board_id not in dict(boards):
+            boards.append((board_id, port))
+    return boards
+
+def find_serial_port():
+    """The first board's port, for scripts that talk to one board."""
+    ports = find_serial_ports()
+    if not ports:
+        print("No serial ports found. Ensure the board is connected.")
+        sys.exit()
+    elif len(ports) > 1:
+        print(f"Multiple serial ports found: {[p for _, p in ports]}. The first one has been selected.")
+    return ports[0][1]
 
 
-# SERIAL_PORT = '/dev/cu.usbmodem103'  # Adjust for your macOS port (e.g., /dev/cu.usbmodemXXXX)
-SERIAL_PORT = find_serial_port()
 BAUD_RATE = 115200
-DATA_DIR = 'motion_data'
-GESTURES = ['up-down', 'shake', 'wave', 'circle', 'tap', 'twist', 'figure-eight']
-SAMPLES_PER_GESTURE = 50
-SAMPLE_DURATION = 2  # seconds (128 samples at 52 Hz)
-FEATURES = [
-    'mean_ax', 'mean_ay', 'mean_az', 'std_ax', 'std_ay', 'std_az', 'sma_a',
-    'corr_ax_ay', 'corr_ax_az', 'corr_ay_az',
-    'mean_gx', 'mean_gy', 'mean_gz', 'std_gx', 'std_gy', 'std_gz', 'sma_g',
-    'corr_gx_gy', 'corr_gx_gz', 'corr_gy_gz'
-]
-
-
-def filter_line(line, command_sent):
-    ANSI_ESCAPE = re.compile(r'\x1B(?:[@-Z\\-_]|\[[0-?]*[ -/]*[@-~])')
-    filter = ['<dbg>', '<wrn>', 'uart:~$']
-    if any(f in line for f in filter):
-        return None
-    if command_sent.strip() == line.strip():
-        return None
-    return ANSI_ESCAPE.sub('', line)
-
-def send_command(command, timeout_val=0.3):
+# Asked for after connecting, see src/uart_speed.c. BOARD_FAST_BAUD=0 stays at BAUD_RATE
+FAST_BAUD_RATE = int(os.environ.get('BOARD_FAST_BAUD', 921600))
+# Every attached board, found on first use so the server also starts without one
+boards = BoardManager(find_serial_ports, BAUD_RATE, FAST_BAUD_RATE or None)
+# Gesture dataset settings, see gestures/ and gesture_dataset.py
+from gestures import DATA_DIR, GESTURES, SAMPLES_PER_GESTURE, SAMPLE_DURATION, FEATURES
+
+
+# Handled by process_command itself rather than sent to a board
+META_COMMANDS = ('term_help', 'boards', 'all', 'set_timeout', 'os_do')
+
+def is_meta_command(command):
+    words = command.split()
+    return bool(words) and words[0].lower() in META_COMMANDS
+
+def get_board(board_id=None):
+    """The board with board_id (default: the first), rescanning the ports
+    if it is not known yet. Raises KeyError when there is no such board."""
+    try:
+        return boards.get(board_id)
+    except KeyError:
+        # At most one scan a second for ids that keep missing
+        boards.refresh(max_age=1.0)
+        return boards.get(board_id)
+
+def send_command(command, timeout_val=0.3, board_id=None):
     try:
-        with serial.Serial(SERIAL_PORT, BAUD_RATE, timeout=timeout_val) as ser:
-            command += '\n'  # Ensure the command ends with a newline
-
-            # Flush input and output buffers
-            ser.reset_input_buffer()
-            ser.reset_output_buffer()
-
-            # Send the shell command
-            ser.write(command.encode('utf-8'))
-            print(f"Sent command: {command.strip()}")
-
-            # Read and print response
-            print("Board output:")
-            start_time = time.time()
-            response = ""
-            while time.time() - start_time < timeout_val:  # read for timeout seconds
-                line = ser.readline().decode('utf-8', errors='ignore').strip()
-                line = filter_line(line, command)
-                if line:
-                    response += line + "\n"
-                    print(line)
-            return response
-
-    except serial.SerialException as e:
-        print(f"Serial error: {e}")
-
-def process_command(command, timeout_val=0.3):
+        board = get_board(board_id)
+    except KeyError:
+        return f"No board {board_id}" if board_id else "No board connected"
+    return board.command(command, timeout=timeout_val)
+
+def send_command_all(command, timeout_val=0.3, board_ids=None):
+    """Runs command on every board (or board_ids) in parallel, {board_id: response}."""
+    if board_ids is None:
+        boards.refresh(max_age=REFRESH_S)
+    elif any(b not in boards.ids() for b in board_ids):
+        boards.refresh(max_age=1.0)
+    return boards.fan_out(command, timeout=timeout_val, board_ids=board_ids)
+
+def format_responses(responses):
+    return "".join(f"[{board_id}]\n{text if text is not None else 'No such board'}\n"
+                   for board_id, text in responses.items())
+
+def process_command(command, timeout_val=0.3, board_id=None):
     """Process a single command and return the response."""
     if command.lower() == 'term_help':
         return (
@@ -143,8 +142,16 @@ def process_command(command, timeout_val=0.3):
             "  - 'term_help': Get help related to the Python terminal interface\n"
             "  - 'set_timeout <seconds>': Set the timeout for serial commands (default is 0.3 seconds)\n"
             "  - 'os_do <command>': Execute a shell command on the host system\n"
+            "  - 'boards': List the connected boards\n"
+            "  - 'all <command>': Send a command to every board at once\n"
             "  - 'clear': Clear the terminal output\n"
         )
+    elif command.lower() == 'boards':
+        boards.refresh(max_age=REFRESH_S)
+        listed = [f"{b.id}  {b.port}" for b in boards.boards()]
+        return "\n".join(listed) if listed else "No board connected"
+    elif command.lower().startswith('all '):
+        return format_responses(send_command_all(command[4:].strip(), timeout_val=timeout_val))
     elif command.lower().startswith('set_timeout '):
         try:
             timeout_val = float(command.split()[1])
@@ -162,17 +169,22 @@ def process_command(command, timeout_val=0.3):
             return f"Error executing OS command: {e}"
     else:
         # Send the command to the board
-        response = send_command(command, timeout_val=timeout_val)
+        response = send_command(command, timeout_val=timeout_val, board_id=board_id)
         return response
 
 def terminal():
     timeout_val = 0.3  # Default timeout value
     print(opening)
-    print(f"Using serial port: {SERIAL_PORT}")
+    ids = boards.refresh()
+    board_id = ids[0] if ids else None
+    print(f"Boards: {', '.join(ids) or 'none'}. Type 'use <board>' to switch.")
     while True:
         print("Ready to send commands. Type 'exit' to quit, or 'term_help' for help related to the Python terminal interface.")
-        command = input("Enter command: ").strip()
-        response = process_command(command, timeout_val=timeout_val)
+        command = input(f"[{board_id}] Enter command: ").strip()
+        if command.startswith('use '):
+            board_id = command[4:].strip()
+            continue
+        response = process_command(command, timeout_val=timeout_val, board_id=board_id)
         if response == "Exiting...":
             print(response)
             break
@@ -186,3 +198,5 @@ if __name__ == '__main__':
         terminal()
     except KeyboardInterrupt:
         print("Program terminated")
+    finally:
+        boards.close()
@@ -1,5 +1,8 @@
-from flask import Blueprint, request, jsonify
+import time
+
+from flask import Blueprint, current_app, request, jsonify
 from .controller import *
+from ingest.query import MAX_POINTS, list_sources, query
 
 bp = Blueprint('routes', __name__)
 
@@ -9,7 +12,9 @@ def index():
 
 @bp.route('/process_command', methods=['POST'])
 def api_process_command():
-    """API endpoint to process terminal commands."""
+    """API endpoint to process terminal commands.
+
+    Goes to the board named by "board" in the body, or the first board."""
     data = request.json
     command = data.get('command', '')
     timeout_val = data.get('timeout', 0.3)
@@ -17,9 +22,91 @@ def api_process_command():
     if not command:
         return jsonify({'error': 'No command provided'}), 400
 
-    response = process_command(command, timeout_val=timeout_val)
+    response = process_command(command, timeout_val=timeout_val, board_id=data.get('board'))
     return jsonify({'response': response})
 
 @bp.route('/startup', methods=['GET'])
 def api_startup():
-    return jsonify({'response': get_opening()})
\ No newline at end of file
+    return jsonify({'response': get_opening()})
+
+@bp.route('/boards', methods=['GET'])
+def api_boards():
+    """Every connected board, with its port and command counters."""
+    boards.refresh(max_age=REFRESH_S)
+    return jsonify([b.info() for b in boards.boards()])
+
+@bp.route('/boards/<board_id>/process_command', methods=['POST'])
+def api_board_process_command(board_id):
+    data = request.json
+    command = data.get('command', '')
+    if not command:
+        return jsonify({'error': 'No command provided'}), 400
+    if is_meta_command(command):
+        # `all ...` or `os_do ...` would not stay on this board
+        return jsonify({'error': f'{command.split()[0]} is a terminal command, use /process_command'}), 400
+    try:
+        get_board(board_id)
+    except KeyError:
+        return jsonify({'error': f'No board {board_id}'}), 404
+
+    response = process_command(command, timeout_val=data.get('timeout', 0.3), board_id=board_id)
+    return jsonify({'board': board_id, 'response': response})
+
+@bp.route('/boards/<board_id>/startup', methods=['GET'])
+def api_board_startup(board_id):
+    try:
+        board = get_board(board_id)
+    except KeyError:
+        return jsonify({'error': f'No board {board_id}'}), 404
+    return jsonify({'board': board_id, 'response': f"{get_opening()}\nBoard {board.id} on {board.port}"})
+
+@bp.route('/boards/process_command', methods=['POST'])
+def api_boards_process_command():
+    """Sends one command to many boards at once.
+
+    Body: command, optional timeout, optional boards (a list of ids, default
+    all). The call takes as long as the slowest board, not the sum."""
+    data = request.json
+    command = data.get('command', '')
+    if not command:
+        return jsonify({'error': 'No command provided'}), 400
+
+    started = time.monotonic()
+    responses = send_command_all(command, timeout_val=data.get('timeout', 0.3),
+                                 board_ids=data.get('boards'))
+    return jsonify({
+        'responses': responses,
+        'elapsed_ms': round((time.monotonic() - started) * 1000, 1),
+    })
+
+@bp.route('/history', methods=['GET'])
+def api_history_sources():
+    """Boards and sensors with stored data (see ingest_run.py)."""
+    return jsonify(list_sources(current_app.config['SENSOR_DATA_DIR']))
+
+@bp.route('/history/<board>/<sensor>', methods=['GET'])
+def api_history(board, sensor):
+    """Downsampled series for a chart.
+
+    Query parameters: start and end in unix ms (default: the last hour),
+    points (default 500, at most MAX_POINTS) and fields (comma separated,
+    default all). Returns one min/max/mean per field for each bucket that
+    has data, with the bucket start times in t.
+    """
+    try:
+        end = int(request.args.get('end', time.time() * 1000))
+        start = int(request.args.get('start', end - 3600 * 1000))
+        points = int(request.args.get('points', 500))
+    except ValueError:
+        return jsonify({'error': 'start, end and points must be integers'}), 400
+    if start >= end or not 0 < points <= MAX_POINTS:
+        return jsonify({'error': f'need start < end and 0 < points <= {MAX_POINTS}'}), 400
+    fields = [f for f in request.args.get('fields', '').split(',') if f] or None
+
+    try:
+        result = query(current_app.config['SENSOR_DATA_DIR'], board, sensor, start, end, points, fields)
+    except KeyError as e:
+        return jsonify({'error': f'unknown field {e.args[0]}'}), 400
+    if result is None:
+        return jsonify({'error': f'no data for {board}/{sensor} in that range'}), 404
+    return jsonify(result)
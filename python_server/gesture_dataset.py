@@ -0,0 +1,173 @@
+"""Gesture dataset tool: record IMU windows from a board, then build features.
+
+    python3 gesture_dataset.py capture --port /dev/ttyACM0     # 7 x 50 windows
+    python3 gesture_dataset.py features --augment 20           # features.npz/.csv
+    python3 gesture_dataset.py train                           # ../src/gesture_model.c
+    python3 gesture_dataset.py synth                           # fake windows, no board
+
+`capture` keeps one serial connection open and asks the board for one window
+at a time with `imu_window`, so a full dataset takes about as long as the
+gestures themselves (2.5 s sampling + 0.3 s transfer per window at 115200).
+It resumes where an earlier, interrupted run stopped. `features` computes
+the FEATURES of every recorded window plus `--augment` perturbed copies of
+each, spread over all cores, and marks a held-out test split. `train` fits
+the on-device classifier to the training rows and writes its int8 tables as
+C source for the firmware, reporting accuracy on the test rows.
+"""
+import argparse
+import os
+import sys
+import time
+
+import numpy as np
+
+from gestures import DATA_DIR, FEATURES, GESTURES, SAMPLES_PER_GESTURE, WINDOW_HZ
+from gestures.capture import WindowReader, empty_dataset, find_port, load_dataset, record, save_dataset
+from gestures.features import build_training_set, split_by_source
+from gestures import model
+from gestures.synth import synthetic_dataset
+
+WINDOWS_FILE = os.path.join(DATA_DIR, 'windows.npz')
+FEATURES_FILE = os.path.join(DATA_DIR, 'features.npz')
+MODEL_C_FILE = os.path.join(os.path.dirname(os.path.abspath(__file__)), '..', 'src', 'gesture_model.c')
+
+
+def cmd_capture(args):
+    port = args.port or find_port()
+    if not port:
+        sys.exit("No serial port found, pass --port")
+    gestures = args.gestures or GESTURES
+    if os.path.exists(args.out) and not args.restart:
+        data = load_dataset(args.out)
+        if [str(g) for g in data["gestures"]] != list(gestures):
+            sys.exit(f"{args.out} holds other gestures, use --restart or another --out")
+        print(f"Resuming {args.out}: {int(data['recorded'].sum())}/{len(data['recorded'])} windows recorded")
+    else:
+        data = empty_dataset(gestures, args.per_gesture)
+
+    reader = WindowReader(port, args.baud)
+    print(f"Recording from {port} at {args.baud} baud, {args.hz} Hz windows")
+    started = time.monotonic()
+    try:
+        record(reader, data, args.out, rest_s=args.rest, hz=args.hz)
+    finally:
+        reader.close()
+    missed = int(data["missed"].sum())
+    print(f"{int(data['recorded'].sum())} windows in {time.monotonic() - started:.0f} s, "
+          f"{missed} missed sample periods, saved to {args.out}")
+
+
+def cmd_synth(args):
+    data = synthetic_dataset(args.gestures or GESTURES, args.per_gesture, seed=args.seed)
+    save_dataset(args.out, data)
+    print(f"{len(data['labels'])} synthetic windows saved to {args.out}")
+
+
+def cmd_features(args):
+    data = load_dataset(args.input)
+    keep = data["recorded"]
+    windows, labels = data["windows"][keep], data["labels"][keep]
+    if not len(windows):
+        sys.exit(f"No recorded windows in {args.input}")
+
+    started = time.perf_counter()
+    X, y, source = build_training_set(windows, labels, copies=args.augment,
+                                      workers=args.workers, chunk=args.chunk, seed=args.seed)
+    test = split_by_source(source, y, args.test_fraction, seed=args.seed)
+    elapsed = time.perf_counter() - started
+
+    gestures = data["gestures"]
+    os.makedirs(os.path.dirname(args.out) or ".", exist_ok=True)
+    np.savez(args.out, X=X, y=y, source=source, test=test,
+             features=np.array(FEATURES), gestures=gestures)
+    csv = os.path.splitext(args.out)[0] + ".csv"
+    table = np.column_stack([X.astype(object), gestures[y], np.where(test, "test", "train")])
+    np.savetxt(csv, table, fmt=["%.6g"] * len(FEATURES) + ["%s", "%s"], delimiter=",",
+               header=",".join(FEATURES + ["gesture", "split"]), comments="")
+
+    print(f"{len(windows)} windows x {args.augment + 1} -> {len(X)} rows of {X.shape[1]} features "
+          f"in {elapsed:.2f} s ({len(X) / elapsed:,.0f} rows/s), {int(test.sum())} held out for test")
+    print(f"Saved {args.out} and {csv}")
+
+
+def cmd_train(args):
+    data = np.load(args.input)
+    X, y, test = data["X"], data["y"], data["test"]
+    gestures = [str(g) for g in data["gestures"]]
+    train = ~test if test.any() else np.ones(len(y), dtype=bool)
+
+    started = time.perf_counter()
+    params = model.train(X[train], y[train], len(gestures), hidden=args.hidden,
+                         epochs=args.epochs, seed=args.seed)
+    q = model.quantize(params, X[train])
+    elapsed = time.perf_counter() - started
+
+    rows = test if test.any() else train
+    float_acc = (model.float_predict(params, X[rows]) == y[rows]).mean()
+    pred, _ = model.quantized_predict(q, X[rows])
+    int8_acc = (pred == y[rows]).mean()
+    print(f"trained on {int(train.sum())} rows in {elapsed:.1f} s, "
+          f"{'test' if test.any() else 'train'} accuracy: float {float_acc:.1%}, int8 {int8_acc:.1%}")
+    confusion = np.zeros((len(gestures), len(gestures)), dtype=int)
+    np.add.at(confusion, (y[rows], pred), 1)
+    width = max(len(g) for g in gestures)
+    for g, row in zip(gestures, confusion):
+        print(f"  {g:>{width}} " + " ".join(f"{c:4d}" for c in row))
+
+    split = "test" if test.any() else "training"
+    note = (f"{len(gestures)} gestures, {int(train.sum())} training rows, "
+            f"int8 accuracy {int8_acc:.1%} on {int(rows.sum())} {split} rows")
+    if args.note:
+        note = f"{args.note}\n// {note}"
+    model.export_c(q, gestures, args.out, note)
+    size = q["w1"].size + q["w2"].size + 4 * (q["b1"].size + q["b2"].size) + 8 * q["feat_mean"].size
+    print(f"Wrote {os.path.normpath(args.out)}, {size} bytes of tables")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n")[0])
+    sub = parser.add_subparsers(dest="command", required=True)
+
+    p = sub.add_parser("capture", help="record windows from a board")
+    p.add_argument("--port", help="serial port (default: first board found)")
+    p.add_argument("--baud", type=int, default=115200)
+    p.add_argument("--hz", type=int, default=WINDOW_HZ)
+    p.add_argument("--per-gesture", type=int, default=SAMPLES_PER_GESTURE)
+    p.add_argument("--gestures", nargs="+")
+    p.add_argument("--rest", type=float, default=1.0, help="seconds between windows")
+    p.add_argument("--out", default=WINDOWS_FILE)
+    p.add_argument("--restart", action="store_true", help="ignore an earlier partial recording")
+    p.set_defaults(func=cmd_capture)
+
+    p = sub.add_parser("synth", help="write synthetic windows")
+    p.add_argument("--per-gesture", type=int, default=SAMPLES_PER_GESTURE)
+    p.add_argument("--gestures", nargs="+")
+    p.add_argument("--seed", type=int, default=0)
+    p.add_argument("--out", default=WINDOWS_FILE)
+    p.set_defaults(func=cmd_synth)
+
+    p = sub.add_parser("features", help="compute features and the training set")
+    p.add_argument("--input", default=WINDOWS_FILE)
+    p.add_argument("--out", default=FEATURES_FILE)
+    p.add_argument("--augment", type=int, default=0, help="perturbed copies per window")
+    p.add_argument("--workers", type=int, help="processes (default: all cores)")
+    p.add_argument("--chunk", type=int, default=256, help="windows per job")
+    p.add_argument("--test-fraction", type=float, default=0.2)
+    p.add_argument("--seed", type=int, default=0)
+    p.set_defaults(func=cmd_features)
+
+    p = sub.add_parser("train", help="train the on-device classifier and export it as C")
+    p.add_argument("--input", default=FEATURES_FILE)
+    p.add_argument("--out", default=MODEL_C_FILE)
+    p.add_argument("--hidden", type=int, default=24, help="hidden units, at most 64")
+    p.add_argument("--epochs", type=int, default=150)
+    p.add_argument("--seed", type=int, default=0)
+    p.add_argument("--note", default="", help="extra line for the comment at the top of the C file")
+    p.set_defaults(func=cmd_train)
+
+    args = parser.parse_args()
+    args.func(args)
+
+
+if __name__ == "__main__":
+    main()
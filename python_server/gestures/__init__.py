@@ -0,0 +1,19 @@
+"""Gesture dataset definitions shared by the terminal bridge and the tools.
+
+A sample is one window of WINDOW_LEN LSM6DSL readings at WINDOW_HZ, six
+channels in CHANNELS order. Datasets are held as float32 arrays of shape
+(windows, WINDOW_LEN, 6) with an int label per window, an index into GESTURES.
+"""
+DATA_DIR = 'motion_data'
+GESTURES = ['up-down', 'shake', 'wave', 'circle', 'tap', 'twist', 'figure-eight']
+SAMPLES_PER_GESTURE = 50
+SAMPLE_DURATION = 2  # seconds (128 samples at 52 Hz)
+WINDOW_LEN = 128
+WINDOW_HZ = 52
+CHANNELS = ['accel_x', 'accel_y', 'accel_z', 'gyro_x', 'gyro_y', 'gyro_z']
+FEATURES = [
+    'mean_ax', 'mean_ay', 'mean_az', 'std_ax', 'std_ay', 'std_az', 'sma_a',
+    'corr_ax_ay', 'corr_ax_az', 'corr_ay_az',
+    'mean_gx', 'mean_gy', 'mean_gz', 'std_gx', 'std_gy', 'std_gz', 'sma_g',
+    'corr_gx_gy', 'corr_gx_gz', 'corr_gy_gz'
+]
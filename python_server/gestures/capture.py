@@ -0,0 +1,145 @@
+"""Recording gesture windows from a board over one open serial connection.
+
+The board's `imu_window <samples> <hz>` command (src/imu_window.c) samples
+the LSM6DSL on its own timer and then prints the window as one block:
+
+    IMU_WINDOW <samples> <hz> <accel lsb per m/s^2> <gyro lsb per rad/s>
+    IMU <hex>          8 samples per line, 6 little-endian int16 each
+    ...
+    IMU_END <missed timer periods>
+
+Windows are decoded straight into rows of a preallocated array, and the
+dataset file is rewritten after every gesture so a recording can be resumed.
+"""
+import glob
+import os
+import re
+import time
+
+import numpy as np
+
+from . import CHANNELS, GESTURES, SAMPLES_PER_GESTURE, WINDOW_HZ, WINDOW_LEN
+
+BAUD_RATE = 115200
+_ANSI = re.compile(r'\x1B(?:[@-Z\\-_]|\[[0-?]*[ -/]*[@-~])')
+_FRAME = re.compile(r'(IMU_WINDOW|IMU_END|IMU_ERROR|IMU) (.*)')
+PORT_PATTERNS = ['/dev/ttyACM*', '/dev/ttyUSB*', '/dev/cu.usbmodem*', '/dev/tty.usbmodem*']
+
+
+class CaptureError(Exception):
+    pass
+
+
+def find_port():
+    """First likely board port, or None. Unlike controller.find_serial_port()
+    this does not exit, so the tools can run without a board attached."""
+    found = sorted(p for pattern in PORT_PATTERNS for p in glob.glob(pattern))
+    if found:
+        return found[0]
+    try:
+        import serial.tools.list_ports
+        ports = [p.device for p in serial.tools.list_ports.comports()
+                 if 'USB' in str(p.description) or 'VID:PID' in str(p.hwid)]
+        return ports[0] if ports else None
+    except ImportError:
+        return None
+
+
+class WindowReader:
+    """Requests windows from one board over a serial port kept open."""
+
+    def __init__(self, port, baud=BAUD_RATE):
+        import serial
+        self.ser = serial.Serial(port, baud, timeout=0.5)
+        self.ser.reset_input_buffer()
+
+    def close(self):
+        self.ser.close()
+
+    def read_window(self, out, hz=WINDOW_HZ, timeout=None):
+        """Fills out, a (samples, 6) float32 array, in m/s^2 and rad/s.
+
+        Returns the number of timer periods the board missed while sampling.
+        """
+        samples = out.shape[0]
+        # Sampling time plus the hex at 10 bits per character and some slack
+        timeout = timeout or samples / hz + samples * 26 * 10 / self.ser.baudrate + 2.0
+        self.ser.write(f"imu_window {samples} {hz}\n".encode())
+
+        raw = bytearray()
+        header = None
+        deadline = time.monotonic() + timeout
+        while time.monotonic() < deadline:
+            line = self.ser.readline().decode('ascii', errors='ignore')
+            found = _FRAME.search(_ANSI.sub('', line))
+            if not found:
+                continue
+            kind, rest = found.group(1), found.group(2).strip()
+            if kind == 'IMU_ERROR':
+                raise CaptureError(f"board: {rest}")
+            if kind == 'IMU_WINDOW':
+                header = [int(v) for v in rest.split()]
+                raw.clear()
+            elif kind == 'IMU' and header:
+                raw += bytes.fromhex(rest)
+            elif kind == 'IMU_END' and header:
+                return self._decode(raw, header, out, int(rest.split()[0]))
+        raise CaptureError(f"no complete window within {timeout:.1f} s")
+
+    @staticmethod
+    def _decode(raw, header, out, missed):
+        count, _, accel_lsb, gyro_lsb = header
+        if count != out.shape[0] or len(raw) != count * 12:
+            raise CaptureError(f"window has {len(raw)} bytes for {count} samples")
+        fixed = np.frombuffer(bytes(raw), dtype='<i2').reshape(count, 6)
+        np.divide(fixed[:, :3], accel_lsb, out=out[:, :3], casting='unsafe')
+        np.divide(fixed[:, 3:], gyro_lsb, out=out[:, 3:], casting='unsafe')
+        return missed
+
+
+def empty_dataset(gestures=GESTURES, per_gesture=SAMPLES_PER_GESTURE, samples=WINDOW_LEN):
+    n = len(gestures) * per_gesture
+    return {
+        "windows": np.zeros((n, samples, len(CHANNELS)), dtype=np.float32),
+        "labels": np.repeat(np.arange(len(gestures)), per_gesture),
+        "recorded": np.zeros(n, dtype=bool),
+        "missed": np.zeros(n, dtype=np.int32),
+        "gestures": np.array(gestures),
+        "channels": np.array(CHANNELS),
+        "hz": np.int32(WINDOW_HZ),
+    }
+
+
+def load_dataset(path):
+    with np.load(path) as f:
+        return {k: f[k] for k in f.files}
+
+
+def save_dataset(path, data):
+    os.makedirs(os.path.dirname(path) or ".", exist_ok=True)
+    tmp = path + ".tmp.npz"
+    np.savez(tmp, **data)
+    os.replace(tmp, path)
+
+
+def record(reader, data, path, rest_s=1.0, hz=WINDOW_HZ, wait=input, log=print):
+    """Records every window of data that is not recorded yet, gesture by
+    gesture, saving to path after each gesture."""
+    gestures = [str(g) for g in data["gestures"]]
+    for g, name in enumerate(gestures):
+        todo = np.flatnonzero((data["labels"] == g) & ~data["recorded"])
+        if not len(todo):
+            continue
+        wait(f"Next gesture: {name}, {len(todo)} windows. Press Enter to start...")
+        started = time.monotonic()
+        try:
+            for k, row in enumerate(todo):
+                log(f"  {name} {k + 1}/{len(todo)}: go")
+                data["missed"][row] = reader.read_window(data["windows"][row], hz=hz)
+                data["recorded"][row] = True
+                time.sleep(rest_s)
+        finally:
+            # Keeps what was recorded when interrupted, a rerun picks up from there
+            save_dataset(path, data)
+        log(f"  {name} done in {time.monotonic() - started:.0f} s, saved to {path}")
+    return data
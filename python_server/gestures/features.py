@@ -0,0 +1,117 @@
+"""Window features and training set generation, vectorized over whole datasets.
+
+Every kernel works on a (windows, samples, 6) array at once, so the cost is
+a handful of numpy passes over the data instead of a Python loop per window.
+Training sets with augmented copies are cut into fixed chunks that run in a
+process pool; each chunk has its own seed, so the result does not depend on
+the number of workers.
+"""
+from concurrent.futures import ProcessPoolExecutor
+import os
+
+import numpy as np
+
+from . import FEATURES
+
+# (i, j) channel pairs of the corr_* features, accel then gyro
+_PAIRS = [(0, 1), (0, 2), (1, 2), (3, 4), (3, 5), (4, 5)]
+
+
+def extract(windows):
+    """(N, T, 6) windows to (N, len(FEATURES)) float32 features.
+
+    std is the population standard deviation, sma the mean over the window of
+    |x| + |y| + |z|, and corr the Pearson correlation (0 for a flat channel).
+    """
+    x = np.asarray(windows, dtype=np.float64)
+    if x.ndim != 3 or x.shape[2] != 6:
+        raise ValueError(f"expected (windows, samples, 6), got {x.shape}")
+    mean = x.mean(axis=1)
+    centered = x - mean[:, None, :]
+    cov = np.einsum("ntc,ntd->ncd", centered, centered) / x.shape[1]
+    var = np.diagonal(cov, axis1=1, axis2=2)
+    std = np.sqrt(var)
+    sma = np.abs(x).reshape(x.shape[0], x.shape[1], 2, 3).sum(axis=3).mean(axis=1)
+
+    i, j = np.array(_PAIRS).T
+    denom = std[:, i] * std[:, j]
+    corr = np.divide(cov[:, i, j], denom, out=np.zeros_like(denom), where=denom > 0)
+
+    out = np.empty((x.shape[0], len(FEATURES)), dtype=np.float32)
+    for group, base in ((0, 0), (1, 10)):
+        axes = slice(group * 3, group * 3 + 3)
+        out[:, base:base + 3] = mean[:, axes]
+        out[:, base + 3:base + 6] = std[:, axes]
+        out[:, base + 6] = sma[:, group]
+        out[:, base + 7:base + 10] = corr[:, group * 3:group * 3 + 3]
+    return out
+
+
+def augment(windows, rng, max_shift=0.1, scale=0.1, noise=(0.05, 0.02)):
+    """One randomly perturbed copy of every window.
+
+    Per window: a time shift of up to max_shift of the window (edges held),
+    a gain of 1 +- scale for accel and gyro separately, and Gaussian noise with
+    the given accel and gyro standard deviations.
+    """
+    n, t, _ = windows.shape
+    shift = rng.integers(-int(t * max_shift), int(t * max_shift) + 1, size=n)
+    idx = np.clip(np.arange(t)[None, :] - shift[:, None], 0, t - 1)
+    out = np.take_along_axis(windows, idx[:, :, None], axis=1)
+
+    gain = 1.0 + rng.uniform(-scale, scale, size=(n, 1, 2))
+    out *= np.repeat(gain, 3, axis=2).astype(out.dtype)
+    sigma = np.repeat(np.asarray(noise, dtype=out.dtype), 3)
+    out += rng.standard_normal(out.shape, dtype=out.dtype) * sigma
+    return out
+
+
+def _chunk_features(windows, copies, seed):
+    rng = np.random.default_rng(seed)
+    parts = [extract(windows)]
+    parts.extend(extract(augment(windows, rng)) for _ in range(copies))
+    return np.concatenate(parts)
+
+
+def build_training_set(windows, labels, copies=0, workers=None, chunk=256, seed=0):
+    """Features of every window plus `copies` augmented variants of each.
+
+    Returns (X, y, source): source is the index of the recorded window each
+    row comes from, so train/test splits can keep a window and its copies on
+    the same side.
+    """
+    windows = np.asarray(windows, dtype=np.float32)
+    labels = np.asarray(labels)
+    n = len(windows)
+    starts = list(range(0, n, chunk))
+    seeds = np.random.SeedSequence(seed).spawn(len(starts))
+    jobs = [(windows[s:s + chunk], copies, sd) for s, sd in zip(starts, seeds)]
+
+    workers = workers or os.cpu_count() or 1
+    if workers > 1 and len(jobs) > 1:
+        with ProcessPoolExecutor(max_workers=min(workers, len(jobs))) as pool:
+            results = list(pool.map(_chunk_features, *zip(*jobs)))
+    else:
+        results = [_chunk_features(*job) for job in jobs]
+
+    # Each chunk is laid out originals first, then one block per copy
+    index = np.arange(n)
+    sources = [np.tile(index[s:s + chunk], copies + 1) for s in starts]
+    source = np.concatenate(sources) if sources else index
+    X = np.concatenate(results) if results else np.empty((0, len(FEATURES)), np.float32)
+    return X, labels[source], source
+
+
+def split_by_source(source, labels, test_fraction, seed=0):
+    """Boolean test mask that holds out test_fraction of the recorded windows
+    of each gesture, with all of their augmented copies."""
+    rng = np.random.default_rng(seed)
+    held = np.zeros(source.max() + 1 if len(source) else 0, dtype=bool)
+    src_labels = np.zeros_like(held, dtype=labels.dtype)
+    src_labels[source] = labels
+    for g in np.unique(labels):
+        members = np.flatnonzero(src_labels == g)
+        members = members[np.isin(members, source)]
+        k = int(round(len(members) * test_fraction))
+        held[rng.choice(members, size=k, replace=False)] = True
+    return held[source]
@@ -0,0 +1,170 @@
+"""Gesture classifier for the board: a small MLP over the window FEATURES,
+trained in float and run on the device with int8 weights.
+
+    features -> standardize -> int8 -> dense+ReLU (int32 acc) -> int8 -> dense -> argmax
+
+`quantized_predict` follows the integer arithmetic of src/gesture.c step by
+step (float32 where the device uses float, floor(x + 0.5) for its rounding),
+so the accuracy printed at export time is the accuracy of the tables that
+go into flash. `export_c` writes those tables as src/gesture_model.c.
+"""
+import numpy as np
+
+from . import FEATURES
+
+# Inputs are clipped at this many standard deviations before quantizing
+INPUT_CLIP = 6.0
+
+
+def _init(rng, n_in, n_out):
+    return rng.normal(0, np.sqrt(2.0 / n_in), size=(n_in, n_out)), np.zeros(n_out)
+
+
+def train(X, y, num_classes, hidden=24, epochs=150, batch=256, lr=0.01, weight_decay=1e-4, seed=0):
+    """Float MLP with Adam on softmax cross entropy. Returns a params dict."""
+    rng = np.random.default_rng(seed)
+    X = np.asarray(X, dtype=np.float64)
+    mean = X.mean(axis=0)
+    std = X.std(axis=0)
+    std[std == 0] = 1.0
+    Z = (X - mean) / std
+
+    W1, b1 = _init(rng, X.shape[1], hidden)
+    W2, b2 = _init(rng, hidden, num_classes)
+    params = [W1, b1, W2, b2]
+    m = [np.zeros_like(p) for p in params]
+    v = [np.zeros_like(p) for p in params]
+    onehot = np.eye(num_classes)[y]
+    step = 0
+    for _ in range(epochs):
+        order = rng.permutation(len(Z))
+        for s in range(0, len(Z), batch):
+            idx = order[s:s + batch]
+            x, t = Z[idx], onehot[idx]
+            h_pre = x @ W1 + b1
+            h = np.maximum(h_pre, 0)
+            logits = h @ W2 + b2
+            p = np.exp(logits - logits.max(axis=1, keepdims=True))
+            p /= p.sum(axis=1, keepdims=True)
+
+            d_logits = (p - t) / len(idx)
+            d_h = (d_logits @ W2.T) * (h_pre > 0)
+            grads = [x.T @ d_h + weight_decay * W1, d_h.sum(axis=0),
+                     h.T @ d_logits + weight_decay * W2, d_logits.sum(axis=0)]
+            step += 1
+            for i, (param, g) in enumerate(zip(params, grads)):
+                m[i] = 0.9 * m[i] + 0.1 * g
+                v[i] = 0.999 * v[i] + 0.001 * g * g
+                mh = m[i] / (1 - 0.9 ** step)
+                vh = v[i] / (1 - 0.999 ** step)
+                param -= lr * mh / (np.sqrt(vh) + 1e-8)
+    return {"mean": mean, "std": std, "W1": W1, "b1": b1, "W2": W2, "b2": b2}
+
+
+def float_predict(params, X):
+    Z = (np.asarray(X, dtype=np.float64) - params["mean"]) / params["std"]
+    h = np.maximum(Z @ params["W1"] + params["b1"], 0)
+    return np.argmax(h @ params["W2"] + params["b2"], axis=1)
+
+
+def quantize(params, X_calib):
+    """int8 tables with symmetric per-layer scales, calibrated on X_calib."""
+    f32 = np.float32
+    in_scale = INPUT_CLIP / 127
+    w1_scale = np.abs(params["W1"]).max() / 127
+    w2_scale = np.abs(params["W2"]).max() / 127
+
+    Z = (np.asarray(X_calib, dtype=np.float64) - params["mean"]) / params["std"]
+    h = np.maximum(np.clip(Z, -INPUT_CLIP, INPUT_CLIP) @ params["W1"] + params["b1"], 0)
+    h_scale = max(np.percentile(h, 99.9), 1e-6) / 127
+
+    return {
+        "feat_mean": params["mean"].astype(f32),
+        "feat_inv_std": (1.0 / params["std"]).astype(f32),
+        "in_inv_scale": f32(1.0 / in_scale),
+        "w1": np.round(params["W1"].T / w1_scale).astype(np.int8),           # [hidden][features]
+        "b1": np.round(params["b1"] / (in_scale * w1_scale)).astype(np.int32),
+        "h_mult": f32(in_scale * w1_scale / h_scale),
+        "w2": np.round(params["W2"].T / w2_scale).astype(np.int8),           # [classes][hidden]
+        "b2": np.round(params["b2"] / (h_scale * w2_scale)).astype(np.int32),
+        "out_scale": f32(h_scale * w2_scale),
+    }
+
+
+def _to_int8(x):
+    return np.clip(np.floor(x + np.float32(0.5)), -127, 127).astype(np.int32)
+
+
+def quantized_predict(q, X):
+    """Class and int32 logits, computed the way src/gesture.c does."""
+    z = (np.asarray(X, dtype=np.float32) - q["feat_mean"]) * q["feat_inv_std"]
+    xq = _to_int8(z * q["in_inv_scale"])
+    acc1 = xq @ q["w1"].T.astype(np.int32) + q["b1"]
+    hq = _to_int8(np.maximum(acc1, 0).astype(np.float32) * q["h_mult"])
+    acc2 = hq @ q["w2"].T.astype(np.int32) + q["b2"]
+    return np.argmax(acc2, axis=1), acc2
+
+
+def _rows(values, fmt, per_line, indent="    "):
+    values = list(values)
+    lines = [", ".join(fmt(v) for v in values[i:i + per_line]) for i in range(0, len(values), per_line)]
+    return (",\n" + indent).join(lines)
+
+
+def _f(v):
+    return f"{float(v):.9g}f"
+
+
+def export_c(q, gestures, path, note):
+    hidden, n_feat = q["w1"].shape
+    n_cls = q["w2"].shape[0]
+    names = ", ".join(f'"{g}"' for g in gestures)
+    text = f"""// Generated by python_server/gesture_dataset.py train, do not edit.
+// {note}
+#include "gesture_model.h"
+
+static const char *const class_names[{n_cls}] = {{ {names} }};
+
+// Feature order: {", ".join(FEATURES)}
+static const float feat_mean[{n_feat}] = {{
+    {_rows(q["feat_mean"], _f, 5)}
+}};
+
+static const float feat_inv_std[{n_feat}] = {{
+    {_rows(q["feat_inv_std"], _f, 5)}
+}};
+
+static const int8_t w1[{hidden} * {n_feat}] = {{
+    {_rows(q["w1"].ravel(), str, n_feat)}
+}};
+
+static const int32_t b1[{hidden}] = {{
+    {_rows(q["b1"], str, 8)}
+}};
+
+static const int8_t w2[{n_cls} * {hidden}] = {{
+    {_rows(q["w2"].ravel(), str, hidden)}
+}};
+
+static const int32_t b2[{n_cls}] = {{
+    {_rows(q["b2"], str, 8)}
+}};
+
+const struct gesture_model gesture_model = {{
+    .num_features = {n_feat},
+    .hidden = {hidden},
+    .num_classes = {n_cls},
+    .class_names = class_names,
+    .feat_mean = feat_mean,
+    .feat_inv_std = feat_inv_std,
+    .in_inv_scale = {_f(q["in_inv_scale"])},
+    .w1 = w1,
+    .b1 = b1,
+    .h_mult = {_f(q["h_mult"])},
+    .w2 = w2,
+    .b2 = b2,
+    .out_scale = {_f(q["out_scale"])},
+}};
+"""
+    with open(path, "w") as f:
+        f.write(text)
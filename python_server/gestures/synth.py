@@ -0,0 +1,60 @@
+"""Synthetic gesture windows, to exercise the tools without a board.
+
+Each gesture is a rough kinematic caricature (gravity on z, plus the motion
+on the axes it mostly moves) with random amplitude, tempo, phase and sensor
+noise. They are separable but not trivially so, which is all the pipeline
+and model code need.
+"""
+import numpy as np
+
+from . import GESTURES, SAMPLES_PER_GESTURE, WINDOW_HZ, WINDOW_LEN
+from .capture import empty_dataset
+
+G = 9.81
+
+
+def _gesture(name, t, rng):
+    n = len(t)
+    amp = rng.uniform(0.7, 1.3)
+    f = rng.uniform(0.8, 1.2)
+    ph = rng.uniform(0, 2 * np.pi)
+    a = np.zeros((n, 3))
+    w = np.zeros((n, 3))
+    a[:, 2] = G
+    if name == 'up-down':
+        a[:, 2] += amp * 6 * np.sin(2 * np.pi * 1.0 * f * t + ph)
+    elif name == 'shake':
+        a[:, 0] += amp * 12 * np.sin(2 * np.pi * 4.0 * f * t + ph)
+        w[:, 2] += amp * 2 * np.sin(2 * np.pi * 4.0 * f * t + ph + 1.0)
+    elif name == 'wave':
+        a[:, 1] += amp * 5 * np.sin(2 * np.pi * 1.5 * f * t + ph)
+        w[:, 0] += amp * 3 * np.cos(2 * np.pi * 1.5 * f * t + ph)
+    elif name == 'circle':
+        a[:, 0] += amp * 5 * np.sin(2 * np.pi * 1.0 * f * t + ph)
+        a[:, 1] += amp * 5 * np.cos(2 * np.pi * 1.0 * f * t + ph)
+    elif name == 'tap':
+        at = rng.integers(n // 4, 3 * n // 4)
+        pulse = np.exp(-0.5 * ((np.arange(n) - at) / 1.5) ** 2)
+        a[:, 2] += amp * 25 * pulse
+        w[:, 1] += amp * 1.5 * pulse
+    elif name == 'twist':
+        w[:, 2] += amp * 6 * np.sin(2 * np.pi * 1.0 * f * t + ph)
+        a[:, 0] += amp * 1.0 * np.sin(2 * np.pi * 1.0 * f * t + ph)
+    elif name == 'figure-eight':
+        a[:, 0] += amp * 5 * np.sin(2 * np.pi * 1.0 * f * t + ph)
+        a[:, 1] += amp * 4 * np.sin(2 * np.pi * 2.0 * f * t + 2 * ph)
+        w[:, 2] += amp * 1.0 * np.cos(2 * np.pi * 1.0 * f * t + ph)
+    # Hand tremor and sensor noise
+    a += rng.normal(0, 0.3, size=a.shape)
+    w += rng.normal(0, 0.05, size=w.shape)
+    return np.hstack([a, w])
+
+
+def synthetic_dataset(gestures=GESTURES, per_gesture=SAMPLES_PER_GESTURE, seed=0):
+    data = empty_dataset(gestures, per_gesture)
+    rng = np.random.default_rng(seed)
+    t = np.arange(WINDOW_LEN) / WINDOW_HZ
+    for row, g in enumerate(data["labels"]):
+        data["windows"][row] = _gesture(gestures[g], t, rng)
+    data["recorded"][:] = True
+    return data
@@ -0,0 +1,83 @@
+"""Sample ingestion service: boards POST batches, they land in Parquet.
+
+Kept apart from flaskr (the serial terminal bridge), which needs a board on
+a serial port to start at all; this service only needs the network.
+"""
+import queue
+import threading
+import time
+
+from flask import Flask, Response, request, jsonify
+
+from .decode import DecodeError, check_name, decode_binary, decode_json
+from .live import LiveHub
+from .store import PartitionedWriter
+
+MAX_BODY = 32 * 1024 * 1024
+
+
+def create_app(data_dir="sensor_data", flush_rows=200_000, flush_s=5.0):
+    app = Flask(__name__)
+    app.config["MAX_CONTENT_LENGTH"] = MAX_BODY
+    writer = PartitionedWriter(data_dir, flush_rows=flush_rows, flush_s=flush_s)
+    app.extensions["ingest_writer"] = writer
+    hub = LiveHub()
+    started = time.monotonic()
+    totals = {"requests": 0, "samples": 0, "rejected": 0}
+    totals_lock = threading.Lock()
+
+    def count(**kw):
+        with totals_lock:
+            for k, v in kw.items():
+                totals[k] += v
+
+    @app.route('/ingest/<board>', methods=['POST'])
+    def ingest(board):
+        try:
+            check_name("board", board)
+            body = request.get_data(cache=False)
+            if request.mimetype == 'application/octet-stream':
+                batches = decode_binary(body)
+            else:
+                batches = decode_json(body)
+        except DecodeError as e:
+            count(rejected=1)
+            return jsonify({'error': str(e)}), 400
+
+        accepted = 0
+        for b in batches:
+            accepted += writer.append(board, b)
+            hub.publish(board, b)
+        count(requests=1, samples=accepted)
+        return jsonify({'accepted': accepted})
+
+    @app.route('/ingest/stats', methods=['GET'])
+    def ingest_stats():
+        uptime = time.monotonic() - started
+        with totals_lock:
+            snapshot = dict(totals)
+        return jsonify(dict(snapshot, uptime_s=round(uptime, 1),
+                            samples_per_s=round(snapshot["samples"] / uptime, 1), **writer.stats()))
+
+    @app.route('/live/<board>/<sensor>', methods=['GET'])
+    def live(board, sensor):
+        """Server-sent events with each batch as it arrives, for live charts."""
+        q = hub.subscribe(board, sensor)
+
+        def stream():
+            try:
+                yield 'retry: 2000\n\n'
+                while True:
+                    try:
+                        msg = q.get(timeout=15)
+                    except queue.Empty:
+                        yield ': keepalive\n\n'
+                        continue
+                    yield f'data: {msg}\n\n'
+            finally:
+                hub.unsubscribe(board, sensor, q)
+
+        headers = {'Cache-Control': 'no-cache', 'Access-Control-Allow-Origin': '*'}
+        return Response(stream(), mimetype='text/event-stream', headers=headers)
+
+    return app
@@ -0,0 +1,157 @@
+"""Decoding of batched sample uploads.
+
+Boards (or a bridge in front of them) send many samples per request, either
+as JSON or in a packed binary form. Both decode to the same thing: one
+`Batch` per sensor with a timestamp column and a float32 value matrix, so
+the rest of the pipeline never touches individual samples.
+
+JSON body, one object or a list of them:
+
+    {"sensor": "lsm6dsl",
+     "fields": ["accel_x", "accel_y", "accel_z", "gyro_x", "gyro_y", "gyro_z"],
+     "t": [1760860800000, 1760860800010, ...],          # unix ms
+     "values": [[0.1, 9.8, 0.2, 0.0, 0.0, 0.0], ...]}
+
+Binary body (Content-Type: application/octet-stream), little-endian, any
+number of blocks back to back:
+
+    char     magic[4] = "SMP1"
+    uint8    sensor_len
+    uint8    num_vals
+    uint16   reserved
+    uint32   count
+    char     sensor[sensor_len]
+    count x { int64 t_ms; float32 vals[num_vals]; }
+"""
+from dataclasses import dataclass
+import json
+import re
+import struct
+
+import numpy as np
+
+MAGIC = b"SMP1"
+BLOCK_HEADER = struct.Struct("<4sBBHI")
+
+MAX_VALS = 16
+MAX_SAMPLES = 1_000_000  # per block, keeps one request from exhausting memory
+NAME_RE = re.compile(r"^[A-Za-z0-9_.-]{1,32}$")
+
+# Axis names from the sensor table in src/main.c. Binary blocks carry no
+# field names, so these keep their columns the same as in JSON uploads
+SENSOR_FIELDS = {
+    "hts221": ["temperature", "humidity"],
+    "lps22hb": ["pressure"],
+    "lis3mdl": ["magnetic_x", "magnetic_y", "magnetic_z"],
+    "lsm6dsl": ["accel_x", "accel_y", "accel_z", "gyro_x", "gyro_y", "gyro_z"],
+    "vl53l0x": ["distance"],
+    "orientation": ["quat_w", "quat_x", "quat_y", "quat_z", "roll", "pitch", "yaw"],
+}
+
+
+class DecodeError(ValueError):
+    """The upload is malformed; reported back to the sender as a 400."""
+
+
+@dataclass
+class Batch:
+    sensor: str
+    fields: list
+    t_ms: np.ndarray    # int64, one per sample
+    values: np.ndarray  # float32, samples x fields
+
+
+def check_name(kind, name):
+    if not isinstance(name, str) or not NAME_RE.match(name):
+        raise DecodeError(f"bad {kind} name {name!r}")
+    return name
+
+
+def _finish(sensor, fields, t_ms, values):
+    if values.ndim != 2 or values.shape[0] != t_ms.shape[0]:
+        raise DecodeError(f"{sensor}: {t_ms.shape[0]} timestamps for {values.shape[0]} samples")
+    if values.shape[1] != len(fields) or not 0 < len(fields) <= MAX_VALS:
+        raise DecodeError(f"{sensor}: {values.shape[1]} values per sample for {len(fields)} fields")
+    if t_ms.shape[0] > MAX_SAMPLES:
+        raise DecodeError(f"{sensor}: more than {MAX_SAMPLES} samples in one block")
+
+    # Drop samples the sensor flagged as invalid (NaN/inf) in one pass
+    ok = np.isfinite(values).all(axis=1) & (t_ms > 0)
+    if not ok.all():
+        t_ms, values = t_ms[ok], values[ok]
+    return Batch(sensor, list(fields), t_ms, values)
+
+
+def decode_json(body):
+    try:
+        doc = json.loads(body)
+    except (UnicodeDecodeError, json.JSONDecodeError) as e:
+        raise DecodeError(f"bad JSON: {e}")
+
+    batches = []
+    for item in doc if isinstance(doc, list) else [doc]:
+        if not isinstance(item, dict):
+            raise DecodeError("expected an object per sensor")
+        sensor = check_name("sensor", item.get("sensor"))
+        fields = item.get("fields", [])
+        if not isinstance(fields, list):
+            raise DecodeError(f"{sensor}: fields must be a list of names")
+        for f in fields:
+            check_name("field", f)
+        # Each field becomes a column beside t_ms, so names must be unique
+        if len(set(fields)) != len(fields) or "t_ms" in fields:
+            raise DecodeError(f"{sensor}: repeated or reserved field name")
+        try:
+            t_ms = np.asarray(item.get("t", []), dtype=np.int64)
+            values = np.asarray(item.get("values", []), dtype=np.float32)
+        except (TypeError, ValueError, OverflowError) as e:
+            raise DecodeError(f"{sensor}: {e}")
+        if t_ms.ndim != 1:
+            raise DecodeError(f"{sensor}: t must be a flat list")
+        if values.size == 0:
+            values = values.reshape(0, len(fields))
+        batches.append(_finish(sensor, fields, t_ms, values))
+    return batches
+
+
+def decode_binary(body):
+    view = memoryview(body)
+    batches = []
+    pos = 0
+    while pos < len(view):
+        if len(view) - pos < BLOCK_HEADER.size:
+            raise DecodeError(f"truncated block header at byte {pos}")
+        magic, name_len, num_vals, _, count = BLOCK_HEADER.unpack_from(view, pos)
+        if magic != MAGIC:
+            raise DecodeError(f"bad magic at byte {pos}")
+        if not 0 < num_vals <= MAX_VALS or count > MAX_SAMPLES:
+            raise DecodeError(f"bad block size at byte {pos}")
+        pos += BLOCK_HEADER.size
+
+        sensor = check_name("sensor", bytes(view[pos:pos + name_len]).decode("ascii", "replace"))
+        pos += name_len
+
+        rec = np.dtype([("t", "<i8"), ("v", "<f4", (num_vals,))])
+        end = pos + count * rec.itemsize
+        if end > len(view):
+            raise DecodeError(f"{sensor}: block runs past the end of the body")
+        recs = np.frombuffer(view[pos:end], dtype=rec)
+        pos = end
+
+        fields = SENSOR_FIELDS.get(sensor)
+        if not fields or len(fields) != num_vals:
+            fields = [f"v{i}" for i in range(num_vals)]
+        batches.append(_finish(sensor, fields, recs["t"].copy(), recs["v"].copy()))
+    return batches
+
+
+def encode_binary(sensor, t_ms, values):
+    """Pack one block, the inverse of decode_binary (used by the load test)."""
+    values = np.ascontiguousarray(values, dtype="<f4")
+    rec = np.dtype([("t", "<i8"), ("v", "<f4", (values.shape[1],))])
+    recs = np.empty(len(t_ms), dtype=rec)
+    recs["t"] = t_ms
+    recs["v"] = values
+    name = sensor.encode("ascii")
+    header = BLOCK_HEADER.pack(MAGIC, len(name), values.shape[1], 0, len(t_ms))
+    return header + name + recs.tobytes()
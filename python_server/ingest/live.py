@@ -0,0 +1,56 @@
+"""Fan-out of freshly ingested batches to live dashboard charts.
+
+Each subscriber gets a small bounded queue of ready-to-send JSON messages.
+A chart that cannot keep up loses its oldest batches instead of growing the
+queue, and batches nobody subscribed to are never encoded.
+"""
+import json
+import queue
+import threading
+
+QUEUE_LEN = 64
+
+
+class LiveHub:
+    def __init__(self):
+        self.lock = threading.Lock()
+        self.subscribers = {}
+        # Only publishers add to the queues. With one at a time, the slot
+        # freed by dropping the oldest message cannot be taken before the put
+        self.publish_lock = threading.Lock()
+
+    def subscribe(self, board, sensor):
+        q = queue.Queue(QUEUE_LEN)
+        with self.lock:
+            self.subscribers.setdefault((board, sensor), []).append(q)
+        return q
+
+    def unsubscribe(self, board, sensor, q):
+        with self.lock:
+            subs = self.subscribers.get((board, sensor), [])
+            if q in subs:
+                subs.remove(q)
+            if not subs:
+                self.subscribers.pop((board, sensor), None)
+
+    def publish(self, board, batch):
+        with self.lock:
+            subs = list(self.subscribers.get((board, batch.sensor), []))
+        if not subs or len(batch.t_ms) == 0:
+            return
+        # Column-major, so the chart copies each channel straight into its ring buffer
+        msg = json.dumps({
+            "fields": batch.fields,
+            "t": batch.t_ms.tolist(),
+            "v": batch.values.T.astype("f8").round(5).tolist(),
+        })
+        with self.publish_lock:
+            for q in subs:
+                try:
+                    q.put_nowait(msg)
+                except queue.Full:
+                    try:
+                        q.get_nowait()
+                    except queue.Empty:
+                        pass
+                    q.put_nowait(msg)
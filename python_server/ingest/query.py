@@ -0,0 +1,235 @@
+"""Downsampled time-series reads over the ingested Parquet data.
+
+A query asks for about `points` buckets over [start, end). It is answered
+from the coarsest rollup whose buckets still fit that many into the range,
+so the data read grows with `points`, not with the sample rate or the length
+of the range. Only ranges shorter than `points` seconds go to the raw files.
+Each returned bucket has min, max and mean per field; drawing min and max
+as a band keeps spikes that plain averaging or every-Nth sampling would lose.
+Bucket edges fall on rollup bucket edges, so every full bucket covers the
+same number of rollup rows.
+"""
+import calendar
+from collections import OrderedDict
+import os
+import threading
+import time
+
+import numpy as np
+import pyarrow.dataset as ds
+import pyarrow.parquet as pq
+
+from .rollup import RESOLUTIONS_S, ROLLUP_DIR
+
+MAX_POINTS = 5000
+MS_PER_HOUR = 3600 * 1000
+CACHE_BYTES = 256 * 1024 * 1024
+
+
+def list_sources(root):
+    """{board: [sensor, ...]} for everything stored under root."""
+    out = {}
+    for entry in sorted(os.listdir(root)) if os.path.isdir(root) else []:
+        if entry.startswith("board="):
+            sensors = os.listdir(os.path.join(root, entry))
+            out[entry[6:]] = sorted(s[7:] for s in sensors if s.startswith("sensor="))
+    return out
+
+
+def _hour_dirs(base, start_ms, end_ms):
+    if not os.path.isdir(base):
+        return []
+    dirs = []
+    for entry in os.listdir(base):
+        if not entry.startswith("hour="):
+            continue
+        try:
+            hour_ms = calendar.timegm(time.strptime(entry[5:], "%Y%m%d%H")) * 1000
+        except ValueError:
+            continue
+        if hour_ms < end_ms and hour_ms + MS_PER_HOUR > start_ms:
+            dirs.append(os.path.join(base, entry))
+    return dirs
+
+
+def _field_sets(base):
+    """Directories of a sensor holding one field set each. Data written before
+    field sets had their own level sits in base itself."""
+    if not os.path.isdir(base):
+        return []
+    entries = os.listdir(base)
+    sets = [os.path.join(base, e) for e in sorted(entries) if e.startswith("fields=")]
+    if any(e.startswith("hour=") for e in entries):
+        sets.append(base)
+    return sets
+
+
+def _files(base, start_ms, end_ms):
+    files = []
+    for d in _hour_dirs(base, start_ms, end_ms):
+        # Dot files are being written
+        files.extend(os.path.join(d, f) for f in os.listdir(d)
+                     if f.endswith(".parquet") and not f.startswith("."))
+    return sorted(files)
+
+
+class _TableCache:
+    """Rollup tables by path. The file of the current hour is rewritten on
+    every flush, so an entry is only used while the file's mtime and size
+    match. Bounded by bytes rather than entries: an hour of 1 s buckets is
+    3600 rows, an hour of 1 h buckets one."""
+
+    def __init__(self, max_bytes):
+        self.max_bytes = max_bytes
+        self.entries = OrderedDict()
+        self.bytes = 0
+        self.lock = threading.Lock()
+
+    def read(self, path):
+        st = os.stat(path)
+        stamp = (st.st_mtime_ns, st.st_size)
+        with self.lock:
+            entry = self.entries.get(path)
+            if entry and entry[0] == stamp:
+                self.entries.move_to_end(path)
+                return entry[1]
+        table = pq.read_table(path)
+        with self.lock:
+            old = self.entries.pop(path, None)
+            if old:
+                self.bytes -= old[1].nbytes
+            self.entries[path] = (stamp, table)
+            self.bytes += table.nbytes
+            while self.bytes > self.max_bytes and len(self.entries) > 1:
+                _, (_, dropped) = self.entries.popitem(last=False)
+                self.bytes -= dropped.nbytes
+        return table
+
+
+_rollups = _TableCache(CACHE_BYTES)
+
+
+def _pick(found, fields):
+    """found holds (available fields, newest file, data) per field set with
+    data in range. Without fields asked for, those of the set written last
+    are used; every set that has them all is read."""
+    if not found:
+        return None
+    newest = max(found, key=lambda f: f[1])[0]
+    fields = fields or newest
+    matching = [data for available, _, data in found if all(f in available for f in fields)]
+    if not matching:
+        raise KeyError(next((f for f in fields if f not in newest), fields[0]))
+    return fields, matching
+
+
+def _in_range(base, start_ms, end_ms):
+    """(set directory, files) for each field set with files in the range."""
+    for d in _field_sets(base):
+        files = _files(d, start_ms, end_ms)
+        if files:
+            yield d, files
+
+
+def _load_rollup(root, res_s, board, sensor, start_ms, end_ms, fields):
+    base = os.path.join(root, ROLLUP_DIR, f"{res_s}s", f"board={board}", f"sensor={sensor}")
+    found = []
+    for d, files in _in_range(base, start_ms, end_ms):
+        tables = [_rollups.read(p) for p in files]
+        available = [c[:-4] for c in tables[0].column_names if c.endswith("_min")]
+        found.append((available, os.path.relpath(files[-1], d), tables))
+    picked = _pick(found, fields)
+    if picked is None:
+        return None
+    fields, sets = picked
+    tables = [tb for tables in sets for tb in tables]
+    t = np.concatenate([tb["t_ms"].to_numpy() for tb in tables])
+    keep = (t + res_s * 1000 > start_ms) & (t < end_ms)
+    cols = {"t": t[keep], "count": np.concatenate([tb["count"].to_numpy() for tb in tables])[keep]}
+    for f in fields:
+        for agg in ("min", "max", "sum"):
+            cols[f"{f}_{agg}"] = np.concatenate([tb[f"{f}_{agg}"].to_numpy() for tb in tables])[keep]
+    return fields, cols
+
+
+def _load_raw(root, board, sensor, start_ms, end_ms, fields):
+    base = os.path.join(root, f"board={board}", f"sensor={sensor}")
+    found = []
+    for d, files in _in_range(base, start_ms, end_ms):
+        available = [n for n in pq.read_schema(files[0]).names if n != "t_ms"]
+        found.append((available, os.path.relpath(files[-1], d), files))
+    picked = _pick(found, fields)
+    if picked is None:
+        return None
+    fields, sets = picked
+    dataset = ds.dataset([f for files in sets for f in files], format="parquet")
+    table = dataset.to_table(columns=["t_ms"] + fields,
+                             filter=(ds.field("t_ms") >= start_ms) & (ds.field("t_ms") < end_ms))
+    t = table["t_ms"].to_numpy()
+    cols = {"t": t, "count": np.ones(len(t), dtype=np.int64)}
+    for f in fields:
+        v = table[f].to_numpy()
+        cols[f"{f}_min"] = cols[f"{f}_max"] = cols[f"{f}_sum"] = v
+    return fields, cols
+
+
+def bucket_grid(start_ms, end_ms, points, res_ms):
+    """First bucket start and bucket width for at most `points` buckets over
+    [start_ms, end_ms). Both are multiples of res_ms, the width of the rows
+    being combined, so no row straddles two buckets and no bucket gets one
+    row more than the next."""
+    origin = start_ms - start_ms % res_ms
+    span = max(1, end_ms - origin)
+    width = res_ms * -(-span // (points * res_ms))
+    return origin, width
+
+
+def _combine(fields, cols, origin, width):
+    """Merges rows into buckets of width ms starting at origin."""
+    bucket = (cols["t"] - origin) // width
+    order = np.argsort(bucket, kind="stable")
+    bucket = bucket[order]
+    starts = np.flatnonzero(np.r_[True, bucket[1:] != bucket[:-1]]) if len(bucket) else bucket
+
+    count = np.add.reduceat(cols["count"][order], starts) if len(starts) else starts
+    out = {
+        "t": (origin + bucket[starts] * width).tolist(),
+        "count": count.tolist(),
+        "fields": {},
+    }
+    for f in fields:
+        if not len(starts):
+            out["fields"][f] = {"min": [], "max": [], "mean": []}
+            continue
+        sums = np.add.reduceat(cols[f"{f}_sum"][order].astype(np.float64), starts)
+        out["fields"][f] = {
+            "min": np.minimum.reduceat(cols[f"{f}_min"][order], starts).astype(np.float64).round(5).tolist(),
+            "max": np.maximum.reduceat(cols[f"{f}_max"][order], starts).astype(np.float64).round(5).tolist(),
+            "mean": (sums / count).round(5).tolist(),
+        }
+    return out
+
+
+def query(root, board, sensor, start_ms, end_ms, points=500, fields=None):
+    """Returns the downsampled series, None without data, KeyError for an unknown field."""
+    points = max(1, min(int(points), MAX_POINTS))
+    width_ms = (end_ms - start_ms) / points
+    usable = [r for r in RESOLUTIONS_S if r * 1000 <= width_ms]
+
+    loaded = None
+    if usable:
+        loaded = _load_rollup(root, usable[-1], board, sensor, start_ms, end_ms, fields)
+        resolution, res_ms = f"{usable[-1]}s", usable[-1] * 1000
+    if loaded is None:
+        # Short range, or data written before rollups existed
+        loaded = _load_raw(root, board, sensor, start_ms, end_ms, fields)
+        resolution, res_ms = "raw", 1
+    if loaded is None:
+        return None
+
+    fields, cols = loaded
+    origin, width = bucket_grid(start_ms, end_ms, points, res_ms)
+    result = _combine(fields, cols, origin, width)
+    result.update(board=board, sensor=sensor, start=start_ms, end=end_ms, bucket_ms=int(width),
+                  resolution=resolution, rows_read=int(len(cols["t"])))
+    return result
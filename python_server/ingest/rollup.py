@@ -0,0 +1,148 @@
+"""Precomputed min/max/sum/count rollups of the raw sample files.
+
+Each hour of raw data has one file per resolution with one row per time
+bucket, stored beside the raw dataset:
+
+    <root>/_rollup/<res>s/board=<board>/sensor=<sensor>/fields=<digest>/hour=<H>/rollup.parquet
+
+Every flush of raw samples is merged into the hour's file, so a query reads
+one file per hour however often the service flushed. Buckets that span two
+flushes are combined on the way in with min of min, max of max and sum of
+sum/count; readers do the same for files from before the compaction, which
+had one part file per flush. The leading underscore keeps dataset readers of
+<root> from picking the rollups up as raw data.
+
+Rebuild them from the raw files, with the ingestion service stopped, with:
+
+    python3 -m ingest.rollup sensor_data
+"""
+from collections import OrderedDict
+import glob
+import os
+import shutil
+import sys
+import threading
+
+import numpy as np
+import pyarrow as pa
+import pyarrow.parquet as pq
+
+RESOLUTIONS_S = (1, 10, 60, 600, 3600)
+ROLLUP_DIR = "_rollup"
+ROLLUP_FILE = "rollup.parquet"
+
+# Flushes of one partition can be written from two threads (a full buffer in
+# a request, the timer in the flusher). Striped so the locks do not pile up
+# with every hour
+_locks = [threading.Lock() for _ in range(64)]
+
+# The last table written to each of the hours being filled, so the next flush
+# merges into it without reading the file back. Checked against the file's
+# mtime and size in case something else rewrote it
+OPEN_FILES = 512
+_written = OrderedDict()
+_written_lock = threading.Lock()
+
+
+def _read_back(path):
+    st = os.stat(path)
+    with _written_lock:
+        entry = _written.get(path)
+    if entry and entry[0] == (st.st_mtime_ns, st.st_size):
+        return entry[1]
+    return pq.read_table(path)
+
+
+def _remember(path, table):
+    st = os.stat(path)
+    with _written_lock:
+        _written[path] = ((st.st_mtime_ns, st.st_size), table)
+        _written.move_to_end(path)
+        while len(_written) > OPEN_FILES:
+            _written.popitem(last=False)
+
+
+def rollup_path(root, res_s, raw_path):
+    rel = os.path.relpath(os.path.dirname(raw_path), root)
+    return os.path.join(root, ROLLUP_DIR, f"{res_s}s", rel, ROLLUP_FILE)
+
+
+def merge(table, fields):
+    """Combines the rows of table that share a bucket."""
+    t = table["t_ms"].to_numpy()
+    order = np.argsort(t, kind="stable")
+    t = t[order]
+    starts = np.flatnonzero(np.r_[True, t[1:] != t[:-1]])
+    columns = {
+        "t_ms": pa.array(t[starts], type=pa.int64()),
+        "count": pa.array(np.add.reduceat(table["count"].to_numpy()[order], starts), type=pa.int64()),
+    }
+    for name in fields:
+        for agg, ufunc, kind in (("min", np.minimum, pa.float32()), ("max", np.maximum, pa.float32()),
+                                 ("sum", np.add, pa.float64())):
+            col = table[f"{name}_{agg}"].to_numpy()[order]
+            columns[f"{name}_{agg}"] = pa.array(ufunc.reduceat(col, starts), type=kind)
+    return pa.table(columns)
+
+
+def build(t_ms, values, fields, res_s):
+    """One row per res_s bucket: bucket start, sample count, per field min/max/sum."""
+    width = res_s * 1000
+    buckets = t_ms // width
+    if len(buckets) > 1 and (np.diff(buckets) < 0).any():
+        order = np.argsort(buckets, kind="stable")
+        buckets, values = buckets[order], values[order]
+    starts = np.flatnonzero(np.r_[True, buckets[1:] != buckets[:-1]])
+
+    columns = {
+        "t_ms": pa.array(buckets[starts] * width, type=pa.int64()),
+        "count": pa.array(np.diff(np.r_[starts, len(buckets)]), type=pa.int64()),
+    }
+    v64 = values.astype(np.float64)
+    for i, name in enumerate(fields):
+        col = values[:, i]
+        columns[f"{name}_min"] = pa.array(np.minimum.reduceat(col, starts), type=pa.float32())
+        columns[f"{name}_max"] = pa.array(np.maximum.reduceat(col, starts), type=pa.float32())
+        columns[f"{name}_sum"] = pa.array(np.add.reduceat(v64[:, i], starts), type=pa.float64())
+    return pa.table(columns)
+
+
+def write(root, raw_path, t_ms, values, fields, compression="zstd"):
+    if len(t_ms) == 0:
+        return
+    for res_s in RESOLUTIONS_S:
+        path = rollup_path(root, res_s, raw_path)
+        table = build(t_ms, values, fields, res_s)
+        with _locks[hash(path) % len(_locks)]:
+            if os.path.exists(path):
+                table = merge(pa.concat_tables([_read_back(path), table]), fields)
+            else:
+                os.makedirs(os.path.dirname(path), exist_ok=True)
+            # Replaced in one step, a reader sees the old or the new file
+            tmp = os.path.join(os.path.dirname(path), "." + os.path.basename(path))
+            pq.write_table(table, tmp, compression=compression)
+            os.replace(tmp, path)
+            _remember(path, table)
+
+
+def rebuild(root):
+    # Merging into what is there would count the samples twice
+    shutil.rmtree(os.path.join(root, ROLLUP_DIR), ignore_errors=True)
+    with _written_lock:
+        _written.clear()
+    count = 0
+    # Files from before field sets got a directory level sit under the sensor
+    raw_paths = glob.glob(os.path.join(root, "board=*", "sensor=*", "fields=*", "hour=*", "part-*.parquet"))
+    raw_paths += glob.glob(os.path.join(root, "board=*", "sensor=*", "hour=*", "part-*.parquet"))
+    for raw_path in raw_paths:
+        table = pq.read_table(raw_path)
+        fields = [n for n in table.column_names if n != "t_ms"]
+        values = np.column_stack([table[f].to_numpy() for f in fields]).astype(np.float32)
+        write(root, raw_path, table["t_ms"].to_numpy(), values, fields)
+        count += 1
+    return count
+
+
+if __name__ == "__main__":
+    root = sys.argv[1] if len(sys.argv) > 1 else "sensor_data"
+    print(f"rolled up {rebuild(root)} files in {root}")
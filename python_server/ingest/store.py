@@ -0,0 +1,156 @@
+"""Partitioned Parquet storage for decoded sample batches.
+
+Samples are buffered in memory per (board, sensor, field set, hour) and
+written out as one Parquet file per flush, in a hive-style layout that
+pyarrow, pandas, DuckDB and Spark read as a single dataset:
+
+    <root>/board=<board>/sensor=<sensor>/fields=<digest>/hour=<YYYYMMDDHH>/part-<n>.parquet
+
+The field set is part of the key so every file in a directory has the same
+columns, also when a board's firmware adds or renames a field.
+
+A partition is flushed when it holds `flush_rows` samples or its oldest
+sample has waited `flush_s` seconds, so files stay large enough to read
+quickly while data still lands on disk within a few seconds. Each flush
+also writes the rollups the history queries read (see rollup.py).
+"""
+import hashlib
+import os
+import threading
+import time
+
+import numpy as np
+import pyarrow as pa
+import pyarrow.parquet as pq
+
+from . import rollup
+
+MS_PER_HOUR = 3600 * 1000
+
+
+def fields_key(fields):
+    """Directory name part of a field set: short and the same on every run."""
+    return hashlib.sha1(",".join(fields).encode()).hexdigest()[:8]
+
+
+class _Partition:
+    def __init__(self, fields):
+        self.fields = fields
+        self.t_chunks = []
+        self.v_chunks = []
+        self.rows = 0
+        self.since = time.monotonic()
+
+    def add(self, t_ms, values):
+        if not self.t_chunks:
+            self.since = time.monotonic()
+        self.t_chunks.append(t_ms)
+        self.v_chunks.append(values)
+        self.rows += len(t_ms)
+
+    def take(self):
+        t_ms = np.concatenate(self.t_chunks)
+        values = np.concatenate(self.v_chunks)
+        self.t_chunks, self.v_chunks, self.rows = [], [], 0
+        return t_ms, values
+
+
+class PartitionedWriter:
+    def __init__(self, root, flush_rows=200_000, flush_s=5.0, compression="zstd"):
+        self.root = root
+        self.flush_rows = flush_rows
+        self.flush_s = flush_s
+        self.compression = compression
+        self.partitions = {}
+        self.lock = threading.Lock()
+        self.seq = 0
+        self.rows_written = 0
+        self.files_written = 0
+        self.stop_event = threading.Event()
+        self.flusher = threading.Thread(target=self._flush_loop, daemon=True)
+        self.flusher.start()
+
+    def append(self, board, batch):
+        """Buffers a decoded batch, split by hour. Returns the samples taken."""
+        if len(batch.t_ms) == 0:
+            return 0
+
+        # Split by hour without a Python loop over samples: sort once by hour
+        # (stable, so each hour keeps its arrival order) and cut at the boundaries
+        hours = batch.t_ms // MS_PER_HOUR
+        if hours[0] == hours[-1] and (hours == hours[0]).all():
+            groups = [(hours[0], batch.t_ms, batch.values)]
+        else:
+            order = np.argsort(hours, kind="stable")
+            hours, t_ms, values = hours[order], batch.t_ms[order], batch.values[order]
+            cuts = np.flatnonzero(np.diff(hours)) + 1
+            groups = zip(hours[np.r_[0, cuts]], np.split(t_ms, cuts), np.split(values, cuts))
+
+        full = []
+        with self.lock:
+            for hour, t_ms, values in groups:
+                key = (board, batch.sensor, int(hour), tuple(batch.fields))
+                part = self.partitions.get(key)
+                if part is None:
+                    part = self.partitions[key] = _Partition(batch.fields)
+                part.add(t_ms, values)
+                if part.rows >= self.flush_rows:
+                    full.append((key, part.take()))
+        for key, data in full:
+            self._write(key, *data)
+        return len(batch.t_ms)
+
+    def flush(self, max_age_s=0.0):
+        now = time.monotonic()
+        ready = []
+        with self.lock:
+            for key, part in list(self.partitions.items()):
+                if not part.rows:
+                    del self.partitions[key]  # past hours would pile up otherwise
+                elif now - part.since >= max_age_s:
+                    ready.append((key, part.take()))
+        for key, data in ready:
+            self._write(key, *data)
+
+    def close(self):
+        self.stop_event.set()
+        self.flusher.join()
+        self.flush()
+
+    def _flush_loop(self):
+        while not self.stop_event.wait(self.flush_s / 4):
+            self.flush(self.flush_s)
+
+    def _write(self, key, t_ms, values):
+        board, sensor, hour, fields = key
+        hour_str = time.strftime("%Y%m%d%H", time.gmtime(hour * 3600))
+        directory = os.path.join(self.root, f"board={board}", f"sensor={sensor}",
+                                 f"fields={fields_key(fields)}", f"hour={hour_str}")
+        os.makedirs(directory, exist_ok=True)
+
+        columns = {"t_ms": pa.array(t_ms, type=pa.int64())}
+        for i, name in enumerate(fields):
+            columns[name] = pa.array(values[:, i], type=pa.float32())
+        with self.lock:
+            self.seq += 1
+            name = f"part-{int(time.time() * 1000)}-{self.seq:06d}.parquet"
+
+        # Written under a dot name first (dataset readers skip those), so
+        # nobody sees half a file
+        tmp = os.path.join(directory, "." + name)
+        path = os.path.join(directory, name)
+        pq.write_table(pa.table(columns), tmp, compression=self.compression)
+        os.replace(tmp, path)
+        rollup.write(self.root, path, t_ms, values, fields, self.compression)
+        with self.lock:
+            self.rows_written += len(t_ms)
+            self.files_written += 1
+
+    def stats(self):
+        with self.lock:
+            return {
+                "buffered_rows": sum(p.rows for p in self.partitions.values()),
+                "partitions": len(self.partitions),
+                "rows_written": self.rows_written,
+                "files_written": self.files_written,
+            }
@@ -0,0 +1,112 @@
+"""Load test for the ingestion service: many simulated boards streaming IMU data.
+
+Each board is a separate process with a keep-alive connection that posts
+`--batch` LSM6DSL samples (6 values) per request, as fast as the server
+takes them or paced to `--rate` samples/s per board. At the end it prints
+the sustained samples/s seen by the clients and the server's own counters.
+
+    python3 ingest_run.py &
+    python3 ingest_load.py --boards 32 --duration 20
+    python3 ingest_load.py --boards 32 --rate 416 --format json
+"""
+import argparse
+import http.client
+import json
+import multiprocessing
+import time
+
+import numpy as np
+
+from ingest.decode import SENSOR_FIELDS, encode_binary
+
+FIELDS = SENSOR_FIELDS["lsm6dsl"]
+
+
+def make_body(fmt, t0_ms, batch, period_ms, rng):
+    t_ms = t0_ms + np.arange(batch, dtype=np.int64) * period_ms
+    values = rng.normal(0.0, 1.0, size=(batch, len(FIELDS))).astype(np.float32)
+    values[:, 2] += 9.81
+    if fmt == "binary":
+        return encode_binary("lsm6dsl", t_ms, values), "application/octet-stream"
+    doc = {"sensor": "lsm6dsl", "fields": FIELDS, "t": t_ms.tolist(), "values": values.tolist()}
+    return json.dumps(doc).encode(), "application/json"
+
+
+def board(index, args, results):
+    rng = np.random.default_rng(index)
+    conn = http.client.HTTPConnection(args.host, args.port, timeout=30)
+    period_ms = max(1, round(1000 / args.rate)) if args.rate else 10
+    t_ms = int(time.time() * 1000)
+    sent = errors = requests = 0
+    latencies = []
+
+    start = time.monotonic()
+    deadline = start + args.duration
+    while time.monotonic() < deadline:
+        body, ctype = make_body(args.format, t_ms, args.batch, period_ms, rng)
+        t_ms += args.batch * period_ms
+        begin = time.monotonic()
+        try:
+            conn.request("POST", f"/ingest/board{index:03d}", body, {"Content-Type": ctype})
+            resp = conn.getresponse()
+            resp.read()
+            ok = resp.status == 200
+        except (OSError, http.client.HTTPException):
+            conn.close()
+            conn = http.client.HTTPConnection(args.host, args.port, timeout=30)
+            ok = False
+        latencies.append(time.monotonic() - begin)
+        requests += 1
+        if ok:
+            sent += args.batch
+        else:
+            errors += 1
+        if args.rate:
+            # Pace to the board's sample rate, as a real board would
+            due = start + sent / args.rate
+            time.sleep(max(0.0, due - time.monotonic()))
+    results.put((sent, errors, requests, latencies, time.monotonic() - start))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--host", default="127.0.0.1")
+    parser.add_argument("--port", type=int, default=8080)
+    parser.add_argument("--boards", type=int, default=24)
+    parser.add_argument("--batch", type=int, default=500, help="samples per request")
+    parser.add_argument("--rate", type=float, default=0, help="samples/s per board, 0 = flat out")
+    parser.add_argument("--duration", type=float, default=10.0, help="seconds")
+    parser.add_argument("--format", choices=["binary", "json"], default="binary")
+    args = parser.parse_args()
+
+    results = multiprocessing.Queue()
+    procs = [multiprocessing.Process(target=board, args=(i, args, results))
+             for i in range(args.boards)]
+    for p in procs:
+        p.start()
+    outcomes = [results.get() for _ in procs]
+    for p in procs:
+        p.join()
+
+    sent = sum(o[0] for o in outcomes)
+    errors = sum(o[1] for o in outcomes)
+    requests = sum(o[2] for o in outcomes)
+    latencies = np.concatenate([o[3] for o in outcomes]) * 1000
+    elapsed = max(o[4] for o in outcomes)
+
+    print(f"{args.boards} boards, {args.format}, {args.batch} samples/request, {elapsed:.1f} s")
+    print(f"sustained: {sent / elapsed:,.0f} samples/s ({requests / elapsed:,.0f} requests/s), "
+          f"{errors} failed requests")
+    if len(latencies):
+        print(f"request latency ms: p50 {np.percentile(latencies, 50):.1f}  "
+              f"p99 {np.percentile(latencies, 99):.1f}  max {latencies.max():.1f}")
+    if args.rate:
+        print(f"offered: {args.boards * args.rate:,.0f} samples/s")
+
+    conn = http.client.HTTPConnection(args.host, args.port, timeout=10)
+    conn.request("GET", "/ingest/stats")
+    print("server:", conn.getresponse().read().decode().strip())
+
+
+if __name__ == "__main__":
+    main()
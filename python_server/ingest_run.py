@@ -0,0 +1,30 @@
+"""Starts the sample ingestion service, see README.md."""
+import argparse
+import atexit
+import signal
+import sys
+
+from ingest import create_app
+
+parser = argparse.ArgumentParser(description=__doc__)
+parser.add_argument('--host', default='0.0.0.0')
+parser.add_argument('--port', type=int, default=8080)
+parser.add_argument('--data-dir', default='sensor_data')
+parser.add_argument('--threads', type=int, default=16)
+args = parser.parse_args()
+
+app = create_app(args.data_dir)
+# Buffered samples are flushed on the way out, for Ctrl-C and kill alike
+atexit.register(app.extensions["ingest_writer"].close)
+signal.signal(signal.SIGTERM, lambda *_: sys.exit(0))
+
+if __name__ == '__main__':
+    try:
+        from waitress import serve
+    except ImportError:
+        serve = None
+    if serve:
+        serve(app, host=args.host, port=args.port, threads=args.threads)
+    else:
+        print("waitress not installed, using Flask's development server")
+        app.run(host=args.host, port=args.port, threaded=True)
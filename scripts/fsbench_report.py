@@ -0,0 +1,85 @@
+#!/usr/bin/env python3
+"""Compare littlefs profiles from `fsbench` output and pick one per workload.
+
+Run `fsbench` on the board (or native_sim) and save the output, then:
+
+    scripts/fsbench_report.py fsbench.txt
+    scripts/native_sim_bench.sh | scripts/fsbench_report.py
+
+For every operation and write size it prints throughput and p99 latency per
+profile, marking the best throughput. At the end it recommends a profile for
+the logging pattern (open, append one record, close) at --record bytes, and
+for bulk writes and reads, by throughput with p99 breaking near-ties.
+"""
+import argparse
+import json
+import re
+import sys
+
+# With the BENCH prefix from the shell, or without as native_sim_bench.sh prints them
+LINE = re.compile(r'(\{"bench".*\})')
+OPS = ("write", "read", "open_append")
+
+
+def load(lines):
+    results = {}
+    for line in lines:
+        m = LINE.search(line)
+        if not m:
+            continue
+        doc = json.loads(m.group(1))
+        if doc.get("bench") == "fsbench":
+            results[(doc["op"], doc["size"], doc["profile"])] = doc
+    return results
+
+
+def best(results, op, size, profiles):
+    rows = [results[(op, size, p)] for p in profiles if (op, size, p) in results]
+    if not rows:
+        return None
+    top = max(r["bytes_per_s"] for r in rows)
+    # Within 5 % of the best throughput the lower tail latency wins
+    close = [r for r in rows if r["bytes_per_s"] >= 0.95 * top]
+    return min(close, key=lambda r: r["p99_us"])["profile"]
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("capture", nargs="?", help="fsbench output (default: stdin)")
+    parser.add_argument("--record", type=int, default=64,
+                        help="log record size to recommend for, as measured (16, 64, 256, 1024)")
+    args = parser.parse_args()
+
+    with (open(args.capture) if args.capture else sys.stdin) as f:
+        results = load(f)
+    if not results:
+        sys.exit("No fsbench results in the input")
+
+    profiles = list(dict.fromkeys(p for _, _, p in results))  # in the order measured
+    sizes = sorted({s for _, s, _ in results})
+
+    print(f"{'op':<12} {'size':>5}  " + "  ".join(f"{p:>20}" for p in profiles))
+    for op in OPS:
+        for size in sizes:
+            winner = best(results, op, size, profiles)
+            if winner is None:
+                continue
+            cells = []
+            for p in profiles:
+                r = results.get((op, size, p))
+                cell = f"{r['bytes_per_s'] / 1024:7.1f} KB/s {r['p99_us']:6d}us" if r else "-"
+                cells.append(f"{cell:>19}" + ("*" if p == winner else " "))
+            print(f"{op:<12} {size:>5}  " + "  ".join(cells))
+    print("KB/s over the whole run, p99 of single calls; * best for that row")
+
+    print()
+    for label, op, size in (("logging", "open_append", args.record),
+                            ("bulk write", "write", max(sizes)),
+                            ("bulk read", "read", max(sizes))):
+        winner = best(results, op, size, profiles)
+        if winner:
+            print(f"{label:<11} ({op}, {size} B): fs_profile {winner}")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,168 @@
+#!/usr/bin/env python3
+"""Replay orientation filter steps recorded on the device against a host
+reference implementation of the same Madgwick update.
+
+Capture the shell output of `fusion_trace` (board or native_sim) and feed it
+in, either as a file argument or on stdin:
+
+    fusion_start 104
+    fusion_trace 32
+
+Every step is replayed from the quaternion the device started it with, so the
+comparison does not accumulate drift. Exits non-zero if any step differs by
+more than --tol in any quaternion component.
+"""
+import argparse
+import math
+import struct
+import sys
+
+# Layout of struct fusion_trace_rec in src/fusion.c
+FIELDS = 18
+
+
+def bits_to_float(word):
+    return struct.unpack("<f", struct.pack("<I", int(word, 16)))[0]
+
+
+def madgwick_imu(q, g, a, dt, beta):
+    q0, q1, q2, q3 = q
+    gx, gy, gz = g
+    ax, ay, az = a
+
+    qd0 = 0.5 * (-q1 * gx - q2 * gy - q3 * gz)
+    qd1 = 0.5 * (q0 * gx + q2 * gz - q3 * gy)
+    qd2 = 0.5 * (q0 * gy - q1 * gz + q3 * gx)
+    qd3 = 0.5 * (q0 * gz + q1 * gy - q2 * gx)
+
+    if not (ax == 0.0 and ay == 0.0 and az == 0.0):
+        n = math.sqrt(ax * ax + ay * ay + az * az)
+        ax, ay, az = ax / n, ay / n, az / n
+
+        s0 = 4 * q0 * q2 * q2 + 2 * q2 * ax + 4 * q0 * q1 * q1 - 2 * q1 * ay
+        s1 = (4 * q1 * q3 * q3 - 2 * q3 * ax + 4 * q0 * q0 * q1 - 2 * q0 * ay - 4 * q1
+              + 8 * q1 * q1 * q1 + 8 * q1 * q2 * q2 + 4 * q1 * az)
+        s2 = (4 * q0 * q0 * q2 + 2 * q0 * ax + 4 * q2 * q3 * q3 - 2 * q3 * ay - 4 * q2
+              + 8 * q2 * q1 * q1 + 8 * q2 * q2 * q2 + 4 * q2 * az)
+        s3 = 4 * q1 * q1 * q3 - 2 * q1 * ax + 4 * q2 * q2 * q3 - 2 * q2 * ay
+
+        n = math.sqrt(s0 * s0 + s1 * s1 + s2 * s2 + s3 * s3)
+        if n > 0:
+            qd0 -= beta * s0 / n
+            qd1 -= beta * s1 / n
+            qd2 -= beta * s2 / n
+            qd3 -= beta * s3 / n
+
+    return normalise((q0 + qd0 * dt, q1 + qd1 * dt, q2 + qd2 * dt, q3 + qd3 * dt))
+
+
+def madgwick_marg(q, g, a, m, dt, beta):
+    mx, my, mz = m
+    if mx == 0.0 and my == 0.0 and mz == 0.0:
+        return madgwick_imu(q, g, a, dt, beta)
+
+    q0, q1, q2, q3 = q
+    gx, gy, gz = g
+    ax, ay, az = a
+
+    qd0 = 0.5 * (-q1 * gx - q2 * gy - q3 * gz)
+    qd1 = 0.5 * (q0 * gx + q2 * gz - q3 * gy)
+    qd2 = 0.5 * (q0 * gy - q1 * gz + q3 * gx)
+    qd3 = 0.5 * (q0 * gz + q1 * gy - q2 * gx)
+
+    if not (ax == 0.0 and ay == 0.0 and az == 0.0):
+        n = math.sqrt(ax * ax + ay * ay + az * az)
+        ax, ay, az = ax / n, ay / n, az / n
+        n = math.sqrt(mx * mx + my * my + mz * mz)
+        mx, my, mz = mx / n, my / n, mz / n
+
+        # Earth's field in the sensor frame, via the rotation matrix of q
+        hx = (mx * (q0 * q0 + q1 * q1 - q2 * q2 - q3 * q3)
+              + 2 * my * (q1 * q2 - q0 * q3) + 2 * mz * (q0 * q2 + q1 * q3))
+        hy = (2 * mx * (q0 * q3 + q1 * q2) + my * (q0 * q0 - q1 * q1 + q2 * q2 - q3 * q3)
+              + 2 * mz * (q2 * q3 - q0 * q1))
+        bx2 = math.sqrt(hx * hx + hy * hy)
+        bz2 = (2 * mx * (q1 * q3 - q0 * q2) + 2 * my * (q0 * q1 + q2 * q3)
+               + mz * (q0 * q0 - q1 * q1 - q2 * q2 + q3 * q3))
+
+        # Residuals of the gravity and field directions
+        fa = (2 * (q1 * q3 - q0 * q2) - ax,
+              2 * (q0 * q1 + q2 * q3) - ay,
+              1 - 2 * (q1 * q1 + q2 * q2) - az)
+        fm = (bx2 * (0.5 - q2 * q2 - q3 * q3) + bz2 * (q1 * q3 - q0 * q2) - mx,
+              bx2 * (q1 * q2 - q0 * q3) + bz2 * (q0 * q1 + q2 * q3) - my,
+              bx2 * (q0 * q2 + q1 * q3) + bz2 * (0.5 - q1 * q1 - q2 * q2) - mz)
+
+        # Jacobian rows per quaternion component, gravity then field
+        jac = (
+            (-2 * q2, 2 * q1, 0, -bz2 * q2, -bx2 * q3 + bz2 * q1, bx2 * q2),
+            (2 * q3, 2 * q0, -4 * q1, bz2 * q3, bx2 * q2 + bz2 * q0, bx2 * q3 - 2 * bz2 * q1),
+            (-2 * q0, 2 * q3, -4 * q2, -2 * bx2 * q2 - bz2 * q0, bx2 * q1 + bz2 * q3,
+             bx2 * q0 - 2 * bz2 * q2),
+            (2 * q1, 2 * q2, 0, -2 * bx2 * q3 + bz2 * q1, -bx2 * q0 + bz2 * q2, bx2 * q1),
+        )
+        f = fa + fm
+        s = [sum(j * r for j, r in zip(row, f)) for row in jac]
+
+        n = math.sqrt(sum(v * v for v in s))
+        if n > 0:
+            qd0 -= beta * s[0] / n
+            qd1 -= beta * s[1] / n
+            qd2 -= beta * s[2] / n
+            qd3 -= beta * s[3] / n
+
+    return normalise((q0 + qd0 * dt, q1 + qd1 * dt, q2 + qd2 * dt, q3 + qd3 * dt))
+
+
+def normalise(q):
+    n = math.sqrt(sum(v * v for v in q))
+    return tuple(v / n for v in q)
+
+
+def parse(lines):
+    beta = None
+    steps = []
+    for line in lines:
+        words = line.split()
+        if "FUSION_BETA" in words:
+            beta = bits_to_float(words[words.index("FUSION_BETA") + 1])
+        elif "FUSION" in words:
+            vals = [bits_to_float(w) for w in words[words.index("FUSION") + 1:]]
+            if len(vals) != FIELDS:
+                raise ValueError("expected %d fields, got %d: %s" % (FIELDS, len(vals), line))
+            steps.append(vals)
+    return beta, steps
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    ap.add_argument("capture", nargs="?", help="shell capture (default: stdin)")
+    ap.add_argument("--tol", type=float, default=1e-5,
+                    help="max abs difference per quaternion component")
+    args = ap.parse_args()
+
+    src = open(args.capture) if args.capture else sys.stdin
+    with src:
+        beta, steps = parse(src)
+    if beta is None or not steps:
+        print("no fusion_trace output found", file=sys.stderr)
+        return 2
+
+    worst = 0.0
+    for i, s in enumerate(steps):
+        dt, acc, gyro, mag, q_in, q_dev = s[0], s[1:4], s[4:7], s[7:10], s[10:14], s[14:18]
+        q_ref = madgwick_marg(q_in, gyro, acc, mag, dt, beta)
+        err = max(abs(a - b) for a, b in zip(q_ref, q_dev))
+        worst = max(worst, err)
+        if err > args.tol:
+            print("step %d: device %s reference %s (err %.3g)"
+                  % (i, ["%.7f" % v for v in q_dev], ["%.7f" % v for v in q_ref], err))
+
+    ok = worst <= args.tol
+    print("%d steps, beta %.4f, max error %.3g: %s"
+          % (len(steps), beta, worst, "PASS" if ok else "FAIL"))
+    return 0 if ok else 1
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,37 @@
+#!/bin/sh
+# Build the firmware for native_sim, run a scripted sampling session against
+# the emulated sensors and print the bench_all, fsbench and stats_dump JSON
+# lines. scripts/fsbench_report.py turns the output into a profile table.
+#
+#   BUILD      build directory         (default: build/native_sim)
+#   DURATION   seconds of sampling     (default: 20)
+#   PERIOD     sensor_timer_start rate (default: 1)
+set -e
+
+ROOT=$(cd "$(dirname "$0")/.." && pwd)
+BUILD=${BUILD:-$ROOT/build/native_sim}
+DURATION=${DURATION:-20}
+PERIOD=${PERIOD:-1}
+SENSORS="hts221 lps22hb lis3mdl lsm6dsl vl53l0x"
+
+west build -b native_sim -d "$BUILD" "$ROOT/zephyr"
+
+{
+    sleep 2
+    for s in $SENSORS; do
+        echo "sensor_timer_start $s $s.txt $PERIOD"
+    done
+    sleep "$DURATION"
+    echo "stats_dump"
+    sleep 1
+    echo "bench_all"
+    sleep 15
+    # fsbench refuses to run next to logging sessions
+    for s in $SENSORS; do
+        echo "sensor_timer_stop $s"
+    done
+    sleep 1
+    echo "fsbench all"
+    sleep 20
+} | "$BUILD/zephyr/zephyr.exe" -uart_stdinout -stop_at=$((DURATION + 41)) \
+  | sed -n 's/.*\({".*}\).*/\1/p'
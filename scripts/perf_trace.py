@@ -0,0 +1,131 @@
+#!/usr/bin/env python3
+"""Turn a `perf_trace_dump` capture into a CTF trace directory.
+
+Arm and dump the pipeline trace from the shell (board or native_sim), and
+save the output:
+
+    perf_trace_start
+    ... let the sessions run ...
+    perf_trace_dump          (or perf_trace_save, then perf_trace_dump file)
+
+then feed the capture in, either as a file argument or on stdin:
+
+    scripts/perf_trace.py capture.txt -o pipeline_trace
+    babeltrace2 pipeline_trace
+
+The directory holds a `metadata` file describing the event layout and a
+`stream` file with the raw events, so it also opens in Trace Compass.
+"""
+import argparse
+import os
+import struct
+import sys
+
+# Layout of struct perf_trace_event in src/perf.c
+EVENT = struct.Struct("<IBBBh")
+
+# enum perf_event in include/perf.h: (name, arg field, value field)
+EVENTS = [
+    ("timer_fire", "session", "value"),
+    ("work_start", "session", "value"),
+    ("fetch_start", "arg", "value"),
+    ("fetch_end", "arg", "rc"),
+    ("sink_write", "sink", "result"),
+    ("shared", "session", "value"),
+]
+
+METADATA = """/* CTF 1.8 */
+
+typealias integer {{ size = 8; align = 8; signed = false; }} := uint8_t;
+typealias integer {{ size = 16; align = 8; signed = true; }} := int16_t;
+typealias integer {{ size = 32; align = 8; signed = false; }} := uint32_t;
+
+trace {{
+    major = 1;
+    minor = 8;
+    byte_order = le;
+}};
+
+env {{
+    domain = "stm32-dashboard";
+    tracer_name = "perf_trace";
+}};
+
+clock {{
+    name = cycles;
+    description = "System timer (k_cycle_get_32), the 32 kHz LPTIM on the board";
+    freq = {freq};
+}};
+
+typealias integer {{
+    size = 32; align = 8; signed = false;
+    map = clock.cycles.value;
+}} := cycles_t;
+
+stream {{
+    event.header := struct {{
+        cycles_t timestamp;
+        uint8_t id;
+    }};
+}};
+{events}"""
+
+EVENT_DECL = """
+event {{
+    name = "{name}";
+    id = {id};
+    fields := struct {{
+        uint8_t sensor;
+        uint8_t {arg};
+        int16_t {value};
+    }};
+}};
+"""
+
+
+def parse_capture(lines):
+    freq = None
+    data = bytearray()
+    for line in lines:
+        line = line.strip()
+        if line.startswith("CTF_CLOCK "):
+            freq = int(line.split()[1])
+        elif line.startswith("CTF "):
+            data += bytes.fromhex(line.split()[1])
+    return freq, bytes(data)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("capture", nargs="?", help="shell output, stdin if omitted")
+    parser.add_argument("-o", "--out", default="pipeline_trace", help="trace directory to write")
+    args = parser.parse_args()
+
+    if args.capture:
+        with open(args.capture) as f:
+            freq, data = parse_capture(f)
+    else:
+        freq, data = parse_capture(sys.stdin)
+
+    if freq is None:
+        sys.exit("no CTF_CLOCK line, is this perf_trace_dump output?")
+    if len(data) % EVENT.size:
+        sys.exit("capture is truncated: %d bytes is not a whole number of events" % len(data))
+
+    events = "".join(EVENT_DECL.format(name=name, id=i, arg=arg, value=value)
+                     for i, (name, arg, value) in enumerate(EVENTS))
+    os.makedirs(args.out, exist_ok=True)
+    with open(os.path.join(args.out, "metadata"), "w") as f:
+        f.write(METADATA.format(freq=freq, events=events))
+    with open(os.path.join(args.out, "stream"), "wb") as f:
+        f.write(data)
+
+    count = len(data) // EVENT.size
+    first = EVENT.unpack_from(data, 0)[0] if count else 0
+    last = EVENT.unpack_from(data, len(data) - EVENT.size)[0] if count else 0
+    span_ms = ((last - first) & 0xFFFFFFFF) * 1000.0 / freq
+    print("%d events over %.1f ms written to %s/" % (count, span_ms, args.out))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,434 @@
+// On-target micro benchmarks for the sampling, formatting and storage paths.
+// Every result is printed as one "BENCH {...}" JSON line so runs on the board
+// or on native_sim can be collected and compared by scripts on the host.
+#include "sensors.h"
+#include "stats.h"
+#include "http_sink.h"
+#include "fs_profile.h"
+#include "session.h"
+#include <zephyr/kernel.h>
+#include <zephyr/shell/shell.h>
+#include <zephyr/fs/fs.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#define BENCH_FILE "/lfs/bench.txt"
+
+// fsbench: write sizes, and per-operation latencies kept for percentiles
+#define FSBENCH_MAX_OPS 256
+#define FSBENCH_MAX_SIZE 1024
+#define FSBENCH_OPEN_OPS 64 // open, append, close cycles per size
+
+struct bench_acc {
+    uint32_t n;
+    uint32_t min;
+    uint32_t max;
+    uint64_t sum;
+};
+
+static void acc_add(struct bench_acc *acc, uint32_t cycles)
+{
+    if (acc->n == 0 || cycles < acc->min) {
+        acc->min = cycles;
+    }
+    if (cycles > acc->max) {
+        acc->max = cycles;
+    }
+    acc->sum += cycles;
+    acc->n++;
+}
+
+static void acc_print(const struct shell *shell, const char *name, const char *label,
+                      const struct bench_acc *acc)
+{
+    uint32_t avg = acc->n ? (uint32_t)(acc->sum / acc->n) : 0;
+
+    shell_print(shell,
+                "BENCH {\"bench\":\"%s\",\"id\":\"%s\",\"n\":%u,"
+                "\"cyc_min\":%u,\"cyc_avg\":%u,\"cyc_max\":%u,\"us_avg\":%u}",
+                name, label, acc->n, acc->min, avg, acc->max, stats_cyc_to_us(avg));
+}
+
+static int arg_or(size_t argc, char **argv, size_t i, int def)
+{
+    return (argc > i) ? atoi(argv[i]) : def;
+}
+
+// Cycles per sensor_reading() call, fetch and formatting together
+static int cmd_bench_read(const struct shell *shell, size_t argc, char **argv)
+{
+    int iters = arg_or(argc, argv, 1, 50);
+    char buf[256];
+
+    for (int i = 0; i < NUM_SENSORS; i++) {
+        struct bench_acc acc = { 0 };
+        int errors = 0;
+
+        for (int k = 0; k < iters; k++) {
+            uint32_t start = stats_now();
+            int rc = sensor_reading(get_sensor_name(i), buf, sizeof(buf));
+            uint32_t cycles = stats_now() - start;
+            if (rc < 0) {
+                errors++;
+                continue;
+            }
+            acc_add(&acc, cycles);
+        }
+        acc_print(shell, "read", get_sensor_name(i), &acc);
+        if (errors) {
+            shell_warn(shell, "%s: %d failed reads", get_sensor_name(i), errors);
+        }
+    }
+    return 0;
+}
+
+// Append throughput for a given number of records per open/sync cycle.
+// flush == 0 mimics the file sink, which opens and closes the file per record
+static int bench_fs_run(const struct shell *shell, int records, int rec_size, int flush)
+{
+    char rec[128];
+    struct fs_file_t file;
+    int rc = 0;
+    bool open = false;
+
+    memset(rec, 'x', rec_size - 1);
+    rec[rec_size - 1] = '\n';
+    fs_unlink(BENCH_FILE);
+    fs_file_t_init(&file);
+
+    int64_t start = k_uptime_ticks();
+    for (int i = 0; i < records; i++) {
+        if (!open) {
+            rc = fs_open(&file, BENCH_FILE, FS_O_CREATE | FS_O_APPEND | FS_O_WRITE);
+            if (rc < 0) {
+                break;
+            }
+            open = true;
+        }
+        rc = fs_write(&file, rec, rec_size);
+        if (rc < 0) {
+            break;
+        }
+        if (flush == 0) {
+            fs_close(&file);
+            open = false;
+        } else if ((i + 1) % flush == 0) {
+            fs_sync(&file);
+        }
+    }
+    if (open) {
+        fs_close(&file);
+    }
+    uint32_t us = k_ticks_to_us_floor32(k_uptime_ticks() - start);
+    fs_unlink(BENCH_FILE);
+
+    if (rc < 0) {
+        shell_error(shell, "fs bench failed: %d", rc);
+        return rc;
+    }
+    if (us == 0) {
+        us = 1;
+    }
+    shell_print(shell,
+                "BENCH {\"bench\":\"fs_append\",\"flush\":%d,\"records\":%d,\"rec_size\":%d,"
+                "\"us\":%u,\"bytes_per_s\":%u,\"records_per_s\":%u}",
+                flush, records, rec_size, us,
+                (uint32_t)((uint64_t)records * rec_size * 1000000U / us),
+                (uint32_t)((uint64_t)records * 1000000U / us));
+    return 0;
+}
+
+static int cmd_bench_fs(const struct shell *shell, size_t argc, char **argv)
+{
+    static const int flush_sizes[] = { 0, 1, 8, 32, 128 };
+    int records = arg_or(argc, argv, 1, 100);
+    int rec_size = arg_or(argc, argv, 2, 64);
+
+    if (rec_size < 2 || rec_size > 128 || records <= 0) {
+        shell_error(shell, "Usage: bench_fs [records] [record_size 2-128]");
+        return -EINVAL;
+    }
+    for (int i = 0; i < ARRAY_SIZE(flush_sizes); i++) {
+        int rc = bench_fs_run(shell, records, rec_size, flush_sizes[i]);
+        if (rc < 0) {
+            return rc;
+        }
+    }
+    return 0;
+}
+
+static uint32_t fsb_lat[FSBENCH_MAX_OPS]; // us
+static char fsb_buf[FSBENCH_MAX_SIZE];
+
+static int cmp_u32(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+    return (x > y) - (x < y);
+}
+
+static void fsb_record(int op, uint32_t start)
+{
+    fsb_lat[op] = stats_cyc_to_us(stats_now() - start);
+}
+
+static void fsb_print(const struct shell *shell, const char *profile, const char *op, int size,
+                      int n, uint32_t us)
+{
+    qsort(fsb_lat, n, sizeof(fsb_lat[0]), cmp_u32);
+    us = MAX(us, 1);
+    shell_print(shell,
+                "BENCH {\"bench\":\"fsbench\",\"profile\":\"%s\",\"op\":\"%s\",\"size\":%d,"
+                "\"n\":%d,\"us\":%u,\"bytes_per_s\":%u,\"ops_per_s\":%u,\"p50_us\":%u,"
+                "\"p90_us\":%u,\"p99_us\":%u,\"max_us\":%u}",
+                profile, op, size, n, us, (uint32_t)((uint64_t)n * size * 1000000U / us),
+                (uint32_t)((uint64_t)n * 1000000U / us), fsb_lat[(n - 1) * 50 / 100],
+                fsb_lat[(n - 1) * 90 / 100], fsb_lat[(n - 1) * 99 / 100], fsb_lat[n - 1]);
+}
+
+// One file written in size chunks, read back the same way, then the file
+// sink's pattern of open, append and close per record. The sequential
+// timings include the open and close, the percentiles are per call
+static int fsbench_size(const struct shell *shell, const char *profile, int size, int bytes)
+{
+    struct fs_file_t file;
+    int n = MIN(bytes / size, FSBENCH_MAX_OPS);
+    int rc;
+
+    fs_unlink(BENCH_FILE);
+    fs_file_t_init(&file);
+
+    int64_t start = k_uptime_ticks();
+    rc = fs_open(&file, BENCH_FILE, FS_O_CREATE | FS_O_WRITE);
+    for (int i = 0; rc >= 0 && i < n; i++) {
+        uint32_t t = stats_now();
+        rc = fs_write(&file, fsb_buf, size);
+        fsb_record(i, t);
+    }
+    if (rc >= 0) {
+        rc = fs_close(&file);
+    }
+    if (rc < 0) {
+        return rc;
+    }
+    fsb_print(shell, profile, "write", size, n, k_ticks_to_us_floor32(k_uptime_ticks() - start));
+
+    start = k_uptime_ticks();
+    rc = fs_open(&file, BENCH_FILE, FS_O_READ);
+    for (int i = 0; rc >= 0 && i < n; i++) {
+        uint32_t t = stats_now();
+        rc = fs_read(&file, fsb_buf, size);
+        fsb_record(i, t);
+        if (rc == 0) {
+            rc = -EIO; // shorter than written
+        }
+    }
+    if (rc >= 0) {
+        rc = fs_close(&file);
+    }
+    if (rc < 0) {
+        return rc;
+    }
+    fsb_print(shell, profile, "read", size, n, k_ticks_to_us_floor32(k_uptime_ticks() - start));
+
+    fs_unlink(BENCH_FILE);
+    n = MIN(n, FSBENCH_OPEN_OPS);
+    start = k_uptime_ticks();
+    for (int i = 0; rc >= 0 && i < n; i++) {
+        uint32_t t = stats_now();
+        rc = fs_open(&file, BENCH_FILE, FS_O_CREATE | FS_O_APPEND | FS_O_WRITE);
+        if (rc >= 0) {
+            rc = fs_write(&file, fsb_buf, size);
+            fs_close(&file);
+        }
+        fsb_record(i, t);
+    }
+    fs_unlink(BENCH_FILE);
+    if (rc < 0) {
+        return rc;
+    }
+    fsb_print(shell, profile, "open_append", size, n, k_ticks_to_us_floor32(k_uptime_ticks() - start));
+    return 0;
+}
+
+static int fsbench_profile(const struct shell *shell, int index, int bytes)
+{
+    static const int sizes[] = { 16, 64, 256, FSBENCH_MAX_SIZE };
+    const char *name = fs_profile_get(index)->name;
+    struct fs_statvfs vfs;
+
+    int rc = fs_profile_mount(index);
+    if (rc == 0) {
+        rc = fs_statvfs(FS_MOUNT_POINT, &vfs);
+    }
+    if (rc == 0 && (uint64_t)vfs.f_bfree * vfs.f_frsize < 2ULL * bytes) {
+        rc = -ENOSPC;
+    }
+    for (int i = 0; rc == 0 && i < ARRAY_SIZE(sizes); i++) {
+        rc = fsbench_size(shell, name, sizes[i], bytes);
+    }
+    if (rc < 0) {
+        shell_error(shell, "fsbench %s failed: %d", name, rc);
+    }
+    return rc;
+}
+
+static int cmd_fsbench(const struct shell *shell, size_t argc, char **argv)
+{
+    const char *which = argc > 1 ? argv[1] : "all";
+    int bytes = arg_or(argc, argv, 2, 4096);
+    int first = 0, last = fs_profile_count() - 1;
+    int original = fs_profile_current();
+    int rc = 0;
+
+    if (strcmp(which, "all") != 0) {
+        first = last = fs_profile_find(which);
+    }
+    if (first < 0 || bytes < FSBENCH_MAX_SIZE || bytes > 8192) {
+        shell_error(shell, "Usage: fsbench [profile|all] [bytes %d-8192], see fs_profile",
+                    FSBENCH_MAX_SIZE);
+        return -EINVAL;
+    }
+
+    // Their writes would land in the measurements, and each remount makes
+    // them wait. The event and step sinks write rarely enough to leave be
+    if (session_active() > 0) {
+        shell_error(shell, "Stop the logging sessions first, see list_sessions");
+        return -EBUSY;
+    }
+
+    memset(fsb_buf, 'x', sizeof(fsb_buf));
+    for (int i = first; i <= last && rc == 0; i++) {
+        rc = fsbench_profile(shell, i, bytes);
+    }
+    // Back to what was mounted, also after a failure
+    if (original >= 0 && fs_profile_current() != original) {
+        fs_profile_mount(original);
+    }
+    shell_print(shell, "BENCH {\"bench\":\"fsbench_done\"}");
+    return rc;
+}
+
+// URL parsing plus request formatting, without touching the network
+static int cmd_bench_http(const struct shell *shell, size_t argc, char **argv)
+{
+    int iters = arg_or(argc, argv, 1, 200);
+    const char *body = "LSM6DSL Accel: X 0.123456, Y -0.654321, Z 9.806650 m/s^2\n";
+    size_t body_len = strlen(body);
+    struct http_target target;
+    struct bench_acc acc = { 0 };
+    char req[256];
+
+    for (int k = 0; k < iters; k++) {
+        uint32_t start = stats_now();
+        int rc = http_parse_url("192.168.1.10/ingest/lsm6dsl", &target);
+        if (rc == 0) {
+            rc = http_build_post(req, sizeof(req), &target, body, body_len);
+        }
+        uint32_t cycles = stats_now() - start;
+        if (rc < 0) {
+            shell_error(shell, "request assembly failed: %d", rc);
+            return rc;
+        }
+        acc_add(&acc, cycles);
+    }
+    acc_print(shell, "http_build", "post", &acc);
+    return 0;
+}
+
+// End to end: timer expiry -> work queue -> sensor_reading() -> file append
+static struct {
+    struct k_timer timer;
+    struct k_work work;
+    struct k_sem done;
+    const char *sensor;
+    volatile uint32_t fired;
+    int remaining;
+    int errors;
+    struct bench_acc acc;
+} e2e;
+
+static void e2e_work_handler(struct k_work *work)
+{
+    char buf[128];
+    struct fs_file_t file;
+
+    int rc = sensor_reading(e2e.sensor, buf, sizeof(buf));
+    if (rc >= 0) {
+        fs_file_t_init(&file);
+        rc = fs_open(&file, BENCH_FILE, FS_O_CREATE | FS_O_APPEND | FS_O_WRITE);
+        if (rc >= 0) {
+            rc = fs_write(&file, buf, strlen(buf));
+            fs_close(&file);
+        }
+    }
+
+    if (rc < 0) {
+        e2e.errors++;
+    } else {
+        acc_add(&e2e.acc, stats_now() - e2e.fired);
+    }
+    if (--e2e.remaining <= 0) {
+        k_timer_stop(&e2e.timer);
+        k_sem_give(&e2e.done);
+    }
+}
+
+static void e2e_timer_callback(struct k_timer *timer)
+{
+    e2e.fired = stats_now();
+    k_work_submit(&e2e.work);
+}
+
+static int cmd_bench_e2e(const struct shell *shell, size_t argc, char **argv)
+{
+    if (argc < 2 || get_sensor_index(argv[1]) < 0) {
+        shell_error(shell, "Usage: bench_e2e <sensor_name> [period_ms] [samples]");
+        return -EINVAL;
+    }
+    int period = arg_or(argc, argv, 2, 100);
+    int samples = arg_or(argc, argv, 3, 50);
+
+    memset(&e2e.acc, 0, sizeof(e2e.acc));
+    e2e.sensor = get_sensor_name(get_sensor_index(argv[1]));
+    e2e.remaining = samples;
+    e2e.errors = 0;
+    k_timer_init(&e2e.timer, e2e_timer_callback, NULL);
+    k_work_init(&e2e.work, e2e_work_handler);
+    k_sem_init(&e2e.done, 0, 1);
+    fs_unlink(BENCH_FILE);
+
+    k_timer_start(&e2e.timer, K_MSEC(period), K_MSEC(period));
+    if (k_sem_take(&e2e.done, K_MSEC(period * samples * 2 + 1000)) != 0) {
+        k_timer_stop(&e2e.timer);
+        k_work_cancel(&e2e.work);
+        shell_error(shell, "Timed out after %u samples", e2e.acc.n);
+    }
+    fs_unlink(BENCH_FILE);
+
+    acc_print(shell, "e2e", e2e.sensor, &e2e.acc);
+    if (e2e.errors) {
+        shell_warn(shell, "%d samples failed", e2e.errors);
+    }
+    return 0;
+}
+
+static int cmd_bench_all(const struct shell *shell, size_t argc, char **argv)
+{
+    char *e2e_argv[] = { "bench_e2e", "lsm6dsl", "20", "50" };
+
+    cmd_bench_read(shell, 1, argv);
+    cmd_bench_http(shell, 1, argv);
+    cmd_bench_fs(shell, 1, argv);
+    cmd_bench_e2e(shell, ARRAY_SIZE(e2e_argv), e2e_argv);
+    shell_print(shell, "BENCH {\"bench\":\"done\"}");
+    return 0;
+}
+
+SHELL_CMD_REGISTER(bench_read, NULL, "Benchmark sensor_reading() per sensor [iterations]", cmd_bench_read);
+SHELL_CMD_REGISTER(bench_fs, NULL, "Benchmark file appends [records] [record_size]", cmd_bench_fs);
+SHELL_CMD_REGISTER(bench_http, NULL, "Benchmark HTTP request assembly [iterations]", cmd_bench_http);
+SHELL_CMD_REGISTER(bench_e2e, NULL, "Benchmark timer to file latency <sensor_name> [period_ms] [samples]", cmd_bench_e2e);
+SHELL_CMD_REGISTER(fsbench, NULL, "Benchmark littlefs profiles: write, read, open/append [profile|all] [bytes]", cmd_fsbench);
+SHELL_CMD_REGISTER(bench_all, NULL, "Run every benchmark with default arguments", cmd_bench_all);
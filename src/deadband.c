@@ -0,0 +1,274 @@
+#include "deadband.h"
+#include <zephyr/kernel.h>
+#include <zephyr/shell/shell.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <errno.h>
+
+struct deadband_axis {
+    int64_t abs_micro;   // absolute band, in micro units of the channel
+    uint32_t rel_ppm;    // relative band, parts per million of the last emitted value
+};
+
+struct deadband_state {
+    bool enabled;
+    uint32_t generation;   // bumped on every change, invalidates session references
+    uint32_t heartbeat_ms; // 0 = no heartbeat
+    struct deadband_axis axis[SENSOR_MAX_VALS];
+    uint32_t passed;
+    uint32_t suppressed;
+};
+
+static struct deadband_state deadband[NUM_SENSORS][STATS_NUM_SINKS];
+static K_MUTEX_DEFINE(deadband_lock);
+
+void deadband_restart(struct deadband_ref *ref)
+{
+    ref->have_ref = false;
+}
+
+static bool sample_moved(const struct deadband_state *st, const struct sensor_sample *ref,
+                         const struct sensor_sample *s)
+{
+    for (int i = 0; i < s->num_vals; i++) {
+        int64_t now = sensor_value_to_micro(&s->val[i]);
+        int64_t then = sensor_value_to_micro(&ref->val[i]);
+        int64_t rel = (int64_t)((uint64_t)llabs(then) * st->axis[i].rel_ppm / 1000000U);
+        if (llabs(now - then) > MAX(st->axis[i].abs_micro, rel)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool deadband_pass(struct deadband_ref *ref, int sensor, enum stats_sink sink,
+                   const struct sensor_sample *sample)
+{
+    bool pass = true;
+    int64_t now = k_uptime_get();
+
+    k_mutex_lock(&deadband_lock, K_FOREVER);
+    struct deadband_state *st = &deadband[sensor][sink];
+
+    if (!st->enabled) {
+        goto out;
+    }
+
+    if (ref->have_ref && ref->generation == st->generation &&
+        ref->sample.num_vals == sample->num_vals && !sample_moved(st, &ref->sample, sample) &&
+        (st->heartbeat_ms == 0 || now - ref->last_emit_ms < st->heartbeat_ms)) {
+        pass = false;
+        st->suppressed++;
+        goto out;
+    }
+
+    ref->sample = *sample;
+    ref->have_ref = true;
+    ref->generation = st->generation;
+    ref->last_emit_ms = now;
+    st->passed++;
+
+out:
+    k_mutex_unlock(&deadband_lock);
+    return pass;
+}
+
+// Fixed point parser for "12", "-0.25", "3.000001"; anything past six
+// fractional digits is truncated
+static int parse_micro(const char *str, int64_t *out)
+{
+    int64_t whole = 0;
+    int64_t frac = 0;
+    int64_t scale = 100000;
+    bool neg = false;
+
+    if (*str == '-' || *str == '+') {
+        neg = (*str == '-');
+        str++;
+    }
+    if (!isdigit((unsigned char)*str) && *str != '.') {
+        return -EINVAL;
+    }
+    while (isdigit((unsigned char)*str)) {
+        whole = whole * 10 + (*str++ - '0');
+    }
+    if (*str == '.') {
+        str++;
+        while (isdigit((unsigned char)*str)) {
+            frac += (*str++ - '0') * scale;
+            scale /= 10;
+        }
+    }
+    if (*str != '\0') {
+        return -EINVAL;
+    }
+    *out = (whole * 1000000 + frac) * (neg ? -1 : 1);
+    return 0;
+}
+
+static int parse_sink(const char *name, enum stats_sink *sink)
+{
+    if (strcmp(name, "file") == 0) {
+        *sink = STATS_SINK_FILE;
+    } else if (strcmp(name, "http") == 0) {
+        *sink = STATS_SINK_HTTP;
+    } else {
+        return -EINVAL;
+    }
+    return 0;
+}
+
+// Resolves "<sensor> <file|http>" and returns the session's state
+static struct deadband_state *parse_session(const struct shell *shell, char **argv, int *sensor)
+{
+    enum stats_sink sink;
+
+    *sensor = get_sensor_index(argv[1]);
+    if (*sensor < 0) {
+        shell_error(shell, "Unknown sensor: %s", argv[1]);
+        return NULL;
+    }
+    if (parse_sink(argv[2], &sink) < 0) {
+        shell_error(shell, "Unknown sink: %s (expected file or http)", argv[2]);
+        return NULL;
+    }
+    return &deadband[*sensor][sink];
+}
+
+static int cmd_deadband_set(const struct shell *shell, size_t argc, char **argv)
+{
+    int sensor;
+    int64_t abs_micro;
+    int64_t rel_micro = 0;
+
+    if (argc < 5) {
+        shell_error(shell, "Usage: deadband_set <sensor_name> <file|http> <axis|all> <abs> [rel_percent]");
+        return -EINVAL;
+    }
+    struct deadband_state *st = parse_session(shell, argv, &sensor);
+    if (!st) {
+        return -EINVAL;
+    }
+    if (parse_micro(argv[4], &abs_micro) < 0 || abs_micro < 0 ||
+        (argc > 5 && (parse_micro(argv[5], &rel_micro) < 0 || rel_micro < 0))) {
+        shell_error(shell, "Deadbands must be non-negative numbers");
+        return -EINVAL;
+    }
+
+    int first = 0;
+    int last = SENSOR_MAX_VALS - 1;
+    if (strcmp(argv[3], "all") != 0) {
+        for (first = 0; first < SENSOR_MAX_VALS; first++) {
+            const char *name = get_sensor_axis_name(sensor, first);
+            if (name && strcmp(name, argv[3]) == 0) {
+                break;
+            }
+        }
+        if (first == SENSOR_MAX_VALS) {
+            shell_error(shell, "%s has no axis %s", argv[1], argv[3]);
+            return -EINVAL;
+        }
+        last = first;
+    }
+
+    k_mutex_lock(&deadband_lock, K_FOREVER);
+    for (int i = first; i <= last; i++) {
+        st->axis[i].abs_micro = abs_micro;
+        // Percent in micro units is parts per hundred million
+        st->axis[i].rel_ppm = (uint32_t)MIN(rel_micro / 100, 1000000);
+    }
+    st->enabled = true;
+    st->generation++;
+    k_mutex_unlock(&deadband_lock);
+
+    shell_print(shell, "Deadband for %s %s %s set", argv[1], argv[2], argv[3]);
+    return 0;
+}
+
+static int cmd_deadband_heartbeat(const struct shell *shell, size_t argc, char **argv)
+{
+    int sensor;
+
+    if (argc < 4) {
+        shell_error(shell, "Usage: deadband_heartbeat <sensor_name> <file|http> <seconds>");
+        return -EINVAL;
+    }
+    struct deadband_state *st = parse_session(shell, argv, &sensor);
+    if (!st) {
+        return -EINVAL;
+    }
+    int seconds = atoi(argv[3]);
+    if (seconds < 0) {
+        shell_error(shell, "Heartbeat must be >= 0 seconds");
+        return -EINVAL;
+    }
+
+    k_mutex_lock(&deadband_lock, K_FOREVER);
+    st->heartbeat_ms = seconds * MSEC_PER_SEC;
+    st->enabled = true;
+    st->generation++;
+    k_mutex_unlock(&deadband_lock);
+
+    shell_print(shell, "Heartbeat for %s %s set to %d s", argv[1], argv[2], seconds);
+    return 0;
+}
+
+static int cmd_deadband_off(const struct shell *shell, size_t argc, char **argv)
+{
+    int sensor;
+
+    if (argc < 3) {
+        shell_error(shell, "Usage: deadband_off <sensor_name> <file|http>");
+        return -EINVAL;
+    }
+    struct deadband_state *st = parse_session(shell, argv, &sensor);
+    if (!st) {
+        return -EINVAL;
+    }
+
+    k_mutex_lock(&deadband_lock, K_FOREVER);
+    uint32_t generation = st->generation;
+    memset(st, 0, sizeof(*st));
+    st->generation = generation + 1;
+    k_mutex_unlock(&deadband_lock);
+
+    shell_print(shell, "Deadband for %s %s disabled, every sample is written", argv[1], argv[2]);
+    return 0;
+}
+
+static int cmd_deadband(const struct shell *shell, size_t argc, char **argv)
+{
+    static const char *const sink_names[STATS_NUM_SINKS] = { "file", "http", "interrupt" };
+
+    k_mutex_lock(&deadband_lock, K_FOREVER);
+    for (int i = 0; i < NUM_SENSORS; i++) {
+        for (int k = 0; k < STATS_NUM_SINKS; k++) {
+            struct deadband_state *st = &deadband[i][k];
+            if (!st->enabled) {
+                continue;
+            }
+            uint32_t total = st->passed + st->suppressed;
+            shell_print(shell, "%s %s: heartbeat %u s, %u of %u samples written",
+                        get_sensor_name(i), sink_names[k], st->heartbeat_ms / MSEC_PER_SEC,
+                        st->passed, total);
+            for (int a = 0; a < SENSOR_MAX_VALS; a++) {
+                const char *name = get_sensor_axis_name(i, a);
+                if (!name) {
+                    break;
+                }
+                shell_print(shell, "  %-12s abs %lld.%06lld rel %u.%04u %%", name,
+                            (long long)(st->axis[a].abs_micro / 1000000),
+                            (long long)(st->axis[a].abs_micro % 1000000),
+                            st->axis[a].rel_ppm / 10000, st->axis[a].rel_ppm % 10000);
+            }
+        }
+    }
+    k_mutex_unlock(&deadband_lock);
+    return 0;
+}
+
+SHELL_CMD_REGISTER(deadband, NULL, "Show change-triggered logging settings and counts", cmd_deadband);
+SHELL_CMD_REGISTER(deadband_set, NULL, "Set a deadband <sensor_name> <file|http> <axis|all> <abs> [rel_percent]", cmd_deadband_set);
+SHELL_CMD_REGISTER(deadband_heartbeat, NULL, "Set the longest gap between written samples <sensor_name> <file|http> <seconds>", cmd_deadband_heartbeat);
+SHELL_CMD_REGISTER(deadband_off, NULL, "Write every sample again <sensor_name> <file|http>", cmd_deadband_off);
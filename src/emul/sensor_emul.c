@@ -0,0 +1,454 @@
+// Register-level I2C emulators for the discovery board sensors.
+// Only built for native_sim, where they sit on the emulated i2c2 bus in place
+// of the real parts so the unmodified Zephyr drivers and our raw LSM6DSL
+// register accesses run against them.
+#include <zephyr/kernel.h>
+#include <zephyr/device.h>
+#include <zephyr/drivers/emul.h>
+#include <zephyr/drivers/i2c.h>
+#include <zephyr/drivers/i2c_emul.h>
+#include <zephyr/drivers/gpio/gpio_emul.h>
+#include <math.h>
+#include <string.h>
+
+#define PI_F 3.14159265f
+
+// Every transfer and the pedometer timer go through the register file under it
+static struct k_spinlock emul_lock;
+
+struct sensor_emul_data {
+    uint8_t regs[256];
+    uint8_t bank[128]; // LSM6DSL embedded function registers
+    uint8_t ptr;
+};
+
+struct reg_default {
+    uint8_t reg;
+    uint8_t val;
+};
+
+struct sensor_emul_cfg {
+    uint8_t reg_mask; // Sub-address bits that select a register (MSB is auto-increment on some parts)
+    const struct reg_default *defaults;
+    size_t num_defaults;
+    void (*update)(struct sensor_emul_data *data, float t);
+    // Return true if the write was consumed and must not land in regs[]
+    bool (*on_write)(struct sensor_emul_data *data, uint8_t reg, uint8_t val);
+    // Return true if the read was served from somewhere other than regs[]
+    bool (*on_read)(struct sensor_emul_data *data, uint8_t reg, uint8_t *val);
+};
+
+static inline void put_le16(uint8_t *p, int32_t v)
+{
+    p[0] = v & 0xFF;
+    p[1] = (v >> 8) & 0xFF;
+}
+
+static inline float wave(float t, float period_s)
+{
+    return sinf(2.0f * PI_F * t / period_s);
+}
+
+// HTS221: calibration puts T0/T1 at 10/40 C and H0/H1 at 20/80 %rH, with the
+// raw outputs spanning 0..3000 and 0..6000 so one LSB is 0.01 unit
+static const struct reg_default hts221_defaults[] = {
+    { 0x0F, 0xBC }, // WHO_AM_I
+    { 0x27, 0x03 }, // STATUS: T and H ready
+    { 0x30, 40 },   // H0_rH_x2
+    { 0x31, 160 },  // H1_rH_x2
+    { 0x32, 80 },   // T0_degC_x8
+    { 0x33, 0x40 }, // T1_degC_x8 (low byte of 320)
+    { 0x35, 0x04 }, // T1/T0 msb
+    { 0x3A, 0x70 }, { 0x3B, 0x17 }, // H1_T0_OUT = 6000
+    { 0x3E, 0xB8 }, { 0x3F, 0x0B }, // T1_OUT = 3000
+};
+
+static void hts221_update(struct sensor_emul_data *data, float t)
+{
+    float temp = 22.0f + 2.0f * wave(t, 600.0f);
+    float hum = 45.0f + 5.0f * wave(t, 900.0f);
+
+    put_le16(&data->regs[0x28], (int32_t)((hum - 20.0f) * 100.0f));
+    put_le16(&data->regs[0x2A], (int32_t)((temp - 10.0f) * 100.0f));
+}
+
+// LPS22HB: 4096 LSB/hPa, 100 LSB/C
+static const struct reg_default lps22hb_defaults[] = {
+    { 0x0F, 0xB1 }, // WHO_AM_I
+    { 0x11, 0x10 }, // CTRL_REG2: IF_ADD_INC
+    { 0x27, 0x03 }, // STATUS
+};
+
+static void lps22hb_update(struct sensor_emul_data *data, float t)
+{
+    int32_t press = (int32_t)((1013.25f + 0.5f * wave(t, 1200.0f)) * 4096.0f);
+    int32_t temp = (int32_t)((23.0f + wave(t, 600.0f)) * 100.0f);
+
+    data->regs[0x28] = press & 0xFF;
+    data->regs[0x29] = (press >> 8) & 0xFF;
+    data->regs[0x2A] = (press >> 16) & 0xFF;
+    put_le16(&data->regs[0x2B], temp);
+}
+
+// LIS3MDL: +-4 gauss full scale, 6842 LSB/gauss
+static const struct reg_default lis3mdl_defaults[] = {
+    { 0x0F, 0x3D }, // WHO_AM_I
+    { 0x27, 0xFF }, // STATUS
+};
+
+static void lis3mdl_update(struct sensor_emul_data *data, float t)
+{
+    float heading = 2.0f * PI_F * t / 20.0f;
+
+    put_le16(&data->regs[0x28], (int32_t)(0.3f * cosf(heading) * 6842.0f));
+    put_le16(&data->regs[0x2A], (int32_t)(0.3f * sinf(heading) * 6842.0f));
+    put_le16(&data->regs[0x2C], (int32_t)(-0.4f * 6842.0f));
+    put_le16(&data->regs[0x2E], 0);
+}
+
+// LSM6DSL: +-2 g (0.061 mg/LSB) and 245 dps (8.75 mdps/LSB) full scale
+static const struct reg_default lsm6dsl_defaults[] = {
+    { 0x0F, 0x6A }, // WHO_AM_I
+    { 0x12, 0x04 }, // CTRL3_C: IF_INC
+    { 0x1E, 0x07 }, // STATUS_REG: XL, G and T ready
+};
+
+// The FIFO as the step mode uses it: one pattern of timestamp and step
+// counter per detected step, continuous mode dropping the oldest pattern when
+// full. The other datasets are not modelled. There is one LSM6DSL on the bus
+#define LSM6DSL_FIFO_WORDS 2048 // 4 KB, as on the part
+#define LSM6DSL_STEP_WORDS 3
+#define LSM6DSL_STEP_MS_NUM 5000 // 1.8 steps/s: a step every 5000/9 ms
+#define LSM6DSL_STEP_MS_DEN 9
+// Where the board wires INT1, GPIOD 11 (INT1_PIN in main.c)
+#define LSM6DSL_INT1_PIN 11
+#define LSM6DSL_PEDO_TICK_MS 100
+
+static struct {
+    uint16_t words[LSM6DSL_FIFO_WORDS];
+    uint16_t head;
+    uint16_t level;
+    uint8_t pattern; // words of the pattern at head already read
+    bool overrun;
+    uint32_t steps; // last step count the FIFO was brought up to
+} lsm6dsl_fifo;
+
+static struct sensor_emul_data *lsm6dsl_data;
+
+static void lsm6dsl_pedo_tick(struct k_timer *timer);
+static K_TIMER_DEFINE(lsm6dsl_pedo_timer, lsm6dsl_pedo_tick, NULL);
+
+// TIMESTAMP2..0 count in 25 us with WAKE_UP_DUR.TIMER_HR, else in 6.4 ms
+static uint32_t lsm6dsl_timestamp(const struct sensor_emul_data *data, int64_t ms)
+{
+    int64_t ticks = (data->regs[0x5C] & 0x10) ? ms * 40 : ms * 10 / 64;
+
+    return (uint32_t)ticks & 0xFFFFFF;
+}
+
+static void lsm6dsl_fifo_push(const uint16_t *words, int n)
+{
+    if (lsm6dsl_fifo.level + n > LSM6DSL_FIFO_WORDS) {
+        // Whole patterns go, so the next read still starts on a boundary
+        lsm6dsl_fifo.head = (lsm6dsl_fifo.head + n) % LSM6DSL_FIFO_WORDS;
+        lsm6dsl_fifo.level -= n;
+        lsm6dsl_fifo.overrun = true;
+    }
+    for (int i = 0; i < n; i++) {
+        lsm6dsl_fifo.words[(lsm6dsl_fifo.head + lsm6dsl_fifo.level++) % LSM6DSL_FIFO_WORDS] = words[i];
+    }
+}
+
+static void lsm6dsl_fifo_clear(void)
+{
+    lsm6dsl_fifo.head = 0;
+    lsm6dsl_fifo.level = 0;
+    lsm6dsl_fifo.pattern = 0;
+    lsm6dsl_fifo.overrun = false;
+}
+
+static uint16_t lsm6dsl_fifo_watermark(const struct sensor_emul_data *data)
+{
+    return ((data->regs[0x07] & 0x07) << 8) | data->regs[0x06];
+}
+
+// Pedometer: keeps walking at 1.8 steps/s while it is enabled and counts into
+// STEP_COUNTER. With TIMER_PEDO_FIFO_EN and the FIFO running every new step
+// also goes into the FIFO, in the byte order lsm6dsl_step_decode() expects
+static void lsm6dsl_pedometer(struct sensor_emul_data *data, int64_t ms)
+{
+    uint32_t steps = (uint32_t)(ms * LSM6DSL_STEP_MS_DEN / LSM6DSL_STEP_MS_NUM);
+    bool to_fifo = (data->regs[0x07] & 0x80) && (data->regs[0x0A] & 0x07);
+
+    if (!(data->regs[0x19] & 0x04)) {
+        lsm6dsl_fifo.steps = steps;
+        return;
+    }
+    for (uint32_t k = lsm6dsl_fifo.steps + 1; to_fifo && k <= steps; k++) {
+        uint32_t ts = lsm6dsl_timestamp(data, (int64_t)k * LSM6DSL_STEP_MS_NUM / LSM6DSL_STEP_MS_DEN);
+        uint16_t pattern[LSM6DSL_STEP_WORDS] = {
+            ((ts >> 8) & 0xFF) | ((ts >> 16) << 8),
+            (ts & 0xFF) << 8,
+            k & 0xFFFF,
+        };
+        lsm6dsl_fifo_push(pattern, LSM6DSL_STEP_WORDS);
+    }
+    lsm6dsl_fifo.steps = steps;
+    put_le16(&data->regs[0x4B], steps);
+}
+
+// The part detects steps on its own, not only when the bus is busy, and raises
+// INT1 with INT1_FTH while the FIFO is at or above the watermark
+static void lsm6dsl_pedo_tick(struct k_timer *timer)
+{
+    k_spinlock_key_t key = k_spin_lock(&emul_lock);
+    struct sensor_emul_data *data = lsm6dsl_data;
+
+    lsm6dsl_pedometer(data, k_uptime_get());
+    uint16_t wtm = lsm6dsl_fifo_watermark(data);
+    int int1 = (data->regs[0x0D] & 0x08) && wtm > 0 && lsm6dsl_fifo.level >= wtm;
+    k_spin_unlock(&emul_lock, key);
+
+#if DT_NODE_EXISTS(DT_NODELABEL(gpiod))
+    gpio_emul_input_set(DEVICE_DT_GET(DT_NODELABEL(gpiod)), LSM6DSL_INT1_PIN, int1);
+#else
+    ARG_UNUSED(int1);
+#endif
+}
+
+static void lsm6dsl_update(struct sensor_emul_data *data, float t)
+{
+    // Slow tilt about X with a small 5 Hz vibration on top
+    float tilt = 0.5f * wave(t, 8.0f);
+    float vib = 0.2f * wave(t, 0.2f);
+    float ax = vib;
+    float ay = 9.80665f * sinf(tilt);
+    float az = 9.80665f * cosf(tilt);
+    float gx = 0.5f * (2.0f * PI_F / 8.0f) * cosf(2.0f * PI_F * t / 8.0f) * 180.0f / PI_F;
+
+    put_le16(&data->regs[0x20], 0); // 25 C
+    put_le16(&data->regs[0x22], (int32_t)(gx / 0.00875f));
+    put_le16(&data->regs[0x24], 0);
+    put_le16(&data->regs[0x26], 0);
+    put_le16(&data->regs[0x28], (int32_t)(ax / 9.80665f / 0.000061f));
+    put_le16(&data->regs[0x2A], (int32_t)(ay / 9.80665f / 0.000061f));
+    put_le16(&data->regs[0x2C], (int32_t)(az / 9.80665f / 0.000061f));
+
+    int64_t ms = k_uptime_get();
+    if (data->regs[0x19] & 0x20) {
+        uint32_t ts = lsm6dsl_timestamp(data, ms);
+        data->regs[0x40] = ts & 0xFF;
+        data->regs[0x41] = (ts >> 8) & 0xFF;
+        data->regs[0x42] = (ts >> 16) & 0xFF;
+    }
+    lsm6dsl_pedometer(data, ms);
+}
+
+static bool lsm6dsl_on_write(struct sensor_emul_data *data, uint8_t reg, uint8_t val)
+{
+    if (reg != 0x01 && (data->regs[0x01] & 0x80)) {
+        // FUNC_CFG_EN selects the embedded function bank
+        data->bank[reg & 0x7F] = val;
+        return true;
+    }
+    if (reg == 0x12) {
+        // BOOT and SW_RESET complete immediately
+        data->regs[reg] = val & ~0x81;
+        return true;
+    }
+    if (reg == 0x0A && !(val & 0x07)) {
+        // FIFO_CTRL5 bypass mode empties the FIFO
+        lsm6dsl_fifo_clear();
+    } else if (reg == 0x19) {
+        // CTRL10_C.FUNC_EN: the pedometer runs on its own clock
+        lsm6dsl_data = data;
+        if ((val & 0x04) && !(data->regs[0x19] & 0x04)) {
+            k_timer_start(&lsm6dsl_pedo_timer, K_MSEC(LSM6DSL_PEDO_TICK_MS),
+                          K_MSEC(LSM6DSL_PEDO_TICK_MS));
+        } else if (!(val & 0x04)) {
+            k_timer_stop(&lsm6dsl_pedo_timer);
+        }
+    }
+    return false;
+}
+
+static bool lsm6dsl_on_read(struct sensor_emul_data *data, uint8_t reg, uint8_t *val)
+{
+    if (reg != 0x01 && (data->regs[0x01] & 0x80)) {
+        *val = data->bank[reg & 0x7F];
+        return true;
+    }
+
+    uint16_t wtm = lsm6dsl_fifo_watermark(data);
+
+    switch (reg) {
+    case 0x3A: // FIFO_STATUS1: level in words
+        *val = lsm6dsl_fifo.level & 0xFF;
+        return true;
+    case 0x3B: // FIFO_STATUS2: WaterM, OVER_RUN, FIFO_EMPTY and the level's top bits
+        *val = ((lsm6dsl_fifo.level >> 8) & 0x07) |
+               (wtm > 0 && lsm6dsl_fifo.level >= wtm ? 0x80 : 0) |
+               (lsm6dsl_fifo.overrun ? 0x40 : 0) | (lsm6dsl_fifo.level == 0 ? 0x10 : 0);
+        return true;
+    case 0x3C: // FIFO_STATUS3/4: pattern word the next read returns
+        *val = lsm6dsl_fifo.pattern;
+        return true;
+    case 0x3D:
+        *val = 0;
+        return true;
+    case 0x3E: // FIFO_DATA_OUT_L: the word at the head
+        *val = lsm6dsl_fifo.level ? lsm6dsl_fifo.words[lsm6dsl_fifo.head] & 0xFF : 0;
+        return true;
+    case 0x3F: // FIFO_DATA_OUT_H pops the word and rolls back to _L
+        if (lsm6dsl_fifo.level) {
+            *val = lsm6dsl_fifo.words[lsm6dsl_fifo.head] >> 8;
+            lsm6dsl_fifo.head = (lsm6dsl_fifo.head + 1) % LSM6DSL_FIFO_WORDS;
+            lsm6dsl_fifo.level--;
+            lsm6dsl_fifo.pattern = (lsm6dsl_fifo.pattern + 1) % LSM6DSL_STEP_WORDS;
+            lsm6dsl_fifo.overrun = false;
+        } else {
+            *val = 0;
+        }
+        data->ptr = 0x3E;
+        return true;
+    default:
+        return false;
+    }
+}
+
+// VL53L0X: just enough of the ST API's register protocol for single-shot ranging
+static const struct reg_default vl53l0x_defaults[] = {
+    { 0xC0, 0xEE }, // IDENTIFICATION_MODEL_ID
+    { 0xC1, 0xAA },
+    { 0xC2, 0x10 }, // IDENTIFICATION_REVISION_ID
+    { 0x83, 0x01 }, // strobe
+    { 0x13, 0x07 }, // RESULT_INTERRUPT_STATUS: new sample ready
+    { 0x14, 0x58 }, // RESULT_RANGE_STATUS: range valid
+    { 0x1A, 0x01 }, // signal rate
+    { 0xB0, 0xFF }, { 0xB1, 0xFF }, { 0xB2, 0xFF }, // reference SPAD map
+    { 0xB3, 0xFF }, { 0xB4, 0xFF }, { 0xB5, 0xFF },
+};
+
+static void vl53l0x_update(struct sensor_emul_data *data, float t)
+{
+    int32_t range_mm = (int32_t)(300.0f + 100.0f * wave(t, 5.0f));
+
+    data->regs[0x1E] = (range_mm >> 8) & 0xFF;
+    data->regs[0x1F] = range_mm & 0xFF;
+}
+
+static bool vl53l0x_on_write(struct sensor_emul_data *data, uint8_t reg, uint8_t val)
+{
+    switch (reg) {
+    case 0x00: // SYSRANGE_START: the measurement finishes instantly
+        data->regs[reg] = val & ~0x01;
+        return true;
+    case 0x83: // strobe reads back non-zero once armed
+        data->regs[reg] = val ? val : 0x01;
+        return true;
+    case 0x0B: // SYSTEM_INTERRUPT_CLEAR: keep data ready asserted
+        return true;
+    default:
+        return false;
+    }
+}
+
+static int sensor_emul_transfer(const struct emul *target, struct i2c_msg *msgs,
+                                int num_msgs, int addr)
+{
+    const struct sensor_emul_cfg *cfg = target->cfg;
+    struct sensor_emul_data *data = target->data;
+    bool addressed = false;
+
+    ARG_UNUSED(addr);
+
+    k_spinlock_key_t key = k_spin_lock(&emul_lock);
+    cfg->update(data, k_uptime_get() / 1000.0f);
+
+    for (int i = 0; i < num_msgs; i++) {
+        struct i2c_msg *msg = &msgs[i];
+        uint32_t n = 0;
+
+        if (msg->flags & I2C_MSG_READ) {
+            for (; n < msg->len; n++) {
+                uint8_t reg = data->ptr++;
+                if (!cfg->on_read || !cfg->on_read(data, reg, &msg->buf[n])) {
+                    msg->buf[n] = data->regs[reg];
+                }
+            }
+            continue;
+        }
+
+        // First written byte of a transaction is the register address
+        if (!addressed && msg->len > 0) {
+            data->ptr = msg->buf[0] & cfg->reg_mask;
+            addressed = true;
+            n = 1;
+        }
+        for (; n < msg->len; n++) {
+            uint8_t reg = data->ptr++;
+            if (!cfg->on_write || !cfg->on_write(data, reg, msg->buf[n])) {
+                data->regs[reg] = msg->buf[n];
+            }
+        }
+    }
+    k_spin_unlock(&emul_lock, key);
+
+    return 0;
+}
+
+static const struct i2c_emul_api sensor_emul_api = {
+    .transfer = sensor_emul_transfer,
+};
+
+static int sensor_emul_init(const struct emul *target, const struct device *parent)
+{
+    const struct sensor_emul_cfg *cfg = target->cfg;
+    struct sensor_emul_data *data = target->data;
+
+    ARG_UNUSED(parent);
+
+    memset(data, 0, sizeof(*data));
+    for (size_t i = 0; i < cfg->num_defaults; i++) {
+        data->regs[cfg->defaults[i].reg] = cfg->defaults[i].val;
+    }
+    return 0;
+}
+
+#define SENSOR_EMUL_DEFINE(name, n, mask, write_hook, read_hook)               \
+    static struct sensor_emul_data sensor_emul_data_##name##_##n;              \
+    static const struct sensor_emul_cfg sensor_emul_cfg_##name##_##n = {       \
+        .reg_mask = mask,                                                      \
+        .defaults = name##_defaults,                                           \
+        .num_defaults = ARRAY_SIZE(name##_defaults),                           \
+        .update = name##_update,                                               \
+        .on_write = write_hook,                                                \
+        .on_read = read_hook,                                                  \
+    };                                                                         \
+    EMUL_DT_INST_DEFINE(n, sensor_emul_init, &sensor_emul_data_##name##_##n,   \
+                        &sensor_emul_cfg_##name##_##n, &sensor_emul_api, NULL)
+
+#define DT_DRV_COMPAT st_hts221
+#define HTS221_EMUL(n) SENSOR_EMUL_DEFINE(hts221, n, 0x7F, NULL, NULL);
+DT_INST_FOREACH_STATUS_OKAY(HTS221_EMUL)
+#undef DT_DRV_COMPAT
+
+#define DT_DRV_COMPAT st_lps22hb_press
+#define LPS22HB_EMUL(n) SENSOR_EMUL_DEFINE(lps22hb, n, 0x7F, NULL, NULL);
+DT_INST_FOREACH_STATUS_OKAY(LPS22HB_EMUL)
+#undef DT_DRV_COMPAT
+
+#define DT_DRV_COMPAT st_lis3mdl_magn
+#define LIS3MDL_EMUL(n) SENSOR_EMUL_DEFINE(lis3mdl, n, 0x7F, NULL, NULL);
+DT_INST_FOREACH_STATUS_OKAY(LIS3MDL_EMUL)
+#undef DT_DRV_COMPAT
+
+#define DT_DRV_COMPAT st_lsm6dsl
+#define LSM6DSL_EMUL(n) SENSOR_EMUL_DEFINE(lsm6dsl, n, 0x7F, lsm6dsl_on_write, lsm6dsl_on_read);
+DT_INST_FOREACH_STATUS_OKAY(LSM6DSL_EMUL)
+#undef DT_DRV_COMPAT
+
+#define DT_DRV_COMPAT st_vl53l0x
+#define VL53L0X_EMUL(n) SENSOR_EMUL_DEFINE(vl53l0x, n, 0xFF, vl53l0x_on_write, NULL);
+DT_INST_FOREACH_STATUS_OKAY(VL53L0X_EMUL)
+#undef DT_DRV_COMPAT
@@ -0,0 +1,349 @@
+#include "event_bus.h"
+#include "sensors.h"
+#include "stats.h"
+#include "http_sink.h"
+#include "lsm6dsl_ctx.h"
+#include "gesture.h"
+#include "fs_profile.h"
+#include <zephyr/kernel.h>
+#include <zephyr/shell/shell.h>
+#include <zephyr/fs/fs.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+
+#ifdef CONFIG_BT_ZEPHYR_NUS
+#include <zephyr/bluetooth/services/nus.h>
+#endif
+
+#define EVENT_QUEUE_DEPTH 16
+// Events a sink thread drains into one write
+#define EVENT_BATCH 8
+#define EVENT_LINE_MAX 40
+
+#define EVENT_FAST_PRIO 6
+#define EVENT_SLOW_PRIO 9
+
+// Source register bits
+#define TAP_SRC_SINGLE 0x20
+#define TAP_SRC_DOUBLE 0x10
+#define TAP_SRC_AXES 0x0F   // sign and X/Y/Z
+#define WU_SRC_FF 0x20
+#define WU_SRC_WU 0x08
+#define WU_SRC_AXES 0x07
+#define D6D_SRC_IA 0x40
+#define D6D_SRC_POS 0x3F
+
+struct sink_state {
+    const char *name;
+    struct k_msgq *queue;
+    int (*deliver)(struct sink_state *st, const char *buf, size_t len);
+    bool subscribed;
+    char target[128];
+    // Publishers, the sink's thread and the shell all touch the counters
+    atomic_t delivered;
+    atomic_t dropped;
+    atomic_t errors;
+    uint32_t lat_max; // under lat_lock
+    uint64_t lat_sum;
+};
+
+static const char *const type_names[EVENT_NUM_TYPES] = {
+    "single_tap", "double_tap", "wake_up", "free_fall", "6d", "gesture"
+};
+
+static K_MUTEX_DEFINE(bus_lock);
+static struct k_spinlock lat_lock;
+static volatile uint32_t int1_cycles;
+
+K_MSGQ_DEFINE(file_queue, sizeof(struct motion_event), EVENT_QUEUE_DEPTH, 4);
+K_MSGQ_DEFINE(http_queue, sizeof(struct motion_event), EVENT_QUEUE_DEPTH, 4);
+#ifdef CONFIG_BT_ZEPHYR_NUS
+K_MSGQ_DEFINE(ble_queue, sizeof(struct motion_event), EVENT_QUEUE_DEPTH, 4);
+#endif
+K_MSGQ_DEFINE(shell_queue, sizeof(struct motion_event), EVENT_QUEUE_DEPTH, 4);
+
+static int deliver_file(struct sink_state *st, const char *buf, size_t len)
+{
+    char path[sizeof(st->target) + 8];
+    struct fs_file_t file;
+
+    k_mutex_lock(&bus_lock, K_FOREVER);
+    snprintf(path, sizeof(path), "/lfs/%s", st->target);
+    k_mutex_unlock(&bus_lock);
+
+    fs_file_t_init(&file);
+    fs_profile_lock();
+    int ret = fs_open(&file, path, FS_O_CREATE | FS_O_APPEND | FS_O_WRITE);
+    if (ret == 0) {
+        ret = fs_write(&file, buf, len);
+        fs_close(&file);
+    }
+    fs_profile_unlock();
+    return ret;
+}
+
+static int deliver_http(struct sink_state *st, const char *buf, size_t len)
+{
+    static char req[EVENT_BATCH * EVENT_LINE_MAX + 256];
+    struct http_target http;
+
+    k_mutex_lock(&bus_lock, K_FOREVER);
+    int ret = http_parse_url(st->target, &http);
+    k_mutex_unlock(&bus_lock);
+
+    if (ret == 0) {
+        ret = http_build_post(req, sizeof(req), &http, buf, len);
+    }
+    if (ret > 0) {
+        ret = http_send(&http, req, ret);
+    }
+    return ret;
+}
+
+#ifdef CONFIG_BT_ZEPHYR_NUS
+static int deliver_ble(struct sink_state *st, const char *buf, size_t len)
+{
+    int ret = bt_nus_send(NULL, buf, len);
+    return ret < 0 ? ret : (int)len;
+}
+#endif
+
+static int deliver_shell(struct sink_state *st, const char *buf, size_t len)
+{
+    printk("%.*s", (int)len, buf);
+    return len;
+}
+
+static struct sink_state sinks[EVENT_NUM_SINKS] = {
+    [EVENT_SINK_FILE] = { .name = "file", .queue = &file_queue, .deliver = deliver_file },
+    [EVENT_SINK_HTTP] = { .name = "http", .queue = &http_queue, .deliver = deliver_http },
+#ifdef CONFIG_BT_ZEPHYR_NUS
+    [EVENT_SINK_BLE] = { .name = "ble", .queue = &ble_queue, .deliver = deliver_ble },
+#else
+    // Named so the shell can say it is not supported, no queue or thread
+    [EVENT_SINK_BLE] = { .name = "ble" },
+#endif
+    [EVENT_SINK_SHELL] = { .name = "shell", .queue = &shell_queue, .deliver = deliver_shell },
+};
+
+static void sink_thread(void *p1, void *p2, void *p3)
+{
+    struct sink_state *st = &sinks[(int)(intptr_t)p1];
+    struct motion_event ev;
+    uint32_t cycles[EVENT_BATCH];
+    char buf[EVENT_BATCH * EVENT_LINE_MAX];
+
+    while (true) {
+        size_t used = 0;
+        int n = 0;
+
+        k_msgq_get(st->queue, &ev, K_FOREVER);
+        do {
+            if (ev.type == EVENT_GESTURE) {
+                used += snprintf(buf + used, sizeof(buf) - used, "%u,%s,%s,%u\n", ev.uptime_ms,
+                                 type_names[ev.type], gesture_name(ev.detail), ev.value);
+            } else {
+                used += snprintf(buf + used, sizeof(buf) - used, "%u,%s,0x%02x\n",
+                                 ev.uptime_ms, type_names[ev.type], ev.detail);
+            }
+            cycles[n++] = ev.cycles;
+        } while (n < EVENT_BATCH && k_msgq_get(st->queue, &ev, K_NO_WAIT) == 0);
+
+        int ret = st->deliver(st, buf, used);
+        uint32_t now = stats_now();
+
+        if (st == &sinks[EVENT_SINK_FILE] || st == &sinks[EVENT_SINK_HTTP]) {
+            stats_sink_write(LSM6DSL, STATS_SINK_INTERRUPT, ret);
+        }
+        if (ret < 0) {
+            atomic_add(&st->errors, n);
+            continue;
+        }
+        k_spinlock_key_t key = k_spin_lock(&lat_lock);
+        for (int i = 0; i < n; i++) {
+            uint32_t lat = now - cycles[i];
+            st->lat_max = MAX(st->lat_max, lat);
+            st->lat_sum += lat;
+        }
+        atomic_add(&st->delivered, n);
+        k_spin_unlock(&lat_lock, key);
+    }
+}
+
+K_THREAD_DEFINE(event_file_tid, 2048, sink_thread, (void *)EVENT_SINK_FILE, NULL, NULL,
+                EVENT_SLOW_PRIO, 0, 0);
+K_THREAD_DEFINE(event_http_tid, 3072, sink_thread, (void *)EVENT_SINK_HTTP, NULL, NULL,
+                EVENT_SLOW_PRIO, 0, 0);
+#ifdef CONFIG_BT_ZEPHYR_NUS
+K_THREAD_DEFINE(event_ble_tid, 1024, sink_thread, (void *)EVENT_SINK_BLE, NULL, NULL,
+                EVENT_FAST_PRIO, 0, 0);
+#endif
+K_THREAD_DEFINE(event_shell_tid, 1024, sink_thread, (void *)EVENT_SINK_SHELL, NULL, NULL,
+                EVENT_FAST_PRIO, 0, 0);
+
+void event_publish(const struct motion_event *event)
+{
+    for (int i = 0; i < EVENT_NUM_SINKS; i++) {
+        struct sink_state *st = &sinks[i];
+        struct motion_event oldest;
+
+        if (!st->subscribed) {
+            continue;
+        }
+        // Keep latency bounded: a backed up sink loses its oldest event
+        while (k_msgq_put(st->queue, event, K_NO_WAIT) != 0) {
+            if (k_msgq_get(st->queue, &oldest, K_NO_WAIT) == 0) {
+                atomic_inc(&st->dropped);
+            }
+        }
+    }
+}
+
+int event_subscribe(enum event_sink sink, const char *target)
+{
+    if (sink >= EVENT_NUM_SINKS) {
+        return -EINVAL;
+    }
+#ifndef CONFIG_BT_ZEPHYR_NUS
+    if (sink == EVENT_SINK_BLE) {
+        return -ENOTSUP;
+    }
+#endif
+    if ((sink == EVENT_SINK_FILE || sink == EVENT_SINK_HTTP) &&
+        (!target || strlen(target) >= sizeof(sinks[sink].target))) {
+        return -EINVAL;
+    }
+
+    k_mutex_lock(&bus_lock, K_FOREVER);
+    if (target) {
+        strcpy(sinks[sink].target, target);
+    }
+    sinks[sink].subscribed = true;
+    k_mutex_unlock(&bus_lock);
+    return 0;
+}
+
+void event_unsubscribe(enum event_sink sink)
+{
+    if (sink < EVENT_NUM_SINKS) {
+        sinks[sink].subscribed = false;
+    }
+}
+
+// Runs on the system work queue: one burst read of the latched sources,
+// then every event found is published once
+static void event_read_handler(struct k_work *work)
+{
+    uint8_t src[3]; // WAKE_UP_SRC, TAP_SRC, D6D_SRC
+    struct motion_event ev = {
+        .cycles = int1_cycles,
+        .uptime_ms = k_uptime_get_32(),
+    };
+
+    stats_work_begin(LSM6DSL);
+    if (lsm6dsl_read_event_sources(&lsm6dsl_ctx, src) < 0) {
+        return;
+    }
+
+    if (src[1] & TAP_SRC_DOUBLE) {
+        ev.type = EVENT_DOUBLE_TAP;
+        ev.detail = src[1] & TAP_SRC_AXES;
+        event_publish(&ev);
+    } else if (src[1] & TAP_SRC_SINGLE) {
+        ev.type = EVENT_SINGLE_TAP;
+        ev.detail = src[1] & TAP_SRC_AXES;
+        event_publish(&ev);
+    }
+    if (src[0] & WU_SRC_WU) {
+        ev.type = EVENT_WAKE_UP;
+        ev.detail = src[0] & WU_SRC_AXES;
+        event_publish(&ev);
+    }
+    if (src[0] & WU_SRC_FF) {
+        ev.type = EVENT_FREE_FALL;
+        ev.detail = 0;
+        event_publish(&ev);
+    }
+    if (src[2] & D6D_SRC_IA) {
+        ev.type = EVENT_6D;
+        ev.detail = src[2] & D6D_SRC_POS;
+        event_publish(&ev);
+    }
+}
+
+static K_WORK_DEFINE(event_read_work, event_read_handler);
+
+void event_bus_int1(void)
+{
+    int1_cycles = stats_now();
+    stats_tick(LSM6DSL, k_work_submit(&event_read_work));
+}
+
+static int parse_sink(const char *name)
+{
+    for (int i = 0; i < EVENT_NUM_SINKS; i++) {
+        if (strcmp(sinks[i].name, name) == 0) {
+            return i;
+        }
+    }
+    return -EINVAL;
+}
+
+static int cmd_events(const struct shell *shell, size_t argc, char **argv)
+{
+    shell_print(shell, "%-6s %-4s %10s %8s %8s %6s %8s %8s", "sink", "on", "delivered",
+                "dropped", "errors", "queued", "avg_us", "max_us");
+    for (int i = 0; i < EVENT_NUM_SINKS; i++) {
+        struct sink_state *st = &sinks[i];
+        if (!st->queue) {
+            continue;
+        }
+        k_spinlock_key_t key = k_spin_lock(&lat_lock);
+        uint32_t delivered = atomic_get(&st->delivered);
+        uint32_t avg = delivered ? (uint32_t)(st->lat_sum / delivered) : 0;
+        uint32_t max = st->lat_max;
+        k_spin_unlock(&lat_lock, key);
+
+        shell_print(shell, "%-6s %-4s %10u %8u %8u %6u %8u %8u", st->name,
+                    st->subscribed ? "yes" : "no", delivered, (uint32_t)atomic_get(&st->dropped),
+                    (uint32_t)atomic_get(&st->errors), k_msgq_num_used_get(st->queue),
+                    stats_cyc_to_us(avg), stats_cyc_to_us(max));
+    }
+    return 0;
+}
+
+static int cmd_events_subscribe(const struct shell *shell, size_t argc, char **argv)
+{
+    if (argc < 2) {
+        shell_error(shell, "Usage: events_subscribe <file|http|ble|shell> [file_name|url]");
+        return -EINVAL;
+    }
+    int sink = parse_sink(argv[1]);
+    if (sink < 0) {
+        shell_error(shell, "Unknown sink: %s", argv[1]);
+        return -EINVAL;
+    }
+    int ret = event_subscribe(sink, argc > 2 ? argv[2] : NULL);
+    if (ret < 0) {
+        shell_error(shell, "Cannot subscribe %s: %d", argv[1], ret);
+        return ret;
+    }
+    shell_print(shell, "Motion events go to %s", argv[1]);
+    return 0;
+}
+
+static int cmd_events_unsubscribe(const struct shell *shell, size_t argc, char **argv)
+{
+    if (argc < 2 || parse_sink(argv[1]) < 0) {
+        shell_error(shell, "Usage: events_unsubscribe <file|http|ble|shell>");
+        return -EINVAL;
+    }
+    event_unsubscribe(parse_sink(argv[1]));
+    shell_print(shell, "Motion events no longer go to %s", argv[1]);
+    return 0;
+}
+
+SHELL_CMD_REGISTER(events, NULL, "Show motion event sinks, drops and latency", cmd_events);
+SHELL_CMD_REGISTER(events_subscribe, NULL, "Send motion events to <file|http|ble|shell> [file_name|url]", cmd_events_subscribe);
+SHELL_CMD_REGISTER(events_unsubscribe, NULL, "Stop sending motion events to <file|http|ble|shell>", cmd_events_unsubscribe);
@@ -73,8 +73,8 @@ static int cmd_cat(const struct shell *shell, size_t argc, char **argv)
         return rc;
     } else {
         shell_print(shell, "Contents of %s:", filepath);
-        char buf[64];
-        while(1) { // reading 64 bytes at a time for now. maybe bigger later
+        char buf[256];
+        while(1) { // one shell write, and so one UART DMA transfer, per chunk
             int got = fs_read(&file, buf, sizeof(buf) - 1);
             if (got < 0) { //error
                 shell_error(shell, "Failed to read file %s: %d", filepath, got);
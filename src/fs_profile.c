@@ -0,0 +1,188 @@
+// littlefs configuration profiles for the storage partition. The STM32L475
+// flash programs 8 bytes at a time and erases 2 KB pages, so every size here
+// is a multiple of 8 that divides 2048. `fsbench` in bench.c measures them.
+#include "fs_profile.h"
+#include <zephyr/kernel.h>
+#include <zephyr/fs/fs.h>
+#include <zephyr/fs/littlefs.h>
+#include <zephyr/storage/flash_map.h>
+#include <zephyr/settings/settings.h>
+#include <zephyr/shell/shell.h>
+#include <string.h>
+#include <errno.h>
+
+#define FS_PROFILE_KEY "fs/profile"
+
+static const struct fs_profile profiles[] = {
+    // Zephyr's Kconfig defaults, what the board always mounted with
+    { "default", "Zephyr defaults", 16, 16, 64, 32, 512 },
+    // Fewest bytes: 72 for the mount and 32 per open file
+    { "small_ram", "least RAM", 8, 8, 32, 8, 512 },
+    // Small appends coalesce in the cache and the metadata commit of each
+    // close touches fewer pages. 10 blocks need only 16 bytes of lookahead
+    { "logging", "append-heavy logging", 16, 16, 256, 16, 500 },
+    // Whole-page cache for large sequential reads and writes
+    { "bulk", "large transfers", 64, 64, 512, 16, 500 },
+};
+
+FS_LITTLEFS_DECLARE_CUSTOM_CONFIG(lfs_data, 4, 16, 16, FS_PROFILE_CACHE_MAX, FS_PROFILE_LOOKAHEAD_MAX);
+
+static struct fs_mount_t lfs_mnt = {
+    .type = FS_LITTLEFS,
+    .fs_data = &lfs_data,
+    .storage_dev = (void *)FIXED_PARTITION_ID(storage_partition),
+    .mnt_point = FS_MOUNT_POINT,
+};
+
+static K_MUTEX_DEFINE(fs_lock);
+static int current = -1; // not mounted
+static bool booted;
+
+int fs_profile_count(void)
+{
+    return ARRAY_SIZE(profiles);
+}
+
+const struct fs_profile *fs_profile_get(int index)
+{
+    return (index >= 0 && index < ARRAY_SIZE(profiles)) ? &profiles[index] : NULL;
+}
+
+int fs_profile_find(const char *name)
+{
+    for (int i = 0; i < ARRAY_SIZE(profiles); i++) {
+        if (strcmp(profiles[i].name, name) == 0) {
+            return i;
+        }
+    }
+    return -ENOENT;
+}
+
+int fs_profile_current(void)
+{
+    return current;
+}
+
+void fs_profile_lock(void)
+{
+    k_mutex_lock(&fs_lock, K_FOREVER);
+}
+
+void fs_profile_unlock(void)
+{
+    k_mutex_unlock(&fs_lock);
+}
+
+int fs_profile_mount(int index)
+{
+    const struct fs_profile *p = fs_profile_get(index);
+    int rc;
+
+    if (!p) {
+        return -EINVAL;
+    }
+    if (p->cache_size > FS_PROFILE_CACHE_MAX || p->lookahead_size > FS_PROFILE_LOOKAHEAD_MAX) {
+        return -ENOMEM;
+    }
+
+    fs_profile_lock();
+    if (current >= 0) {
+        rc = fs_unmount(&lfs_mnt);
+        if (rc < 0) {
+            fs_profile_unlock();
+            return rc;
+        }
+        current = -1;
+    }
+    lfs_data.cfg.read_size = p->read_size;
+    lfs_data.cfg.prog_size = p->prog_size;
+    lfs_data.cfg.cache_size = p->cache_size;
+    lfs_data.cfg.lookahead_size = p->lookahead_size;
+    lfs_data.cfg.block_cycles = p->block_cycles;
+    // Only the boot mount formats a partition it cannot mount, a profile
+    // that fails later must not cost the logs
+    lfs_mnt.flags = booted ? FS_MOUNT_FLAG_NO_FORMAT : 0;
+    rc = fs_mount(&lfs_mnt);
+    booted = true;
+    if (rc == 0) {
+        current = index;
+    }
+    fs_profile_unlock();
+    return rc;
+}
+
+int fs_profile_select(int index)
+{
+    int rc = fs_profile_mount(index);
+
+    if (rc == 0) {
+        const char *name = profiles[index].name;
+        rc = settings_save_one(FS_PROFILE_KEY, name, strlen(name) + 1);
+    }
+    return rc;
+}
+
+static int restore_one(const char *key, size_t len, settings_read_cb read_cb, void *cb_arg,
+                       void *param)
+{
+    char name[16];
+    int *index = param;
+
+    if (len > sizeof(name) || read_cb(cb_arg, name, len) != len) {
+        return 0;
+    }
+    name[sizeof(name) - 1] = '\0';
+    *index = fs_profile_find(name);
+    return 0;
+}
+
+int fs_profile_restore(void)
+{
+    int index = -ENOENT;
+    int rc = settings_load_subtree_direct(FS_PROFILE_KEY, restore_one, &index);
+
+    if (rc < 0 || index < 0 || index == current) {
+        return (rc < 0) ? rc : current;
+    }
+    rc = fs_profile_mount(index);
+    if (rc < 0) {
+        printk("littlefs profile %s failed (%d), back to %s\n", profiles[index].name, rc,
+               profiles[FS_PROFILE_DEFAULT].name);
+        fs_profile_mount(FS_PROFILE_DEFAULT);
+        return rc;
+    }
+    return index;
+}
+
+static int cmd_fs_profile(const struct shell *shell, size_t argc, char **argv)
+{
+    if (argc > 1) {
+        int index = fs_profile_find(argv[1]);
+        if (index < 0) {
+            shell_error(shell, "Unknown profile: %s", argv[1]);
+            return -EINVAL;
+        }
+        // Loggers wait on fs_profile_lock() for the remount
+        int rc = fs_profile_select(index);
+        if (rc < 0) {
+            shell_error(shell, "Mounting with %s failed: %d", argv[1], rc);
+            return rc;
+        }
+    }
+
+    shell_print(shell, "%-10s %5s %5s %6s %10s %7s %9s  %s", "profile", "read", "prog", "cache",
+                "lookahead", "cycles", "ram", "use");
+    for (int i = 0; i < ARRAY_SIZE(profiles); i++) {
+        const struct fs_profile *p = &profiles[i];
+        // What the profile needs: read and prog caches plus lookahead for the
+        // mount, and a cache per open file. The mount buffers are sized for
+        // FS_PROFILE_CACHE_MAX whichever profile is mounted
+        shell_print(shell, "%-10s %5u %5u %6u %10u %7d %4u + %un  %s%s", p->name, p->read_size,
+                    p->prog_size, p->cache_size, p->lookahead_size, p->block_cycles,
+                    2 * p->cache_size + p->lookahead_size, p->cache_size, p->use,
+                    i == current ? " (mounted)" : "");
+    }
+    return 0;
+}
+
+SHELL_CMD_REGISTER(fs_profile, NULL, "Show littlefs profiles or remount with one [name]", cmd_fs_profile);
@@ -0,0 +1,588 @@
+// Orientation from the LSM6DSL and LIS3MDL with a Madgwick filter.
+// The filter runs in its own thread at the IMU rate; the orientation sensor in
+// main.c only copies the latest result, so sinks pick their own output rate.
+#include "fusion.h"
+#include "sensors.h"
+#include "stats.h"
+#include "power.h"
+#include "lsm6dsl_ctx.h"
+#include "sample_pool.h"
+#include <zephyr/kernel.h>
+#include <zephyr/shell/shell.h>
+#include <zephyr/drivers/sensor.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+
+#define FUSION_STACK_SIZE 1536
+#define FUSION_PRIO 5
+
+// The magnetometer changes slowly, one fetch every FUSION_MAG_DIV IMU samples
+#define FUSION_MAG_DIV 4
+#define FUSION_MAG_ODR_HZ 80
+// Steps longer than this many periods (scheduling stalls) are clamped
+#define FUSION_MAX_DT_PERIODS 4
+
+#define FUSION_DEFAULT_BETA 0.1f
+#define FUSION_TRACE_MAX 32
+
+#define RAD_TO_DEG 57.29578f
+
+// One filter step, kept so the host can replay it (see scripts/fusion_parity.py)
+struct fusion_trace_rec {
+    float dt;
+    float acc[3];
+    float gyro[3];
+    float mag[3];
+    float q_in[4];
+    float q_out[4];
+};
+
+static const struct device *const imu = DEVICE_DT_GET_ANY(st_lsm6dsl);
+static const struct device *const magn = DEVICE_DT_GET_ANY(st_lis3mdl_magn);
+
+// The magnetometer axes are used as they come. A board that mounts the
+// LIS3MDL rotated against the IMU needs its remap here
+static const int8_t mag_axis[3] = { 0, 1, 2 };
+static const int8_t mag_sign[3] = { 1, 1, 1 };
+
+static K_SEM_DEFINE(start_sem, 0, 1);
+static K_SEM_DEFINE(trace_sem, 0, 1);
+static K_TIMER_DEFINE(fusion_timer, NULL, NULL);
+static struct k_spinlock q_lock;
+
+static atomic_t running;
+static uint32_t rate_hz = FUSION_DEFAULT_HZ;
+static float beta = FUSION_DEFAULT_BETA;
+static enum fusion_output output = FUSION_OUTPUT_BOTH;
+
+// Filter state, owned by the fusion thread
+static float q[4] = { 1.0f, 0.0f, 0.0f, 0.0f };
+static float mag[3];
+static uint32_t last_cycles;
+static uint32_t step_count;
+
+// Published copy for fusion_capture()
+static float q_out[4];
+static float euler_out[3];
+static bool have_output;
+
+// Status counters
+static uint32_t updates;
+static uint32_t fetch_errors;
+static uint32_t missed_ticks;
+static uint32_t filter_cyc_max;
+static uint64_t filter_cyc_sum;
+
+static struct fusion_trace_rec trace[FUSION_TRACE_MAX];
+static atomic_t trace_want;
+static atomic_t trace_len;
+
+static inline float value_to_float(const struct sensor_value *v)
+{
+    return (float)v->val1 + (float)v->val2 * 1e-6f;
+}
+
+static void float_to_value(float f, struct sensor_value *v)
+{
+    int64_t micro = (int64_t)(f * 1e6f);
+    v->val1 = (int32_t)(micro / 1000000);
+    v->val2 = (int32_t)(micro % 1000000);
+}
+
+static inline float inv_sqrt(float x)
+{
+    return 1.0f / sqrtf(x);
+}
+
+// Gyroscope and accelerometer only, used until the first magnetometer sample
+static void madgwick_imu(float *qv, const float *g, const float *a, float dt)
+{
+    float q0 = qv[0], q1 = qv[1], q2 = qv[2], q3 = qv[3];
+    float gx = g[0], gy = g[1], gz = g[2];
+    float ax = a[0], ay = a[1], az = a[2];
+    float recip, s0, s1, s2, s3;
+
+    float qd0 = 0.5f * (-q1 * gx - q2 * gy - q3 * gz);
+    float qd1 = 0.5f * (q0 * gx + q2 * gz - q3 * gy);
+    float qd2 = 0.5f * (q0 * gy - q1 * gz + q3 * gx);
+    float qd3 = 0.5f * (q0 * gz + q1 * gy - q2 * gx);
+
+    if (!(ax == 0.0f && ay == 0.0f && az == 0.0f)) {
+        recip = inv_sqrt(ax * ax + ay * ay + az * az);
+        ax *= recip;
+        ay *= recip;
+        az *= recip;
+
+        float _2q0 = 2.0f * q0;
+        float _2q1 = 2.0f * q1;
+        float _2q2 = 2.0f * q2;
+        float _2q3 = 2.0f * q3;
+        float _4q0 = 4.0f * q0;
+        float _4q1 = 4.0f * q1;
+        float _4q2 = 4.0f * q2;
+        float _8q1 = 8.0f * q1;
+        float _8q2 = 8.0f * q2;
+        float q0q0 = q0 * q0;
+        float q1q1 = q1 * q1;
+        float q2q2 = q2 * q2;
+        float q3q3 = q3 * q3;
+
+        s0 = _4q0 * q2q2 + _2q2 * ax + _4q0 * q1q1 - _2q1 * ay;
+        s1 = _4q1 * q3q3 - _2q3 * ax + 4.0f * q0q0 * q1 - _2q0 * ay - _4q1
+             + _8q1 * q1q1 + _8q1 * q2q2 + _4q1 * az;
+        s2 = 4.0f * q0q0 * q2 + _2q0 * ax + _4q2 * q3q3 - _2q3 * ay - _4q2
+             + _8q2 * q1q1 + _8q2 * q2q2 + _4q2 * az;
+        s3 = 4.0f * q1q1 * q3 - _2q1 * ax + 4.0f * q2q2 * q3 - _2q2 * ay;
+
+        float norm = s0 * s0 + s1 * s1 + s2 * s2 + s3 * s3;
+        if (norm > 0.0f) {
+            recip = inv_sqrt(norm);
+            qd0 -= beta * s0 * recip;
+            qd1 -= beta * s1 * recip;
+            qd2 -= beta * s2 * recip;
+            qd3 -= beta * s3 * recip;
+        }
+    }
+
+    q0 += qd0 * dt;
+    q1 += qd1 * dt;
+    q2 += qd2 * dt;
+    q3 += qd3 * dt;
+
+    recip = inv_sqrt(q0 * q0 + q1 * q1 + q2 * q2 + q3 * q3);
+    qv[0] = q0 * recip;
+    qv[1] = q1 * recip;
+    qv[2] = q2 * recip;
+    qv[3] = q3 * recip;
+}
+
+// Full MARG update. Units only matter for the gyroscope (rad/s), the
+// accelerometer and magnetometer vectors are normalised
+static void madgwick_marg(float *qv, const float *g, const float *a, const float *m, float dt)
+{
+    float q0 = qv[0], q1 = qv[1], q2 = qv[2], q3 = qv[3];
+    float gx = g[0], gy = g[1], gz = g[2];
+    float ax = a[0], ay = a[1], az = a[2];
+    float mx = m[0], my = m[1], mz = m[2];
+    float recip, s0, s1, s2, s3;
+
+    if (mx == 0.0f && my == 0.0f && mz == 0.0f) {
+        madgwick_imu(qv, g, a, dt);
+        return;
+    }
+
+    float qd0 = 0.5f * (-q1 * gx - q2 * gy - q3 * gz);
+    float qd1 = 0.5f * (q0 * gx + q2 * gz - q3 * gy);
+    float qd2 = 0.5f * (q0 * gy - q1 * gz + q3 * gx);
+    float qd3 = 0.5f * (q0 * gz + q1 * gy - q2 * gx);
+
+    if (!(ax == 0.0f && ay == 0.0f && az == 0.0f)) {
+        recip = inv_sqrt(ax * ax + ay * ay + az * az);
+        ax *= recip;
+        ay *= recip;
+        az *= recip;
+        recip = inv_sqrt(mx * mx + my * my + mz * mz);
+        mx *= recip;
+        my *= recip;
+        mz *= recip;
+
+        float _2q0mx = 2.0f * q0 * mx;
+        float _2q0my = 2.0f * q0 * my;
+        float _2q0mz = 2.0f * q0 * mz;
+        float _2q1mx = 2.0f * q1 * mx;
+        float _2q0 = 2.0f * q0;
+        float _2q1 = 2.0f * q1;
+        float _2q2 = 2.0f * q2;
+        float _2q3 = 2.0f * q3;
+        float _2q0q2 = 2.0f * q0 * q2;
+        float _2q2q3 = 2.0f * q2 * q3;
+        float q0q0 = q0 * q0;
+        float q0q1 = q0 * q1;
+        float q0q2 = q0 * q2;
+        float q0q3 = q0 * q3;
+        float q1q1 = q1 * q1;
+        float q1q2 = q1 * q2;
+        float q1q3 = q1 * q3;
+        float q2q2 = q2 * q2;
+        float q2q3 = q2 * q3;
+        float q3q3 = q3 * q3;
+
+        // Earth's field in the sensor frame, rotated into the x-z plane
+        float hx = mx * q0q0 - _2q0my * q3 + _2q0mz * q2 + mx * q1q1 + _2q1 * my * q2
+                   + _2q1 * mz * q3 - mx * q2q2 - mx * q3q3;
+        float hy = _2q0mx * q3 + my * q0q0 - _2q0mz * q1 + _2q1mx * q2 - my * q1q1
+                   + my * q2q2 + _2q2 * mz * q3 - my * q3q3;
+        float _2bx = sqrtf(hx * hx + hy * hy);
+        float _2bz = -_2q0mx * q2 + _2q0my * q1 + mz * q0q0 + _2q1mx * q3 - mz * q1q1
+                     + _2q2 * my * q3 - mz * q2q2 + mz * q3q3;
+        float _4bx = 2.0f * _2bx;
+        float _4bz = 2.0f * _2bz;
+
+        // Objective function residuals
+        float fa0 = 2.0f * q1q3 - _2q0q2 - ax;
+        float fa1 = 2.0f * q0q1 + _2q2q3 - ay;
+        float fa2 = 1.0f - 2.0f * q1q1 - 2.0f * q2q2 - az;
+        float fm0 = _2bx * (0.5f - q2q2 - q3q3) + _2bz * (q1q3 - q0q2) - mx;
+        float fm1 = _2bx * (q1q2 - q0q3) + _2bz * (q0q1 + q2q3) - my;
+        float fm2 = _2bx * (q0q2 + q1q3) + _2bz * (0.5f - q1q1 - q2q2) - mz;
+
+        // Gradient descent step, J^T * f
+        s0 = -_2q2 * fa0 + _2q1 * fa1 - _2bz * q2 * fm0
+             + (-_2bx * q3 + _2bz * q1) * fm1 + _2bx * q2 * fm2;
+        s1 = _2q3 * fa0 + _2q0 * fa1 - 4.0f * q1 * fa2 + _2bz * q3 * fm0
+             + (_2bx * q2 + _2bz * q0) * fm1 + (_2bx * q3 - _4bz * q1) * fm2;
+        s2 = -_2q0 * fa0 + _2q3 * fa1 - 4.0f * q2 * fa2 + (-_4bx * q2 - _2bz * q0) * fm0
+             + (_2bx * q1 + _2bz * q3) * fm1 + (_2bx * q0 - _4bz * q2) * fm2;
+        s3 = _2q1 * fa0 + _2q2 * fa1 + (-_4bx * q3 + _2bz * q1) * fm0
+             + (-_2bx * q0 + _2bz * q2) * fm1 + _2bx * q1 * fm2;
+
+        float norm = s0 * s0 + s1 * s1 + s2 * s2 + s3 * s3;
+        if (norm > 0.0f) {
+            recip = inv_sqrt(norm);
+            qd0 -= beta * s0 * recip;
+            qd1 -= beta * s1 * recip;
+            qd2 -= beta * s2 * recip;
+            qd3 -= beta * s3 * recip;
+        }
+    }
+
+    q0 += qd0 * dt;
+    q1 += qd1 * dt;
+    q2 += qd2 * dt;
+    q3 += qd3 * dt;
+
+    recip = inv_sqrt(q0 * q0 + q1 * q1 + q2 * q2 + q3 * q3);
+    qv[0] = q0 * recip;
+    qv[1] = q1 * recip;
+    qv[2] = q2 * recip;
+    qv[3] = q3 * recip;
+}
+
+// Roll about X, pitch about Y, yaw about Z, in degrees
+static void quat_to_euler(const float *qv, float *e)
+{
+    float sinp = 2.0f * (qv[0] * qv[2] - qv[3] * qv[1]);
+
+    e[0] = atan2f(2.0f * (qv[0] * qv[1] + qv[2] * qv[3]),
+                  1.0f - 2.0f * (qv[1] * qv[1] + qv[2] * qv[2])) * RAD_TO_DEG;
+    e[1] = asinf(CLAMP(sinp, -1.0f, 1.0f)) * RAD_TO_DEG;
+    e[2] = atan2f(2.0f * (qv[0] * qv[3] + qv[1] * qv[2]),
+                  1.0f - 2.0f * (qv[2] * qv[2] + qv[3] * qv[3])) * RAD_TO_DEG;
+}
+
+// The sensors are read through the sample pool like every other user, which
+// keeps the fetches apart from sessions and gesture recognition. A capture
+// taken within half of max_age_ms is shared
+static int fetch_vals(int sensor, uint32_t period_ms, float *out, int n)
+{
+    struct sample_rec *rec;
+    int rc = sample_get(sensor, period_ms / 2, &rec);
+    if (rc < 0) {
+        return rc;
+    }
+    if (rec->sample.num_vals < n) {
+        rc = -EIO;
+    }
+    for (int i = 0; rc >= 0 && i < n; i++) {
+        out[i] = value_to_float(&rec->sample.val[i]);
+    }
+    sample_put(rec);
+    return (rc < 0) ? rc : 0;
+}
+
+static int fetch_mag(void)
+{
+    float raw[3];
+    int rc = fetch_vals(LIS3MDL, FUSION_MAG_DIV * MSEC_PER_SEC / rate_hz, raw, 3);
+    if (rc < 0) {
+        return rc;
+    }
+    for (int i = 0; i < 3; i++) {
+        mag[i] = mag_sign[i] * raw[mag_axis[i]];
+    }
+    return 0;
+}
+
+static void fusion_step(void)
+{
+    float imu_vals[6], euler[3], dt;
+    // accel_x..z then gyro_x..z, as the LSM6DSL sensor lists its axes
+    const float *acc = &imu_vals[0];
+    const float *gyro = &imu_vals[3];
+
+    if (fetch_vals(LSM6DSL, MSEC_PER_SEC / rate_hz, imu_vals, 6) < 0) {
+        fetch_errors++;
+        return;
+    }
+    // A failed magnetometer read keeps the previous field, the IMU part still runs
+    if (step_count++ % FUSION_MAG_DIV == 0 && fetch_mag() < 0) {
+        fetch_errors++;
+    }
+
+    // Integrate over the time that actually passed, not the nominal period.
+    // The CPU may sleep in between, so this one is on the system timer
+    uint32_t now = k_cycle_get_32();
+    if (last_cycles == 0) {
+        dt = 1.0f / rate_hz;
+    } else {
+        dt = k_cyc_to_us_floor32(now - last_cycles) * 1e-6f;
+        dt = MIN(dt, (float)FUSION_MAX_DT_PERIODS / rate_hz);
+    }
+    last_cycles = now;
+
+    uint32_t filter_start = stats_now();
+    struct fusion_trace_rec *rec = NULL;
+    atomic_val_t n = atomic_get(&trace_len);
+    if (n < atomic_get(&trace_want)) {
+        rec = &trace[n];
+        rec->dt = dt;
+        memcpy(rec->acc, acc, sizeof(rec->acc));
+        memcpy(rec->gyro, gyro, sizeof(rec->gyro));
+        memcpy(rec->mag, mag, sizeof(mag));
+        memcpy(rec->q_in, q, sizeof(q));
+    }
+
+    madgwick_marg(q, gyro, acc, mag, dt);
+    quat_to_euler(q, euler);
+
+    uint32_t cycles = stats_now() - filter_start;
+    filter_cyc_sum += cycles;
+    filter_cyc_max = MAX(filter_cyc_max, cycles);
+    updates++;
+
+    if (rec) {
+        memcpy(rec->q_out, q, sizeof(q));
+        if (atomic_inc(&trace_len) + 1 >= atomic_get(&trace_want)) {
+            k_sem_give(&trace_sem);
+        }
+    }
+
+    k_spinlock_key_t key = k_spin_lock(&q_lock);
+    memcpy(q_out, q, sizeof(q));
+    memcpy(euler_out, euler, sizeof(euler));
+    have_output = true;
+    k_spin_unlock(&q_lock, key);
+}
+
+static void fusion_thread_fn(void *p1, void *p2, void *p3)
+{
+    for (;;) {
+        k_sem_take(&start_sem, K_FOREVER);
+        while (atomic_get(&running)) {
+            // Returns 0 once the timer is stopped, more than 1 if we fell behind
+            uint32_t expired = k_timer_status_sync(&fusion_timer);
+            if (expired == 0 || !atomic_get(&running)) {
+                break;
+            }
+            missed_ticks += expired - 1;
+            fusion_step();
+        }
+    }
+}
+
+K_THREAD_DEFINE(fusion_thread, FUSION_STACK_SIZE, fusion_thread_fn, NULL, NULL, NULL,
+                FUSION_PRIO, K_FP_REGS, 0);
+
+int fusion_start(uint32_t imu_hz)
+{
+    if (imu_hz == 0 || imu_hz > FUSION_MAX_HZ) {
+        return -EINVAL;
+    }
+    if (!device_is_ready(imu) || !device_is_ready(magn)) {
+        return -ENODEV;
+    }
+    if (atomic_get(&running)) {
+        fusion_stop();
+    }
+    // The event modes reprogram the accelerometer and switch the gyro off,
+    // so they stay out until the filter stops
+    if (lsm6dsl_hold_normal(&lsm6dsl_ctx) < 0) {
+        return -EBUSY;
+    }
+
+    // Held, so low power mode does not drop the rates under the filter
+    struct sensor_value odr = { imu_hz, 0 };
+    struct sensor_value mag_odr = { FUSION_MAG_ODR_HZ, 0 };
+    power_window_hold(LSM6DSL, true);
+    power_window_hold(LIS3MDL, true);
+    lsm6dsl_set_odr(&lsm6dsl_ctx, SENSOR_CHAN_ACCEL_XYZ, &odr);
+    lsm6dsl_set_odr(&lsm6dsl_ctx, SENSOR_CHAN_GYRO_XYZ, &odr);
+    sensor_attr_set(magn, SENSOR_CHAN_ALL, SENSOR_ATTR_SAMPLING_FREQUENCY, &mag_odr);
+
+    rate_hz = imu_hz;
+    q[0] = 1.0f;
+    q[1] = q[2] = q[3] = 0.0f;
+    memset(mag, 0, sizeof(mag));
+    last_cycles = 0;
+    step_count = 0;
+    updates = fetch_errors = missed_ticks = 0;
+    filter_cyc_max = 0;
+    filter_cyc_sum = 0;
+
+    k_spinlock_key_t key = k_spin_lock(&q_lock);
+    have_output = false;
+    k_spin_unlock(&q_lock, key);
+
+    atomic_set(&running, 1);
+    k_timer_start(&fusion_timer, K_USEC(USEC_PER_SEC / imu_hz), K_USEC(USEC_PER_SEC / imu_hz));
+    k_sem_give(&start_sem);
+    return 0;
+}
+
+void fusion_stop(void)
+{
+    if (!atomic_cas(&running, 1, 0)) {
+        return;
+    }
+    k_timer_stop(&fusion_timer);
+    power_window_hold(LSM6DSL, false);
+    power_window_hold(LIS3MDL, false);
+    lsm6dsl_release_normal(&lsm6dsl_ctx);
+}
+
+bool fusion_running(void)
+{
+    return atomic_get(&running) != 0;
+}
+
+int fusion_capture(struct sensor_sample *sample)
+{
+    float qv[4], e[3];
+
+    k_spinlock_key_t key = k_spin_lock(&q_lock);
+    bool valid = have_output;
+    memcpy(qv, q_out, sizeof(qv));
+    memcpy(e, euler_out, sizeof(e));
+    k_spin_unlock(&q_lock, key);
+
+    if (!valid) {
+        return -ENODATA;
+    }
+    for (int i = 0; i < 4; i++) {
+        float_to_value(qv[i], &sample->val[i]);
+    }
+    for (int i = 0; i < 3; i++) {
+        float_to_value(e[i], &sample->val[4 + i]);
+    }
+    sample->num_vals = FUSION_NUM_VALS;
+    return 0;
+}
+
+enum fusion_output fusion_get_output(void)
+{
+    return output;
+}
+
+static uint32_t filter_us_avg(void)
+{
+    return updates ? stats_cyc_to_us((uint32_t)(filter_cyc_sum / updates)) : 0;
+}
+
+// fusion_start [imu_hz] [beta]
+static int cmd_fusion_start(const struct shell *shell, size_t argc, char **argv)
+{
+    uint32_t hz = (argc > 1) ? strtoul(argv[1], NULL, 10) : FUSION_DEFAULT_HZ;
+
+    if (argc > 2) {
+        float b = strtof(argv[2], NULL);
+        if (b <= 0.0f || b > 1.0f) {
+            shell_error(shell, "beta must be in (0, 1]");
+            return -EINVAL;
+        }
+        beta = b;
+    }
+
+    int rc = fusion_start(hz);
+    if (rc == -EBUSY) {
+        shell_error(shell, "LSM6DSL is in %s mode, switch to normal first",
+                    lsm6dsl_mode_name(lsm6dsl_get_mode(&lsm6dsl_ctx)));
+    } else if (rc < 0) {
+        shell_error(shell, "Usage: fusion_start [imu_hz 1-%d] [beta] (err %d)", FUSION_MAX_HZ, rc);
+    } else {
+        shell_print(shell, "Fusion running at %u Hz, read it as sensor \"orientation\"", hz);
+    }
+    return rc;
+}
+
+static int cmd_fusion_stop(const struct shell *shell, size_t argc, char **argv)
+{
+    fusion_stop();
+    shell_print(shell, "Fusion stopped");
+    return 0;
+}
+
+static int cmd_fusion_output(const struct shell *shell, size_t argc, char **argv)
+{
+    static const char *const names[] = { "quat", "euler", "both" };
+
+    if (argc < 2) {
+        shell_print(shell, "%s", names[output]);
+        return 0;
+    }
+    for (int i = 0; i < ARRAY_SIZE(names); i++) {
+        if (strcmp(argv[1], names[i]) == 0) {
+            output = i;
+            return 0;
+        }
+    }
+    shell_error(shell, "Usage: fusion_output <quat|euler|both>");
+    return -EINVAL;
+}
+
+static int cmd_fusion(const struct shell *shell, size_t argc, char **argv)
+{
+    shell_print(shell, "state: %s at %u Hz, beta %d.%03d", fusion_running() ? "running" : "stopped",
+                rate_hz, (int)beta, (int)(beta * 1000) % 1000);
+    shell_print(shell, "updates: %u, fetch errors: %u, missed ticks: %u",
+                updates, fetch_errors, missed_ticks);
+    shell_print(shell, "filter: avg %u us, max %u us per update",
+                filter_us_avg(), stats_cyc_to_us(filter_cyc_max));
+    return 0;
+}
+
+// Record the next n filter steps and dump their inputs and outputs as raw
+// float bits, so a host reference sees exactly what the filter saw
+static int cmd_fusion_trace(const struct shell *shell, size_t argc, char **argv)
+{
+    int n = (argc > 1) ? atoi(argv[1]) : FUSION_TRACE_MAX;
+
+    if (n <= 0 || n > FUSION_TRACE_MAX) {
+        shell_error(shell, "Usage: fusion_trace [steps 1-%d]", FUSION_TRACE_MAX);
+        return -EINVAL;
+    }
+    if (!fusion_running()) {
+        shell_error(shell, "Fusion is not running");
+        return -ENODATA;
+    }
+
+    k_sem_reset(&trace_sem);
+    atomic_set(&trace_len, 0);
+    atomic_set(&trace_want, n);
+    if (k_sem_take(&trace_sem, K_MSEC(n * 4 * MSEC_PER_SEC / rate_hz + 1000)) != 0) {
+        shell_warn(shell, "Only %d of %d steps recorded", (int)atomic_get(&trace_len), n);
+    }
+    n = atomic_get(&trace_len);
+    atomic_set(&trace_want, 0);
+
+    union { float f; uint32_t u; } beta_bits = { .f = beta };
+    shell_print(shell, "FUSION_BETA %08x", beta_bits.u);
+    for (int i = 0; i < n; i++) {
+        const uint32_t *w = (const uint32_t *)&trace[i];
+        char line[sizeof(struct fusion_trace_rec) / 4 * 9 + 8];
+        int used = snprintf(line, sizeof(line), "FUSION");
+        for (int k = 0; k < sizeof(struct fusion_trace_rec) / 4; k++) {
+            used += snprintf(line + used, sizeof(line) - used, " %08x", w[k]);
+        }
+        shell_print(shell, "%s", line);
+    }
+    return 0;
+}
+
+SHELL_CMD_REGISTER(fusion, NULL, "Show orientation filter status", cmd_fusion);
+SHELL_CMD_REGISTER(fusion_start, NULL, "Start the orientation filter [imu_hz] [beta]", cmd_fusion_start);
+SHELL_CMD_REGISTER(fusion_stop, NULL, "Stop the orientation filter", cmd_fusion_stop);
+SHELL_CMD_REGISTER(fusion_output, NULL, "Select orientation output <quat|euler|both>", cmd_fusion_output);
+SHELL_CMD_REGISTER(fusion_trace, NULL, "Dump filter steps for a host parity check [steps]", cmd_fusion_trace);
@@ -0,0 +1,431 @@
+// On-device gesture recognition with the quantized MLP in gesture_model.c.
+// A thread samples the LSM6DSL at the window rate and keeps exact integer sums
+// over the last IMU_WINDOW_LEN samples. Every hop it turns them into the
+// window features and classifies them, which costs the same few microseconds
+// whatever the window length. Recognized gestures go out on the event bus.
+#include "gesture.h"
+#include "gesture_model.h"
+#include "imu_window.h"
+#include "event_bus.h"
+#include "sample_pool.h"
+#include "sensors.h"
+#include "stats.h"
+#include "power.h"
+#include "fusion.h"
+#include "lsm6dsl_ctx.h"
+#include <zephyr/kernel.h>
+#include <zephyr/shell/shell.h>
+#include <zephyr/drivers/sensor.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+
+#define GESTURE_STACK_SIZE 1536
+#define GESTURE_PRIO 6
+
+// Windows with less accelerometer movement than this (sum of the three std,
+// m/s^2) are rest, not a gesture, and are not classified into events
+#define GESTURE_MIN_MOTION 1.0f
+// The IMU rate while recognizing, unless the fusion filter has set its own
+#define GESTURE_IMU_ODR_HZ 104
+
+// (i, j) channel pairs of the corr_* features, accel then gyro
+static const uint8_t pairs[6][2] = { { 0, 1 }, { 0, 2 }, { 1, 2 }, { 3, 4 }, { 3, 5 }, { 4, 5 } };
+
+// Sums over the samples in a window, in the fixed point units of imu_window.h.
+// Integer, so removing the oldest sample undoes adding it exactly
+struct window_sums {
+    uint16_t n;
+    int32_t sum[IMU_WINDOW_AXES];
+    int32_t abs_sum[2];          // |x| + |y| + |z|, accel then gyro
+    int64_t sq[IMU_WINDOW_AXES];
+    int64_t cross[6];            // in pairs order
+};
+
+// Everything the recognizer keeps in RAM, reported by `gesture`
+struct gesture_state {
+    int16_t ring[IMU_WINDOW_LEN][IMU_WINDOW_AXES];
+    uint16_t head;
+    struct window_sums sums;
+    uint16_t since_hop;
+    uint32_t since_event;
+    int8_t last_class;
+};
+
+static K_SEM_DEFINE(start_sem, 0, 1);
+static K_TIMER_DEFINE(gesture_timer, NULL, NULL);
+
+static atomic_t running;
+static uint16_t hop = GESTURE_DEFAULT_HOP;
+static uint8_t min_conf = GESTURE_DEFAULT_CONF;
+static struct gesture_state st;
+
+// Counters, written by the gesture thread only
+static uint32_t windows, events, fetch_errors, missed_ticks;
+static uint32_t feat_cyc_max, infer_cyc_max;
+static uint64_t feat_cyc_sum, infer_cyc_sum;
+static int8_t last_seen = -1;
+static uint8_t last_seen_conf;
+
+static void sums_update(struct window_sums *s, const int16_t v[IMU_WINDOW_AXES], int sign)
+{
+    for (int c = 0; c < IMU_WINDOW_AXES; c++) {
+        s->sum[c] += sign * v[c];
+        s->abs_sum[c / 3] += sign * abs(v[c]);
+        s->sq[c] += sign * (int64_t)v[c] * v[c];
+    }
+    for (int k = 0; k < 6; k++) {
+        s->cross[k] += sign * (int64_t)v[pairs[k][0]] * v[pairs[k][1]];
+    }
+    s->n += sign;
+}
+
+// mean, std (population), sma and Pearson correlation, as in gestures/features.py
+static void sums_features(const struct window_sums *s, float out[GESTURE_FEATURES])
+{
+    float n = s->n;
+    float spread[IMU_WINDOW_AXES]; // sqrt(n * sq - sum^2), n times the std in LSBs
+
+    for (int c = 0; c < IMU_WINDOW_AXES; c++) {
+        int64_t var_n2 = s->n * s->sq[c] - (int64_t)s->sum[c] * s->sum[c];
+        spread[c] = sqrtf((float)var_n2);
+    }
+    for (int g = 0; g < 2; g++) {
+        float *f = &out[g * 10];
+        float lsb = g == 0 ? IMU_ACCEL_LSB_PER_MS2 : IMU_GYRO_LSB_PER_RADS;
+
+        for (int i = 0; i < 3; i++) {
+            f[i] = s->sum[g * 3 + i] / (n * lsb);
+            f[3 + i] = spread[g * 3 + i] / (n * lsb);
+        }
+        f[6] = s->abs_sum[g] / (n * lsb);
+        for (int k = 0; k < 3; k++) {
+            int a = pairs[g * 3 + k][0];
+            int b = pairs[g * 3 + k][1];
+            float denom = spread[a] * spread[b];
+            int64_t cov_n2 = s->n * s->cross[g * 3 + k] - (int64_t)s->sum[a] * s->sum[b];
+            f[7 + k] = denom > 0.0f ? (float)cov_n2 / denom : 0.0f;
+        }
+    }
+}
+
+void gesture_features(const struct imu_window *w, float out[GESTURE_FEATURES])
+{
+    struct window_sums s = { 0 };
+
+    for (int k = 0; k < w->len; k++) {
+        sums_update(&s, w->v[k], 1);
+    }
+    sums_features(&s, out);
+}
+
+static int8_t to_int8(float x)
+{
+    float r = floorf(x + 0.5f);
+
+    return (int8_t)CLAMP(r, -127.0f, 127.0f);
+}
+
+int gesture_classify(const float features[GESTURE_FEATURES], uint8_t *conf)
+{
+    const struct gesture_model *m = &gesture_model;
+    int8_t xq[GESTURE_FEATURES];
+    int8_t hq[GESTURE_HIDDEN_MAX];
+    int32_t out[GESTURE_CLASSES_MAX];
+    int best = 0;
+
+    if (m->num_features != GESTURE_FEATURES || m->hidden > GESTURE_HIDDEN_MAX ||
+        m->num_classes > GESTURE_CLASSES_MAX) {
+        return -EINVAL;
+    }
+    for (int i = 0; i < GESTURE_FEATURES; i++) {
+        xq[i] = to_int8((features[i] - m->feat_mean[i]) * m->feat_inv_std[i] * m->in_inv_scale);
+    }
+    for (int j = 0; j < m->hidden; j++) {
+        const int8_t *w = &m->w1[j * GESTURE_FEATURES];
+        int32_t acc = m->b1[j];
+
+        for (int i = 0; i < GESTURE_FEATURES; i++) {
+            acc += w[i] * xq[i];
+        }
+        hq[j] = acc > 0 ? to_int8(acc * m->h_mult) : 0;
+    }
+    for (int k = 0; k < m->num_classes; k++) {
+        const int8_t *w = &m->w2[k * m->hidden];
+        int32_t acc = m->b2[k];
+
+        for (int j = 0; j < m->hidden; j++) {
+            acc += w[j] * hq[j];
+        }
+        out[k] = acc;
+        if (acc > out[best]) {
+            best = k;
+        }
+    }
+    if (conf) {
+        // Softmax probability of the winner, 1 / sum(exp(logit_k - logit_best))
+        float denom = 0.0f;
+        for (int k = 0; k < m->num_classes; k++) {
+            denom += expf((out[k] - out[best]) * m->out_scale);
+        }
+        *conf = (uint8_t)(100.0f / denom);
+    }
+    return best;
+}
+
+const char *gesture_name(int cls)
+{
+    if (cls < 0 || cls >= gesture_model.num_classes) {
+        return "?";
+    }
+    return gesture_model.class_names[cls];
+}
+
+static void gesture_classify_window(uint32_t window_cycles)
+{
+    float features[GESTURE_FEATURES];
+    uint8_t conf;
+
+    uint32_t start = stats_now();
+    sums_features(&st.sums, features);
+    uint32_t mid = stats_now();
+    int cls = gesture_classify(features, &conf);
+    uint32_t end = stats_now();
+
+    windows++;
+    feat_cyc_sum += mid - start;
+    feat_cyc_max = MAX(feat_cyc_max, mid - start);
+    infer_cyc_sum += end - mid;
+    infer_cyc_max = MAX(infer_cyc_max, end - mid);
+    if (cls < 0) {
+        return;
+    }
+    last_seen = cls;
+    last_seen_conf = conf;
+
+    // Rest between gestures lets the same gesture be reported again at once
+    if (features[3] + features[4] + features[5] < GESTURE_MIN_MOTION) {
+        st.last_class = -1;
+        return;
+    }
+    if (conf < min_conf) {
+        return;
+    }
+    // One event per gesture: the window keeps seeing it for a while
+    if (cls == st.last_class && st.since_event < IMU_WINDOW_LEN) {
+        return;
+    }
+    struct motion_event ev = {
+        .cycles = window_cycles,
+        .uptime_ms = k_uptime_get_32(),
+        .type = EVENT_GESTURE,
+        .detail = cls,
+        .value = conf,
+    };
+    event_publish(&ev);
+    events++;
+    st.last_class = cls;
+    st.since_event = 0;
+}
+
+static void gesture_step(uint32_t max_age_ms)
+{
+    struct sample_rec *rec;
+    int16_t v[IMU_WINDOW_AXES];
+
+    if (sample_get(LSM6DSL, max_age_ms, &rec) < 0) {
+        fetch_errors++;
+        return;
+    }
+    uint32_t taken = stats_now();
+    imu_window_fixed(&rec->sample, v);
+    sample_put(rec);
+
+    if (st.sums.n == IMU_WINDOW_LEN) {
+        sums_update(&st.sums, st.ring[st.head], -1);
+    }
+    memcpy(st.ring[st.head], v, sizeof(v));
+    sums_update(&st.sums, v, 1);
+    st.head = (st.head + 1) % IMU_WINDOW_LEN;
+    st.since_event++;
+
+    if (st.sums.n == IMU_WINDOW_LEN && ++st.since_hop >= hop) {
+        st.since_hop = 0;
+        gesture_classify_window(taken);
+    }
+}
+
+static void gesture_thread_fn(void *p1, void *p2, void *p3)
+{
+    for (;;) {
+        k_sem_take(&start_sem, K_FOREVER);
+        while (atomic_get(&running)) {
+            // Returns 0 once the timer is stopped, more than 1 if we fell behind
+            uint32_t expired = k_timer_status_sync(&gesture_timer);
+            if (expired == 0 || !atomic_get(&running)) {
+                break;
+            }
+            missed_ticks += expired - 1;
+            // A capture shared with a session is fine if it is from this period
+            gesture_step(MSEC_PER_SEC / IMU_WINDOW_HZ / 2);
+        }
+    }
+}
+
+K_THREAD_DEFINE(gesture_thread, GESTURE_STACK_SIZE, gesture_thread_fn, NULL, NULL, NULL,
+                GESTURE_PRIO, K_FP_REGS, 0);
+
+int gesture_start(uint16_t hop_samples, uint8_t conf)
+{
+    if (hop_samples == 0 || hop_samples > IMU_WINDOW_LEN || conf > 100) {
+        return -EINVAL;
+    }
+    if (gesture_model.num_features != GESTURE_FEATURES ||
+        gesture_model.hidden > GESTURE_HIDDEN_MAX ||
+        gesture_model.num_classes > GESTURE_CLASSES_MAX) {
+        return -EINVAL;
+    }
+    if (atomic_get(&running)) {
+        gesture_stop();
+    }
+    // The event modes reprogram the accelerometer and switch the gyro off,
+    // so they stay out until recognition stops
+    if (lsm6dsl_hold_normal(&lsm6dsl_ctx) < 0) {
+        return -EBUSY;
+    }
+
+    power_window_hold(LSM6DSL, true);
+    if (!fusion_running()) {
+        struct sensor_value odr = { GESTURE_IMU_ODR_HZ, 0 };
+        lsm6dsl_set_odr(&lsm6dsl_ctx, SENSOR_CHAN_ACCEL_XYZ, &odr);
+        lsm6dsl_set_odr(&lsm6dsl_ctx, SENSOR_CHAN_GYRO_XYZ, &odr);
+    }
+
+    hop = hop_samples;
+    min_conf = conf;
+    memset(&st, 0, sizeof(st));
+    st.last_class = -1;
+    windows = events = fetch_errors = missed_ticks = 0;
+    feat_cyc_max = infer_cyc_max = 0;
+    feat_cyc_sum = infer_cyc_sum = 0;
+    last_seen = -1;
+
+    atomic_set(&running, 1);
+    k_timer_start(&gesture_timer, K_USEC(USEC_PER_SEC / IMU_WINDOW_HZ),
+                  K_USEC(USEC_PER_SEC / IMU_WINDOW_HZ));
+    k_sem_give(&start_sem);
+    return 0;
+}
+
+void gesture_stop(void)
+{
+    if (!atomic_cas(&running, 1, 0)) {
+        return;
+    }
+    k_timer_stop(&gesture_timer);
+    // Holds are counted, the filter keeps its own if it still runs
+    power_window_hold(LSM6DSL, false);
+    lsm6dsl_release_normal(&lsm6dsl_ctx);
+}
+
+bool gesture_running(void)
+{
+    return atomic_get(&running) != 0;
+}
+
+static uint32_t cyc_avg_us(uint64_t sum)
+{
+    return windows ? stats_cyc_to_us((uint32_t)(sum / windows)) : 0;
+}
+
+// gesture_start [hop_samples] [min_conf_percent]
+static int cmd_gesture_start(const struct shell *shell, size_t argc, char **argv)
+{
+    int hop_arg = argc > 1 ? atoi(argv[1]) : GESTURE_DEFAULT_HOP;
+    int conf_arg = argc > 2 ? atoi(argv[2]) : GESTURE_DEFAULT_CONF;
+
+    if (hop_arg <= 0 || hop_arg > IMU_WINDOW_LEN || conf_arg < 0 || conf_arg > 100) {
+        shell_error(shell, "Usage: gesture_start [hop_samples 1-%d] [min_conf 0-100]", IMU_WINDOW_LEN);
+        return -EINVAL;
+    }
+    int rc = gesture_start(hop_arg, conf_arg);
+    if (rc == -EBUSY) {
+        shell_error(shell, "LSM6DSL is in %s mode, switch to normal first",
+                    lsm6dsl_mode_name(lsm6dsl_get_mode(&lsm6dsl_ctx)));
+        return rc;
+    } else if (rc < 0) {
+        shell_error(shell, "Cannot start gesture recognition (err %d)", rc);
+        return rc;
+    }
+    shell_print(shell, "Recognizing %d gestures every %d ms over %d ms windows, "
+                "events go to the events_subscribe sinks", gesture_model.num_classes,
+                hop_arg * MSEC_PER_SEC / IMU_WINDOW_HZ, IMU_WINDOW_LEN * MSEC_PER_SEC / IMU_WINDOW_HZ);
+    return 0;
+}
+
+static int cmd_gesture_stop(const struct shell *shell, size_t argc, char **argv)
+{
+    gesture_stop();
+    shell_print(shell, "Gesture recognition stopped");
+    return 0;
+}
+
+static int cmd_gesture(const struct shell *shell, size_t argc, char **argv)
+{
+    const struct gesture_model *m = &gesture_model;
+    size_t flash = m->hidden * m->num_features + m->num_classes * m->hidden +
+                   (m->hidden + m->num_classes) * sizeof(int32_t) +
+                   m->num_features * 2 * sizeof(float);
+    size_t unused = 0;
+
+    shell_print(shell, "state: %s, hop %u samples, min confidence %u%%",
+                gesture_running() ? "running" : "stopped", hop, min_conf);
+    shell_print(shell, "model: %u features, %u hidden, %u classes, %u bytes of tables in flash",
+                m->num_features, m->hidden, m->num_classes, (uint32_t)flash);
+    shell_print(shell, "windows: %u classified, %u events, last %s (%u%%)", windows, events,
+                gesture_name(last_seen), last_seen_conf);
+    shell_print(shell, "per window: features avg %u us max %u us, inference avg %u us max %u us",
+                cyc_avg_us(feat_cyc_sum), stats_cyc_to_us(feat_cyc_max),
+                cyc_avg_us(infer_cyc_sum), stats_cyc_to_us(infer_cyc_max));
+    k_thread_stack_space_get(gesture_thread, &unused);
+    shell_print(shell, "ram: %u bytes state, stack %u / %u used",
+                (uint32_t)sizeof(st), (uint32_t)(GESTURE_STACK_SIZE - unused), GESTURE_STACK_SIZE);
+    shell_print(shell, "fetch errors: %u, missed ticks: %u", fetch_errors, missed_ticks);
+    return 0;
+}
+
+// Records one window, classifies it and prints the features in thousandths,
+// to compare against gestures/features.py on the same window
+static int cmd_gesture_once(const struct shell *shell, size_t argc, char **argv)
+{
+    static struct imu_window window;
+    float features[GESTURE_FEATURES];
+    uint8_t conf;
+
+    int rc = imu_window_capture(&window, IMU_WINDOW_LEN, IMU_WINDOW_HZ);
+    if (rc == -EBUSY) {
+        shell_error(shell, "LSM6DSL is in %s mode, switch to normal first",
+                    lsm6dsl_mode_name(lsm6dsl_get_mode(&lsm6dsl_ctx)));
+        return rc;
+    } else if (rc < 0) {
+        shell_error(shell, "Capture failed (err %d)", rc);
+        return rc;
+    }
+    uint32_t start = stats_now();
+    gesture_features(&window, features);
+    int cls = gesture_classify(features, &conf);
+    uint32_t cycles = stats_now() - start;
+
+    for (int i = 0; i < GESTURE_FEATURES; i++) {
+        shell_fprintf(shell, SHELL_NORMAL, "%d%s", (int)lroundf(features[i] * 1000.0f),
+                      i == GESTURE_FEATURES - 1 ? "\n" : ",");
+    }
+    shell_print(shell, "%s (%u%%) in %u us", gesture_name(cls), conf, stats_cyc_to_us(cycles));
+    return 0;
+}
+
+SHELL_CMD_REGISTER(gesture, NULL, "Show gesture recognition state, timing and memory", cmd_gesture);
+SHELL_CMD_REGISTER(gesture_start, NULL, "Recognize gestures [hop_samples] [min_conf]", cmd_gesture_start);
+SHELL_CMD_REGISTER(gesture_stop, NULL, "Stop gesture recognition", cmd_gesture_stop);
+SHELL_CMD_REGISTER(gesture_once, NULL, "Classify one window and print its features", cmd_gesture_once);
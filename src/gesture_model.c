@@ -0,0 +1,84 @@
+// Generated by python_server/gesture_dataset.py train, do not edit.
+// Placeholder trained on synthetic windows (gesture_dataset.py synth), retrain on recorded ones
+// 7 gestures, 5880 training rows, int8 accuracy 100.0% on 1470 test rows
+#include "gesture_model.h"
+
+static const char *const class_names[7] = { "up-down", "shake", "wave", "circle", "tap", "twist", "figure-eight" };
+
+// Feature order: mean_ax, mean_ay, mean_az, std_ax, std_ay, std_az, sma_a, corr_ax_ay, corr_ax_az, corr_ay_az, mean_gx, mean_gy, mean_gz, std_gx, std_gy, std_gz, sma_g, corr_gx_gy, corr_gx_gz, corr_gy_gz
+static const float feat_mean[20] = {
+    0.0118251769f, 0.00694425078f, 9.92257595f, 2.42406535f, 1.53607225f,
+    1.33304954f, 13.4615421f, -0.00145173341f, -0.00116142258f, -0.00655284757f,
+    0.000165528283f, 0.00652325992f, -0.0118280165f, 0.344872117f, 0.0772849843f,
+    0.939715147f, 1.20243454f, -0.0126469927f, 0.00395554025f, -0.00495826686f
+};
+
+static const float feat_inv_std[20] = {
+    3.6244154f, 5.2919364f, 1.55743694f, 0.346678823f, 0.669997334f,
+    0.596104026f, 0.344365895f, 11.2916679f, 10.0481081f, 10.3719501f,
+    16.3155708f, 60.4471931f, 5.35311508f, 1.37402058f, 16.4167461f,
+    0.679459095f, 0.749581099f, 10.2954741f, 10.6621332f, 10.5933828f
+};
+
+static const int8_t w1[24 * 20] = {
+    1, -2, -15, 54, -17, 10, 29, -3, 0, 0, 3, -10, 1, 5, -13, -78, -78, 2, 4, -1,
+    1, 1, 3, 38, -81, 29, -1, 1, -3, -2, 0, -17, 2, -28, -30, 112, 89, -1, 0, 3,
+    2, 1, 9, -5, -41, 61, -66, 0, 0, -8, 2, -23, 0, -19, -33, 1, -12, -1, -1, 4,
+    3, 0, -8, -25, 71, -34, 18, 2, 1, 2, 1, -8, 1, -24, -5, -52, -65, -3, -4, 0,
+    6, 5, -8, -33, 89, -13, 10, 5, 1, -6, 4, -29, -1, -81, -37, -25, -69, -6, -6, 5,
+    1, 1, -7, 42, -7, -10, 23, 1, 1, -4, -1, -5, 1, 12, -6, 7, 24, -13, 7, -14,
+    -1, -2, 20, -26, -23, -23, -30, -4, 0, 0, -4, 70, -2, 14, 83, 23, 31, 3, 2, -8,
+    -1, 1, 1, 73, -96, 33, 11, -1, -1, 0, 3, 6, 0, -1, 8, 28, 27, 2, 4, 0,
+    2, 2, -4, 10, 30, -32, 18, -1, -1, 1, -1, -7, 1, -26, -9, 28, 18, 3, -6, 2,
+    1, 0, -4, 49, -63, -15, 20, -1, -3, 3, -2, -3, 2, -25, -7, 89, 82, 2, -1, 1,
+    -1, 2, 4, -12, -22, 15, -19, 0, -1, -1, 0, -24, -1, 9, -31, 64, 68, -1, -2, 3,
+    0, -2, 4, -13, 17, -21, -9, 19, -3, 11, -2, 2, 11, 20, -5, 30, 40, -2, -1, -1,
+    -2, -1, 7, -24, 1, -23, -12, -4, 0, 5, 1, 22, 1, 58, 34, -2, 28, 2, -2, -4,
+    0, -1, -13, 64, -52, 22, 29, -1, -3, 3, 1, -6, 2, -12, -13, -15, -21, 4, 0, 0,
+    -1, 1, 14, -43, 21, -13, -46, -1, 0, 2, 2, -18, -2, 56, -17, 68, 87, 0, -4, -1,
+    -3, -1, 14, -25, -32, 42, -36, 1, 0, -5, 0, 28, -12, -2, 34, -16, -12, -1, 2, -1,
+    -2, -1, 3, -54, 57, 59, -19, 2, 4, -2, 1, -27, -2, 61, -44, -90, -76, -1, 0, 1,
+    -1, 0, 2, -6, 26, 20, -10, 0, 2, -1, 2, 9, -2, -4, 15, -70, -69, 0, 1, -2,
+    4, 2, 0, 9, 29, -37, 25, 1, 1, -1, -2, 37, 1, -42, 51, -22, -46, 2, -1, -2,
+    1, 0, -2, 51, -49, -31, 23, -1, -2, 1, -1, -5, 2, -33, -16, 127, 120, 1, -1, 1,
+    2, -1, -12, -25, 75, -9, 12, -2, 0, 2, 2, -31, 2, 19, -30, -80, -75, 1, -5, 0,
+    -1, -3, 1, -27, 29, -24, -10, -4, -1, 5, -3, -11, 0, 46, -9, 3, 46, 2, -5, -1,
+    -1, -1, 2, -24, 35, -6, -6, 0, 1, 0, -1, 8, -1, 37, 15, -55, -36, 0, 1, -2,
+    -4, -2, 13, -30, -31, 38, -50, 0, 1, -1, 2, -33, 0, 11, -40, 35, 44, 1, 3, 3
+};
+
+static const int32_t b1[24] = {
+    -217, 4800, 1479, 1466, 2265, 506, 2237, 1656,
+    2228, 3253, 3198, 1067, 1685, 2289, 3265, 2086,
+    -463, -550, 3311, 3483, 1455, 1575, -353, 1386
+};
+
+static const int8_t w2[7 * 24] = {
+    10, 29, 71, -20, 2, -17, -41, 21, -30, -12, 20, -17, -27, 19, -1, 25, 54, 12, -42, -22, 2, -22, -8, 51,
+    27, 44, -17, -37, -53, 33, -20, 56, 4, 56, -3, -10, -10, 60, -39, -23, -10, -11, -6, 47, -42, -23, -7, -28,
+    -18, -28, -24, -1, -34, 8, 4, -9, -5, -20, 10, 26, 47, -33, 61, -10, 38, -10, -30, -25, 28, 55, 27, 11,
+    66, -117, -23, 76, 64, -23, -20, -11, -17, -87, -67, -33, -22, -10, -71, -20, 49, 53, 35, -127, 74, -21, 37, -16,
+    -12, -14, -1, -12, -33, -5, 76, 16, -14, -9, -22, -4, 28, -3, -14, 45, -24, 19, 39, -16, -32, -9, 11, -18,
+    -27, 41, 2, -25, -40, -9, 24, -7, 1, 41, 30, 15, 1, -32, 43, -18, -26, -10, -41, 42, -45, 4, -12, 35,
+    -55, 19, -7, 18, 59, 12, -27, -72, 49, 25, 13, 24, -9, -6, 17, -18, -94, -46, 30, 48, -5, 8, -37, -40
+};
+
+static const int32_t b2[7] = {
+    -344, -265, -100, 14, -123, -353, 777
+};
+
+const struct gesture_model gesture_model = {
+    .num_features = 20,
+    .hidden = 24,
+    .num_classes = 7,
+    .class_names = class_names,
+    .feat_mean = feat_mean,
+    .feat_inv_std = feat_inv_std,
+    .in_inv_scale = 21.166666f,
+    .w1 = w1,
+    .b1 = b1,
+    .h_mult = 0.00669123093f,
+    .w2 = w2,
+    .b2 = b2,
+    .out_scale = 0.0010315621f,
+};
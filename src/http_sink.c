@@ -0,0 +1,128 @@
+#include "http_sink.h"
+#include <zephyr/kernel.h>
+#include <zephyr/net/socket.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+
+int http_parse_url(const char *url, struct http_target *target)
+{
+    if (!url || !target) {
+        return -EINVAL;
+    }
+
+    // Basic URL parsing
+    const char *path = strchr(url, '/');
+    size_t host_len = path ? (size_t)(path - url) : strlen(url);
+    if (host_len == 0 || host_len >= sizeof(target->host)) {
+        return -EINVAL;
+    }
+    memcpy(target->host, url, host_len);
+    target->host[host_len] = '\0';
+
+    path = path ? path + 1 : "";
+    if (strlen(path) >= sizeof(target->path)) {
+        return -EINVAL;
+    }
+    strcpy(target->path, path);
+    return 0;
+}
+
+static int build_header(char *out, size_t out_len, const struct http_target *target,
+                        size_t body_len)
+{
+    return snprintf(out, out_len,
+                    "POST /%s HTTP/1.1\r\nHost: %s\r\nContent-Type: application/json\r\nContent-Length: %d\r\n\r\n",
+                    target->path, target->host, (int)body_len);
+}
+
+int http_build_post(char *out, size_t out_len, const struct http_target *target,
+                    const char *body, size_t body_len)
+{
+    int used = build_header(out, out_len, target, body_len);
+    if (used < 0 || (size_t)used + body_len >= out_len) {
+        return -ENOSPC;
+    }
+    memcpy(out + used, body, body_len);
+    out[used + body_len] = '\0';
+    return used + body_len;
+}
+
+static int http_connect(const struct http_target *target)
+{
+    struct addrinfo *res;
+    struct addrinfo hints = {
+        .ai_family = AF_INET,
+        .ai_socktype = SOCK_STREAM,
+        .ai_flags = AI_NUMERICHOST,
+    };
+
+    if (getaddrinfo(target->host, "80", &hints, &res) != 0) {
+        printk("Failed to resolve hostname: %s\n", target->host);
+        return -EHOSTUNREACH;
+    }
+
+    int sock = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (sock < 0) {
+        freeaddrinfo(res);
+        return -errno;
+    }
+    int ret = connect(sock, res->ai_addr, res->ai_addrlen);
+    freeaddrinfo(res);
+    if (ret < 0) {
+        ret = -errno;
+        close(sock);
+        return ret;
+    }
+
+    return sock;
+}
+
+// send() on a stream socket may take only part of the buffer
+static int send_all(int sock, const char *buf, size_t len)
+{
+    size_t sent = 0;
+
+    while (sent < len) {
+        ssize_t n = send(sock, buf + sent, len - sent, 0);
+        if (n < 0) {
+            return -errno;
+        }
+        sent += n;
+    }
+    return sent;
+}
+
+int http_send(const struct http_target *target, const char *req, size_t req_len)
+{
+    int sock = http_connect(target);
+    if (sock < 0) {
+        return sock;
+    }
+
+    int ret = send_all(sock, req, req_len);
+    close(sock);
+    return ret;
+}
+
+int http_post(const struct http_target *target, const char *body, size_t body_len)
+{
+    char header[sizeof(target->host) + sizeof(target->path) + 96];
+    int used = build_header(header, sizeof(header), target, body_len);
+    if (used < 0 || used >= (int)sizeof(header)) {
+        return -ENOSPC;
+    }
+
+    int sock = http_connect(target);
+    if (sock < 0) {
+        return sock;
+    }
+
+    int ret = send_all(sock, header, used);
+    if (ret >= 0) {
+        ret = send_all(sock, body, body_len);
+    }
+    ret = (ret < 0) ? ret : used + (int)body_len;
+    close(sock);
+    return ret;
+}
@@ -0,0 +1,141 @@
+// Fixed-length LSM6DSL windows for gesture work. The shell command sends a
+// whole window to the host in one framed hex block, so a dataset recorder
+// (python_server/gesture_dataset.py) keeps one serial connection open and
+// gets every sample at the board's own pace instead of scraping `read` output.
+#include "imu_window.h"
+#include "sensors.h"
+#include "sample_pool.h"
+#include "lsm6dsl_ctx.h"
+#include "power.h"
+#include "fusion.h"
+#include "gesture.h"
+#include <zephyr/kernel.h>
+#include <zephyr/shell/shell.h>
+#include <zephyr/drivers/sensor.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+
+#define IMU_DUMP_SAMPLES 8 // per hex line
+
+static K_TIMER_DEFINE(window_timer, NULL, NULL);
+static K_MUTEX_DEFINE(window_lock);
+
+static int16_t to_fixed(const struct sensor_value *val, int64_t lsb_per_unit)
+{
+    int64_t fixed = sensor_value_to_micro(val) * lsb_per_unit / 1000000;
+
+    return (int16_t)CLAMP(fixed, INT16_MIN, INT16_MAX);
+}
+
+void imu_window_fixed(const struct sensor_sample *sample, int16_t out[IMU_WINDOW_AXES])
+{
+    for (int i = 0; i < IMU_WINDOW_AXES; i++) {
+        out[i] = to_fixed(&sample->val[i], i < 3 ? IMU_ACCEL_LSB_PER_MS2 : IMU_GYRO_LSB_PER_RADS);
+    }
+}
+
+int imu_window_capture(struct imu_window *w, uint16_t len, uint16_t hz)
+{
+    if (!w || len == 0 || len > IMU_WINDOW_LEN || hz == 0 || hz > IMU_WINDOW_MAX_HZ) {
+        return -EINVAL;
+    }
+
+    int rc = 0;
+    k_timeout_t period = K_USEC(USEC_PER_SEC / hz);
+    // A capture shared with a session or the filter is at most half a period old
+    uint32_t max_age_ms = MSEC_PER_SEC / hz / 2;
+
+    w->len = 0;
+    w->hz = hz;
+    w->missed = 0;
+
+    // The event modes switch the gyro off and reprogram the accelerometer,
+    // a window recorded under them would be zeros and wrong scales
+    if (lsm6dsl_hold_normal(&lsm6dsl_ctx) < 0) {
+        return -EBUSY;
+    }
+    // One capture at a time, they share the timer
+    k_mutex_lock(&window_lock, K_FOREVER);
+    // Low power mode would otherwise switch the ODR around every sample. The
+    // filter and recognition already run the IMU at their own rate
+    power_window_hold(LSM6DSL, true);
+    if (!fusion_running() && !gesture_running()) {
+        struct sensor_value odr = { hz, 0 }; // rounded up to a supported rate
+        lsm6dsl_set_odr(&lsm6dsl_ctx, SENSOR_CHAN_ACCEL_XYZ, &odr);
+        lsm6dsl_set_odr(&lsm6dsl_ctx, SENSOR_CHAN_GYRO_XYZ, &odr);
+    }
+
+    k_timer_start(&window_timer, K_NO_WAIT, period);
+    while (w->len < len) {
+        uint32_t expired = k_timer_status_sync(&window_timer);
+        struct sample_rec *rec;
+
+        w->missed += expired > 1 ? expired - 1 : 0;
+        // Through the pool, so the fetch is serialised with every other
+        // LSM6DSL reader and cannot mix values of two fetches
+        rc = sample_get(LSM6DSL, max_age_ms, &rec);
+        if (rc < 0) {
+            break;
+        }
+        rc = 0;
+        imu_window_fixed(&rec->sample, w->v[w->len]);
+        sample_put(rec);
+        w->len++;
+    }
+    k_timer_stop(&window_timer);
+
+    // Counted like the other holds, the last release restores the ODR
+    power_window_hold(LSM6DSL, false);
+    k_mutex_unlock(&window_lock);
+    lsm6dsl_release_normal(&lsm6dsl_ctx);
+    return rc;
+}
+
+// Little-endian int16 samples, IMU_DUMP_SAMPLES per line
+static void dump_window(const struct shell *shell, const struct imu_window *w)
+{
+    char line[IMU_DUMP_SAMPLES * IMU_WINDOW_AXES * 4 + 1];
+    char *at = line;
+
+    for (int k = 0; k < w->len; k++) {
+        for (int i = 0; i < IMU_WINDOW_AXES; i++) {
+            uint16_t v = (uint16_t)w->v[k][i];
+            at += snprintf(at, 5, "%02x%02x", v & 0xff, v >> 8);
+        }
+        if (k % IMU_DUMP_SAMPLES == IMU_DUMP_SAMPLES - 1 || k == w->len - 1) {
+            shell_print(shell, "IMU %s", line);
+            at = line;
+        }
+    }
+}
+
+static int cmd_imu_window(const struct shell *shell, size_t argc, char **argv)
+{
+    static struct imu_window window;
+    int len = argc > 1 ? atoi(argv[1]) : IMU_WINDOW_LEN;
+    int hz = argc > 2 ? atoi(argv[2]) : IMU_WINDOW_HZ;
+
+    if (len <= 0 || len > IMU_WINDOW_LEN || hz <= 0 || hz > IMU_WINDOW_MAX_HZ) {
+        shell_error(shell, "Usage: imu_window [samples 1-%d] [hz 1-%d]",
+                    IMU_WINDOW_LEN, IMU_WINDOW_MAX_HZ);
+        return -EINVAL;
+    }
+
+    int rc = imu_window_capture(&window, len, hz);
+    if (rc == -EBUSY) {
+        shell_error(shell, "LSM6DSL is in %s mode, switch to normal first",
+                    lsm6dsl_mode_name(lsm6dsl_get_mode(&lsm6dsl_ctx)));
+        return rc;
+    } else if (rc < 0) {
+        shell_error(shell, "IMU_ERROR %d after %u samples", rc, window.len);
+        return rc;
+    }
+    shell_print(shell, "IMU_WINDOW %u %u %d %d", window.len, window.hz,
+                IMU_ACCEL_LSB_PER_MS2, IMU_GYRO_LSB_PER_RADS);
+    dump_window(shell, &window);
+    shell_print(shell, "IMU_END %u", window.missed);
+    return 0;
+}
+
+SHELL_CMD_REGISTER(imu_window, NULL, "Capture an LSM6DSL window and print it as hex [samples] [hz]", cmd_imu_window);
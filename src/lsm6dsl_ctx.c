@@ -0,0 +1,471 @@
+// Context based LSM6DSL access for the features the Zephyr driver does not
+// cover (pedometer, tap, FIFO). The Zephyr driver still owns the part for
+// plain accel/gyro reads; everything else, ODR changes included, goes through
+// here so the shadow copy of the control registers stays authoritative.
+#include "lsm6dsl_ctx.h"
+#include "sensors.h"
+#include "stats.h"
+#include <zephyr/sys/printk.h>
+#include <zephyr/sys/byteorder.h>
+#include <string.h>
+#include <errno.h>
+
+#define FUNC_CFG_ACCESS 0x01
+#define FIFO_CTRL1 0x06
+#define INT1_CTRL 0x0D
+#define WHO_AM_I 0x0F
+#define CTRL1_XL 0x10
+#define CTRL2_G 0x11
+#define CTRL10_C 0x19
+#define WAKE_UP_SRC 0x1B
+#define FIFO_STATUS1 0x3A
+#define FIFO_STATUS2 0x3B
+#define FIFO_STATUS3 0x3C
+#define FIFO_DATA_OUT_L 0x3E
+#define TIMESTAMP0_REG 0x40
+#define STEP_COUNTER_L 0x4B
+#define TAP_CFG 0x58
+#define MD1_CFG 0x5E
+#define MD2_CFG 0x5F
+
+// BANK A
+#define CONFIG_PEDO_THS_MIN 0x0F
+
+#define LSM6DSL_WHO_AM_I_EXPECTED 0x6A
+#define FUNC_CFG_EN 0x80
+#define FIFO_OVER_RUN 0x40
+
+#define BLOCK(start, ...) { \
+    .reg = (start), \
+    .len = sizeof((uint8_t[]){ __VA_ARGS__ }), \
+    .val = { __VA_ARGS__ } \
+}
+
+// FIFO_CTRL1..5: watermark, decimation, ODR and mode
+#define FIFO_BYPASS      BLOCK(FIFO_CTRL1, 0x00, 0x00, 0x00, 0x00, 0x00)
+// 96 word watermark, accel and gyro undecimated, 104 Hz, continuous mode
+#define FIFO_CONTINUOUS  BLOCK(FIFO_CTRL1, 0x60, 0x00, 0x09, 0x00, 0x26)
+// Only the step counter and timestamp dataset, written on every detected
+// step (TIMER_PEDO_FIFO_EN | TIMER_PEDO_FIFO_DRDY), 26 Hz, continuous mode.
+// The watermark is a batch of steps
+#define FIFO_STEPS       BLOCK(FIFO_CTRL1, LSM6DSL_STEP_FIFO_STEPS * LSM6DSL_STEP_WORDS, \
+                               0xC0, 0x00, 0x08, 0x16)
+
+// TAP_CFG, TAP_THS_6D, INT_DUR2, WAKE_UP_THS, WAKE_UP_DUR, FREE_FALL, MD1_CFG
+#define TAP_OFF          BLOCK(TAP_CFG, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00)
+// Event modes latch their sources (LIR) until the event bus has read them
+#define TAP_SINGLE       BLOCK(TAP_CFG, 0x8f, 0x89, 0x06, 0x00, 0x00, 0x00, 0x40)
+#define TAP_DOUBLE       BLOCK(TAP_CFG, 0x8f, 0x8c, 0x7f, 0x80, 0x00, 0x00, 0x08)
+// Single and double tap, wake-up (62 mg), free-fall (312 mg, 6 samples) and
+// 6D at 60 degrees, all on INT1
+#define TAP_MOTION       BLOCK(TAP_CFG, 0x8f, 0x4c, 0x7f, 0x82, 0x00, 0x33, 0x7c)
+// Tap off, WAKE_UP_DUR.TIMER_HR: 25 us timestamp
+#define TAP_STEP_TIMER   BLOCK(TAP_CFG, 0x00, 0x00, 0x00, 0x00, 0x10, 0x00, 0x00)
+
+// CTRL1_XL always keeps FS_XL at +-2 g, the full scale the Zephyr driver
+// converts with. INT1_CTRL goes last: the interrupt is only routed once the
+// mode is complete
+static const struct lsm6dsl_reg_block normal_blocks[] = {
+    FIFO_BYPASS,
+    BLOCK(CTRL1_XL, 0x40),   // 104 Hz
+    BLOCK(CTRL10_C, 0x00),
+    TAP_OFF,
+    BLOCK(INT1_CTRL, 0x00),
+};
+
+// The FIFO is bypassed first so it starts empty, on a pattern boundary
+static const struct lsm6dsl_reg_block step_blocks[] = {
+    FIFO_BYPASS,
+    BLOCK(FUNC_CFG_ACCESS, FUNC_CFG_EN),
+    BLOCK(CONFIG_PEDO_THS_MIN, 0x8E),
+    BLOCK(FUNC_CFG_ACCESS, 0x00),
+    BLOCK(CTRL1_XL, 0x20),   // 26 Hz
+    BLOCK(CTRL10_C, 0x34),   // TIMER_EN | FUNC_EN | PEDO_EN
+    TAP_STEP_TIMER,
+    FIFO_STEPS,
+    BLOCK(INT1_CTRL, 0x08),  // INT1_FTH: one interrupt per batch of steps
+};
+
+static const struct lsm6dsl_reg_block single_tap_blocks[] = {
+    FIFO_BYPASS,
+    BLOCK(CTRL1_XL, 0x60),   // 416 Hz
+    BLOCK(CTRL10_C, 0x00),
+    TAP_SINGLE,
+    BLOCK(INT1_CTRL, 0x00),
+};
+
+static const struct lsm6dsl_reg_block double_tap_blocks[] = {
+    FIFO_BYPASS,
+    BLOCK(CTRL1_XL, 0x60),
+    BLOCK(CTRL10_C, 0x00),
+    TAP_DOUBLE,
+    BLOCK(INT1_CTRL, 0x00),
+};
+
+static const struct lsm6dsl_reg_block motion_blocks[] = {
+    FIFO_BYPASS,
+    BLOCK(CTRL1_XL, 0x60),
+    BLOCK(CTRL10_C, 0x00),
+    TAP_MOTION,
+    BLOCK(INT1_CTRL, 0x00),
+};
+
+static const struct lsm6dsl_reg_block fifo_blocks[] = {
+    FIFO_CONTINUOUS,
+    BLOCK(CTRL1_XL, 0x40),
+    BLOCK(CTRL10_C, 0x00),
+    TAP_OFF,
+    BLOCK(INT1_CTRL, 0x08),  // INT1_FTH
+};
+
+#define PROGRAM(prog_name, blk) { .name = prog_name, .blocks = blk, .num_blocks = ARRAY_SIZE(blk) }
+
+static const struct lsm6dsl_program programs[LSM6DSL_NUM_MODES] = {
+    [LSM6DSL_MODE_NORMAL] = PROGRAM("normal", normal_blocks),
+    [LSM6DSL_MODE_STEP] = PROGRAM("step", step_blocks),
+    [LSM6DSL_MODE_SINGLE_TAP] = PROGRAM("single_tap", single_tap_blocks),
+    [LSM6DSL_MODE_DOUBLE_TAP] = PROGRAM("double_tap", double_tap_blocks),
+    [LSM6DSL_MODE_MOTION] = PROGRAM("motion", motion_blocks),
+    [LSM6DSL_MODE_FIFO] = PROGRAM("fifo", fifo_blocks),
+};
+
+// Output data rates in mHz, index is the ODR_XL / ODR_G field value
+static const uint32_t odr_mhz[] = {
+    0, 12500, 26000, 52000, 104000, 208000, 416000, 833000,
+    1660000, 3330000, 6660000
+};
+
+// Registers mirrored in the shadow: the configuration blocks, not the
+// output, status and counter registers in between
+static bool in_shadow(uint8_t reg, uint16_t len)
+{
+    return (reg >= FUNC_CFG_ACCESS && reg + len - 1 <= CTRL10_C) ||
+           (reg >= TAP_CFG && reg + len - 1 <= MD2_CFG);
+}
+
+// While the embedded function bank is selected the addresses alias other
+// registers, only FUNC_CFG_ACCESS itself stays the same
+static bool cacheable(lsm6dsl_ctx_t *ctx, uint8_t reg, uint16_t len)
+{
+    if (!in_shadow(reg, len)) {
+        return false;
+    }
+    return !(ctx->shadow[FUNC_CFG_ACCESS] & FUNC_CFG_EN) || (reg == FUNC_CFG_ACCESS && len == 1);
+}
+
+// Bus access blocks on I2C, so it never happens in the INT1 ISR: the handlers
+// only read the mode there and leave the registers to the work queue
+static void lock(lsm6dsl_ctx_t *ctx)
+{
+    __ASSERT(!k_is_in_isr(), "LSM6DSL bus access from an ISR");
+    k_mutex_lock(&ctx->lock, K_FOREVER);
+}
+
+static void unlock(lsm6dsl_ctx_t *ctx)
+{
+    k_mutex_unlock(&ctx->lock);
+}
+
+static int bus_read(lsm6dsl_ctx_t *ctx, uint8_t reg, uint8_t *data, uint16_t len)
+{
+    int ret = i2c_burst_read(ctx->i2c_dev, LSM6DSL_I2C_ADDR, reg, data, len);
+    ctx->bus_reads++;
+    if (ret < 0) {
+        stats_i2c_error(LSM6DSL);
+    }
+    return ret;
+}
+
+static int bus_write(lsm6dsl_ctx_t *ctx, uint8_t reg, const uint8_t *data, uint16_t len)
+{
+    int ret = i2c_burst_write(ctx->i2c_dev, LSM6DSL_I2C_ADDR, reg, data, len);
+    ctx->bus_writes++;
+    if (ret < 0) {
+        stats_i2c_error(LSM6DSL);
+    }
+    return ret;
+}
+
+static int write_locked(lsm6dsl_ctx_t *ctx, uint8_t reg, const uint8_t *data, uint8_t len, bool force)
+{
+    bool cached = cacheable(ctx, reg, len);
+
+    if (cached && !force && memcmp(&ctx->shadow[reg], data, len) == 0) {
+        ctx->writes_skipped++;
+        return 0;
+    }
+    int ret = bus_write(ctx, reg, data, len);
+    if (ret == 0 && cached) {
+        memcpy(&ctx->shadow[reg], data, len);
+    }
+    return ret;
+}
+
+static int shadow_load(lsm6dsl_ctx_t *ctx)
+{
+    int ret = bus_read(ctx, FUNC_CFG_ACCESS, &ctx->shadow[FUNC_CFG_ACCESS],
+                       CTRL10_C - FUNC_CFG_ACCESS + 1);
+    if (ret == 0) {
+        ret = bus_read(ctx, TAP_CFG, &ctx->shadow[TAP_CFG], MD2_CFG - TAP_CFG + 1);
+    }
+    return ret;
+}
+
+int lsm6dsl_ctx_init(lsm6dsl_ctx_t *ctx, gpio_callback_handler_t int1_handler)
+{
+    k_mutex_init(&ctx->lock);
+
+    if (!device_is_ready(ctx->i2c_dev)) {
+        printk("I2C device not ready\n");
+        return -ENODEV;
+    }
+
+    int ret = shadow_load(ctx);
+    if (ret < 0) {
+        return ret;
+    }
+    if (ctx->shadow[WHO_AM_I] != LSM6DSL_WHO_AM_I_EXPECTED) {
+        printk("LSM6DSL WHO_AM_I mismatch: %02x\n", ctx->shadow[WHO_AM_I]);
+        return -ENODEV;
+    }
+
+    ret = lsm6dsl_set_mode(ctx, LSM6DSL_MODE_NORMAL, false);
+    if (ret < 0 || !ctx->int1_gpio) {
+        return ret;
+    }
+
+    ret = gpio_pin_configure_dt(ctx->int1_gpio, GPIO_INPUT);
+    if (ret < 0) {
+        return ret;
+    }
+    gpio_init_callback(&ctx->int1_cb, int1_handler, BIT(ctx->int1_gpio->pin));
+    ret = gpio_add_callback(ctx->int1_gpio->port, &ctx->int1_cb);
+    if (ret < 0) {
+        return ret;
+    }
+    return gpio_pin_interrupt_configure_dt(ctx->int1_gpio, GPIO_INT_EDGE_RISING);
+}
+
+int lsm6dsl_reg_read(lsm6dsl_ctx_t *ctx, uint8_t reg, uint8_t *data, uint8_t len)
+{
+    int ret = 0;
+
+    lock(ctx);
+    if (cacheable(ctx, reg, len)) {
+        memcpy(data, &ctx->shadow[reg], len);
+    } else {
+        ret = bus_read(ctx, reg, data, len);
+    }
+    unlock(ctx);
+    return ret;
+}
+
+int lsm6dsl_reg_write(lsm6dsl_ctx_t *ctx, uint8_t reg, const uint8_t *data, uint8_t len)
+{
+    lock(ctx);
+    int ret = write_locked(ctx, reg, data, len, false);
+    unlock(ctx);
+    return ret;
+}
+
+int lsm6dsl_reg_update(lsm6dsl_ctx_t *ctx, uint8_t reg, uint8_t mask, uint8_t val)
+{
+    if (!in_shadow(reg, 1)) {
+        return -EINVAL;
+    }
+
+    lock(ctx);
+    uint8_t new_val = (ctx->shadow[reg] & ~mask) | (val & mask);
+    int ret = write_locked(ctx, reg, &new_val, 1, false);
+    unlock(ctx);
+    return ret;
+}
+
+int lsm6dsl_set_mode(lsm6dsl_ctx_t *ctx, enum lsm6dsl_mode mode, bool verify)
+{
+    uint8_t readback[LSM6DSL_BLOCK_MAX];
+    int ret = 0;
+
+    if (mode >= LSM6DSL_NUM_MODES) {
+        return -EINVAL;
+    }
+    const struct lsm6dsl_program *prog = &programs[mode];
+
+    k_mutex_lock(&ctx->lock, K_FOREVER);
+    // A holder reads the accelerometer and gyro at rates it set itself, even
+    // reapplying normal mode would reset them
+    if (ctx->normal_holds > 0) {
+        k_mutex_unlock(&ctx->lock);
+        return (mode == LSM6DSL_MODE_NORMAL) ? 0 : -EBUSY;
+    }
+    if (ctx->int1_gpio) {
+        gpio_pin_interrupt_configure_dt(ctx->int1_gpio, GPIO_INT_DISABLE);
+    }
+
+    for (int i = 0; i < prog->num_blocks && ret == 0; i++) {
+        const struct lsm6dsl_reg_block *blk = &prog->blocks[i];
+
+        ret = write_locked(ctx, blk->reg, blk->val, blk->len, verify);
+        if (ret < 0 || !verify) {
+            continue;
+        }
+        // Verify right away, bank switches change what a later read would see
+        ret = bus_read(ctx, blk->reg, readback, blk->len);
+        if (ret == 0 && memcmp(readback, blk->val, blk->len) != 0) {
+            printk("LSM6DSL %s: register 0x%02x did not take\n", prog->name, blk->reg);
+            ret = -EIO;
+        }
+    }
+
+    if (ret == 0) {
+        ctx->mode = mode;
+    } else {
+        // Half applied: trust the part, not the shadow
+        shadow_load(ctx);
+    }
+
+    if (ctx->int1_gpio) {
+        gpio_pin_interrupt_configure_dt(ctx->int1_gpio, GPIO_INT_EDGE_RISING);
+    }
+    k_mutex_unlock(&ctx->lock);
+    return ret;
+}
+
+enum lsm6dsl_mode lsm6dsl_get_mode(lsm6dsl_ctx_t *ctx)
+{
+    return ctx->mode;
+}
+
+int lsm6dsl_hold_normal(lsm6dsl_ctx_t *ctx)
+{
+    int ret = 0;
+
+    k_mutex_lock(&ctx->lock, K_FOREVER);
+    if (ctx->mode == LSM6DSL_MODE_NORMAL) {
+        ctx->normal_holds++;
+    } else {
+        ret = -EBUSY;
+    }
+    k_mutex_unlock(&ctx->lock);
+    return ret;
+}
+
+void lsm6dsl_release_normal(lsm6dsl_ctx_t *ctx)
+{
+    k_mutex_lock(&ctx->lock, K_FOREVER);
+    if (ctx->normal_holds > 0) {
+        ctx->normal_holds--;
+    }
+    k_mutex_unlock(&ctx->lock);
+}
+
+const char *lsm6dsl_mode_name(enum lsm6dsl_mode mode)
+{
+    return mode < LSM6DSL_NUM_MODES ? programs[mode].name : "unknown";
+}
+
+int lsm6dsl_mode_from_name(const char *name)
+{
+    for (int i = 0; i < LSM6DSL_NUM_MODES; i++) {
+        if (strcmp(programs[i].name, name) == 0) {
+            return i;
+        }
+    }
+    return -EINVAL;
+}
+
+int lsm6dsl_set_odr(lsm6dsl_ctx_t *ctx, enum sensor_channel chan, const struct sensor_value *hz)
+{
+    uint8_t reg;
+    uint64_t want = (uint64_t)hz->val1 * 1000 + hz->val2 / 1000;
+    uint8_t code = 0;
+
+    switch (chan) {
+    case SENSOR_CHAN_ACCEL_XYZ:
+        reg = CTRL1_XL;
+        break;
+    case SENSOR_CHAN_GYRO_XYZ:
+        reg = CTRL2_G;
+        break;
+    default:
+        return -ENOTSUP;
+    }
+
+    while (code < ARRAY_SIZE(odr_mhz) - 1 && odr_mhz[code] < want) {
+        code++;
+    }
+    return lsm6dsl_reg_update(ctx, reg, 0xF0, code << 4);
+}
+
+int lsm6dsl_fifo_level(lsm6dsl_ctx_t *ctx, uint16_t *words, bool *overrun)
+{
+    uint8_t status[2];
+    int ret = lsm6dsl_reg_read(ctx, FIFO_STATUS1, status, sizeof(status));
+    if (ret == 0) {
+        *words = ((uint16_t)(status[1] & 0x07) << 8) | status[0];
+        *overrun = status[1] & FIFO_OVER_RUN;
+    }
+    return ret;
+}
+
+// FIFO_DATA_OUT_H rolls back to FIFO_DATA_OUT_L, so one burst drains many words
+int lsm6dsl_fifo_read(lsm6dsl_ctx_t *ctx, int16_t *words, uint16_t count)
+{
+    lock(ctx);
+    int ret = bus_read(ctx, FIFO_DATA_OUT_L, (uint8_t *)words, count * sizeof(int16_t));
+    unlock(ctx);
+    if (ret == 0) {
+        for (int i = 0; i < count; i++) {
+            words[i] = sys_le16_to_cpu(words[i]);
+        }
+    }
+    return ret;
+}
+
+int lsm6dsl_fifo_pattern(lsm6dsl_ctx_t *ctx, uint16_t *index)
+{
+    uint8_t status[2];
+    int ret = lsm6dsl_reg_read(ctx, FIFO_STATUS3, status, sizeof(status));
+    if (ret == 0) {
+        *index = ((uint16_t)(status[1] & 0x03) << 8) | status[0];
+    }
+    return ret;
+}
+
+int lsm6dsl_read_step_count(lsm6dsl_ctx_t *ctx, uint16_t *steps)
+{
+    uint8_t buf[2];
+    int ret = lsm6dsl_reg_read(ctx, STEP_COUNTER_L, buf, sizeof(buf));
+    if (ret == 0) {
+        *steps = ((uint16_t)buf[1] << 8) | buf[0];
+    }
+    return ret;
+}
+
+int lsm6dsl_read_timestamp(lsm6dsl_ctx_t *ctx, uint32_t *timestamp)
+{
+    uint8_t buf[3];
+    int ret = lsm6dsl_reg_read(ctx, TIMESTAMP0_REG, buf, sizeof(buf));
+    if (ret == 0) {
+        *timestamp = ((uint32_t)buf[2] << 16) | ((uint32_t)buf[1] << 8) | buf[0];
+    }
+    return ret;
+}
+
+// The dataset's bytes are TIMESTAMP[15:8], TIMESTAMP[23:16], unused,
+// TIMESTAMP[7:0], STEP_COUNTER[7:0], STEP_COUNTER[15:8]
+void lsm6dsl_step_decode(const int16_t words[LSM6DSL_STEP_WORDS], uint16_t *steps,
+                         uint32_t *timestamp)
+{
+    uint16_t w0 = words[0];
+    uint16_t w1 = words[1];
+
+    *timestamp = ((uint32_t)(w0 >> 8) << 16) | ((uint32_t)(w0 & 0xFF) << 8) | (w1 >> 8);
+    *steps = words[2];
+}
+
+// WAKE_UP_SRC, TAP_SRC and D6D_SRC in one burst; reading them clears latched events
+int lsm6dsl_read_event_sources(lsm6dsl_ctx_t *ctx, uint8_t src[3])
+{
+    return lsm6dsl_reg_read(ctx, WAKE_UP_SRC, src, 3);
+}
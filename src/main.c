@@ -19,6 +19,7 @@
 #include <zephyr/fs/fs.h>
 #include <zephyr/fs/littlefs.h>
 #include <zephyr/storage/flash_map.h>
+#include <zephyr/settings/settings.h>
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -34,103 +35,23 @@
 
 #include "wifi.h"
 #include "filesys.h"
+#include "sensors.h"
+#include "stats.h"
+#include "power.h"
+#include "lsm6dsl_ctx.h"
+#include "step_log.h"
+#include "event_bus.h"
+#include "fusion.h"
+#include "session.h"
+#include "fs_profile.h"
+#include "perf.h"
 
 LOG_MODULE_REGISTER(main, LOG_LEVEL_DBG);
 
-#define NUM_SENSORS 6
 // INTERRUPTS
 #define I2C_NODE    DT_NODELABEL(i2c2)
-#define I2C_ADDR 0x6A
-
-#define INT1_PORT   "GPIOD"
 #define INT1_PIN 0xb
 
-#define WHO_AM_I_REG 0x0F
-#define LSM6DSL_WHO_AM_I_EXPECTED 0x6A
-
-typedef struct
-{
-    bool why_not;
-} stmdev_ctx_t;
-
-// LSM6DSL REGISTERS
-#define FUNC_CFG_ACCESS 0x01
-#define CTRL1_XL 0x10
-#define CTRL10_C 0x19
-#define MD1_CFG 0x5E
-#define TAP_CFG 0x58
-#define TAP_THS_6D 0x59
-#define INT_DUR2 0x5a
-#define WAKE_UP_THS 0x5b
-#define INT1_CTRL 0x0D
-#define TAP_SRC 0x1C
-#define FUNC_SRC1 0x53
-#define FUNC_SRC2 0x54
-#define WAKE_UP_SRC 0x1B
-#define STEP_COUNTER_L 0x4B
-#define STEP_COUNTER_H 0x4C
-#define CTRL1_XL 0x10
-#define CTRL10_C 0x19
-
-// BANK A
-#define CONFIG_PEDO_THS_MIN 0x0F
-
-//FUNC_CFG_ACCESS 
-enum {
-    FUNC_CFG_EN_B = 0x20,  // Bit 5 set
-    FUNC_CFG_EN = 0x80   // Bit 7 set
-};
-
-// TAP_CFG
-enum {
-
-    LIR = 0x01,  // Bit 0 set
-    TAP_Z_EN = 0x02,  // Bit 1 set
-    TAP_Y_EN = 0x04,  // Bit 2 set
-    TAP_X_EN = 0x08,  // Bit 3 set
-    SLOPE_FDS= 0x10,  // Bit 4 set
-    INACT_EN0 = 0x20,  // Bit 5 set
-    INACT_EN1 = 0x40,  // Bit 6 set
-    INTERRUPTS_ENABLE = 0x80   // Bit 7 set
-};
-
-
-
-// FUNC_SRC1 - 0x53
-enum {
-    SENSORHUB_END_OP = 0x01,  // Bit 0 set
-    SI_END_OP = 0x02,  // Bit 1 set
-    HI_FAIL = 0x04,  // Bit 2 set
-    STEP_DETECTED = 0x08,  // Bit 3 set
-    BIT_5 = 0x10,  // Bit 4 set
-    BIT_6 = 0x20,  // Bit 5 set
-    BIT_7 = 0x40,  // Bit 6 set
-    BIT_8 = 0x80   // Bit 7 set
-};
-
-enum sensor_names {
-    HTS221,
-    LPS22HB,
-    LIS3MDL,
-    LSM6DSL,
-    VL53L0X,
-    BUTTON0
-};
-
-const struct device *i2c_dev = DEVICE_DT_GET(I2C_NODE);
-
-volatile int lsm6dsl_mode = 0; // 0 - normal, 1 - step, 2 - tap
-volatile int lsm6dsl_action_mode = 0; // 0 - normal, 1 - step, 2 - tap
-enum {
-    LSM6DSL_MODE_NORMAL = 0,
-    LSM6DSL_MODE_STEP = 1,
-    LSM6DSL_MODE_TAP = 2
-};
-
-enum {
-    MODE_FILE = 0,
-    MODE_HTTP = 1
-};
 // INTERRUPTS
 
 // Sensor device nodes
@@ -147,35 +68,17 @@ static const struct gpio_dt_spec button0 = GPIO_DT_SPEC_GET(DT_ALIAS(sw0), gpios
 static struct gpio_callback button_cb_data;
 
 
-// Filesystem
-FS_LITTLEFS_DECLARE_DEFAULT_CONFIG(cstorage);
-static struct fs_mount_t littlefs_mnt = {
-    .type = FS_LITTLEFS,
-    .fs_data = &cstorage,
-    .storage_dev = (void *)FIXED_PARTITION_ID(storage_partition),
-    .mnt_point = "/lfs"
-};
-
 // INTERRUPTS
-int32_t lsm6dsl_read_reg(uint8_t reg, uint8_t *data, uint16_t len) {
-    return i2c_burst_read(i2c_dev, I2C_ADDR, reg, data, len);
-}
-
-int32_t lsm6dsl_write_reg(uint8_t reg, const uint8_t *data, uint16_t len) {
-    return i2c_burst_write(i2c_dev, I2C_ADDR, reg, data, len);    
-}
-
-static void platform_delay(uint32_t ms) {
-    k_msleep(ms);
-}
-
 static const struct gpio_dt_spec int1_gpio = {
     .port = DEVICE_DT_GET(DT_NODELABEL(gpiod)),
     .pin = INT1_PIN,
     .dt_flags = GPIO_INPUT | GPIO_INT_EDGE_TO_ACTIVE
 };
 
-static struct gpio_callback gpio_cb;
+lsm6dsl_ctx_t lsm6dsl_ctx = {
+    .i2c_dev = DEVICE_DT_GET(I2C_NODE),
+    .int1_gpio = &int1_gpio,
+};
 
 
 
@@ -185,7 +88,8 @@ static struct gpio_callback gpio_cb;
 // Sensor Info
 enum sensor_type {
     TYPE_DEV,
-    TYPE_GPIO
+    TYPE_GPIO,
+    TYPE_VIRTUAL // no device of its own, derived from other sensors
 };
 
 struct axes_list {
@@ -195,24 +99,12 @@ struct axes_list {
 
 struct sensor_info {
 
-    bool dev_or_gpio;
+    enum sensor_type dev_or_gpio;
     const struct device *dev;
     const struct gpio_dt_spec *gpio;
     const char *name;
-    struct k_timer timer;
-    struct k_timer http_timer;
-    void * timer_callback;
-    void * http_timer_callback;
-    const char *cb_filename;
-    const char *interrupt_cb_filename;
     int num_axes;
-    struct axes_info *axes;
-    struct k_work work; // File client
-    struct k_work http_work; // For HTTP client
-    struct k_work interrupt_work; // For interrupt file client 
-    struct k_work interrupt_http_work; // For interrupt HTTP client
-    const char * url; // For timer HTTP client
-    const char * interrupt_url; // For interrupt HTTP client
+    struct axes_list *axes;
 };
 
 struct sensor_save_work {
@@ -248,13 +140,18 @@ static struct axes_list lsm6dsl_axes[] = {
 };
 
 static struct axes_list vl53l0x_axes[] = {
-    { .chan = SENSOR_CHAN_PROX, .name = "proximity" }
+    { .chan = SENSOR_CHAN_DISTANCE, .name = "distance" }
 };
 
-void sensor_timer_callback(struct k_timer *timer_id);
-
-// HTTP Client
-void sensor_timer_http_callback(struct k_timer *timer_id);
+static struct axes_list orientation_axes[] = {
+    { .chan = SENSOR_CHAN_ALL, .name = "quat_w" },
+    { .chan = SENSOR_CHAN_ALL, .name = "quat_x" },
+    { .chan = SENSOR_CHAN_ALL, .name = "quat_y" },
+    { .chan = SENSOR_CHAN_ALL, .name = "quat_z" },
+    { .chan = SENSOR_CHAN_ALL, .name = "roll" },
+    { .chan = SENSOR_CHAN_ALL, .name = "pitch" },
+    { .chan = SENSOR_CHAN_ALL, .name = "yaw" }
+};
 
 struct sensor_info sensors[NUM_SENSORS] = {
     {
@@ -262,9 +159,6 @@ struct sensor_info sensors[NUM_SENSORS] = {
         .dev = hts221,
         .gpio = NULL,
         .name = "hts221",
-        .timer_callback = sensor_timer_callback,
-        .http_timer_callback = sensor_timer_http_callback,
-        .cb_filename = NULL,
         .num_axes = 2,
         .axes = hts221_axes
     },
@@ -273,9 +167,6 @@ struct sensor_info sensors[NUM_SENSORS] = {
         .dev = lps22hb,
         .gpio = NULL,
         .name = "lps22hb",
-        .timer_callback = sensor_timer_callback,
-        .http_timer_callback = sensor_timer_http_callback,
-        .cb_filename = NULL,
         .num_axes = 1,
         .axes = lps22hb_axes
     },
@@ -284,9 +175,6 @@ struct sensor_info sensors[NUM_SENSORS] = {
         .dev = lis3mdl,
         .gpio = NULL,
         .name = "lis3mdl",
-        .timer_callback = sensor_timer_callback,
-        .http_timer_callback = sensor_timer_http_callback,
-        .cb_filename = NULL,
         .num_axes = 3,
         .axes = lis3mdl_axes
     },
@@ -295,9 +183,6 @@ struct sensor_info sensors[NUM_SENSORS] = {
         .dev = lsm6dsl,
         .gpio = NULL,
         .name = "lsm6dsl",
-        .timer_callback = sensor_timer_callback,
-        .http_timer_callback = sensor_timer_http_callback,
-        .cb_filename = NULL,
         .num_axes = 6,
         .axes = lsm6dsl_axes
     },
@@ -306,9 +191,8 @@ struct sensor_info sensors[NUM_SENSORS] = {
         .dev = vl53l0x,
         .gpio = NULL,
         .name = "vl53l0x",
-        .timer_callback = sensor_timer_callback,
-        .http_timer_callback = sensor_timer_http_callback,
-        .cb_filename = NULL
+        .num_axes = 1,
+        .axes = vl53l0x_axes
 
     },
     {
@@ -316,13 +200,18 @@ struct sensor_info sensors[NUM_SENSORS] = {
         .dev = NULL, 
         .gpio = &button0,
         .name = "button0",
-        .timer_callback = sensor_timer_callback,
-        .http_timer_callback = sensor_timer_http_callback,
-        .cb_filename = NULL
+    },
+    {
+        .dev_or_gpio = TYPE_VIRTUAL,
+        .dev = NULL,
+        .gpio = NULL,
+        .name = "orientation",
+        .num_axes = FUSION_NUM_VALS,
+        .axes = orientation_axes
     }
 };
 
-int get_sensor_index(char *sensor_name) {
+int get_sensor_index(const char *sensor_name) {
     for (int i = 0; i < NUM_SENSORS; i++) {
         if (strcmp(sensors[i].name, sensor_name) == 0) {
             return i;
@@ -331,40 +220,43 @@ int get_sensor_index(char *sensor_name) {
     return -1; 
 }
 
-static void http_client_work_handler(struct k_work *work);
+const char *get_sensor_name(int sensor_index) {
+    if (sensor_index < 0 || sensor_index >= NUM_SENSORS) {
+        return "unknown";
+    }
+    return sensors[sensor_index].name;
+}
+
+const char *get_sensor_axis_name(int sensor_index, int axis) {
+    if (sensor_index < 0 || sensor_index >= NUM_SENSORS || axis < 0) {
+        return NULL;
+    }
+    if (sensors[sensor_index].dev_or_gpio == TYPE_GPIO) {
+        return axis == 0 ? "state" : NULL;
+    }
+    return axis < sensors[sensor_index].num_axes ? sensors[sensor_index].axes[axis].name : NULL;
+}
+
+const struct device *get_sensor_device(int sensor_index) {
+    if (sensor_index < 0 || sensor_index >= NUM_SENSORS) {
+        return NULL;
+    }
+    return sensors[sensor_index].dev;
+}
 
 void int1_handler(const struct device *port, struct gpio_callback *cb, uint32_t pins) {
     //printk("INT1 triggered (step or free fall)\n");
-    switch (lsm6dsl_mode) {
+    switch (lsm6dsl_get_mode(&lsm6dsl_ctx)) {
         case LSM6DSL_MODE_STEP:
-            uint8_t step_count_l, step_count_h;
-            lsm6dsl_read_reg(STEP_COUNTER_L, &step_count_l, 1);
-            lsm6dsl_read_reg(STEP_COUNTER_H, &step_count_h, 1);
-            uint16_t step_count = (step_count_h << 8) | step_count_l;
-            printk("Step count: %d\n", step_count);
+            // FIFO watermark: no I2C in the ISR, the step log drains the batch from the work queue
+            step_log_int1();
             break;
 
-        case LSM6DSL_MODE_TAP:
-            switch (lsm6dsl_action_mode) {
-                case MODE_FILE: {
-                    // Write tap data to file
-                    struct sensor_info *sensor = &sensors[LSM6DSL];
-                    k_work_submit(&sensor->interrupt_work);
-                    printk("Tap data written to file\n");
-                }
-                break;
-
-                case MODE_HTTP: {
-                    // Send tap data via HTTP
-                    struct sensor_info *sensor = &sensors[LSM6DSL];
-                    k_work_submit(&sensor->interrupt_http_work);
-                    printk("Tap data written to file\n");
-                }
-                break;
-
-                default:
-                    printk("No action for current mode\n");
-            }
+        case LSM6DSL_MODE_SINGLE_TAP:
+        case LSM6DSL_MODE_DOUBLE_TAP:
+        case LSM6DSL_MODE_MOTION:
+            // Published once, every subscribed sink gets its own copy
+            event_bus_int1();
             break;
 
         default:
@@ -440,469 +332,296 @@ static void cmd_toggle_led1 (const struct shell *shell, size_t argc, char **argv
     }
 }
 
-// Work Handlers
-void http_client_work_handler(struct k_work *work) {
-    struct sensor_info *sensor = CONTAINER_OF(work, struct sensor_info, http_work);
-
-    char buf[128];           
-    struct http_request req;
-    //static uint8_t recv_buf[512];
-    int sock;
-    struct addrinfo *res;
-    struct addrinfo hints = {
-        .ai_family = AF_INET,
-        .ai_socktype = SOCK_STREAM,
-        .ai_flags = AI_NUMERICHOST,
-    };
-    printk("http_client_work_handler for sensor at %p, name = %s, url = %s\n", sensor, sensor->name, sensor->url);
-    int ret = sensor_reading(sensor->name, buf, sizeof(buf));
-    if (ret < 0) {
-        printk("Sensor read failed: %d\n", ret);
-        return;
-    }
-
-    // Make sure the result is a full line
-    size_t len = strlen(buf);
-    if (len < sizeof(buf) - 1) {
-        buf[len] = '\0';
-    }
-    char _url[128];
-    strncpy(_url, sensor->url, sizeof(_url) - 1);
-    _url[sizeof(_url) - 1] = '\0';
-
-    // Basic URL parsing
-    char *host = _url;
-    char *path = strchr(host, '/');
-    if (path) {
-        *path = 0;
-        path++;
-    } else {
-        path = "";
-    }
+// The event modes keep the LSM6DSL window open. Power holds are counted, so
+// the shell takes one however many event modes it switches through
+static void event_mode_hold(bool hold)
+{
+    static bool held;
 
-    if (getaddrinfo(host, "80", &hints, &res) != 0) {
-        printk("Failed to resolve hostname: %s\n", host);
-        return;
+    if (hold != held) {
+        power_window_hold(LSM6DSL, hold);
+        held = hold;
     }
-    
-    sock = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
-    connect(sock, (struct sockaddr *)res->ai_addr, sizeof(res->ai_addr));
-    char _buf[256]; // Buffer for the HTTP request
-    char * msg_template = "POST /%s HTTP/1.1\r\nHost: %s\r\nContent-Type: application/json\r\nContent-Length: %d\r\n\r\n%s";
-    snprintf(_buf, sizeof(_buf), msg_template, path, host, len, buf);
-    write(sock, _buf, strlen(_buf));
-    close(sock);
 }
 
-void sensor_work_handler(struct k_work *work) {
-
-    struct sensor_info *sensor = CONTAINER_OF(work, struct sensor_info, work);
-
-    char buf[128];           // Larger buffer to ensure full string fits
-    char full_path[128];
-
-    int ret = sensor_reading(sensor->name, buf, sizeof(buf));
-    if (ret < 0) {
-        printk("Sensor read failed: %d\n", ret);
-        return;
+static void mode_error(const struct shell *shell, const char *what, int ret)
+{
+    if (ret == -EBUSY) {
+        shell_error(shell, "Failed to %s: fusion or gesture recognition holds the LSM6DSL", what);
+    } else {
+        shell_error(shell, "Failed to %s: %d", what, ret);
     }
+}
 
-    // Make sure the result is a full line
-    size_t len = strlen(buf);
-    if (len < sizeof(buf) - 1) {
-        buf[len] = '\0';
+// Work Handlers
+static void lsm6dsl_tap_start(const struct shell *shell, enum event_sink sink, const char *target) {
+    int ret = event_subscribe(sink, target);
+    if (ret == 0) {
+        ret = lsm6dsl_set_mode(&lsm6dsl_ctx, LSM6DSL_MODE_SINGLE_TAP, false);
+        if (ret < 0) {
+            event_unsubscribe(sink);
+        }
     }
-
-    snprintf(full_path, sizeof(full_path), "/lfs/%s", sensor->cb_filename);
-
-    struct fs_file_t file;
-    fs_file_t_init(&file);
-    ret = fs_open(&file, full_path, FS_O_CREATE | FS_O_APPEND);
     if (ret < 0) {
+        mode_error(shell, "start tap detection", ret);
         return;
     }
-
-    ret = fs_write(&file, buf, len);
-    if (ret < 0) {
-    }
-    printk("Writing to file %s->%s<-END\n", full_path, buf);
-    fs_close(&file);
+    event_mode_hold(true);
+    shell_print(shell, "Started LSM6DSL tap detection, events go to %s", target);
 }
 
-void interrupt_work_handler(struct k_work *work) {
-    //struct sensor_info *sensor = CONTAINER_OF(work, struct sensor_info, interrupt_work);
-    struct sensor_info *sensor = &sensors[LSM6DSL];
-    printk("Interrupt work handler for sensor %s\n", sensor->name);
-    char full_path[128];
-    snprintf(full_path, sizeof(full_path), "/lfs/%s", sensor->interrupt_cb_filename);
-    struct fs_file_t file;
-    fs_file_t_init(&file);
-    int ret = fs_open(&file, full_path, FS_O_CREATE | FS_O_APPEND);
-    if (ret < 0) {
-        printk("Failed to open file %s: %d\n", full_path, ret);
+static void cmd_lsm6dsl_tap_http_start(const struct shell *shell, size_t argc, char **argv) {
+    if (argc < 2) {
+        shell_error(shell, "Usage: lsm6dsl_tap_http_start <url>");
         return;
     }
-    // Write the interrupt data to the file
-    char buf[128];
-    ret = sensor_reading(sensor->name, buf, sizeof(buf));
-    if (ret < 0) {
-        printk("Sensor read failed: %d\n", ret);
-        fs_close(&file);
+    lsm6dsl_tap_start(shell, EVENT_SINK_HTTP, argv[1]);
+}
+
+static void cmd_lsm6dsl_tap_start(const struct shell *shell, size_t argc, char **argv) {
+    if (argc < 2) {
+        shell_error(shell, "Usage: lsm6dsl_tap_start <filename>");
         return;
     }
-    // Make sure the result is a full line
-    size_t len = strlen(buf);
-    if (len < sizeof(buf) - 1) {
-        buf[len] = '\0';
+    lsm6dsl_tap_start(shell, EVENT_SINK_FILE, argv[1]);
+}
+
+static void lsm6dsl_step_start(const struct shell *shell, enum step_sink sink, const char *target) {
+    int ret = lsm6dsl_set_mode(&lsm6dsl_ctx, LSM6DSL_MODE_STEP, false);
+    if (ret == 0) {
+        event_mode_hold(true);
+        ret = step_log_start(sink, target);
     }
-    ret = fs_write(&file, buf, len);
     if (ret < 0) {
-        printk("Failed to write to file %s: %d\n", full_path, ret);
-        fs_close(&file);
+        mode_error(shell, "start step detection", ret);
         return;
     }
-    printk("Sensor %s interrupt data: %s\n", sensor->name, buf);
-    fs_close(&file);
+    shell_print(shell, "Started LSM6DSL step detection, logging to %s", target);
 }
 
-void interrupt_http_work_handler(struct k_work *work) {
-    //struct sensor_info *sensor = CONTAINER_OF(work, struct sensor_info, interrupt_work);
-    struct sensor_info *sensor = &sensors[LSM6DSL];
-    printk("Interrupt http work handler for sensor %s\n", sensor->name);
-    
-}
-
-// Timer Callbacks
-void sensor_timer_callback(struct k_timer *timer_id) {
-    struct sensor_info *sensor = CONTAINER_OF(timer_id, struct sensor_info, timer);
-    k_work_submit(&sensor->work);
+static void cmd_lsm6dsl_step_start(const struct shell *shell, size_t argc, char **argv) {
+   if (argc < 2) {
+        shell_error(shell, "Usage: lsm6dsl_step_start <filename>");
+        return;
+    }
+    lsm6dsl_step_start(shell, STEP_SINK_FILE, argv[1]);
 }
 
-void sensor_timer_http_callback(struct k_timer *timer_id) {
-    struct sensor_info *sensor = CONTAINER_OF(timer_id, struct sensor_info, http_timer);
-    k_work_submit(&sensor->http_work);
+static void cmd_lsm6dsl_step_http_start(const struct shell *shell, size_t argc, char **argv) {
+   if (argc < 2) {
+        shell_error(shell, "Usage: lsm6dsl_step_http_start <url>");
+        return;
+    }
+    lsm6dsl_step_start(shell, STEP_SINK_HTTP, argv[1]);
 }
 
-// Sensor Timer HTTP Stop Command
-static void cmd_sensor_timer_http_stop (const struct shell *shell, size_t argc, char **argv) {
+// Switch the LSM6DSL mode by hand, e.g. to go back to normal or to time a mode switch
+static int cmd_lsm6dsl_mode(const struct shell *shell, size_t argc, char **argv) {
     if (argc < 2) {
-        shell_error(shell, "Usage: sensor_timer_stop <sensor_name>");
-        return;
+        shell_error(shell, "Usage: lsm6dsl_mode <normal|step|single_tap|double_tap|motion|fifo> [verify]");
+        return -EINVAL;
     }
-    const char *sensor_name = argv[1];
-    int sensor_index = get_sensor_index(sensor_name);
-    struct sensor_info *sensor = &sensors[sensor_index];
+    int mode = lsm6dsl_mode_from_name(argv[1]);
+    if (mode < 0) {
+        shell_error(shell, "Unknown mode: %s", argv[1]);
+        return -EINVAL;
+    }
+    bool verify = argc > 2 && strcmp(argv[2], "verify") == 0;
+    uint32_t writes = lsm6dsl_ctx.bus_writes;
+    uint32_t reads = lsm6dsl_ctx.bus_reads;
 
-    k_timer_stop(&(sensor->http_timer));
-    shell_print(shell, "Stopped timer for %s", sensor_name);
-}
+    uint32_t start = stats_now();
+    int ret = lsm6dsl_set_mode(&lsm6dsl_ctx, mode, verify);
+    uint32_t us = stats_cyc_to_us(stats_now() - start);
 
-// Sensor Timer HTTP Start Command
-static void cmd_sensor_timer_http_start (const struct shell *shell, size_t argc, char **argv){
-    if (argc < 3) {
-        shell_error(shell, "Usage: sensor_timer_cb <sensor_name> <url> <timing>");
-        return;
+    if (ret < 0) {
+        mode_error(shell, "set the mode", ret);
+        return ret;
     }
-    const char *sensor_name = argv[1];
-    const char * url = argv[2];
-    const char * timing_str = argv[3]; 
-    int time = atoi(timing_str);
-    int sensor_index = get_sensor_index(sensor_name);
-    struct sensor_info *sensor = &sensors[sensor_index];
-    void * cb;
-    
-    sensor->url = url;
-    k_timer_init(&(sensor->http_timer), sensor->http_timer_callback, NULL);
-    k_timer_start(&(sensor->http_timer), K_SECONDS(time), K_SECONDS(time));
+    event_mode_hold(mode != LSM6DSL_MODE_NORMAL);
+    shell_print(shell, "Mode %s set in %u us (%u writes, %u reads)", argv[1], us,
+                lsm6dsl_ctx.bus_writes - writes, lsm6dsl_ctx.bus_reads - reads);
+    return 0;
 }
 
-// Sensor Timer Start Command
-static void cmd_sensor_timer_start(const struct shell *shell, size_t argc, char **argv){
-    if (argc < 3) {
-        shell_error(shell, "Usage: sensor_timer <sensor_name> <file_name> <timing>");
-        return;
-    }
-    const char *sensor_name = argv[1];
-    const char * file_name = argv[2];
-    const char * timing_str = argv[3]; 
-    int time = atoi(timing_str);
-    int sensor_index = get_sensor_index(sensor_name);
-    struct sensor_info *sensor = &sensors[sensor_index];
-    void * cb;
-    
-    sensor->cb_filename = file_name;
-    k_timer_init(&(sensor->timer), sensor->timer_callback, NULL);
-    k_timer_start(&(sensor->timer), K_SECONDS(time), K_SECONDS(time));
-}
+static int cmd_lsm6dsl_status(const struct shell *shell, size_t argc, char **argv) {
+    uint8_t ctrl[2];
+    uint16_t fifo_words = 0;
+    bool overrun = false;
 
-void enable_tap_sensor() {
-    uint8_t val;
-    int32_t ret;
-    
-    ret = lsm6dsl_read_reg(CTRL1_XL, &val, 1); // CRTL1_XL
-    printk("CTRL1_XL: %02x\n", val);
-    val = 0x60;
-    ret = lsm6dsl_write_reg(CTRL1_XL, &val, 1);
-    
-    ret = lsm6dsl_read_reg(TAP_CFG, &val, 1); // TAP_CFG
-    printk("TAP_CFG: %02x\n", val);
-    val = 0x8e;
-    ret = lsm6dsl_write_reg(TAP_CFG, &val, 1);
-
-    ret = lsm6dsl_read_reg(TAP_THS_6D, &val, 1); // TAP_THS_6D
-    printk("TAP_THS_6D: %02x\n", val); 
-    val = 0x8c;
-    ret = lsm6dsl_write_reg(TAP_THS_6D, &val, 1);
-
-    ret = lsm6dsl_read_reg(INT_DUR2, &val, 1); // INT_DUR2
-    printk("INT_DUR2: %02x\n", val);
-    val = 0x7f; // Set duration for tap detection
-    ret = lsm6dsl_write_reg(INT_DUR2, &val, 1);
-
-    ret = lsm6dsl_read_reg(WAKE_UP_THS, &val, 1); // WAKE_UP_THS
-    printk("WAKE_UP_THS: %02x\n", val);
-    val = 0x80; // Set wake-up threshold
-    ret = lsm6dsl_write_reg(WAKE_UP_THS, &val, 1); // Set wake-up threshold
-
-    ret = lsm6dsl_read_reg(MD1_CFG, &val, 1);
-    printk("MD1_CFG: %02x\n", val);
-    val = 0x08;
-    ret = lsm6dsl_write_reg(MD1_CFG, &val, 1); //MD1_CFG
-    
-    ret = lsm6dsl_read_reg(INT1_CTRL, &val, 1);
-    printk("INT1_CTRL: %02x\n", val);
-    val = 0x80; // Set wake-up threshold
-    ret = lsm6dsl_write_reg(INT1_CTRL, &val, 1); 
+    lsm6dsl_reg_read(&lsm6dsl_ctx, 0x10, ctrl, sizeof(ctrl)); // CTRL1_XL, CTRL2_G
+    shell_print(shell, "mode: %s", lsm6dsl_mode_name(lsm6dsl_get_mode(&lsm6dsl_ctx)));
+    shell_print(shell, "CTRL1_XL: %02x CTRL2_G: %02x", ctrl[0], ctrl[1]);
+    if (lsm6dsl_get_mode(&lsm6dsl_ctx) == LSM6DSL_MODE_FIFO &&
+        lsm6dsl_fifo_level(&lsm6dsl_ctx, &fifo_words, &overrun) == 0) {
+        shell_print(shell, "fifo: %u words%s", fifo_words, overrun ? " (overrun)" : "");
+    }
+    shell_print(shell, "bus: %u writes, %u reads, %u writes skipped by the shadow",
+                lsm6dsl_ctx.bus_writes, lsm6dsl_ctx.bus_reads, lsm6dsl_ctx.writes_skipped);
+    return 0;
 }
 
-void enable_single_tap_sensor() {
-    uint8_t val;
-    int32_t ret;
-    
-    ret = lsm6dsl_read_reg(CTRL1_XL, &val, 1); // CRTL1_XL
-    printk("CTRL1_XL: %02x\n", val);
-    val = 0x60;
-    ret = lsm6dsl_write_reg(CTRL1_XL, &val, 1);
-    
-    ret = lsm6dsl_read_reg(TAP_CFG, &val, 1); // TAP_CFG
-    printk("TAP_CFG: %02x\n", val);
-    val = 0x8e;
-    ret = lsm6dsl_write_reg(TAP_CFG, &val, 1);
-
-    ret = lsm6dsl_read_reg(TAP_THS_6D, &val, 1); // TAP_THS_6D
-    printk("TAP_THS_6D: %02x\n", val); 
-    val = 0x89;
-    ret = lsm6dsl_write_reg(TAP_THS_6D, &val, 1);
-
-    ret = lsm6dsl_read_reg(INT_DUR2, &val, 1); // INT_DUR2
-    printk("INT_DUR2: %02x\n", val);
-    val = 0x06; // Set duration for tap detection
-    ret = lsm6dsl_write_reg(INT_DUR2, &val, 1);
-
-    ret = lsm6dsl_read_reg(WAKE_UP_THS, &val, 1); // WAKE_UP_THS
-    printk("WAKE_UP_THS: %02x\n", val);
-    val = 0x00; // Set wake-up threshold
-    ret = lsm6dsl_write_reg(WAKE_UP_THS, &val, 1); // Set wake-up threshold
-
-    ret = lsm6dsl_read_reg(MD1_CFG, &val, 1);
-    printk("MD1_CFG: %02x\n", val);
-    val = 0x40;
-    ret = lsm6dsl_write_reg(MD1_CFG, &val, 1); //MD1_CFG
-
-        ret = lsm6dsl_read_reg(INT1_CTRL, &val, 1);
-    printk("INT1_CTRL: %02x\n", val);
-    val = 0x80; // Set wake-up threshold
-    ret = lsm6dsl_write_reg(INT1_CTRL, &val, 1); 
+static void cmd_lsm6dsl_step_stop(const struct shell *shell, size_t argc, char **argv) {
+    // Flush the last batch, then turn the pedometer and its interrupt off
+    uint32_t steps = step_log_stop();
+    lsm6dsl_set_mode(&lsm6dsl_ctx, LSM6DSL_MODE_NORMAL, false);
+    event_mode_hold(false);
+    shell_print(shell, "Stopped LSM6DSL step detection, %u steps logged", steps);
 }
 
-void enable_step_sensor() {
-    uint8_t val;
-    int32_t ret;
-
-    ret = lsm6dsl_read_reg(FUNC_CFG_ACCESS, &val, 1); // CRTL1_XL
-    printk("CTRL1_XL: %02x\n", val);
-    val = 0x80; // Set accelerometer to 104 Hz
-    ret = lsm6dsl_write_reg(FUNC_CFG_ACCESS, &val, 1);
-
-    ret = lsm6dsl_read_reg(CONFIG_PEDO_THS_MIN, &val, 1); // CRTL1_XL
-    printk("CONFIG_PEDO_THS_MIN: %02x\n", val);
-    val = 0x8E; // Set accelerometer to 104 Hz
-    ret = lsm6dsl_write_reg(CONFIG_PEDO_THS_MIN, &val, 1);
-
-    ret = lsm6dsl_read_reg(FUNC_CFG_ACCESS, &val, 1); // CRTL1_XL
-    printk("FUNC_CFG_ACCESS: %02x\n", val);
-    val = 0x00; // Set accelerometer to 104 Hz
-    ret = lsm6dsl_write_reg(FUNC_CFG_ACCESS, &val, 1);
-
-    ret = lsm6dsl_read_reg(CTRL1_XL, &val, 1); // CRTL1_XL
-    printk("CTRL1_XL: %02x\n", val);
-    val = 0x28; // Set accelerometer to 104 Hz
-    ret = lsm6dsl_write_reg(CTRL1_XL, &val, 1);
-
-    ret = lsm6dsl_read_reg(CTRL10_C, &val, 1); // CRTL1_XL
-    printk("CTRL10_C: %02x\n", val);
-    val = 0x14; // Set accelerometer to 104 Hz
-    ret = lsm6dsl_write_reg(CTRL10_C, &val, 1);
-
-    ret = lsm6dsl_read_reg(INT1_CTRL, &val, 1); // CRTL1_XL
-    printk("INT1_CTRL: %02x\n", val);
-    val = 0x80; // Set accelerometer to 104 Hz
-    ret = lsm6dsl_write_reg(INT1_CTRL, &val, 1);
+// Fetch a sample and record its latency in the pipeline statistics
+static int timed_fetch(int sensor_index, const struct device *dev)
+{
+    uint32_t start = stats_now();
+    int rc = sensor_sample_fetch(dev);
+    stats_fetch(sensor_index, start, rc);
+    return rc;
 }
 
-static void cmd_lsm6dsl_tap_http_start(const struct shell *shell, size_t argc, char **argv) {
-    if (argc < 2) {
-        shell_error(shell, "Usage: lsm6dsl_tap_http_start <url>");
-        return;
+// Fetch one sample and read every axis listed for the sensor
+int sensor_capture(int sensor_index, struct sensor_sample *sample)
+{
+    if (sensor_index < 0 || sensor_index >= NUM_SENSORS || !sample) {
+        return -EINVAL;
     }
-    sensors[LSM6DSL].interrupt_url = argv[1];
-
-    enable_single_tap_sensor();
-    lsm6dsl_mode = LSM6DSL_MODE_TAP;
-    lsm6dsl_action_mode = MODE_HTTP;
+    struct sensor_info *sensor = &sensors[sensor_index];
 
-    shell_print(shell, "Started LSM6DSL tap detection with HTTP mode");
-}
+    sample->sensor = sensor_index;
+    sample->num_vals = 0;
 
-static void cmd_lsm6dsl_tap_start(const struct shell *shell, size_t argc, char **argv) {
-    if (argc < 2) {
-        shell_error(shell, "Usage: lsm6dsl_step_start <filename>");
-        return;
+    if (sensor->dev_or_gpio == TYPE_GPIO) {
+        uint32_t start = stats_now();
+        int state = gpio_pin_get_dt(sensor->gpio);
+        stats_fetch(sensor_index, start, state < 0 ? -EIO : 0);
+        if (state < 0) {
+            return -EIO;
+        }
+        sample->val[0].val1 = state;
+        sample->val[0].val2 = 0;
+        sample->num_vals = 1;
+        return 0;
     }
-    sensors[LSM6DSL].interrupt_cb_filename = argv[1];
 
-    enable_single_tap_sensor();
-    lsm6dsl_mode = LSM6DSL_MODE_TAP;
-    lsm6dsl_action_mode = MODE_FILE;
-}
+    // The filter thread did the fetching, this only copies its latest output
+    if (sensor->dev_or_gpio == TYPE_VIRTUAL) {
+        return fusion_capture(sample);
+    }
 
-static void cmd_lsm6dsl_step_start(const struct shell *shell, size_t argc, char **argv) {
-   if (argc < 2) {
-        shell_error(shell, "Usage: lsm6dsl_step_start <filename>");
-        return;
+    power_window_open(sensor_index);
+    int rc = timed_fetch(sensor_index, sensor->dev);
+    power_window_close(sensor_index);
+    if (rc != 0) {
+        return rc;
     }
-    sensors[LSM6DSL].interrupt_cb_filename = argv[1];
 
-    enable_step_sensor();
-    lsm6dsl_mode = LSM6DSL_MODE_STEP;
-    lsm6dsl_action_mode = MODE_FILE;    
+    for (int i = 0; i < sensor->num_axes && i < SENSOR_MAX_VALS; i++) {
+        sensor_channel_get(sensor->dev, sensor->axes[i].chan, &sample->val[i]);
+    }
+    sample->num_vals = MIN(sensor->num_axes, SENSOR_MAX_VALS);
+    return 0;
 }
 
-static void cmd_lsm6dsl_step_stop(const struct shell *shell, size_t argc, char **argv) {
-    // Stop the LSM6DSL step detection timer
-    //k_timer_stop(&sensors[LSM6DSL].timer);
-    shell_print(shell, "Stopped LSM6DSL step detection");
+// Signed fixed point with the given number of decimals; %d.%06d on a
+// sensor_value prints -0.5 as 0.-500000
+static int format_fixed(char *buf, size_t buf_len, const struct sensor_value *v, int decimals)
+{
+    int64_t micro = sensor_value_to_micro(v);
+    uint64_t mag = (micro < 0) ? -micro : micro;
+    uint32_t div = 1;
+
+    for (int i = decimals; i < 6; i++) {
+        div *= 10;
+    }
+    return snprintf(buf, buf_len, "%s%u.%0*u", micro < 0 ? "-" : "",
+                    (uint32_t)(mag / 1000000), decimals, (uint32_t)(mag % 1000000 / div));
 }
 
-// Sensor Timer Stop Command
-static void cmd_sensor_timer_stop (const struct shell *shell, size_t argc, char **argv) {
-    if (argc < 2) {
-        shell_error(shell, "Usage: sensor_timer_stop <sensor_name>");
-        return;
+static int format_orientation(const struct sensor_value *val, char *buf, size_t buf_len)
+{
+    enum fusion_output out = fusion_get_output();
+    char q[4][12], e[3][12];
+    int used = 0;
+
+    for (int i = 0; i < 4; i++) {
+        format_fixed(q[i], sizeof(q[i]), &val[i], 4);
+    }
+    for (int i = 0; i < 3; i++) {
+        format_fixed(e[i], sizeof(e[i]), &val[4 + i], 2);
     }
-    const char *sensor_name = argv[1];
-    int sensor_index = get_sensor_index(sensor_name);
-    struct sensor_info *sensor = &sensors[sensor_index];
 
-    k_timer_stop(&(sensor->timer));
-    shell_print(shell, "Stopped timer for %s", sensor_name);
+    if (out != FUSION_OUTPUT_EULER) {
+        used += snprintf(buf, buf_len, "Orientation: W %s, X %s, Y %s, Z %s\n",
+                         q[0], q[1], q[2], q[3]);
+    }
+    if (out != FUSION_OUTPUT_QUAT && used < (int)buf_len) {
+        used += snprintf(buf + used, buf_len - used,
+                         "Orientation: Roll %s, Pitch %s, Yaw %s deg\n", e[0], e[1], e[2]);
+    }
+    return used;
 }
 
-// Sensor Reading (Returns formatted string of sensor data)
-// TODO we should use the sensors struct instead of hardcoding
-int sensor_reading(const char *sensor_name, char *buf, size_t buf_len)
+// Format a captured sample as a text line
+int sensor_format(const struct sensor_sample *sample, char *buf, size_t buf_len)
 {
-    struct sensor_value val[3];
-    int rc, used = 0;
+    const struct sensor_value *val = sample->val;
+    int used = 0;
 
-    if (!sensor_name || !buf || buf_len == 0) {
+    if (!buf || buf_len == 0) {
         return -EINVAL;
     }
     buf[0] = '\0';
 
-    if (strcmp(sensor_name, "hts221") == 0) {
-        if ((rc = sensor_sample_fetch(hts221)) != 0) {
-            return rc;
-        }
-        sensor_channel_get(hts221, SENSOR_CHAN_AMBIENT_TEMP, &val[0]);
-        sensor_channel_get(hts221, SENSOR_CHAN_HUMIDITY,     &val[1]);
-
+    switch (sample->sensor) {
+    case HTS221:
         used = snprintf(buf, buf_len,
                         "HTS221: Temp %d.%06d C, Hum %d.%06d %%\n",
                         val[0].val1, val[0].val2,
                         val[1].val1, val[1].val2);
-    }
-
-    else if (strcmp(sensor_name, "lps22hb") == 0) {
-        if ((rc = sensor_sample_fetch(lps22hb)) != 0) {
-            return rc;
-        }
-        sensor_channel_get(lps22hb, SENSOR_CHAN_PRESS, &val[0]);
+        break;
 
+    case LPS22HB:
         used = snprintf(buf, buf_len,
                         "LPS22HB: Pressure %d.%06d kPa\n",
                         val[0].val1, val[0].val2);
-    }
-
-    else if (strcmp(sensor_name, "lis3mdl") == 0) {
-        if ((rc = sensor_sample_fetch(lis3mdl)) != 0) {
-            return rc;
-        }
-        sensor_channel_get(lis3mdl, SENSOR_CHAN_MAGN_XYZ, val);
+        break;
 
+    case LIS3MDL:
         used = snprintf(buf, buf_len,
                         "LIS3MDL: X %d.%06d, Y %d.%06d, Z %d.%06d uT\n",
                         val[0].val1, val[0].val2,
                         val[1].val1, val[1].val2,
                         val[2].val1, val[2].val2);
-    }
-
-    else if (strcmp(sensor_name, "lsm6dsl") == 0) {
-        if ((rc = sensor_sample_fetch(lsm6dsl)) != 0) {
-            return rc;
-        }
+        break;
 
-        /* Accel */
-        sensor_channel_get(lsm6dsl, SENSOR_CHAN_ACCEL_XYZ, val);
+    case LSM6DSL:
         used = snprintf(buf, buf_len,
-                        "LSM6DSL Accel: X %d.%06d, Y %d.%06d, Z %d.%06d m/s^2\n",
+                        "LSM6DSL Accel: X %d.%06d, Y %d.%06d, Z %d.%06d m/s^2\n"
+                        "LSM6DSL Gyro: X %d.%06d, Y %d.%06d, Z %d.%06d deg/s\n",
                         val[0].val1, val[0].val2,
                         val[1].val1, val[1].val2,
-                        val[2].val1, val[2].val2);
-
-        if ((size_t)used < buf_len) {
-            sensor_channel_get(lsm6dsl, SENSOR_CHAN_GYRO_XYZ, val);
-            used += snprintf(buf + used, buf_len - used,
-                             "LSM6DSL Gyro: X %d.%06d, Y %d.%06d, Z %d.%06d deg/s\n",
-                             val[0].val1, val[0].val2,
-                             val[1].val1, val[1].val2,
-                             val[2].val1, val[2].val2);
-        }
-    }
-
-    else if (strcmp(sensor_name, "vl53l0x") == 0) {
-        if ((rc = sensor_sample_fetch(vl53l0x)) != 0) {
-            return rc;
-        }
-        sensor_channel_get(vl53l0x, SENSOR_CHAN_DISTANCE, &val[0]);
+                        val[2].val1, val[2].val2,
+                        val[3].val1, val[3].val2,
+                        val[4].val1, val[4].val2,
+                        val[5].val1, val[5].val2);
+        break;
 
+    case VL53L0X:
         used = snprintf(buf, buf_len,
                         "VL53L0X: Raw Distance %d\n",
                         val[0].val2);
-    }
+        break;
 
-    else if (strcmp(sensor_name, "button0") == 0) {
-        int state = gpio_pin_get_dt(&button0);
-        if (state < 0) {
-            return -EIO;
-        }
+    case BUTTON0:
         used = snprintf(buf, buf_len,
-                        "Button %s\n", state ? "pressed" : "released");
-    }
+                        "Button %s\n", val[0].val1 ? "pressed" : "released");
+        break;
 
-    else {
-        used = snprintf(buf, buf_len,
-                        "Unknown sensor: %s\n", sensor_name);
+    case ORIENTATION:
+        used = format_orientation(val, buf, buf_len);
+        break;
+
+    default:
+        return -EINVAL;
     }
 
     buf[buf_len - 1] = '\0';
@@ -913,6 +632,29 @@ int sensor_reading(const char *sensor_name, char *buf, size_t buf_len)
     return used;
 }
 
+// Sensor Reading (Returns formatted string of sensor data)
+int sensor_reading(const char *sensor_name, char *buf, size_t buf_len)
+{
+    struct sensor_sample sample;
+
+    if (!sensor_name || !buf || buf_len == 0) {
+        return -EINVAL;
+    }
+
+    int idx = get_sensor_index(sensor_name);
+    if (idx < 0) {
+        int used = snprintf(buf, buf_len, "Unknown sensor: %s\n", sensor_name);
+        buf[buf_len - 1] = '\0';
+        return (used >= (int)buf_len) ? -ENOSPC : used;
+    }
+
+    int rc = sensor_capture(idx, &sample);
+    if (rc != 0) {
+        return rc;
+    }
+    return sensor_format(&sample, buf, buf_len);
+}
+
 // Use sensor_reading to read a sensor and print the result
 static int cmd_read_sensor(const struct shell *shell, size_t argc, char **argv)
 {
@@ -938,16 +680,13 @@ static int cmd_read_sensor(const struct shell *shell, size_t argc, char **argv)
 SHELL_CMD_REGISTER(read, NULL, "Read sensor data", cmd_read_sensor);
 SHELL_CMD_REGISTER(toggle_led1, NULL, "Toggle LED1", cmd_toggle_led1);
 
-SHELL_CMD_REGISTER(sensor_timer_start, NULL, "Start sensor timer", cmd_sensor_timer_start);
-SHELL_CMD_REGISTER(sensor_timer_stop, NULL, "Stop sensor timer", cmd_sensor_timer_stop);
-
-SHELL_CMD_REGISTER(sensor_timer_http_start, NULL, "Start sensor HTTP timer", cmd_sensor_timer_http_start);
-SHELL_CMD_REGISTER(sensor_timer_http_stop, NULL, "Stop sensor HTTP timer", cmd_sensor_timer_http_stop);
-
 SHELL_CMD_REGISTER(lsm6dsl_step_start, NULL, "Start LSM6DSL event handler", cmd_lsm6dsl_step_start);
+SHELL_CMD_REGISTER(lsm6dsl_step_http_start, NULL, "Log LSM6DSL steps to a URL <url>", cmd_lsm6dsl_step_http_start);
 SHELL_CMD_REGISTER(lsm6dsl_tap_start, NULL, "Start LSM6DSL event handler", cmd_lsm6dsl_tap_start);
 SHELL_CMD_REGISTER(lsm6dsl_tap_http_start, NULL, "Start LSM6DSL event handler", cmd_lsm6dsl_tap_http_start);
 SHELL_CMD_REGISTER(lsm6dsl_step_stop, NULL, "Stop LSM6DSL event handler", cmd_lsm6dsl_step_stop);
+SHELL_CMD_REGISTER(lsm6dsl_mode, NULL, "Set the LSM6DSL mode <normal|step|single_tap|double_tap|motion|fifo> [verify]", cmd_lsm6dsl_mode);
+SHELL_CMD_REGISTER(lsm6dsl_status, NULL, "Show LSM6DSL mode, ODR, FIFO level and bus traffic", cmd_lsm6dsl_status);
 
 void init_sensors() {
     for (int i = 0; i < NUM_SENSORS; i++) {
@@ -963,26 +702,20 @@ void init_sensors() {
             } else {
                 printk("GPIO %s initialized\n", sensors[i].name);
             }
+        } else {
+            printk("Virtual sensor %s available\n", sensors[i].name);
         }
+    }
 
-        sensors[i].timer_callback = sensor_timer_callback;
-        k_timer_init(&sensors[i].timer, sensors[i].timer_callback, NULL);
-        k_work_init(&sensors[i].work, sensor_work_handler);
-        k_work_init(&sensors[i].http_work, http_client_work_handler);
-        k_work_init(&sensors[i].interrupt_work, interrupt_work_handler);
-        k_work_init(&sensors[i].interrupt_http_work, interrupt_http_work_handler);
-        sensors[i].cb_filename = k_malloc(64);
-        sensors[i].url = k_malloc(128);
-        struct sensor_value odr_attr;
-        odr_attr.val1 = 104; // Set ODR to 100 Hz
-        odr_attr.val2 = 0;
-
-        if (sensor_attr_set(lsm6dsl, SENSOR_CHAN_ACCEL_XYZ, SENSOR_ATTR_SAMPLING_FREQUENCY, &odr_attr) < 0) {
-            printk("Failed to set LSM6DSL ODR\n");
-        }
-        if (sensor_attr_set(lsm6dsl, SENSOR_CHAN_GYRO_XYZ, SENSOR_ATTR_SAMPLING_FREQUENCY, &odr_attr) < 0) {
-            printk("Failed to set LSM6DSL Gyro ODR\n");
-        }
+    struct sensor_value odr_attr;
+    odr_attr.val1 = 104; // Set ODR to 104 Hz
+    odr_attr.val2 = 0;
+
+    if (lsm6dsl_set_odr(&lsm6dsl_ctx, SENSOR_CHAN_ACCEL_XYZ, &odr_attr) < 0) {
+        printk("Failed to set LSM6DSL ODR\n");
+    }
+    if (lsm6dsl_set_odr(&lsm6dsl_ctx, SENSOR_CHAN_GYRO_XYZ, &odr_attr) < 0) {
+        printk("Failed to set LSM6DSL Gyro ODR\n");
     }
 }
 
@@ -1001,50 +734,51 @@ void main(void)
 
     // Initialize Filesystem
     printk("Initializing filesystem...\n");
-    int rc = fs_mount(&littlefs_mnt);
+    int rc = fs_profile_mount(FS_PROFILE_DEFAULT);
     if (rc < 0) {
         printk("Failed to mount littlefs: %d\n", rc);
     }
     init_dir();
-    printk("Filesystem initialized\n");
-    
-    // Initialize WiFi
-    printk("Initializing WiFi...\n");
+    perf_boot_mark("filesystem mounted");
+
     net_mgmt_init_event_callback(&wifi_cb, wifi_mgmt_event_handler, NET_EVENT_IPV4_ADDR_ADD);
     net_mgmt_add_event_callback(&wifi_cb);
-    printk("WiFi initialized\n");
-    wifi_connect_to_saved_network();
 
     // Initialize Sensors and Triggers
-    init_sensors();
-
     // INTERRUPTS
-    int ret = gpio_pin_configure_dt(&int1_gpio, GPIO_INPUT | GPIO_INT_EDGE_RISING);
-    if (ret != 0) {
-        printk("Failed to configure INT1 GPIO: %d\n", ret);
-        return -1;
-    }
-    gpio_init_callback(&gpio_cb, int1_handler, BIT(int1_gpio.pin));
-    ret = gpio_add_callback(int1_gpio.port, &gpio_cb);
+    int ret = lsm6dsl_ctx_init(&lsm6dsl_ctx, int1_handler);
     if (ret != 0) {
-        printk("Failed to add GPIO callback: %d\n", ret);
-        return -1;
+        printk("Failed to initialize LSM6DSL: %d\n", ret);
+    } else {
+        printk("INT1 interrupt configured on GPIOD pin %d\n", int1_gpio.pin);
     }
+    // INTERRUPTS
+    init_sensors();
+    perf_boot_mark("sensors ready");
 
-    ret = gpio_pin_interrupt_configure_dt(&int1_gpio, GPIO_INT_EDGE_RISING);
-    if (ret != 0) {
-        printk("Failed to enable INT1 interrupt: %d\n", ret);
-        return -1;
+    // led0 heartbeat runs off a timer, everything else is timer or interrupt driven
+    power_init(&led0);
+
+    // Settings live in a file on littlefs, so they load after the mount
+    rc = settings_subsys_init();
+    if (rc < 0) {
+        printk("Settings unavailable: %d\n", rc);
+    } else {
+        rc = fs_profile_restore();
+        if (rc > FS_PROFILE_DEFAULT) {
+            printk("littlefs remounted with the %s profile\n", fs_profile_get(rc)->name);
+        }
+        rc = session_restore();
+        printk("%d logging session(s) restored\n", MAX(rc, 0));
     }
+    perf_boot_mark("sessions restored");
 
-    printk("INT1 interrupt configured on GPIOD pin %d\n", int1_gpio.pin);
-    // INTERRUPTS
+    // Initialize WiFi. Association takes seconds, so it is requested once
+    // the sensors and the restored sessions are up instead of ahead of them
+    wifi_connect_in_background();
 
     printk("System Initialized. Entering main loop.\n");
 
-    while (1) {
-        // TODO SLEEP HARDER
-        gpio_pin_toggle_dt(&led0);
-        k_msleep(1000);
-    }
+    // Nothing left to poll, leave the CPU to the idle thread (tickless, PM states)
+    k_sleep(K_FOREVER);
 }
\ No newline at end of file
@@ -0,0 +1,383 @@
+// Where the time and the stack go: per thread CPU share and stack high-water
+// marks, timer and work queue latency histograms for the periodic sessions,
+// and a one-shot CTF capture of the sampling pipeline.
+#include "perf.h"
+#include "stats.h"
+#include "fs_profile.h"
+#include <zephyr/kernel.h>
+#include <zephyr/shell/shell.h>
+#include <zephyr/fs/fs.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#define PERF_MAX_THREADS 24
+// Stacks with less headroom than this are flagged in the report
+#define PERF_STACK_WARN 256
+
+#define PERF_TRACE_EVENTS 256
+#define PERF_TRACE_FILE "/lfs/pipeline.ctf"
+#define PERF_DUMP_BYTES 32 // per hex line
+
+struct perf_hist {
+    uint32_t count;
+    uint32_t max;
+    uint64_t sum;
+    uint32_t bucket[PERF_LAT_BUCKETS];
+};
+
+// Layout must match the event header and fields in scripts/perf_trace.py
+struct perf_trace_event {
+    uint32_t timestamp;
+    uint8_t id;
+    uint8_t sensor;
+    uint8_t arg;
+    int16_t value;
+} __packed;
+
+struct boot_mark {
+    const char *phase;
+    uint32_t us;
+};
+
+struct thread_snap {
+    k_tid_t tid;
+    uint64_t cycles;
+};
+
+static struct k_spinlock hist_lock;
+static struct perf_hist timer_late;  // timer callback vs when it was due
+static struct perf_hist queue_delay; // timer callback until the handler runs
+
+static struct thread_snap snaps[PERF_MAX_THREADS];
+static int num_snaps;
+static uint64_t snap_total;
+
+static struct boot_mark boot_marks[PERF_BOOT_MARKS];
+static atomic_t num_boot_marks;
+
+atomic_t perf_tracing;
+static atomic_t trace_len;
+static struct k_spinlock trace_lock;
+static struct perf_trace_event trace_buf[PERF_TRACE_EVENTS];
+
+static void hist_add(struct perf_hist *h, uint32_t us)
+{
+    int bucket = (us == 0) ? 0 : 32 - __builtin_clz(us);
+
+    k_spinlock_key_t key = k_spin_lock(&hist_lock);
+    h->bucket[MIN(bucket, PERF_LAT_BUCKETS - 1)]++;
+    h->count++;
+    h->sum += us;
+    h->max = MAX(h->max, us);
+    k_spin_unlock(&hist_lock, key);
+}
+
+void perf_timer_fire(struct perf_stamp *st, uint32_t period_ms)
+{
+    // Due times are a period apart, across idle, so they are on the system timer
+    uint32_t now = k_cycle_get_32();
+
+    if (st->expected) {
+        int32_t late = (int32_t)(now - st->expected);
+        hist_add(&timer_late, late > 0 ? k_cyc_to_us_floor32(late) : 0);
+    }
+    st->fired = stats_now();
+    st->expected = now + k_ms_to_cyc_ceil32(period_ms);
+    if (st->expected == 0) {
+        st->expected = 1;
+    }
+}
+
+void perf_timer_restart(struct perf_stamp *st)
+{
+    st->fired = 0;
+    st->expected = 0;
+}
+
+void perf_work_start(struct perf_stamp *st)
+{
+    if (st->fired) {
+        hist_add(&queue_delay, stats_cyc_to_us(stats_now() - st->fired));
+    }
+}
+
+void perf_trace_record(enum perf_event id, uint8_t sensor, uint8_t arg, int16_t value)
+{
+    // Timer ISRs and threads both trace. The timestamp is read under the
+    // same lock that claims the slot, so an ISR cannot slip in between and
+    // leave the stream going back in time, which CTF reads as a wrap
+    k_spinlock_key_t key = k_spin_lock(&trace_lock);
+    atomic_val_t i = atomic_inc(&trace_len);
+
+    if (i >= PERF_TRACE_EVENTS) {
+        // One-shot: a full buffer ends the capture instead of wrapping
+        atomic_set(&perf_tracing, 0);
+        k_spin_unlock(&trace_lock, key);
+        return;
+    }
+    trace_buf[i] = (struct perf_trace_event){
+        .timestamp = k_cycle_get_32(), // in CTF_CLOCK counts
+        .id = id,
+        .sensor = sensor,
+        .arg = arg,
+        .value = value,
+    };
+    k_spin_unlock(&trace_lock, key);
+}
+
+void perf_boot_mark(const char *phase)
+{
+    uint32_t us = k_ticks_to_us_floor32(k_uptime_ticks());
+    atomic_val_t i = atomic_inc(&num_boot_marks);
+
+    if (i < PERF_BOOT_MARKS) {
+        boot_marks[i] = (struct boot_mark){ .phase = phase, .us = us };
+    }
+    printk("[%u.%03u ms] %s\n", us / 1000, us % 1000, phase);
+}
+
+static int trace_events(void)
+{
+    return MIN((int)atomic_get(&trace_len), PERF_TRACE_EVENTS);
+}
+
+// Threads
+
+static uint64_t thread_cycles(k_tid_t tid)
+{
+    k_thread_runtime_stats_t rt;
+    return (k_thread_runtime_stats_get(tid, &rt) == 0) ? rt.execution_cycles : 0;
+}
+
+static uint64_t total_cycles(void)
+{
+    k_thread_runtime_stats_t rt;
+    return (k_thread_runtime_stats_all_get(&rt) == 0) ? rt.execution_cycles : 0;
+}
+
+static void snap_thread(const struct k_thread *thread, void *user_data)
+{
+    if (num_snaps < PERF_MAX_THREADS) {
+        snaps[num_snaps].tid = (k_tid_t)thread;
+        snaps[num_snaps].cycles = thread_cycles((k_tid_t)thread);
+        num_snaps++;
+    }
+}
+
+static uint64_t snap_of(k_tid_t tid)
+{
+    for (int i = 0; i < num_snaps; i++) {
+        if (snaps[i].tid == tid) {
+            return snaps[i].cycles;
+        }
+    }
+    return 0;
+}
+
+struct report_ctx {
+    const struct shell *shell;
+    uint64_t window;
+};
+
+static void report_thread(const struct k_thread *thread, void *user_data)
+{
+    struct report_ctx *ctx = user_data;
+    k_tid_t tid = (k_tid_t)thread;
+    const char *name = k_thread_name_get(tid);
+    uint64_t used = thread_cycles(tid) - snap_of(tid);
+    uint32_t permille = ctx->window ? (uint32_t)(used * 1000 / ctx->window) : 0;
+    size_t size = thread->stack_info.size;
+    size_t unused = 0;
+    char label[16];
+
+    if (!name || !name[0]) {
+        snprintf(label, sizeof(label), "%p", thread);
+        name = label;
+    }
+    if (k_thread_stack_space_get(tid, &unused) != 0) {
+        shell_print(ctx->shell, "%-20s %3u.%u %%   stack n/a", name, permille / 10, permille % 10);
+        return;
+    }
+    shell_print(ctx->shell, "%-20s %3u.%u %%   %5u / %5u   %5u%s", name, permille / 10,
+                permille % 10, (uint32_t)(size - unused), (uint32_t)size, (uint32_t)unused,
+                unused < PERF_STACK_WARN ? "  LOW" : "");
+}
+
+static void perf_reset(void)
+{
+    num_snaps = 0;
+    k_thread_foreach_unlocked(snap_thread, NULL);
+    snap_total = total_cycles();
+
+    k_spinlock_key_t key = k_spin_lock(&hist_lock);
+    memset(&timer_late, 0, sizeof(timer_late));
+    memset(&queue_delay, 0, sizeof(queue_delay));
+    k_spin_unlock(&hist_lock, key);
+}
+
+static int cmd_perf(const struct shell *shell, size_t argc, char **argv)
+{
+    struct report_ctx ctx = {
+        .shell = shell,
+        .window = total_cycles() - snap_total,
+    };
+
+    shell_print(shell, "%-20s %7s   %13s   %5s", "thread", "cpu", "stack used/size", "free");
+    k_thread_foreach_unlocked(report_thread, &ctx);
+    shell_print(shell, "CPU shares since boot or perf_reset; stack use is the high-water mark");
+    return 0;
+}
+
+static void print_hist(const struct shell *shell, const char *name, const struct perf_hist *h)
+{
+    uint32_t avg = h->count ? (uint32_t)(h->sum / h->count) : 0;
+
+    shell_print(shell, "%s: %u samples, avg %u us, max %u us", name, h->count,
+                avg, h->max);
+    for (int b = 0; b < PERF_LAT_BUCKETS; b++) {
+        if (h->bucket[b]) {
+            shell_print(shell, "  < %6u us: %u", 1U << b, h->bucket[b]);
+        }
+    }
+}
+
+static int cmd_perf_latency(const struct shell *shell, size_t argc, char **argv)
+{
+    struct perf_hist late, queue;
+
+    k_spinlock_key_t key = k_spin_lock(&hist_lock);
+    late = timer_late;
+    queue = queue_delay;
+    k_spin_unlock(&hist_lock, key);
+
+    print_hist(shell, "timer lateness", &late);
+    print_hist(shell, "work queue delay", &queue);
+    return 0;
+}
+
+static int cmd_perf_reset(const struct shell *shell, size_t argc, char **argv)
+{
+    perf_reset();
+    shell_print(shell, "CPU window and latency histograms restarted");
+    return 0;
+}
+
+static int cmd_boot_times(const struct shell *shell, size_t argc, char **argv)
+{
+    int n = MIN((int)atomic_get(&num_boot_marks), PERF_BOOT_MARKS);
+    uint32_t prev = 0;
+
+    shell_print(shell, "%-24s %10s %10s", "phase", "at (ms)", "took (ms)");
+    for (int i = 0; i < n; i++) {
+        uint32_t at = boot_marks[i].us;
+        shell_print(shell, "%-24s %6u.%03u %6u.%03u", boot_marks[i].phase, at / 1000, at % 1000,
+                    (at - prev) / 1000, (at - prev) % 1000);
+        prev = at;
+    }
+    shell_print(shell, "Times are from kernel start; the boot ROM and clock setup come before it");
+    return 0;
+}
+
+// Trace capture
+
+static int cmd_perf_trace_start(const struct shell *shell, size_t argc, char **argv)
+{
+    atomic_set(&perf_tracing, 0);
+    atomic_set(&trace_len, 0);
+    atomic_set(&perf_tracing, 1);
+    shell_print(shell, "Tracing the next %d pipeline events", PERF_TRACE_EVENTS);
+    return 0;
+}
+
+static int cmd_perf_trace_stop(const struct shell *shell, size_t argc, char **argv)
+{
+    atomic_set(&perf_tracing, 0);
+    shell_print(shell, "%d events captured", trace_events());
+    return 0;
+}
+
+static int cmd_perf_trace_save(const struct shell *shell, size_t argc, char **argv)
+{
+    struct fs_file_t file;
+    size_t len = trace_events() * sizeof(struct perf_trace_event);
+
+    atomic_set(&perf_tracing, 0);
+    fs_file_t_init(&file);
+    fs_profile_lock();
+    fs_unlink(PERF_TRACE_FILE);
+    int rc = fs_open(&file, PERF_TRACE_FILE, FS_O_CREATE | FS_O_WRITE);
+    if (rc == 0) {
+        rc = fs_write(&file, trace_buf, len);
+        fs_close(&file);
+    }
+    fs_profile_unlock();
+    if (rc < 0) {
+        shell_error(shell, "Saving %s failed: %d", PERF_TRACE_FILE, rc);
+        return rc;
+    }
+    shell_print(shell, "%u bytes saved to %s", (uint32_t)len, PERF_TRACE_FILE);
+    return 0;
+}
+
+static void dump_hex(const struct shell *shell, const uint8_t *buf, size_t len)
+{
+    char line[PERF_DUMP_BYTES * 2 + 1];
+
+    for (size_t i = 0; i < len; i++) {
+        snprintf(&line[(i % PERF_DUMP_BYTES) * 2], 3, "%02x", buf[i]);
+        if (i % PERF_DUMP_BYTES == PERF_DUMP_BYTES - 1 || i == len - 1) {
+            shell_print(shell, "CTF %s", line);
+        }
+    }
+}
+
+// Hex over the shell UART, from RAM or from the copy saved on flash. The
+// host side (scripts/perf_trace.py) turns it into a CTF trace directory
+static int cmd_perf_trace_dump(const struct shell *shell, size_t argc, char **argv)
+{
+    atomic_set(&perf_tracing, 0);
+    shell_print(shell, "CTF_CLOCK %u", sys_clock_hw_cycles_per_sec());
+
+    if (argc > 1 && strcmp(argv[1], "file") == 0) {
+        struct fs_file_t file;
+        uint8_t buf[PERF_DUMP_BYTES * 4];
+        ssize_t n;
+
+        fs_file_t_init(&file);
+        fs_profile_lock();
+        int rc = fs_open(&file, PERF_TRACE_FILE, FS_O_READ);
+        if (rc < 0) {
+            fs_profile_unlock();
+            shell_error(shell, "No saved trace (%d)", rc);
+            return rc;
+        }
+        while ((n = fs_read(&file, buf, sizeof(buf))) > 0) {
+            dump_hex(shell, buf, n);
+        }
+        fs_close(&file);
+        fs_profile_unlock();
+    } else {
+        dump_hex(shell, (const uint8_t *)trace_buf, trace_events() * sizeof(struct perf_trace_event));
+    }
+    shell_print(shell, "CTF_END");
+    return 0;
+}
+
+static int perf_init(void)
+{
+    perf_reset();
+    return 0;
+}
+
+SYS_INIT(perf_init, APPLICATION, 99);
+
+SHELL_CMD_REGISTER(perf, NULL, "Show CPU share and stack high-water mark per thread", cmd_perf);
+SHELL_CMD_REGISTER(perf_latency, NULL, "Show timer lateness and work queue delay histograms", cmd_perf_latency);
+SHELL_CMD_REGISTER(perf_reset, NULL, "Restart the CPU window and latency histograms", cmd_perf_reset);
+SHELL_CMD_REGISTER(boot_times, NULL, "Show how long each boot phase took", cmd_boot_times);
+SHELL_CMD_REGISTER(perf_trace_start, NULL, "Capture pipeline events in CTF layout", cmd_perf_trace_start);
+SHELL_CMD_REGISTER(perf_trace_stop, NULL, "Stop the pipeline event capture", cmd_perf_trace_stop);
+SHELL_CMD_REGISTER(perf_trace_save, NULL, "Save the captured events to flash", cmd_perf_trace_save);
+SHELL_CMD_REGISTER(perf_trace_dump, NULL, "Print the captured events as hex [file]", cmd_perf_trace_dump);
@@ -0,0 +1,284 @@
+#include "power.h"
+#include "lsm6dsl_ctx.h"
+#include <zephyr/kernel.h>
+#include <zephyr/shell/shell.h>
+#include <zephyr/drivers/sensor.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef CONFIG_PM
+#include <zephyr/pm/pm.h>
+#include <zephyr/pm/policy.h>
+#endif
+
+// Adaptive sampling: after ADAPT_QUIET_SAMPLES samples without a meaningful
+// change the period doubles, up to ADAPT_MAX_FACTOR times the requested one.
+// Any change bigger than max(ADAPT_ABS_MICRO, ADAPT_REL_PERMILLE of the value)
+// drops straight back to the requested period.
+#define ADAPT_QUIET_SAMPLES 5
+#define ADAPT_MAX_FACTOR 8
+#define ADAPT_REL_PERMILLE 20
+#define ADAPT_ABS_MICRO 10000
+
+#define HEARTBEAT_PERIOD K_SECONDS(1)
+
+struct odr_window {
+    int sensor;
+    enum sensor_channel chan;
+    struct sensor_value active;
+    struct sensor_value idle;
+    uint16_t settle_ms; // first sample at the new ODR takes this long
+};
+
+static const struct odr_window odr_windows[] = {
+    { HTS221,  SENSOR_CHAN_ALL,       { 12, 500000 }, { 1, 0 },      80 },
+    { LPS22HB, SENSOR_CHAN_ALL,       { 25, 0 },      { 1, 0 },      40 },
+    { LIS3MDL, SENSOR_CHAN_ALL,       { 80, 0 },      { 0, 625000 }, 13 },
+    { LSM6DSL, SENSOR_CHAN_ACCEL_XYZ, { 104, 0 },     { 12, 500000 }, 10 },
+    { LSM6DSL, SENSOR_CHAN_GYRO_XYZ,  { 104, 0 },     { 0, 0 },      70 },
+};
+
+static enum power_mode mode = POWER_MODE_NORMAL;
+static uint8_t window_holds[NUM_SENSORS]; // fusion, gesture and a mode can overlap
+
+static const struct gpio_dt_spec *heartbeat_led;
+static uint32_t window_wakes;
+
+static void heartbeat_callback(struct k_timer *timer)
+{
+    gpio_pin_toggle_dt(heartbeat_led);
+}
+
+static K_TIMER_DEFINE(heartbeat_timer, heartbeat_callback, NULL);
+
+#ifdef CONFIG_PM
+static uint32_t pm_entries[PM_STATE_COUNT];
+
+static void pm_state_entry(enum pm_state state)
+{
+    if (state < PM_STATE_COUNT) {
+        pm_entries[state]++;
+    }
+}
+
+static struct pm_notifier pm_counter = {
+    .state_entry = pm_state_entry,
+};
+#endif
+
+static void set_odr(int sensor, bool active)
+{
+    const struct device *dev = get_sensor_device(sensor);
+
+    for (int i = 0; i < ARRAY_SIZE(odr_windows); i++) {
+        const struct odr_window *w = &odr_windows[i];
+        if (w->sensor != sensor) {
+            continue;
+        }
+        // The LSM6DSL control registers are owned by our context driver.
+        // Drivers without runtime ODR support just keep their Kconfig rate
+        if (sensor == LSM6DSL) {
+            lsm6dsl_set_odr(&lsm6dsl_ctx, w->chan, active ? &w->active : &w->idle);
+        } else {
+            sensor_attr_set(dev, w->chan, SENSOR_ATTR_SAMPLING_FREQUENCY,
+                            active ? &w->active : &w->idle);
+        }
+    }
+}
+
+static uint16_t settle_ms(int sensor)
+{
+    uint16_t ms = 0;
+    for (int i = 0; i < ARRAY_SIZE(odr_windows); i++) {
+        if (odr_windows[i].sensor == sensor) {
+            ms = MAX(ms, odr_windows[i].settle_ms);
+        }
+    }
+    return ms;
+}
+
+void power_init(const struct gpio_dt_spec *led)
+{
+    heartbeat_led = led;
+    k_timer_start(&heartbeat_timer, HEARTBEAT_PERIOD, HEARTBEAT_PERIOD);
+
+#ifdef CONFIG_PM
+    pm_notifier_register(&pm_counter);
+    // The shell UART cannot receive in STOP modes, so only allow them in low power mode
+    pm_policy_state_lock_get(PM_STATE_SUSPEND_TO_IDLE, PM_ALL_SUBSTATES);
+#endif
+}
+
+enum power_mode power_get_mode(void)
+{
+    return mode;
+}
+
+void power_set_mode(enum power_mode new_mode)
+{
+    if (new_mode == mode) {
+        return;
+    }
+    mode = new_mode;
+
+    if (mode == POWER_MODE_LOW) {
+        k_timer_stop(&heartbeat_timer);
+        gpio_pin_set_dt(heartbeat_led, 0);
+#ifdef CONFIG_PM
+        pm_policy_state_lock_put(PM_STATE_SUSPEND_TO_IDLE, PM_ALL_SUBSTATES);
+#endif
+    } else {
+#ifdef CONFIG_PM
+        pm_policy_state_lock_get(PM_STATE_SUSPEND_TO_IDLE, PM_ALL_SUBSTATES);
+#endif
+        k_timer_start(&heartbeat_timer, HEARTBEAT_PERIOD, HEARTBEAT_PERIOD);
+    }
+
+    for (int i = 0; i < NUM_SENSORS; i++) {
+        if (!window_holds[i]) {
+            set_odr(i, mode == POWER_MODE_NORMAL);
+        }
+    }
+}
+
+void power_window_open(int sensor)
+{
+    if (mode != POWER_MODE_LOW || window_holds[sensor]) {
+        return;
+    }
+    uint16_t ms = settle_ms(sensor);
+    if (ms == 0) {
+        return;
+    }
+    set_odr(sensor, true);
+    window_wakes++;
+    k_msleep(ms);
+}
+
+void power_window_close(int sensor)
+{
+    if (mode != POWER_MODE_LOW || window_holds[sensor]) {
+        return;
+    }
+    set_odr(sensor, false);
+}
+
+void power_window_hold(int sensor, bool hold)
+{
+    if (hold) {
+        window_holds[sensor]++;
+    } else if (window_holds[sensor] > 0 && --window_holds[sensor] == 0) {
+        set_odr(sensor, mode == POWER_MODE_NORMAL);
+    }
+}
+
+// The state belongs to one session and is only touched by its work handler
+void power_adapt_start(struct power_adapt *st, uint32_t base_ms)
+{
+    memset(st, 0, sizeof(*st));
+    st->base_ms = base_ms;
+    st->period_ms = base_ms;
+}
+
+static bool sample_changed(const struct sensor_sample *ref, const struct sensor_sample *s)
+{
+    for (int i = 0; i < s->num_vals; i++) {
+        int64_t now = sensor_value_to_micro(&s->val[i]);
+        int64_t then = sensor_value_to_micro(&ref->val[i]);
+        int64_t limit = MAX(ADAPT_ABS_MICRO, llabs(then) * ADAPT_REL_PERMILLE / 1000);
+        if (llabs(now - then) > limit) {
+            return true;
+        }
+    }
+    return false;
+}
+
+uint32_t power_adapt_update(struct power_adapt *st, const struct sensor_sample *sample)
+{
+    uint32_t next = 0;
+
+    if (mode != POWER_MODE_LOW) {
+        // Leaving low power mode restores the requested rate
+        if (st->period_ms != st->base_ms) {
+            st->period_ms = st->base_ms;
+            next = st->period_ms;
+        }
+        st->have_ref = false;
+        goto out;
+    }
+
+    if (!st->have_ref || sample_changed(&st->ref, sample)) {
+        st->ref = *sample;
+        st->have_ref = true;
+        st->quiet = 0;
+        if (st->period_ms != st->base_ms) {
+            st->period_ms = st->base_ms;
+            next = st->period_ms;
+        }
+        goto out;
+    }
+
+    if (++st->quiet >= ADAPT_QUIET_SAMPLES && st->period_ms < st->base_ms * ADAPT_MAX_FACTOR) {
+        st->period_ms = MIN(st->period_ms * 2, st->base_ms * ADAPT_MAX_FACTOR);
+        st->quiet = 0;
+        next = st->period_ms;
+    }
+
+out:
+    return next;
+}
+
+static uint32_t permille(uint64_t part, uint64_t whole)
+{
+    return whole ? (uint32_t)(part * 1000 / whole) : 0;
+}
+
+static int cmd_power(const struct shell *shell, size_t argc, char **argv)
+{
+    int64_t window_ms = stats_window_ms();
+    uint32_t i2c = permille(stats_total_fetch_us(), (uint64_t)window_ms * 1000);
+
+    shell_print(shell, "mode: %s", mode == POWER_MODE_LOW ? "low" : "normal");
+
+#ifdef CONFIG_SCHED_THREAD_USAGE_ALL
+    k_thread_runtime_stats_t rt;
+    if (k_thread_runtime_stats_all_get(&rt) == 0) {
+        uint32_t cpu = permille(rt.total_cycles, rt.execution_cycles);
+        shell_print(shell, "cpu duty: %u.%u %% since boot", cpu / 10, cpu % 10);
+    }
+#endif
+    shell_print(shell, "i2c duty: %u.%u %% over %lld ms", i2c / 10, i2c % 10, (long long)window_ms);
+    shell_print(shell, "wakeups: %u timer ticks, %u sensor ODR windows",
+                stats_total_ticks(), window_wakes);
+
+#ifdef CONFIG_PM
+    for (int s = 0; s < PM_STATE_COUNT; s++) {
+        if (pm_entries[s]) {
+            shell_print(shell, "  %s entered %u times", pm_state_to_str(s), pm_entries[s]);
+        }
+    }
+#endif
+    shell_print(shell, "current session periods: see list_sessions");
+    return 0;
+}
+
+static int cmd_power_mode(const struct shell *shell, size_t argc, char **argv)
+{
+    if (argc < 2) {
+        shell_error(shell, "Usage: power_mode <normal|low>");
+        return -EINVAL;
+    }
+    if (strcmp(argv[1], "low") == 0) {
+        power_set_mode(POWER_MODE_LOW);
+    } else if (strcmp(argv[1], "normal") == 0) {
+        power_set_mode(POWER_MODE_NORMAL);
+    } else {
+        shell_error(shell, "Usage: power_mode <normal|low>");
+        return -EINVAL;
+    }
+    shell_print(shell, "Power mode set to %s", argv[1]);
+    return 0;
+}
+
+SHELL_CMD_REGISTER(power, NULL, "Show duty cycle, wakeups and adaptive sampling periods", cmd_power);
+SHELL_CMD_REGISTER(power_mode, NULL, "Select power mode <normal|low>", cmd_power_mode);
@@ -0,0 +1,128 @@
+#include "sample_pool.h"
+#include "sensors.h"
+#include "perf.h"
+#include <zephyr/kernel.h>
+#include <zephyr/shell/shell.h>
+#include <errno.h>
+
+K_MEM_SLAB_DEFINE_STATIC(sample_slab, sizeof(struct sample_rec), SAMPLE_POOL_SIZE, 8);
+// pool_lock guards latest[] and the counters and is never held across I2C.
+// The fetch lock of a sensor is, so a second sink waits for that capture
+// instead of starting its own while other sensors fetch in parallel
+static K_MUTEX_DEFINE(pool_lock);
+static struct k_mutex fetch_lock[NUM_SENSORS];
+
+// Newest record per sensor, holds a reference of its own
+static struct sample_rec *latest[NUM_SENSORS];
+
+static uint32_t captures;
+static uint32_t shared;
+static uint32_t formats;
+static uint32_t alloc_failures;
+static uint32_t peak_used;
+
+void sample_ref(struct sample_rec *rec)
+{
+    atomic_inc(&rec->refs);
+}
+
+void sample_put(struct sample_rec *rec)
+{
+    if (rec && atomic_dec(&rec->refs) == 1) {
+        k_mem_slab_free(&sample_slab, rec);
+    }
+}
+
+int sample_get(int sensor, uint32_t max_age_ms, struct sample_rec **out)
+{
+    struct sample_rec *rec;
+    void *mem;
+    int rc = 0;
+
+    if (sensor < 0 || sensor >= NUM_SENSORS || !out) {
+        return -EINVAL;
+    }
+
+    k_mutex_lock(&fetch_lock[sensor], K_FOREVER);
+
+    k_mutex_lock(&pool_lock, K_FOREVER);
+    rec = latest[sensor];
+    if (rec && max_age_ms && k_uptime_get() - rec->taken_ms <= max_age_ms) {
+        sample_ref(rec);
+        shared++;
+        rc = 1;
+    }
+    k_mutex_unlock(&pool_lock);
+    if (rc == 1) {
+        goto out;
+    }
+
+    if (k_mem_slab_alloc(&sample_slab, &mem, K_NO_WAIT) != 0) {
+        alloc_failures++;
+        rc = -ENOMEM;
+        goto out;
+    }
+    rec = mem;
+    perf_trace(PERF_EV_FETCH_START, sensor, 0, 0);
+    rc = sensor_capture(sensor, &rec->sample);
+    perf_trace(PERF_EV_FETCH_END, sensor, 0, rc);
+    if (rc < 0) {
+        k_mem_slab_free(&sample_slab, mem);
+        goto out;
+    }
+    rec->taken_ms = k_uptime_get();
+    rec->text_len = -1;
+    atomic_set(&rec->refs, 2); // the caller and latest[]
+
+    k_mutex_lock(&pool_lock, K_FOREVER);
+    sample_put(latest[sensor]);
+    latest[sensor] = rec;
+    captures++;
+    peak_used = MAX(peak_used, k_mem_slab_num_used_get(&sample_slab));
+    k_mutex_unlock(&pool_lock);
+
+out:
+    k_mutex_unlock(&fetch_lock[sensor]);
+    *out = (rc < 0) ? NULL : rec;
+    return rc;
+}
+
+int sample_text(struct sample_rec *rec, const char **text)
+{
+    k_mutex_lock(&pool_lock, K_FOREVER);
+    if (rec->text_len < 0) {
+        int rc = sensor_format(&rec->sample, rec->text, sizeof(rec->text));
+        if (rc < 0) {
+            k_mutex_unlock(&pool_lock);
+            return rc;
+        }
+        rec->text_len = rc;
+        formats++;
+    }
+    k_mutex_unlock(&pool_lock);
+
+    *text = rec->text;
+    return rec->text_len;
+}
+
+static int cmd_sample_pool(const struct shell *shell, size_t argc, char **argv)
+{
+    shell_print(shell, "records: %u used, %u free, %u peak of %d (%u bytes each)",
+                k_mem_slab_num_used_get(&sample_slab), k_mem_slab_num_free_get(&sample_slab),
+                peak_used, SAMPLE_POOL_SIZE, (uint32_t)sizeof(struct sample_rec));
+    shell_print(shell, "captures: %u, shared: %u, formatted: %u, pool empty: %u",
+                captures, shared, formats, alloc_failures);
+    return 0;
+}
+
+static int sample_pool_init(void)
+{
+    for (int i = 0; i < NUM_SENSORS; i++) {
+        k_mutex_init(&fetch_lock[i]);
+    }
+    return 0;
+}
+
+SYS_INIT(sample_pool_init, APPLICATION, 0);
+
+SHELL_CMD_REGISTER(sample_pool, NULL, "Show sample record pool usage and sharing", cmd_sample_pool);
@@ -0,0 +1,616 @@
+#include "session.h"
+#include "sensors.h"
+#include "stats.h"
+#include "http_sink.h"
+#include "power.h"
+#include "deadband.h"
+#include "fusion.h"
+#include "sample_pool.h"
+#include "perf.h"
+#include "fs_profile.h"
+#include <zephyr/kernel.h>
+#include <zephyr/shell/shell.h>
+#include <zephyr/fs/fs.h>
+#include <zephyr/settings/settings.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+struct log_session {
+    bool active;
+    uint8_t sensor;
+    uint8_t sink;       // STATS_SINK_FILE or STATS_SINK_HTTP
+    uint32_t period_ms; // current timer period, adaptive sampling changes it
+    struct k_timer timer;
+    struct k_work work;
+    char dest[SESSION_DEST_MAX]; // file path or "host/path"
+    struct power_adapt adapt;
+    struct deadband_ref deadband;
+    struct perf_stamp perf;
+    uint32_t runs;
+    uint32_t shared;    // runs that reused another session's capture
+    uint32_t written;
+    uint32_t errors;
+};
+
+// Global rather than static so it shows up by name in `west build -t ram_report`
+struct log_session sessions[SESSION_MAX];
+BUILD_ASSERT(sizeof(sessions) <= SESSION_RAM_BUDGET,
+             "session table is over its RAM budget, lower SESSION_MAX");
+
+static K_MUTEX_DEFINE(session_lock);
+
+// What is saved per session under "session/<id>": the arguments it was
+// started with, so restoring it is the same call as starting it
+struct session_conf {
+    uint8_t sensor;
+    uint8_t sink;
+    uint32_t period_ms;
+    char target[SESSION_TARGET_MAX];
+};
+
+static atomic_t first_logged;
+
+// Set while fusion runs because an orientation session started it
+static bool fusion_ours;
+
+static void session_timer_callback(struct k_timer *timer)
+{
+    struct log_session *s = CONTAINER_OF(timer, struct log_session, timer);
+    perf_timer_fire(&s->perf, s->period_ms);
+    perf_trace(PERF_EV_TIMER_FIRE, s->sensor, s - sessions, 0);
+    stats_tick(s->sensor, k_work_submit(&s->work));
+}
+
+static int write_file(struct log_session *s, const char *text, size_t len)
+{
+    struct fs_file_t file;
+    fs_file_t_init(&file);
+    fs_profile_lock();
+    int ret = fs_open(&file, s->dest, FS_O_CREATE | FS_O_APPEND);
+    if (ret == 0) {
+        ret = fs_write(&file, text, len);
+        fs_close(&file);
+    }
+    fs_profile_unlock();
+    return ret;
+}
+
+static void session_work_handler(struct k_work *work)
+{
+    struct log_session *s = CONTAINER_OF(work, struct log_session, work);
+    struct sample_rec *rec;
+    const char *text;
+
+    perf_work_start(&s->perf);
+    perf_trace(PERF_EV_WORK_START, s->sensor, s - sessions, 0);
+    stats_work_begin(s->sensor);
+    // A capture another sink took within half our period is shared, not fetched again
+    int ret = sample_get(s->sensor, s->period_ms / 2, &rec);
+    if (ret < 0) {
+        printk("Sensor read failed: %d\n", ret);
+        s->errors++;
+        return;
+    }
+    s->runs++;
+    s->shared += ret;
+    if (ret == 1) {
+        perf_trace(PERF_EV_SHARED, s->sensor, s - sessions, 0);
+    }
+
+    uint32_t period = power_adapt_update(&s->adapt, &rec->sample);
+    // A halt in progress has stopped the timer, it must stay stopped
+    if (period && s->active) {
+        s->period_ms = period;
+        perf_timer_restart(&s->perf);
+        k_timer_start(&s->timer, K_MSEC(period), K_MSEC(period));
+    }
+
+    // Inside the deadband and before the heartbeat: nothing to write
+    if (!deadband_pass(&s->deadband, s->sensor, s->sink, &rec->sample)) {
+        goto out;
+    }
+
+    ret = sample_text(rec, &text);
+    if (ret < 0) {
+        printk("Sensor format failed: %d\n", ret);
+        goto out;
+    }
+
+    if (s->sink == STATS_SINK_HTTP) {
+        struct http_target target;
+        int len = ret;
+        // Checked when the session started, so this only splits the text
+        ret = http_parse_url(s->dest, &target);
+        if (ret == 0) {
+            ret = http_post(&target, text, len);
+        }
+    } else {
+        ret = write_file(s, text, ret);
+    }
+    stats_sink_write(s->sensor, s->sink, ret);
+    perf_trace(PERF_EV_SINK_WRITE, s->sensor, s->sink, CLAMP(ret, INT16_MIN, INT16_MAX));
+    if (ret < 0) {
+        s->errors++;
+    } else {
+        s->written++;
+        if (atomic_cas(&first_logged, 0, 1)) {
+            perf_boot_mark("first sample logged");
+        }
+    }
+
+out:
+    sample_put(rec);
+}
+
+static int parse_dest(enum stats_sink sink, const char *target, char *dest)
+{
+    struct http_target http;
+    int used;
+
+    memset(dest, 0, SESSION_DEST_MAX);
+    if (sink == STATS_SINK_HTTP) {
+        int rc = http_parse_url(target, &http);
+        if (rc < 0) {
+            return rc;
+        }
+        used = snprintf(dest, SESSION_DEST_MAX, "%s", target);
+    } else {
+        used = snprintf(dest, SESSION_DEST_MAX, "/lfs/%s", target);
+    }
+    return (used >= SESSION_DEST_MAX) ? -ENAMETOOLONG : 0;
+}
+
+// Once this returns the handler is not running and will not run again.
+// active goes first so a handler already running does not restart the
+// timer, and the timer is stopped again in case it did before seeing it
+static void halt(struct log_session *s)
+{
+    struct k_work_sync sync;
+
+    s->active = false;
+    k_timer_stop(&s->timer);
+    k_work_cancel_sync(&s->work, &sync);
+    k_timer_stop(&s->timer);
+}
+
+// Time to the first tick. When another session of the sensor runs at a
+// multiple or a divisor of this period, start in phase with it so the two
+// share captures instead of fetching a few ms apart
+static uint32_t first_tick_ms(const struct log_session *s)
+{
+    for (int i = 0; i < SESSION_MAX; i++) {
+        const struct log_session *o = &sessions[i];
+        if (o == s || !o->active || o->sensor != s->sensor) {
+            continue;
+        }
+        if (o->period_ms % s->period_ms == 0 || s->period_ms % o->period_ms == 0) {
+            uint32_t remaining = k_timer_remaining_get((struct k_timer *)&o->timer);
+            return remaining ? remaining : s->period_ms;
+        }
+    }
+    return s->period_ms;
+}
+
+static void conf_key(char *key, size_t len, int id)
+{
+    snprintf(key, len, "session/%d", id);
+}
+
+static void persist(int id, int sensor, enum stats_sink sink, const char *target, uint32_t period_ms)
+{
+    struct session_conf conf = {
+        .sensor = sensor,
+        .sink = sink,
+        .period_ms = period_ms,
+    };
+    char key[16];
+
+    strncpy(conf.target, target, sizeof(conf.target) - 1);
+    conf_key(key, sizeof(key), id);
+    int rc = settings_save_one(key, &conf, sizeof(conf));
+    if (rc < 0) {
+        printk("Session %d not saved: %d\n", id, rc);
+    }
+}
+
+static void forget(int id)
+{
+    char key[16];
+
+    conf_key(key, sizeof(key), id);
+    settings_delete(key);
+}
+
+// The filter a session started stops with the last orientation session.
+// One started with fusion_start is left running
+static void release_source_locked(void)
+{
+    if (!fusion_ours) {
+        return;
+    }
+    for (int i = 0; i < SESSION_MAX; i++) {
+        if (sessions[i].active && sessions[i].sensor == ORIENTATION) {
+            return;
+        }
+    }
+    fusion_ours = false;
+    if (fusion_running()) {
+        fusion_stop();
+    }
+}
+
+static void release_source(void)
+{
+    k_mutex_lock(&session_lock, K_FOREVER);
+    release_source_locked();
+    k_mutex_unlock(&session_lock);
+}
+
+// slot < 0 takes the matching session or the first free one. Sessions
+// restored at boot keep their slot and take their first sample right away
+static int start_session(int slot, int sensor, enum stats_sink sink, const char *target,
+                         uint32_t period_ms, bool boot)
+{
+    char dest[SESSION_DEST_MAX];
+    struct log_session *s = NULL;
+
+    if (sensor < 0 || sensor >= NUM_SENSORS || period_ms == 0 || !target) {
+        return -EINVAL;
+    }
+    if ((sink != STATS_SINK_FILE && sink != STATS_SINK_HTTP) || slot >= SESSION_MAX) {
+        return -EINVAL;
+    }
+    if (strlen(target) >= SESSION_TARGET_MAX) {
+        return -ENAMETOOLONG;
+    }
+    // Everything that can reject the request is checked before a session
+    // it replaces is halted, a bad target leaves the old one running
+    int rc = parse_dest(sink, target, dest);
+    if (rc < 0) {
+        return rc;
+    }
+
+    k_mutex_lock(&session_lock, K_FOREVER);
+    if (slot >= 0) {
+        if (sessions[slot].active) {
+            halt(&sessions[slot]);
+        }
+        s = &sessions[slot];
+    }
+    // Same sensor, sink and destination: restart that session with the new rate
+    for (int i = 0; i < SESSION_MAX && !s; i++) {
+        struct log_session *o = &sessions[i];
+        if (o->active && o->sensor == sensor && o->sink == sink &&
+            memcmp(o->dest, dest, sizeof(dest)) == 0) {
+            halt(o);
+            s = o;
+        }
+    }
+    for (int i = 0; i < SESSION_MAX && !s; i++) {
+        if (!sessions[i].active) {
+            s = &sessions[i];
+        }
+    }
+    if (!s) {
+        release_source_locked();
+        k_mutex_unlock(&session_lock);
+        return -ENOMEM;
+    }
+
+    s->sensor = sensor;
+    s->sink = sink;
+    memcpy(s->dest, dest, sizeof(s->dest));
+    s->period_ms = period_ms;
+    s->runs = s->shared = s->written = s->errors = 0;
+    power_adapt_start(&s->adapt, period_ms);
+    deadband_restart(&s->deadband);
+    perf_timer_restart(&s->perf);
+    k_timer_init(&s->timer, session_timer_callback, NULL);
+    k_work_init(&s->work, session_work_handler);
+    uint32_t first = first_tick_ms(s);
+    if (boot && first == period_ms) {
+        first = 0; // nothing to line up with, sample now
+    }
+    s->active = true; // before the first tick, the handler checks it
+    k_timer_start(&s->timer, K_MSEC(first), K_MSEC(period_ms));
+    if (!boot) {
+        persist(s - sessions, sensor, sink, target, period_ms);
+    }
+    // The slot may have held the last orientation session
+    release_source_locked();
+    k_mutex_unlock(&session_lock);
+    return s - sessions;
+}
+
+int session_start(int sensor, enum stats_sink sink, const char *target, uint32_t period_ms)
+{
+    return start_session(-1, sensor, sink, target, period_ms, false);
+}
+
+int session_stop_id(int id)
+{
+    if (id < 0 || id >= SESSION_MAX) {
+        return -EINVAL;
+    }
+    k_mutex_lock(&session_lock, K_FOREVER);
+    bool active = sessions[id].active;
+    if (active) {
+        halt(&sessions[id]);
+        forget(id);
+        release_source_locked();
+    }
+    k_mutex_unlock(&session_lock);
+    return active ? 0 : -ENOENT;
+}
+
+int session_active(void)
+{
+    int active = 0;
+
+    k_mutex_lock(&session_lock, K_FOREVER);
+    for (int i = 0; i < SESSION_MAX; i++) {
+        active += sessions[i].active;
+    }
+    k_mutex_unlock(&session_lock);
+    return active;
+}
+
+int session_stop(int sensor, enum stats_sink sink)
+{
+    int stopped = 0;
+
+    k_mutex_lock(&session_lock, K_FOREVER);
+    for (int i = 0; i < SESSION_MAX; i++) {
+        if (sessions[i].active && sessions[i].sensor == sensor && sessions[i].sink == sink) {
+            halt(&sessions[i]);
+            forget(i);
+            stopped++;
+        }
+    }
+    release_source_locked();
+    k_mutex_unlock(&session_lock);
+    return stopped ? stopped : -ENOENT;
+}
+
+// Sink period: whole seconds as before ("5"), fractions of a second ("0.05")
+// or milliseconds ("20ms"). Returns 0 for anything else
+static uint32_t parse_period_ms(const char *str)
+{
+    char *end;
+    unsigned long ms = strtoul(str, &end, 10);
+
+    if (end == str && *end != '.') {
+        return 0;
+    }
+    if (strcmp(end, "ms") == 0) {
+        return ms;
+    }
+    ms *= MSEC_PER_SEC;
+    if (*end == '.') {
+        unsigned long scale = MSEC_PER_SEC / 10;
+        for (end++; *end >= '0' && *end <= '9'; end++) {
+            ms += (*end - '0') * scale;
+            scale /= 10;
+        }
+    }
+    return (*end == '\0') ? ms : 0;
+}
+
+// Orientation sessions start the filter if nobody else has
+static int ensure_source(int sensor_index)
+{
+    if (sensor_index != ORIENTATION || fusion_running()) {
+        return 0;
+    }
+    int rc = fusion_start(FUSION_DEFAULT_HZ);
+    if (rc == 0) {
+        k_mutex_lock(&session_lock, K_FOREVER);
+        fusion_ours = true;
+        k_mutex_unlock(&session_lock);
+    }
+    return rc;
+}
+
+static int restore_one(const char *key, size_t len, settings_read_cb read_cb, void *cb_arg,
+                       void *param)
+{
+    struct session_conf conf;
+    int *restored = param;
+    char *end;
+    long id = strtol(key, &end, 10);
+
+    if (end == key || id < 0 || id >= SESSION_MAX || len != sizeof(conf) ||
+        read_cb(cb_arg, &conf, sizeof(conf)) != sizeof(conf)) {
+        char full[32];
+        snprintf(full, sizeof(full), "session/%s", key);
+        printk("Dropping saved session %s\n", key);
+        settings_delete(full);
+        return 0;
+    }
+    conf.target[sizeof(conf.target) - 1] = '\0';
+    if (ensure_source(conf.sensor) < 0) {
+        printk("Session %ld: %s source not started\n", id, get_sensor_name(conf.sensor));
+    }
+    int rc = start_session(id, conf.sensor, conf.sink, conf.target, conf.period_ms, true);
+    if (rc < 0) {
+        release_source();
+        printk("Session %ld not restored: %d\n", id, rc);
+    } else {
+        printk("Session %ld restored: %s every %u ms\n", id, get_sensor_name(conf.sensor),
+               conf.period_ms);
+        (*restored)++;
+    }
+    return 0;
+}
+
+int session_restore(void)
+{
+    int restored = 0;
+
+    int rc = settings_load_subtree_direct("session", restore_one, &restored);
+    return (rc < 0) ? rc : restored;
+}
+
+static int start_cmd(const struct shell *shell, size_t argc, char **argv, enum stats_sink sink)
+{
+    const char *usage = (sink == STATS_SINK_HTTP)
+        ? "Usage: sensor_timer_http_start <sensor_name> <url> <seconds|N.NNN|Nms>"
+        : "Usage: sensor_timer_start <sensor_name> <file_name> <seconds|N.NNN|Nms>";
+
+    if (argc < 4) {
+        shell_error(shell, "%s", usage);
+        return -EINVAL;
+    }
+    int sensor_index = get_sensor_index(argv[1]);
+    uint32_t period_ms = parse_period_ms(argv[3]);
+    if (sensor_index < 0 || period_ms == 0) {
+        shell_error(shell, "%s", usage);
+        return -EINVAL;
+    }
+
+    int src = ensure_source(sensor_index);
+    if (src < 0) {
+        shell_warn(shell, "Fusion not started (err %d), see fusion_start", src);
+    }
+    int rc = session_start(sensor_index, sink, argv[2], period_ms);
+    if (rc < 0) {
+        release_source();
+    }
+    if (rc == -ENOMEM) {
+        shell_error(shell, "All %d sessions are in use, see list_sessions", SESSION_MAX);
+    } else if (rc < 0) {
+        shell_error(shell, "Bad %s: %s (err %d)", sink == STATS_SINK_HTTP ? "URL" : "file name",
+                    argv[2], rc);
+    } else {
+        shell_print(shell, "Session %d: %s every %u ms", rc, argv[1], period_ms);
+        rc = 0;
+    }
+    return rc;
+}
+
+static int stop_cmd(const struct shell *shell, size_t argc, char **argv, enum stats_sink sink)
+{
+    if (argc < 2 || get_sensor_index(argv[1]) < 0) {
+        shell_error(shell, "Usage: %s <sensor_name>", argv[0]);
+        return -EINVAL;
+    }
+    int stopped = session_stop(get_sensor_index(argv[1]), sink);
+    if (stopped < 0) {
+        shell_warn(shell, "No timer running for %s", argv[1]);
+    } else {
+        shell_print(shell, "Stopped %d timer(s) for %s", stopped, argv[1]);
+    }
+    return 0;
+}
+
+static int cmd_list_sessions(const struct shell *shell, size_t argc, char **argv)
+{
+    int active = 0;
+
+    k_mutex_lock(&session_lock, K_FOREVER);
+    shell_print(shell, "%-3s %-11s %-5s %9s %9s %7s %7s %7s %5s  %s", "id", "sensor", "sink",
+                "period", "requested", "runs", "shared", "written", "err", "target");
+    for (int i = 0; i < SESSION_MAX; i++) {
+        struct log_session *s = &sessions[i];
+        if (!s->active) {
+            continue;
+        }
+        active++;
+        shell_print(shell, "%-3d %-11s %-5s %7u ms %6u ms %7u %7u %7u %5u  %s", i,
+                    get_sensor_name(s->sensor), s->sink == STATS_SINK_HTTP ? "http" : "file",
+                    s->period_ms, s->adapt.base_ms, s->runs, s->shared, s->written, s->errors,
+                    s->dest);
+    }
+    k_mutex_unlock(&session_lock);
+    shell_print(shell, "%d of %d sessions in use", active, SESSION_MAX);
+    return 0;
+}
+
+static int cmd_stop_session(const struct shell *shell, size_t argc, char **argv)
+{
+    char *end;
+
+    if (argc < 2) {
+        shell_error(shell, "Usage: stop_session <id>");
+        return -EINVAL;
+    }
+    long id = strtol(argv[1], &end, 10);
+    if (*end != '\0' || session_stop_id(id) < 0) {
+        shell_error(shell, "No session %s, see list_sessions", argv[1]);
+        return -ENOENT;
+    }
+    shell_print(shell, "Stopped session %ld", id);
+    return 0;
+}
+
+static int cmd_sensor_timer_start(const struct shell *shell, size_t argc, char **argv)
+{
+    return start_cmd(shell, argc, argv, STATS_SINK_FILE);
+}
+
+static int cmd_sensor_timer_stop(const struct shell *shell, size_t argc, char **argv)
+{
+    return stop_cmd(shell, argc, argv, STATS_SINK_FILE);
+}
+
+static int cmd_sensor_timer_http_start(const struct shell *shell, size_t argc, char **argv)
+{
+    return start_cmd(shell, argc, argv, STATS_SINK_HTTP);
+}
+
+static int cmd_sensor_timer_http_stop(const struct shell *shell, size_t argc, char **argv)
+{
+    return stop_cmd(shell, argc, argv, STATS_SINK_HTTP);
+}
+
+// What the periodic logging path costs in RAM, per session and per sink
+static int cmd_session_ram(const struct shell *shell, size_t argc, char **argv)
+{
+    static const struct {
+        enum stats_sink sink;
+        const char *name;
+    } sinks[] = {
+        { STATS_SINK_FILE, "file" },
+        { STATS_SINK_HTTP, "http" },
+    };
+    int active = 0;
+
+    k_mutex_lock(&session_lock, K_FOREVER);
+    for (int i = 0; i < SESSION_MAX; i++) {
+        active += sessions[i].active;
+    }
+    shell_print(shell, "session table: %d slots x %u bytes = %u bytes (budget %d), %d active",
+                SESSION_MAX, (uint32_t)sizeof(struct log_session), (uint32_t)sizeof(sessions),
+                SESSION_RAM_BUDGET, active);
+    shell_print(shell, "  per session: timer %u, work %u, destination %u, adaptive %u, deadband %u bytes",
+                (uint32_t)sizeof(struct k_timer), (uint32_t)sizeof(struct k_work),
+                (uint32_t)SESSION_DEST_MAX, (uint32_t)sizeof(struct power_adapt),
+                (uint32_t)sizeof(struct deadband_ref));
+
+    for (int k = 0; k < ARRAY_SIZE(sinks); k++) {
+        int n = 0;
+        for (int i = 0; i < SESSION_MAX; i++) {
+            n += sessions[i].active && sessions[i].sink == sinks[k].sink;
+        }
+        shell_print(shell, "  %s: %d active, %u bytes in use", sinks[k].name, n,
+                    (uint32_t)(n * sizeof(struct log_session)));
+    }
+    k_mutex_unlock(&session_lock);
+
+    shell_print(shell, "sample pool: %d records x %u bytes = %u bytes",
+                SAMPLE_POOL_SIZE, (uint32_t)sizeof(struct sample_rec),
+                (uint32_t)(SAMPLE_POOL_SIZE * sizeof(struct sample_rec)));
+    return 0;
+}
+
+SHELL_CMD_REGISTER(sensor_timer_start, NULL, "Start sensor timer", cmd_sensor_timer_start);
+SHELL_CMD_REGISTER(sensor_timer_stop, NULL, "Stop sensor timer", cmd_sensor_timer_stop);
+
+SHELL_CMD_REGISTER(sensor_timer_http_start, NULL, "Start sensor HTTP timer", cmd_sensor_timer_http_start);
+SHELL_CMD_REGISTER(sensor_timer_http_stop, NULL, "Stop sensor HTTP timer", cmd_sensor_timer_http_stop);
+
+SHELL_CMD_REGISTER(list_sessions, NULL, "List logging sessions with their rates and counters", cmd_list_sessions);
+SHELL_CMD_REGISTER(stop_session, NULL, "Stop one logging session <id>", cmd_stop_session);
+SHELL_CMD_REGISTER(session_ram, NULL, "Show RAM used by logging sessions per session and sink", cmd_session_ram);
@@ -0,0 +1,278 @@
+#include "stats.h"
+#include "sensors.h"
+#include <zephyr/kernel.h>
+#include <zephyr/sys/atomic.h>
+#include <zephyr/shell/shell.h>
+#include <errno.h>
+#include <string.h>
+
+struct sensor_stats {
+    // Touched from the timer ISR
+    atomic_t ticks;
+    atomic_t coalesced; // tick arrived while the previous work item was still queued
+    atomic_t dropped;   // k_work_submit() refused the item
+
+    // Under stats_lock: fetches and sink writes come from the work queue, the
+    // shell, the fusion and gesture threads and the event bus sinks, which
+    // preempt each other, and lat_sum cannot be read in one access
+    uint32_t samples;
+    uint32_t fetch_errors;
+    uint32_t i2c_errors;
+    uint32_t lat_min;
+    uint32_t lat_max;
+    uint64_t lat_sum;
+    uint32_t lat_hist[STATS_LAT_BUCKETS];
+    uint32_t sink_bytes[STATS_NUM_SINKS];
+    uint32_t sink_errors[STATS_NUM_SINKS];
+};
+
+static struct sensor_stats stats[NUM_SENSORS];
+static struct k_spinlock stats_lock;
+static atomic_t backlog;
+static atomic_t backlog_max;
+static int64_t reset_ms;
+
+static const char *const sink_names[STATS_NUM_SINKS] = {
+    "file",
+    "http",
+    "interrupt"
+};
+
+static inline bool valid_sensor(int sensor)
+{
+    return sensor >= 0 && sensor < NUM_SENSORS;
+}
+
+void stats_tick(int sensor, int submit_ret)
+{
+    if (!valid_sensor(sensor)) {
+        return;
+    }
+    struct sensor_stats *s = &stats[sensor];
+
+    atomic_inc(&s->ticks);
+    if (submit_ret < 0) {
+        atomic_inc(&s->dropped);
+    } else if (submit_ret == 0) {
+        atomic_inc(&s->coalesced);
+    } else {
+        atomic_val_t depth = atomic_inc(&backlog) + 1;
+        atomic_val_t max = atomic_get(&backlog_max);
+        while (depth > max && !atomic_cas(&backlog_max, max, depth)) {
+            max = atomic_get(&backlog_max);
+        }
+    }
+}
+
+void stats_work_begin(int sensor)
+{
+    ARG_UNUSED(sensor);
+    if (atomic_get(&backlog) > 0) {
+        atomic_dec(&backlog);
+    }
+}
+
+void stats_fetch(int sensor, uint32_t start_cycles, int rc)
+{
+    if (!valid_sensor(sensor)) {
+        return;
+    }
+    struct sensor_stats *s = &stats[sensor];
+    k_spinlock_key_t key;
+
+    if (rc < 0) {
+        key = k_spin_lock(&stats_lock);
+        s->fetch_errors++;
+        if (rc == -EIO) {
+            s->i2c_errors++;
+        }
+        k_spin_unlock(&stats_lock, key);
+        return;
+    }
+
+    uint32_t cycles = stats_now() - start_cycles;
+    uint32_t us = stats_cyc_to_us(cycles);
+    int bucket = (us == 0) ? 0 : 32 - __builtin_clz(us);
+    if (bucket >= STATS_LAT_BUCKETS) {
+        bucket = STATS_LAT_BUCKETS - 1;
+    }
+
+    key = k_spin_lock(&stats_lock);
+    if (s->samples == 0 || cycles < s->lat_min) {
+        s->lat_min = cycles;
+    }
+    if (cycles > s->lat_max) {
+        s->lat_max = cycles;
+    }
+    s->lat_sum += cycles;
+    s->lat_hist[bucket]++;
+    s->samples++;
+    k_spin_unlock(&stats_lock, key);
+}
+
+void stats_i2c_error(int sensor)
+{
+    if (valid_sensor(sensor)) {
+        k_spinlock_key_t key = k_spin_lock(&stats_lock);
+        stats[sensor].i2c_errors++;
+        k_spin_unlock(&stats_lock, key);
+    }
+}
+
+void stats_sink_write(int sensor, enum stats_sink sink, int rc)
+{
+    if (!valid_sensor(sensor) || sink >= STATS_NUM_SINKS) {
+        return;
+    }
+    k_spinlock_key_t key = k_spin_lock(&stats_lock);
+    if (rc < 0) {
+        stats[sensor].sink_errors[sink]++;
+    } else {
+        stats[sensor].sink_bytes[sink] += rc;
+    }
+    k_spin_unlock(&stats_lock, key);
+}
+
+// Consistent copy of one sensor's counters for printing
+static void stats_snapshot(int sensor, struct sensor_stats *out)
+{
+    k_spinlock_key_t key = k_spin_lock(&stats_lock);
+    *out = stats[sensor];
+    k_spin_unlock(&stats_lock, key);
+}
+
+void stats_reset(void)
+{
+    k_spinlock_key_t key = k_spin_lock(&stats_lock);
+    memset(stats, 0, sizeof(stats));
+    k_spin_unlock(&stats_lock, key);
+    atomic_set(&backlog_max, atomic_get(&backlog));
+    reset_ms = k_uptime_get();
+}
+
+uint32_t stats_total_ticks(void)
+{
+    uint32_t total = 0;
+    for (int i = 0; i < NUM_SENSORS; i++) {
+        total += atomic_get(&stats[i].ticks);
+    }
+    return total;
+}
+
+uint64_t stats_total_fetch_us(void)
+{
+    uint64_t total = 0;
+    k_spinlock_key_t key = k_spin_lock(&stats_lock);
+    for (int i = 0; i < NUM_SENSORS; i++) {
+        total += stats[i].lat_sum;
+    }
+    k_spin_unlock(&stats_lock, key);
+    return stats_cyc_to_us64(total);
+}
+
+int64_t stats_window_ms(void)
+{
+    return k_uptime_get() - reset_ms;
+}
+
+static uint32_t lat_avg_us(const struct sensor_stats *s)
+{
+    if (s->samples == 0) {
+        return 0;
+    }
+    return stats_cyc_to_us((uint32_t)(s->lat_sum / s->samples));
+}
+
+// Human readable summary
+static int cmd_stats(const struct shell *shell, size_t argc, char **argv)
+{
+    shell_print(shell, "%-8s %8s %6s %6s %8s %6s %6s %8s %8s %8s",
+                "sensor", "samples", "err", "i2c", "ticks", "coal", "drop",
+                "min_us", "avg_us", "max_us");
+    for (int i = 0; i < NUM_SENSORS; i++) {
+        struct sensor_stats snap, *s = &snap;
+        stats_snapshot(i, s);
+        shell_print(shell, "%-8s %8u %6u %6u %8u %6u %6u %8u %8u %8u",
+                    get_sensor_name(i), s->samples, s->fetch_errors, s->i2c_errors,
+                    (uint32_t)atomic_get(&s->ticks), (uint32_t)atomic_get(&s->coalesced),
+                    (uint32_t)atomic_get(&s->dropped),
+                    stats_cyc_to_us(s->lat_min), lat_avg_us(s),
+                    stats_cyc_to_us(s->lat_max));
+    }
+
+    shell_print(shell, "");
+    shell_print(shell, "%-8s %-10s %10s %6s", "sensor", "sink", "bytes", "err");
+    for (int i = 0; i < NUM_SENSORS; i++) {
+        struct sensor_stats s;
+        stats_snapshot(i, &s);
+        for (int k = 0; k < STATS_NUM_SINKS; k++) {
+            if (s.sink_bytes[k] == 0 && s.sink_errors[k] == 0) {
+                continue;
+            }
+            shell_print(shell, "%-8s %-10s %10u %6u", get_sensor_name(i), sink_names[k],
+                        s.sink_bytes[k], s.sink_errors[k]);
+        }
+    }
+
+    shell_print(shell, "");
+    shell_print(shell, "work queue backlog: %d (max %d)",
+                (int)atomic_get(&backlog), (int)atomic_get(&backlog_max));
+    return 0;
+}
+
+// One JSON object per line so the host can parse it without scraping
+static int cmd_stats_dump(const struct shell *shell, size_t argc, char **argv)
+{
+    for (int i = 0; i < NUM_SENSORS; i++) {
+        struct sensor_stats snap, *s = &snap;
+        char hist[STATS_LAT_BUCKETS * 11];
+        int used = 0;
+
+        stats_snapshot(i, s);
+        for (int b = 0; b < STATS_LAT_BUCKETS && used < (int)sizeof(hist); b++) {
+            used += snprintf(hist + used, sizeof(hist) - used, "%s%u",
+                             b ? "," : "", s->lat_hist[b]);
+        }
+
+        shell_print(shell,
+                    "{\"sensor\":\"%s\",\"samples\":%u,\"fetch_err\":%u,\"i2c_err\":%u,"
+                    "\"ticks\":%u,\"coalesced\":%u,\"dropped\":%u,"
+                    "\"lat_us\":[%u,%u,%u],\"lat_hist\":[%s],"
+                    "\"bytes\":[%u,%u,%u],\"sink_err\":[%u,%u,%u]}",
+                    get_sensor_name(i), s->samples, s->fetch_errors, s->i2c_errors,
+                    (uint32_t)atomic_get(&s->ticks), (uint32_t)atomic_get(&s->coalesced),
+                    (uint32_t)atomic_get(&s->dropped),
+                    stats_cyc_to_us(s->lat_min), lat_avg_us(s),
+                    stats_cyc_to_us(s->lat_max), hist,
+                    s->sink_bytes[STATS_SINK_FILE], s->sink_bytes[STATS_SINK_HTTP],
+                    s->sink_bytes[STATS_SINK_INTERRUPT],
+                    s->sink_errors[STATS_SINK_FILE], s->sink_errors[STATS_SINK_HTTP],
+                    s->sink_errors[STATS_SINK_INTERRUPT]);
+    }
+    shell_print(shell, "{\"backlog\":%d,\"backlog_max\":%d}",
+                (int)atomic_get(&backlog), (int)atomic_get(&backlog_max));
+    return 0;
+}
+
+static int cmd_stats_reset(const struct shell *shell, size_t argc, char **argv)
+{
+    stats_reset();
+    shell_print(shell, "Pipeline statistics cleared");
+    return 0;
+}
+
+#ifdef CONFIG_TIMING_FUNCTIONS
+// stats_now() reads the cycle counter the timing functions start
+static int stats_init(void)
+{
+    timing_init();
+    timing_start();
+    return 0;
+}
+
+SYS_INIT(stats_init, APPLICATION, 0);
+#endif
+
+SHELL_CMD_REGISTER(stats, NULL, "Show sampling pipeline statistics", cmd_stats);
+SHELL_CMD_REGISTER(stats_dump, NULL, "Dump pipeline statistics as JSON lines", cmd_stats_dump);
+SHELL_CMD_REGISTER(stats_reset, NULL, "Clear pipeline statistics", cmd_stats_reset);
@@ -0,0 +1,277 @@
+#include "step_log.h"
+#include "sensors.h"
+#include "stats.h"
+#include "http_sink.h"
+#include "lsm6dsl_ctx.h"
+#include "fs_profile.h"
+#include <zephyr/kernel.h>
+#include <zephyr/fs/fs.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+
+// A batch goes out when the FIFO holds a full one (INT1) or on the drain
+// timer. The timer also keeps every FIFO timestamp far younger than the
+// ~419 s the sensor clock wraps at
+#define STEP_BATCH LSM6DSL_STEP_FIFO_STEPS
+#define STEP_DRAIN_MS 10000
+#define STEP_LINE_MAX 40
+
+struct step_record {
+    uint32_t hw_ms;
+    uint16_t steps;
+    uint16_t delta;
+};
+
+static void step_read_handler(struct k_work *work);
+static void step_drain_handler(struct k_work *work);
+
+static K_WORK_DEFINE(step_read_work, step_read_handler);
+static K_WORK_DELAYABLE_DEFINE(step_drain_work, step_drain_handler);
+// step_lock guards the session and the batch, write_lock the text while it
+// goes out. Always write_lock first
+static K_MUTEX_DEFINE(step_lock);
+static K_MUTEX_DEFINE(write_lock);
+
+static volatile bool running;
+static enum step_sink sink;
+static char target[128];
+
+static uint16_t base_steps;
+static uint16_t last_steps;
+
+// Sensor clock since the session started, in LSM6DSL_TS_US, and the raw
+// reading and uptime it was last brought up to date at
+static uint64_t hw_now;
+static uint32_t hw_raw;
+static int64_t hw_uptime_ms;
+
+static struct step_record batch[STEP_BATCH];
+static int batched;
+static uint32_t logged;
+static int16_t words[STEP_BATCH * LSM6DSL_STEP_WORDS];
+
+static enum step_sink out_sink;
+static char out_target[sizeof(target)];
+static char text[STEP_BATCH * STEP_LINE_MAX];
+static char req[sizeof(text) + 256];
+
+static int write_batch(const char *body, size_t len)
+{
+    if (out_sink == STEP_SINK_HTTP) {
+        struct http_target http;
+        int ret = http_parse_url(out_target, &http);
+        if (ret == 0) {
+            ret = http_build_post(req, sizeof(req), &http, body, len);
+        }
+        if (ret > 0) {
+            ret = http_send(&http, req, ret);
+        }
+        return ret;
+    }
+
+    char path[sizeof(out_target) + 8];
+    struct fs_file_t file;
+
+    snprintf(path, sizeof(path), "/lfs/%s", out_target);
+    fs_file_t_init(&file);
+    fs_profile_lock();
+    int ret = fs_open(&file, path, FS_O_CREATE | FS_O_APPEND | FS_O_WRITE);
+    if (ret == 0) {
+        ret = fs_write(&file, body, len);
+        fs_close(&file);
+    }
+    fs_profile_unlock();
+    return ret;
+}
+
+// The batch is taken under step_lock and written without it, so starting,
+// stopping and the next drain never wait for a slow upload
+static void flush(void)
+{
+    size_t used = 0;
+
+    k_mutex_lock(&write_lock, K_FOREVER);
+    k_mutex_lock(&step_lock, K_FOREVER);
+    for (int i = 0; i < batched; i++) {
+        used += snprintf(text + used, sizeof(text) - used, "step,%u,%u,%u\n",
+                         batch[i].hw_ms, batch[i].steps, batch[i].delta);
+    }
+    batched = 0;
+    out_sink = sink;
+    strcpy(out_target, target);
+    k_mutex_unlock(&step_lock);
+
+    if (used > 0) {
+        stats_sink_write(LSM6DSL, STATS_SINK_INTERRUPT, write_batch(text, used));
+    }
+    k_mutex_unlock(&write_lock);
+}
+
+// Brings hw_now up to the sensor clock. The uptime since the last call says
+// how many wraps the raw difference is missing, however long steps paused
+static int clock_sync_locked(void)
+{
+    uint32_t raw;
+    int ret = lsm6dsl_read_timestamp(&lsm6dsl_ctx, &raw);
+    if (ret < 0) {
+        return ret;
+    }
+    int64_t now_ms = k_uptime_get();
+    uint64_t ticks = (raw - hw_raw) & (LSM6DSL_TS_WRAP - 1);
+    uint64_t elapsed = (uint64_t)(now_ms - hw_uptime_ms) * 1000 / LSM6DSL_TS_US;
+
+    if (elapsed > ticks) {
+        ticks += (elapsed - ticks + LSM6DSL_TS_WRAP / 2) / LSM6DSL_TS_WRAP * LSM6DSL_TS_WRAP;
+    }
+    hw_now += ticks;
+    hw_raw = raw;
+    hw_uptime_ms = now_ms;
+    return 0;
+}
+
+// Moves whole patterns from the FIFO into the batch, as many as it has room
+// for. Returns the number of steps still in the FIFO or a negative errno
+static int drain_locked(void)
+{
+    uint16_t level;
+    uint16_t pattern;
+    bool overrun;
+
+    int ret = lsm6dsl_fifo_level(&lsm6dsl_ctx, &level, &overrun);
+    if (ret == 0) {
+        ret = lsm6dsl_fifo_pattern(&lsm6dsl_ctx, &pattern);
+    }
+    // After an overrun the FIFO can start in the middle of a pattern
+    if (ret == 0 && pattern != 0 && level >= LSM6DSL_STEP_WORDS - pattern) {
+        ret = lsm6dsl_fifo_read(&lsm6dsl_ctx, words, LSM6DSL_STEP_WORDS - pattern);
+        level -= LSM6DSL_STEP_WORDS - pattern;
+    }
+    if (ret < 0) {
+        return ret;
+    }
+
+    int waiting = level / LSM6DSL_STEP_WORDS;
+    int n = MIN(waiting, STEP_BATCH - batched);
+    if (n > 0) {
+        ret = lsm6dsl_fifo_read(&lsm6dsl_ctx, words, n * LSM6DSL_STEP_WORDS);
+    }
+    // Read after the FIFO, so every step in it is older than hw_now
+    if (ret == 0) {
+        ret = clock_sync_locked();
+    }
+    if (ret < 0) {
+        return ret;
+    }
+
+    for (int i = 0; i < n; i++) {
+        uint16_t steps;
+        uint32_t ts;
+
+        lsm6dsl_step_decode(&words[i * LSM6DSL_STEP_WORDS], &steps, &ts);
+        // Steps from before the session's baseline count for nothing
+        int16_t delta = steps - last_steps;
+        if (delta <= 0) {
+            continue;
+        }
+        last_steps = steps;
+        logged += delta;
+
+        uint64_t age = (hw_raw - ts) & (LSM6DSL_TS_WRAP - 1);
+        struct step_record *rec = &batch[batched++];
+        rec->hw_ms = (uint32_t)((hw_now - MIN(age, hw_now)) * LSM6DSL_TS_US / 1000);
+        rec->steps = steps - base_steps;
+        rec->delta = delta;
+    }
+    return waiting - n;
+}
+
+// Empties the FIFO, writing every batch that fills up on the way
+static int drain_all(void)
+{
+    int left;
+
+    do {
+        k_mutex_lock(&step_lock, K_FOREVER);
+        left = drain_locked();
+        bool full = (batched == STEP_BATCH);
+        k_mutex_unlock(&step_lock);
+        if (full) {
+            flush();
+        }
+    } while (left > 0);
+    return left;
+}
+
+// INT1 at the watermark: one wakeup per STEP_BATCH steps
+static void step_read_handler(struct k_work *work)
+{
+    stats_work_begin(LSM6DSL);
+    if (running && drain_all() < 0) {
+        stats_sink_write(LSM6DSL, STATS_SINK_INTERRUPT, -EIO);
+    }
+}
+
+static void step_drain_handler(struct k_work *work)
+{
+    step_read_handler(NULL);
+    flush();
+    if (running) {
+        k_work_schedule(&step_drain_work, K_MSEC(STEP_DRAIN_MS));
+    }
+}
+
+int step_log_start(enum step_sink new_sink, const char *new_target)
+{
+    uint16_t steps;
+    uint32_t raw;
+
+    if (strlen(new_target) >= sizeof(target)) {
+        return -ENAMETOOLONG;
+    }
+    // Counter and clock keep running across sessions, take a baseline
+    int ret = lsm6dsl_read_step_count(&lsm6dsl_ctx, &steps);
+    if (ret == 0) {
+        ret = lsm6dsl_read_timestamp(&lsm6dsl_ctx, &raw);
+    }
+    if (ret < 0) {
+        return ret;
+    }
+
+    flush();
+    k_mutex_lock(&step_lock, K_FOREVER);
+    sink = new_sink;
+    strcpy(target, new_target);
+    base_steps = steps;
+    last_steps = steps;
+    hw_now = 0;
+    hw_raw = raw;
+    hw_uptime_ms = k_uptime_get();
+    logged = 0;
+    running = true;
+    k_mutex_unlock(&step_lock);
+
+    k_work_schedule(&step_drain_work, K_MSEC(STEP_DRAIN_MS));
+    return 0;
+}
+
+uint32_t step_log_stop(void)
+{
+    struct k_work_sync sync;
+
+    running = false;
+    k_work_cancel_delayable_sync(&step_drain_work, &sync);
+    k_work_cancel_sync(&step_read_work, &sync);
+
+    // Steps short of a full batch are still in the FIFO
+    drain_all();
+    flush();
+    return logged;
+}
+
+void step_log_int1(void)
+{
+    if (running) {
+        stats_tick(LSM6DSL, k_work_submit(&step_read_work));
+    }
+}
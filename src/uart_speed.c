@@ -0,0 +1,187 @@
+// Shell UART rate. The board boots at UART_DEFAULT_BAUD so any terminal can
+// open it. A host that can go faster asks with `uart_baud <rate>`: the reply
+// and prompt still leave at the old rate, then the UART switches and waits for
+// `uart_baud_confirm` at the new one. Without it the board goes back to the
+// last confirmed rate, so a host that could not follow never loses the shell.
+// flaskr/boards.py does this on connect.
+#include <zephyr/kernel.h>
+#include <zephyr/device.h>
+#include <zephyr/drivers/uart.h>
+#include <zephyr/shell/shell.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#ifdef CONFIG_SOC_FAMILY_STM32
+#include <stm32_ll_usart.h>
+#endif
+
+#define UART_DEFAULT_BAUD 115200
+#define UART_SWITCH_DELAY_MS 20 // longer than the reply and prompt take at 115200
+#define UART_CONFIRM_MS 2000
+#define UART_DRAIN_MS 50        // a full 256-byte shell write at 115200 takes 22
+#define UART_FLOOD_LINE 64
+
+static const struct device *const shell_uart = DEVICE_DT_GET(DT_CHOSEN(zephyr_shell_uart));
+
+// What the ST-LINK virtual COM port and USART1 at 80 MHz both handle
+static const uint32_t rates[] = { 115200, 230400, 460800, 921600, 1000000, 2000000 };
+
+static void switch_handler(struct k_work *work);
+static void revert_handler(struct k_work *work);
+
+static K_WORK_DELAYABLE_DEFINE(switch_work, switch_handler);
+static K_WORK_DELAYABLE_DEFINE(revert_work, revert_handler);
+static K_MUTEX_DEFINE(speed_lock);
+
+static uint32_t confirmed = UART_DEFAULT_BAUD;
+static uint32_t pending; // 0 when no switch is waiting for its confirmation
+
+static int set_baud(uint32_t baud)
+{
+    struct uart_config cfg;
+    int rc = uart_config_get(shell_uart, &cfg);
+
+    if (rc == 0) {
+        cfg.baudrate = baud;
+        rc = uart_configure(shell_uart, &cfg);
+    }
+    return rc;
+}
+
+// uart_configure() disables the USART straight away, so a transfer still
+// running (a log line, the tail of the prompt) would be cut off. Waits until
+// the DMA has stopped feeding the USART and the last frame has left
+static void drain_tx(void)
+{
+#ifdef CONFIG_SOC_FAMILY_STM32
+    USART_TypeDef *usart = (USART_TypeDef *)DT_REG_ADDR(DT_CHOSEN(zephyr_shell_uart));
+    int64_t end = k_uptime_get() + UART_DRAIN_MS;
+
+    while ((LL_USART_IsEnabledDMAReq_TX(usart) || !LL_USART_IsActiveFlag_TC(usart)) &&
+           k_uptime_get() < end) {
+        k_msleep(1);
+    }
+#endif
+}
+
+static uint32_t current_baud(void)
+{
+    struct uart_config cfg;
+
+    return uart_config_get(shell_uart, &cfg) == 0 ? cfg.baudrate : 0;
+}
+
+static void switch_handler(struct k_work *work)
+{
+    k_mutex_lock(&speed_lock, K_FOREVER);
+    drain_tx();
+    if (pending && set_baud(pending) == 0) {
+        k_work_schedule(&revert_work, K_MSEC(UART_CONFIRM_MS));
+    } else {
+        pending = 0;
+    }
+    k_mutex_unlock(&speed_lock);
+}
+
+static void revert_handler(struct k_work *work)
+{
+    k_mutex_lock(&speed_lock, K_FOREVER);
+    if (pending) {
+        printk("UART_BAUD %u, %u was not confirmed\n", confirmed, pending);
+        pending = 0;
+        // The message goes out at the rate the host failed to follow
+        drain_tx();
+        set_baud(confirmed);
+    }
+    k_mutex_unlock(&speed_lock);
+}
+
+static bool supported(uint32_t baud)
+{
+    for (size_t i = 0; i < ARRAY_SIZE(rates); i++) {
+        if (rates[i] == baud) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static int cmd_uart_baud(const struct shell *shell, size_t argc, char **argv)
+{
+    if (argc < 2) {
+        shell_print(shell, "UART_BAUD %u (boot %u, confirmed %u)", current_baud(),
+                    UART_DEFAULT_BAUD, confirmed);
+        for (size_t i = 0; i < ARRAY_SIZE(rates); i++) {
+            shell_fprintf(shell, SHELL_NORMAL, "%s%u", i ? " " : "supported: ", rates[i]);
+        }
+        shell_fprintf(shell, SHELL_NORMAL, "\n");
+        return 0;
+    }
+
+    uint32_t baud = strtoul(argv[1], NULL, 10);
+    if (!supported(baud)) {
+        shell_error(shell, "Usage: uart_baud [rate], see uart_baud for the rates");
+        return -EINVAL;
+    }
+
+    k_mutex_lock(&speed_lock, K_FOREVER);
+    int rc = 0;
+    if (pending) {
+        shell_error(shell, "Switch to %u still waiting for uart_baud_confirm", pending);
+        rc = -EBUSY;
+    } else if (baud == current_baud()) {
+        confirmed = baud;
+        shell_print(shell, "UART_BAUD %u", baud);
+    } else {
+        pending = baud;
+        k_work_schedule(&switch_work, K_MSEC(UART_SWITCH_DELAY_MS));
+        shell_print(shell, "UART_BAUD %u in %d ms, confirm within %d ms", baud,
+                    UART_SWITCH_DELAY_MS, UART_CONFIRM_MS);
+    }
+    k_mutex_unlock(&speed_lock);
+    return rc;
+}
+
+static int cmd_uart_baud_confirm(const struct shell *shell, size_t argc, char **argv)
+{
+    k_mutex_lock(&speed_lock, K_FOREVER);
+    uint32_t baud = pending;
+    if (baud) {
+        k_work_cancel_delayable(&revert_work);
+        confirmed = baud;
+        pending = 0;
+    }
+    k_mutex_unlock(&speed_lock);
+
+    if (!baud) {
+        shell_error(shell, "No rate change to confirm");
+        return -EALREADY;
+    }
+    shell_print(shell, "UART_BAUD_OK %u", baud);
+    return 0;
+}
+
+// Prints about `bytes` of filler, a line per UART_FLOOD_LINE. Shell writes
+// return once their transfer is done, so the time is what the link sustains
+static int cmd_uart_flood(const struct shell *shell, size_t argc, char **argv)
+{
+    uint32_t bytes = argc > 1 ? strtoul(argv[1], NULL, 10) : 16384;
+    char line[UART_FLOOD_LINE];
+
+    memset(line, 'U', sizeof(line) - 1);
+    line[sizeof(line) - 1] = '\0';
+
+    uint32_t lines = bytes / UART_FLOOD_LINE;
+    int64_t start = k_uptime_get();
+    for (uint32_t i = 0; i < lines; i++) {
+        shell_print(shell, "%s", line);
+    }
+    uint32_t ms = (uint32_t)(k_uptime_get() - start);
+
+    shell_print(shell, "UART_FLOOD %u lines in %u ms at %u baud", lines, ms, current_baud());
+    return 0;
+}
+
+SHELL_CMD_REGISTER(uart_baud, NULL, "Show or change the shell UART rate [rate], confirm after", cmd_uart_baud);
+SHELL_CMD_REGISTER(uart_baud_confirm, NULL, "Keep the rate set by uart_baud", cmd_uart_baud_confirm);
+SHELL_CMD_REGISTER(uart_flood, NULL, "Print filler to measure the shell UART throughput [bytes]", cmd_uart_flood);
@@ -1,4 +1,5 @@
 #include "wifi.h"
+#include "perf.h"
 #include <zephyr/net/wifi_mgmt.h>
 
 #include <zephyr/fs/fs.h>
@@ -16,6 +17,10 @@ static int cmd_wifi_connect(const struct shell *shell, size_t argc, char **argv)
         shell_error(shell, "Usage: wifi_connect <ssid> <password>");
         return -EINVAL;
     }
+#ifndef CONFIG_WIFI
+    shell_error(shell, "WiFi is not available on this board");
+    return -ENOTSUP;
+#else
     wifi_params.ssid = (const uint8_t *)argv[1];
     wifi_params.ssid_length = strlen(argv[1]);
     wifi_params.psk = (const uint8_t *)argv[2];
@@ -36,6 +41,7 @@ static int cmd_wifi_connect(const struct shell *shell, size_t argc, char **argv)
         shell_print(shell, "Connecting to WiFi...");
     }
     return ret;
+#endif
 }
 
 static void cmd_wifi_save (const struct shell *shell, size_t argc, char **argv){
@@ -68,10 +74,14 @@ void wifi_mgmt_event_handler(struct net_mgmt_event_callback *cb, uint32_t mgmt_e
 {
     if (mgmt_event == NET_EVENT_IPV4_ADDR_ADD) {
         char buf[NET_IPV4_ADDR_LEN];
+        if (!wifi_is_ready) {
+            perf_boot_mark("network up");
+        }
         wifi_is_ready = true; 
     }
 }
 
+// wifi.conf is "<ssid>\n<password>\n", small enough to read in one go
 void read_wifi_config() {
     struct fs_file_t file;
     fs_file_t_init(&file);
@@ -81,75 +91,73 @@ void read_wifi_config() {
         return;
     }
 
-    char _ssid[128];
-    char _password[128];
-    
-    uint8_t _ssid_len;
-    uint8_t _password_len;
-
-    char buf[64];
-    char * b = &buf;
-    int len = 0;
-    bool next = false;
-    while ((len = fs_read(&file, b, 1)) > 0) {
-        if (*b == '\n') {
-            *b = '\0'; // Null-terminate the string
-            if (!next) {
-                _ssid_len = strlen(buf);
-                if (_ssid_len > 0) {
-                    strncpy(_ssid, buf, sizeof(_ssid) - 1);
-                    _ssid[_ssid_len] = '\0';
-                    next = true;
-                    b = &buf[0]; // Reset buffer pointer
-                    continue;
-                }
-            } else {
-                _password_len = strlen(buf);
-                if (_password_len > 0) {
-                    strncpy(_password, buf, sizeof(_password) - 1);
-                    _password[_password_len] = '\0';
-                }
-                break; 
-            }
-        }
-        b++;
+    char buf[sizeof(ssid) + sizeof(password) + 2];
+    ssize_t len = fs_read(&file, buf, sizeof(buf) - 1);
+    fs_close(&file);
+    if (len <= 0) {
+        printk("Failed to read WiFi config file: %d\n", (int)len);
+        return;
+    }
+    buf[len] = '\0';
 
+    char *pass = strchr(buf, '\n');
+    if (!pass || pass == buf || pass - buf >= sizeof(ssid)) {
+        printk("Bad SSID line in %s\n", WIFI_CONFIG_FILE);
+        return;
     }
-    strcpy(ssid, _ssid);
-    strcpy(password, _password);
-    fs_close(&file);
-    return; 
+    *pass++ = '\0';
+    pass[strcspn(pass, "\r\n")] = '\0';
+    if (strlen(pass) >= sizeof(password)) {
+        printk("Bad password line in %s\n", WIFI_CONFIG_FILE);
+        return;
+    }
+    strcpy((char *)ssid, buf);
+    strcpy((char *)password, pass);
 }
 
-void wifi_connect_to_saved_network() {
+int wifi_connect_to_saved_network() {
+#ifdef CONFIG_WIFI
     read_wifi_config();
-    if (ssid && password) {
-        wifi_params.ssid = (const uint8_t *)ssid;
-        wifi_params.ssid_length = strlen(ssid);
-        wifi_params.psk = (const uint8_t *)password;
-        wifi_params.psk_length = strlen(password);
-        wifi_params.security = WIFI_SECURITY_TYPE_PSK;
-        wifi_params.channel = WIFI_CHANNEL_ANY;
-
-        iface = net_if_get_default();
-        if (!iface) {
-            //shell_error(shell, "Could not get default network interface");
-            return -ENODEV;
-        }
-
-        int ret = net_mgmt(NET_REQUEST_WIFI_CONNECT, iface, &wifi_params, sizeof(struct wifi_connect_req_params));
-        if (ret) {
-            //shell_error(shell, "Failed to connect to WiFi: %d", ret);
-        } else {
-            //shell_print(shell, "Connecting to WiFi...");
-        }
-        return;
-        //return ret;
-    } else {
+    if (ssid[0] == '\0') {
         printk("No saved WiFi credentials found.\n");
+        return -ENOENT;
     }
+    wifi_params.ssid = (const uint8_t *)ssid;
+    wifi_params.ssid_length = strlen((const char *)ssid);
+    wifi_params.psk = (const uint8_t *)password;
+    wifi_params.psk_length = strlen((const char *)password);
+    wifi_params.security = WIFI_SECURITY_TYPE_PSK;
+    wifi_params.channel = WIFI_CHANNEL_ANY;
+
+    iface = net_if_get_default();
+    if (!iface) {
+        return -ENODEV;
+    }
+
+    int ret = net_mgmt(NET_REQUEST_WIFI_CONNECT, iface, &wifi_params, sizeof(struct wifi_connect_req_params));
+    if (ret) {
+        printk("Failed to connect to WiFi: %d\n", ret);
+    }
+    return ret;
+#else
+    return 0; // Boards without a WiFi module (native_sim) use the host network as is
+#endif
 }
 
+// The eS-WiFi connect request blocks for seconds on the SPI link, so at boot
+// it runs as a work item and main goes on without waiting for it. It needs
+// no stack of its own; session ticks that come due meanwhile queue behind it
+static void wifi_boot_handler(struct k_work *work)
+{
+    int ret = wifi_connect_to_saved_network();
+    perf_boot_mark(ret == 0 ? "wifi connect requested" : "wifi connect failed");
+}
+
+static K_WORK_DEFINE(wifi_boot_work, wifi_boot_handler);
+
+void wifi_connect_in_background() {
+    k_work_submit(&wifi_boot_work);
+}
 
 SHELL_CMD_REGISTER(wifi_connect, NULL, "Connect to WiFi", cmd_wifi_connect);
 SHELL_CMD_REGISTER(wifi_save, NULL, "Save WiFi credentials to file", cmd_wifi_save);
@@ -0,0 +1,96 @@
+"""Checks the bench_* and fsbench shell commands (src/bench.c) on native_sim,
+and the step log on the emulated LSM6DSL pedometer and FIFO.
+
+Twister builds the firmware, starts it and hands the shell to these tests,
+see zephyr/testcase.yaml. Every benchmark has to complete without errors
+and report numbers that are consistent with each other.
+"""
+import json
+import re
+import time
+
+from twister_harness import Shell
+
+BENCH = re.compile(r'BENCH (\{.*\})')
+I2C_SENSORS = ("hts221", "lps22hb", "lis3mdl", "lsm6dsl", "vl53l0x")
+
+
+def bench(shell: Shell, command: str, timeout: float = 60, ignore: tuple = ()) -> list:
+    lines = shell.exec_command(command, timeout=timeout)
+    failures = [line for line in lines if ("failed" in line or "Timed out" in line)
+                and not any(name in line for name in ignore)]
+    assert not failures, f"{command}: {failures}"
+    return [json.loads(m.group(1)) for m in map(BENCH.search, lines) if m]
+
+
+def check_cycles(result: dict, n: int):
+    assert result["n"] == n, result
+    assert result["cyc_min"] <= result["cyc_avg"] <= result["cyc_max"], result
+    assert result["cyc_max"] > 0, result
+
+
+def test_bench_read(shell: Shell):
+    # orientation only has a value while fusion runs
+    results = {r["id"]: r for r in bench(shell, "bench_read 20", ignore=("orientation",))}
+    for sensor in I2C_SENSORS:
+        check_cycles(results[sensor], 20)
+
+
+def test_bench_http(shell: Shell):
+    (result,) = bench(shell, "bench_http 100")
+    assert result["bench"] == "http_build"
+    check_cycles(result, 100)
+
+
+def test_bench_fs(shell: Shell):
+    results = bench(shell, "bench_fs 64 32")
+    assert [r["flush"] for r in results] == [0, 1, 8, 32, 128]
+    for r in results:
+        assert r["records"] == 64 and r["rec_size"] == 32, r
+        assert r["us"] > 0 and r["records_per_s"] > 0, r
+    # Keeping the file open has to beat an open and close per record
+    assert results[-1]["records_per_s"] > results[0]["records_per_s"], results
+
+
+def test_bench_e2e(shell: Shell):
+    (result,) = bench(shell, "bench_e2e lsm6dsl 20 25")
+    check_cycles(result, 25)
+    # Each sample is handled well within its period
+    assert result["us_avg"] < 20000, result
+
+
+def test_fsbench(shell: Shell):
+    results = bench(shell, "fsbench logging 4096", timeout=120)
+    rows = [r for r in results if r["bench"] == "fsbench"]
+    assert results[-1]["bench"] == "fsbench_done", results
+    assert {(r["op"], r["size"]) for r in rows} == {
+        (op, size) for op in ("write", "read", "open_append") for size in (16, 64, 256, 1024)}
+    for r in rows:
+        assert r["profile"] == "logging" and r["bytes_per_s"] > 0, r
+        assert r["p50_us"] <= r["p90_us"] <= r["p99_us"] <= r["max_us"], r
+
+
+def test_step_log(shell: Shell):
+    shell.exec_command("rm steps_test.csv")
+    shell.exec_command("stats_reset")
+    assert any("Started" in line for line in shell.exec_command("lsm6dsl_step_start steps_test.csv"))
+    # The emulator walks at 1.8 steps/s, past the 16 step watermark before
+    # the 10 s drain timer would empty the FIFO
+    time.sleep(12)
+    stats = [json.loads(line) for line in shell.exec_command("stats_dump") if line.startswith("{")]
+    (lsm6dsl,) = [s for s in stats if s.get("sensor") == "lsm6dsl"]
+    assert lsm6dsl["ticks"] >= 1, lsm6dsl  # INT1 at the watermark
+
+    stop = shell.exec_command("lsm6dsl_step_stop")
+    logged = int(re.search(r"(\d+) steps logged", "\n".join(stop)).group(1))
+    assert logged >= 16, stop
+
+    records = [line.split(",") for line in shell.exec_command("cat steps_test.csv")
+               if line.startswith("step,")]
+    hw_ms = [int(r[1]) for r in records]
+    steps = [int(r[2]) for r in records]
+    assert sum(int(r[3]) for r in records) == logged, records
+    assert steps == sorted(set(steps)) and steps[-1] == logged, records
+    assert hw_ms == sorted(hw_ms), records
+    # A step every 5000/9 ms on the sensor clock
+    assert abs((hw_ms[-1] - hw_ms[0]) - (len(hw_ms) - 1) * 5000 / 9) < 50, records